@@ -47,6 +47,24 @@
 
 #define OMX_TIZONIA_PORTSTATUS_AWAITBUFFERSRETURN   0x00000004
 
+/**
+ * OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION
+ *
+ * Set by a source component on the first buffer it emits after the stream has
+ * been repositioned via OMX_TizoniaIndexConfigStreamPosition. Buffers received
+ * before the one carrying this flag belong to the previous stream position.
+ */
+#define OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION       0x00010000
+
+/**
+ * OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR
+ *
+ * Set by a source component, instead of OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION,
+ * when the requested stream position could not be reached. The stream carries
+ * on from where it was before the request.
+ */
+#define OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR  0x00020000
+
 /**
  * OMX_TizoniaIndexParamBufferPreAnnouncementsMode
  *
@@ -75,6 +93,7 @@
 #define OMX_TizoniaIndexParamAudioDeezerSession      OMX_IndexVendorStartUnused + 19 /**< reference: OMX_TIZONIA_AUDIO_PARAM_DEEZERSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioDeezerPlaylist     OMX_IndexVendorStartUnused + 20 /**< reference: OMX_TIZONIA_AUDIO_PARAM_DEEZERPLAYLISTTYPE */
 #define OMX_TizoniaIndexParamChromecastSession       OMX_IndexVendorStartUnused + 21 /**< reference: OMX_TIZONIA_PARAM_CHROMECASTSESSIONTYPE */
+#define OMX_TizoniaIndexConfigStreamPosition         OMX_IndexVendorStartUnused + 22 /**< reference: OMX_TIZONIA_STREAMPOSITIONTYPE */
 
 /**
  * OMX_AUDIO_CODINGTYPE extensions
@@ -316,6 +335,22 @@ typedef struct OMX_TIZONIA_PLAYLISTSKIPTYPE {
     OMX_S32 nValue;              /** Can be a positive or a negative value. Wrap-around use cases are allowed. */
 } OMX_TIZONIA_PLAYLISTSKIPTYPE;
 
+/**
+ * Byte-level stream repositioning, requested from a source component by a
+ * downstream component (e.g. a demuxer serving a seek from its cues). Only
+ * sources that can reposition support this index; OMX_GetConfig fails on the
+ * others. The outcome is signalled on the next buffer emitted, with either
+ * OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION or
+ * OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR.
+ */
+
+typedef struct OMX_TIZONIA_STREAMPOSITIONTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U64 nOffset;             /** Absolute byte offset from the start of the stream. */
+} OMX_TIZONIA_STREAMPOSITIONTYPE;
+
 /**
  * Google Play Music source component
  * References:
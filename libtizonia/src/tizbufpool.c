@@ -0,0 +1,305 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizbufpool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Process-wide pool of port buffers
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <tizplatform.h>
+
+#include "tizbufpool.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.bufpool"
+#endif
+
+#define TIZ_BUFPOOL_MAGIC 0x54425046 /* "TBPF" */
+#define TIZ_BUFPOOL_DEFAULT_MAX_BYTES (64 * 1024 * 1024)
+#define TIZ_BUFPOOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Size classes: everything up to 4 KiB goes into one class; above that,
+   each power-of-two interval is split in four classes, so that at most 25%
+   of a payload is wasted. Payloads above 64 MiB are not cached. */
+#define TIZ_BUFPOOL_MIN_CLASS_SHIFT 12
+#define TIZ_BUFPOOL_MAX_CLASS_SHIFT 26
+#define TIZ_BUFPOOL_STEPS_PER_SHIFT 4
+#define TIZ_BUFPOOL_NCLASSES                                           \
+  (1 + (TIZ_BUFPOOL_MAX_CLASS_SHIFT - TIZ_BUFPOOL_MIN_CLASS_SHIFT) \
+         * TIZ_BUFPOOL_STEPS_PER_SHIFT)
+
+/* Every payload is immediately preceded by this header, padded to
+   TIZ_BUFPOOL_ALIGNMENT bytes. For huge-page payloads, the header sits at the
+   end of a leading huge page, so that the payload itself starts on a huge
+   page boundary; p_mem is the start of the allocation in both cases. */
+typedef struct tiz_bufpool_hdr tiz_bufpool_hdr_t;
+struct tiz_bufpool_hdr
+{
+  tiz_bufpool_hdr_t * p_next;
+  void * p_mem;
+  size_t capacity;
+  OMX_S32 class_idx; /* -1 for payloads that are never cached */
+  OMX_U32 magic;
+};
+
+typedef char tiz_bufpool_hdr_fits_check
+  [sizeof (tiz_bufpool_hdr_t) <= TIZ_BUFPOOL_ALIGNMENT ? 1 : -1];
+
+typedef struct tiz_bufpool tiz_bufpool_t;
+struct tiz_bufpool
+{
+  pthread_mutex_t mutex;
+  tiz_bufpool_hdr_t * p_free[TIZ_BUFPOOL_NCLASSES];
+  size_t cached_bytes;
+  size_t max_bytes;
+  bool huge_pages;
+  unsigned long hits;
+  unsigned long misses;
+};
+
+static tiz_bufpool_t g_pool = {PTHREAD_MUTEX_INITIALIZER};
+static pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+static void
+init_pool (void)
+{
+  const char * p_max
+    = tiz_rcfile_get_value ("ilcore", "buffer-pool-max-bytes");
+  g_pool.max_bytes
+    = p_max ? strtoul (p_max, NULL, 10) : TIZ_BUFPOOL_DEFAULT_MAX_BYTES;
+  g_pool.huge_pages
+    = (0 == tiz_rcfile_compare_value ("ilcore", "buffer-pool-huge-pages",
+                                      "true"));
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "max bytes [%lu] huge pages [%s]",
+           (unsigned long) g_pool.max_bytes,
+           g_pool.huge_pages ? "YES" : "NO");
+}
+
+/* Returns the class index for a_size, and the capacity of the class in
+   ap_capacity, or -1 if payloads of this size are not cached. */
+static OMX_S32
+size_class (const size_t a_size, size_t * ap_capacity)
+{
+  size_t shift = TIZ_BUFPOOL_MIN_CLASS_SHIFT;
+  size_t step = 0;
+  size_t capacity = 0;
+
+  assert (ap_capacity);
+
+  if (a_size <= ((size_t) 1 << TIZ_BUFPOOL_MIN_CLASS_SHIFT))
+    {
+      *ap_capacity = (size_t) 1 << TIZ_BUFPOOL_MIN_CLASS_SHIFT;
+      return 0;
+    }
+
+  if (a_size > ((size_t) 1 << TIZ_BUFPOOL_MAX_CLASS_SHIFT))
+    {
+      *ap_capacity = (a_size + TIZ_BUFPOOL_ALIGNMENT - 1)
+                     & ~((size_t) TIZ_BUFPOOL_ALIGNMENT - 1);
+      return -1;
+    }
+
+  /* a_size is in (2^shift, 2^(shift+1)] */
+  while (((size_t) 1 << (shift + 1)) < a_size)
+    {
+      ++shift;
+    }
+  step = ((size_t) 1 << shift) / TIZ_BUFPOOL_STEPS_PER_SHIFT;
+  capacity = (a_size + step - 1) / step * step;
+  *ap_capacity = capacity;
+
+  /* capacity / step is in [5, 8] */
+  return 1 + (shift - TIZ_BUFPOOL_MIN_CLASS_SHIFT) * TIZ_BUFPOOL_STEPS_PER_SHIFT
+         + (capacity / step - (TIZ_BUFPOOL_STEPS_PER_SHIFT + 1));
+}
+
+static tiz_bufpool_hdr_t *
+new_payload (const size_t a_capacity, const OMX_S32 a_class_idx)
+{
+  tiz_bufpool_hdr_t * p_hdr = NULL;
+  size_t alignment = TIZ_BUFPOOL_ALIGNMENT;
+  size_t offset = TIZ_BUFPOOL_ALIGNMENT; /* from p_mem to the payload */
+  size_t total = 0;
+  void * p_mem = NULL;
+
+  if (g_pool.huge_pages && a_capacity >= TIZ_BUFPOOL_HUGE_PAGE_SIZE)
+    {
+      alignment = TIZ_BUFPOOL_HUGE_PAGE_SIZE;
+      offset = TIZ_BUFPOOL_HUGE_PAGE_SIZE;
+    }
+  total = offset + ((a_capacity + alignment - 1) & ~(alignment - 1));
+
+  if (0 != posix_memalign (&p_mem, alignment, total))
+    {
+      return NULL;
+    }
+
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+  if (alignment == TIZ_BUFPOOL_HUGE_PAGE_SIZE)
+    {
+      /* Only the header's page is ever touched in the leading huge page;
+         don't let it be backed by a huge page of its own */
+      (void) madvise (p_mem, offset, MADV_NOHUGEPAGE);
+      (void) madvise ((OMX_U8 *) p_mem + offset, total - offset,
+                      MADV_HUGEPAGE);
+    }
+#endif
+
+  p_hdr = (tiz_bufpool_hdr_t *) ((OMX_U8 *) p_mem + offset
+                                 - TIZ_BUFPOOL_ALIGNMENT);
+  p_hdr->p_next = NULL;
+  p_hdr->p_mem = p_mem;
+  p_hdr->capacity = a_capacity;
+  p_hdr->class_idx = a_class_idx;
+  p_hdr->magic = TIZ_BUFPOOL_MAGIC;
+  return p_hdr;
+}
+
+static inline OMX_U8 *
+payload_of (tiz_bufpool_hdr_t * ap_hdr)
+{
+  return (OMX_U8 *) ap_hdr + TIZ_BUFPOOL_ALIGNMENT;
+}
+
+static inline tiz_bufpool_hdr_t *
+header_of (OMX_PTR ap_buf)
+{
+  return (tiz_bufpool_hdr_t *) ((OMX_U8 *) ap_buf - TIZ_BUFPOOL_ALIGNMENT);
+}
+
+OMX_U8 *
+tiz_bufpool_alloc (const size_t a_size)
+{
+  tiz_bufpool_hdr_t * p_hdr = NULL;
+  size_t capacity = 0;
+  OMX_S32 class_idx = 0;
+
+  assert (a_size > 0);
+
+  (void) pthread_once (&g_pool_once, init_pool);
+
+  class_idx = size_class (a_size, &capacity);
+  if (class_idx >= 0)
+    {
+      (void) pthread_mutex_lock (&g_pool.mutex);
+      if ((p_hdr = g_pool.p_free[class_idx]))
+        {
+          g_pool.p_free[class_idx] = p_hdr->p_next;
+          g_pool.cached_bytes -= p_hdr->capacity;
+          ++g_pool.hits;
+        }
+      else
+        {
+          ++g_pool.misses;
+        }
+      (void) pthread_mutex_unlock (&g_pool.mutex);
+    }
+
+  if (!p_hdr)
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "new payload size [%lu] capacity [%lu]",
+               (unsigned long) a_size, (unsigned long) capacity);
+      p_hdr = new_payload (capacity, class_idx);
+    }
+
+  if (!p_hdr)
+    {
+      return NULL;
+    }
+
+  p_hdr->p_next = NULL;
+  return payload_of (p_hdr);
+}
+
+void
+tiz_bufpool_free (OMX_PTR ap_buf)
+{
+  tiz_bufpool_hdr_t * p_hdr = NULL;
+
+  if (!ap_buf)
+    {
+      return;
+    }
+
+  p_hdr = header_of (ap_buf);
+  assert (TIZ_BUFPOOL_MAGIC == p_hdr->magic);
+
+  if (p_hdr->class_idx >= 0)
+    {
+      (void) pthread_mutex_lock (&g_pool.mutex);
+      if (g_pool.cached_bytes + p_hdr->capacity <= g_pool.max_bytes)
+        {
+          p_hdr->p_next = g_pool.p_free[p_hdr->class_idx];
+          g_pool.p_free[p_hdr->class_idx] = p_hdr;
+          g_pool.cached_bytes += p_hdr->capacity;
+          p_hdr = NULL;
+        }
+      (void) pthread_mutex_unlock (&g_pool.mutex);
+    }
+
+  /* Not cacheable, or the cache is full */
+  if (p_hdr)
+    {
+      free (p_hdr->p_mem);
+    }
+}
+
+void
+tiz_bufpool_trim (void)
+{
+  tiz_bufpool_hdr_t * p_lists[TIZ_BUFPOOL_NCLASSES];
+  size_t i = 0;
+
+  (void) pthread_mutex_lock (&g_pool.mutex);
+  for (i = 0; i < TIZ_BUFPOOL_NCLASSES; ++i)
+    {
+      p_lists[i] = g_pool.p_free[i];
+      g_pool.p_free[i] = NULL;
+    }
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "cached [%lu] hits [%lu] misses [%lu]",
+           (unsigned long) g_pool.cached_bytes, g_pool.hits, g_pool.misses);
+  g_pool.cached_bytes = 0;
+  (void) pthread_mutex_unlock (&g_pool.mutex);
+
+  /* Free outside the lock */
+  for (i = 0; i < TIZ_BUFPOOL_NCLASSES; ++i)
+    {
+      while (p_lists[i])
+        {
+          tiz_bufpool_hdr_t * p_next = p_lists[i]->p_next;
+          free (p_lists[i]->p_mem);
+          p_lists[i] = p_next;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizbufpool.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Process-wide pool of port buffers
+ *
+ *
+ */
+
+#ifndef TIZBUFPOOL_H
+#define TIZBUFPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizbufpool 'tizbufpool' : Recycling pool of buffer payloads
+ *
+ * A process-wide cache of buffer payloads, organised in size classes, that
+ * backs the default port allocation hooks. Payloads released by a port (on
+ * port disable, or when a component is unloaded) are kept and handed out
+ * again to the next port that needs a buffer of the same size class, so
+ * that port reconfigurations and graph rebuilds don't pay for fresh,
+ * zero-filled pages every time.
+ *
+ * Payloads are always aligned to (at least) 64 bytes and are NOT zeroed.
+ * Optionally, payloads of 2 MiB or more are aligned to 2 MiB and backed by
+ * transparent huge pages.
+ *
+ * The pool is configured from the [ilcore] section of tizonia.conf:
+ * - buffer-pool-max-bytes: maximum number of bytes kept in the cache
+ *   (0 disables caching).
+ * - buffer-pool-huge-pages: whether large payloads are backed by huge pages.
+ *
+ * @ingroup libtizonia
+ */
+
+#include <stddef.h>
+
+#include <OMX_Types.h>
+
+/**
+ * The alignment of all payloads handed out by the pool.
+ * @ingroup tizbufpool
+ */
+#define TIZ_BUFPOOL_ALIGNMENT 64
+
+/**
+ * Obtain a payload of at least the requested size. Thread-safe.
+ *
+ * @ingroup tizbufpool
+ * @param a_size The size of the payload, in bytes.
+ * @return A TIZ_BUFPOOL_ALIGNMENT-aligned, non-zeroed payload, or NULL if
+ * memory is exhausted.
+ */
+OMX_U8 *
+tiz_bufpool_alloc (const size_t a_size);
+
+/**
+ * Return a payload to the pool. Thread-safe.
+ *
+ * @ingroup tizbufpool
+ * @param ap_buf A payload obtained with @ref tiz_bufpool_alloc (may be
+ * NULL).
+ */
+void
+tiz_bufpool_free (OMX_PTR ap_buf);
+
+/**
+ * Release all the payloads currently cached. Thread-safe.
+ *
+ * @ingroup tizbufpool
+ */
+void
+tiz_bufpool_trim (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZBUFPOOL_H */
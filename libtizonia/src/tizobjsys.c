@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <tizplatform.h>
 
@@ -85,11 +86,17 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.objsys"
 #endif
 
+#define TIZ_OS_HASH_SIZE 256
+
 struct tiz_os
 {
-  tiz_map_t * p_map;
+  tiz_map_t * p_map; /* plugin-specific types */
   OMX_HANDLETYPE p_hdl;
   tiz_soa_t * p_soa;
+  void ** pp_types; /* this component's copies of the base types, by type id */
+  OMX_U8 * p_arena;
+  size_t arena_size;
+  bool building;
 };
 
 typedef enum tiz_os_type tiz_os_type_t;
@@ -177,6 +184,7 @@ enum tiz_os_type
   ETIZUricfgport,
   ETIZDemuxercfgport_class,
   ETIZDemuxercfgport,
+  ETIZTypeMax
 };
 
 #define TIZ_OS_BASE_TYPE_END ETIZConfigport
@@ -358,6 +366,195 @@ static tiz_os_type_str_t tiz_os_type_to_str_tbl[] = {
   {ETIZDemuxercfgport, "tizdemuxercfgport"},
 };
 
+/* The base types are immutable once built, so they are constructed once per
+   process and each component gets a copy of them. The copy is needed, as
+   handleOf () and typeOf () find the component through the class object, but
+   it is a relocated memcpy of the prototypes instead of a run of every class
+   constructor. */
+typedef struct tiz_os_registry tiz_os_registry_t;
+struct tiz_os_registry
+{
+  pthread_mutex_t mutex;
+  void * p_protos[ETIZTypeMax];
+  size_t arena_offsets[TIZ_OS_BASE_TYPE_END + 1];
+  size_t base_types_size;
+  OMX_S16 hash_tbl[TIZ_OS_HASH_SIZE];
+};
+
+static tiz_os_registry_t g_registry;
+static pthread_once_t g_registry_once = PTHREAD_ONCE_INIT;
+
+static OMX_U32
+os_hash (const char * ap_str)
+{
+  /* FNV-1a */
+  OMX_U32 hash = 2166136261u;
+  while (*ap_str)
+    {
+      hash ^= (OMX_U8) *ap_str++;
+      hash *= 16777619u;
+    }
+  return hash;
+}
+
+static void
+init_registry (void)
+{
+  OMX_S32 type_id = 0;
+  (void) pthread_mutex_init (&g_registry.mutex, NULL);
+  (void) memset (g_registry.hash_tbl, 0xff, sizeof (g_registry.hash_tbl));
+  for (type_id = 0; type_id < ETIZTypeMax; ++type_id)
+    {
+      OMX_U32 slot = os_hash (tiz_os_type_to_str_tbl[type_id].str)
+                     & (TIZ_OS_HASH_SIZE - 1);
+      while (g_registry.hash_tbl[slot] >= 0)
+        {
+          slot = (slot + 1) & (TIZ_OS_HASH_SIZE - 1);
+        }
+      g_registry.hash_tbl[slot] = type_id;
+    }
+}
+
+static OMX_S32
+os_type_id (const char * a_type_name)
+{
+  OMX_U32 slot = os_hash (a_type_name) & (TIZ_OS_HASH_SIZE - 1);
+  OMX_S32 type_id = -1;
+  while ((type_id = g_registry.hash_tbl[slot]) >= 0)
+    {
+      if (0 == strncmp (a_type_name, tiz_os_type_to_str_tbl[type_id].str,
+                        OMX_MAX_STRINGNAME_SIZE))
+        {
+          return type_id;
+        }
+      slot = (slot + 1) & (TIZ_OS_HASH_SIZE - 1);
+    }
+  return -1;
+}
+
+static OMX_S32
+os_proto_id (const void * ap_proto)
+{
+  OMX_S32 type_id = 0;
+  for (type_id = 0; type_id < ETIZTypeMax; ++type_id)
+    {
+      if (g_registry.p_protos[type_id] == ap_proto)
+        {
+          return type_id;
+        }
+    }
+  return -1;
+}
+
+static inline size_t
+os_arena_slot_size (const void * ap_proto)
+{
+  return (sizeOf (ap_proto) + 15) & ~((size_t) 15);
+}
+
+/* Must be called with the registry mutex held and ap_os->building set; the
+   type init functions look up their super classes through ap_os, which then
+   hands out prototypes */
+static void *
+build_prototype (tiz_os_t * ap_os, const OMX_S32 a_type_id)
+{
+  assert (ap_os);
+  assert (ap_os->building);
+  assert (a_type_id >= 0 && a_type_id < ETIZTypeMax);
+  if (!g_registry.p_protos[a_type_id])
+    {
+      TIZ_TRACE (ap_os->p_hdl, "Building type #[%d] : [%s]", a_type_id,
+                 tiz_os_type_to_str_tbl[a_type_id].str);
+      g_registry.p_protos[a_type_id]
+        = tiz_os_type_to_fnt_tbl[a_type_id](ap_os, ap_os->p_hdl);
+    }
+  return g_registry.p_protos[a_type_id];
+}
+
+static bool
+ensure_prototypes (tiz_os_t * ap_os, const OMX_S32 a_first_id,
+                   const OMX_S32 a_last_id)
+{
+  bool built = true;
+  OMX_S32 type_id = 0;
+  assert (ap_os);
+  (void) pthread_mutex_lock (&g_registry.mutex);
+  ap_os->building = true;
+  for (type_id = a_first_id; type_id <= a_last_id && built; ++type_id)
+    {
+      built = (NULL != build_prototype (ap_os, type_id));
+    }
+  if (built && 0 == g_registry.base_types_size
+      && a_last_id >= TIZ_OS_BASE_TYPE_END)
+    {
+      for (type_id = 0; type_id <= TIZ_OS_BASE_TYPE_END; ++type_id)
+        {
+          g_registry.arena_offsets[type_id] = g_registry.base_types_size;
+          g_registry.base_types_size
+            += os_arena_slot_size (g_registry.p_protos[type_id]);
+        }
+    }
+  ap_os->building = false;
+  (void) pthread_mutex_unlock (&g_registry.mutex);
+  return built;
+}
+
+static void *
+clone_type (tiz_os_t * ap_os, const OMX_S32 a_type_id);
+
+static void *
+clone_type_ref (tiz_os_t * ap_os, const void * ap_proto)
+{
+  const OMX_S32 type_id = os_proto_id (ap_proto);
+  assert (type_id >= 0);
+  return ap_os->pp_types[type_id] ? ap_os->pp_types[type_id]
+                                  : clone_type (ap_os, type_id);
+}
+
+/* Copies a prototype into this component, and relocates its class and super
+   class pointers to this component's copies. Base types go in their slot of
+   the arena, the rest get their own allocation. */
+static void *
+clone_type (tiz_os_t * ap_os, const OMX_S32 a_type_id)
+{
+  const tiz_class_t * p_proto = NULL;
+  tiz_class_t * p_type = NULL;
+
+  assert (ap_os);
+  assert (a_type_id >= 0 && a_type_id < ETIZTypeMax);
+  assert (!ap_os->pp_types[a_type_id]);
+
+  p_proto = g_registry.p_protos[a_type_id];
+  assert (p_proto);
+
+  p_type = (a_type_id <= TIZ_OS_BASE_TYPE_END && ap_os->p_arena)
+             ? (void *) (ap_os->p_arena
+                         + g_registry.arena_offsets[a_type_id])
+             : tiz_mem_alloc (sizeOf (p_proto));
+  if (p_type)
+    {
+      (void) memcpy (p_type, p_proto, sizeOf (p_proto));
+      p_type->tos = ap_os;
+      p_type->hdl = ap_os->p_hdl;
+      /* Registered before the references are followed, as tizclass and
+         tizobject refer to each other */
+      ap_os->pp_types[a_type_id] = p_type;
+      {
+        const void * p_class = clone_type_ref (ap_os, p_proto->_.class);
+        memcpy ((char *) p_type, (char *) &p_class, sizeof (tiz_class_t *));
+      }
+      p_type->super = clone_type_ref (ap_os, p_proto->super);
+    }
+  return p_type;
+}
+
+static inline bool
+in_arena (const tiz_os_t * ap_os, const void * ap_addr)
+{
+  return ap_os->p_arena && (const OMX_U8 *) ap_addr >= ap_os->p_arena
+         && (const OMX_U8 *) ap_addr < ap_os->p_arena + ap_os->arena_size;
+}
+
 static /*@null@ */ void *
 os_calloc (/*@null@ */ tiz_soa_t * p_soa, size_t a_size)
 {
@@ -423,8 +620,18 @@ static void
 print_types (const tiz_os_t * ap_os)
 {
 #ifdef _DEBUG
+  OMX_S32 type_id = 0;
   assert (ap_os);
   assert (ap_os->p_map);
+  for (type_id = 0; type_id < ETIZTypeMax; ++type_id)
+    {
+      if (ap_os->pp_types[type_id])
+        {
+          TIZ_TRACE (ap_os->p_hdl, "type [%s]->[%p]",
+                     tiz_os_type_to_str_tbl[type_id].str,
+                     ap_os->pp_types[type_id]);
+        }
+    }
   tiz_map_for_each (ap_os->p_map, print_function, (tiz_os_t *) ap_os);
 #endif
 }
@@ -467,24 +674,33 @@ os_register_type (tiz_os_t * ap_os, const tiz_os_type_init_f a_type_init_f,
 static OMX_ERRORTYPE
 register_base_types (tiz_os_t * ap_os)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  const OMX_S32 count
-    = sizeof (tiz_os_type_to_str_tbl) / sizeof (tiz_os_type_str_t);
   OMX_S32 type_id = 0;
-  OMX_S32 last_element = 0;
 
   assert (ap_os);
-  assert (count >= TIZ_OS_BASE_TYPE_END);
-  last_element = TIZ_OS_BASE_TYPE_END;
+  assert (!ap_os->p_arena);
 
-  for (type_id = 0; type_id <= last_element && OMX_ErrorNone == rc; ++type_id)
+  if (!ensure_prototypes (ap_os, 0, TIZ_OS_BASE_TYPE_END))
     {
-      TIZ_TRACE (ap_os->p_hdl, "Registering type [%s]...",
-                 tiz_os_type_to_str_tbl[type_id].str);
-      rc = os_register_type (ap_os, tiz_os_type_to_fnt_tbl[type_id],
-                             tiz_os_type_to_str_tbl[type_id].str, type_id);
+      return OMX_ErrorInsufficientResources;
     }
-  return rc;
+
+  /* All the base types are copied into a single block */
+  ap_os->arena_size = g_registry.base_types_size;
+  if (!(ap_os->p_arena = tiz_mem_calloc (1, ap_os->arena_size)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (type_id = 0; type_id <= TIZ_OS_BASE_TYPE_END; ++type_id)
+    {
+      if (!ap_os->pp_types[type_id])
+        {
+          TIZ_TRACE (ap_os->p_hdl, "Registering type [%s]...",
+                     tiz_os_type_to_str_tbl[type_id].str);
+          (void) clone_type (ap_os, type_id);
+        }
+    }
+  return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
@@ -498,6 +714,8 @@ tiz_os_init (tiz_os_t ** app_os, const OMX_HANDLETYPE ap_hdl,
 
   TIZ_TRACE (ap_hdl, "Init");
 
+  (void) pthread_once (&g_registry_once, init_registry);
+
   if (NULL == (p_os = (tiz_os_t *) os_calloc (ap_soa, sizeof (tiz_os_t))))
     {
       return OMX_ErrorInsufficientResources;
@@ -505,9 +723,16 @@ tiz_os_init (tiz_os_t ** app_os, const OMX_HANDLETYPE ap_hdl,
 
   assert (p_os);
 
+  if (NULL == (p_os->pp_types = tiz_mem_calloc (ETIZTypeMax, sizeof (void *))))
+    {
+      os_free (ap_soa, p_os);
+      return OMX_ErrorInsufficientResources;
+    }
+
   if (OMX_ErrorNone != tiz_map_init (&(p_os->p_map), os_map_compare_func,
                                      os_map_free_func, NULL))
     {
+      tiz_mem_free (p_os->pp_types);
       os_free (ap_soa, p_os);
       p_os = NULL;
       return OMX_ErrorInsufficientResources;
@@ -515,6 +740,9 @@ tiz_os_init (tiz_os_t ** app_os, const OMX_HANDLETYPE ap_hdl,
 
   p_os->p_hdl = ap_hdl;
   p_os->p_soa = ap_soa;
+  p_os->p_arena = NULL;
+  p_os->arena_size = 0;
+  p_os->building = false;
 
   *app_os = p_os;
 
@@ -526,11 +754,21 @@ tiz_os_destroy (tiz_os_t * ap_os)
 {
   if (ap_os)
     {
+      OMX_S32 type_id = 0;
       while (!tiz_map_empty (ap_os->p_map))
         {
           tiz_map_erase_at (ap_os->p_map, 0);
         };
       tiz_map_destroy (ap_os->p_map);
+      for (type_id = 0; type_id < ETIZTypeMax; ++type_id)
+        {
+          if (!in_arena (ap_os, ap_os->pp_types[type_id]))
+            {
+              tiz_mem_free (ap_os->pp_types[type_id]);
+            }
+        }
+      tiz_mem_free (ap_os->p_arena);
+      tiz_mem_free (ap_os->pp_types);
       os_free (ap_os->p_soa, ap_os);
     }
 }
@@ -541,7 +779,7 @@ tiz_os_register_type (tiz_os_t * ap_os, const tiz_os_type_init_f a_type_init_f,
 {
   assert (ap_os);
   return os_register_type (ap_os, a_type_init_f, a_type_name,
-                           tiz_map_size (ap_os->p_map));
+                           ETIZTypeMax + tiz_map_size (ap_os->p_map));
 }
 
 OMX_ERRORTYPE
@@ -551,50 +789,50 @@ tiz_os_register_base_types (tiz_os_t * ap_os)
   return register_base_types (ap_os);
 }
 
-static OMX_ERRORTYPE
-register_additional_type (tiz_os_t * ap_os, const char * a_type_name)
+static void *
+get_base_type (tiz_os_t * ap_os, const OMX_S32 a_type_id)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  const OMX_S32 count
-    = sizeof (tiz_os_type_to_str_tbl) / sizeof (tiz_os_type_str_t);
-  OMX_S32 type_id = TIZ_OS_BASE_TYPE_END + 1;
-
+  void * res = NULL;
   assert (ap_os);
+  assert (a_type_id >= 0 && a_type_id < ETIZTypeMax);
 
-  for (; type_id < count && OMX_ErrorNone == rc; ++type_id)
+  if (ap_os->building)
     {
-      if (0 == strncmp (a_type_name, tiz_os_type_to_str_tbl[type_id].str,
-                        OMX_MAX_STRINGNAME_SIZE))
+      /* A prototype is being built on this thread, and the registry mutex is
+         held; its super classes are prototypes too */
+      res = build_prototype (ap_os, a_type_id);
+    }
+  else if (!(res = ap_os->pp_types[a_type_id]))
+    {
+      /* Types beyond the base ones (mostly ports) are added on first use */
+      TIZ_TRACE (ap_os->p_hdl, "Registering additional type [%s]...",
+                 tiz_os_type_to_str_tbl[a_type_id].str);
+      if (ensure_prototypes (ap_os, a_type_id, a_type_id))
         {
-          TIZ_TRACE (ap_os->p_hdl, "Registering additional type [%s]...",
-                     a_type_name);
-          rc = os_register_type (ap_os, tiz_os_type_to_fnt_tbl[type_id],
-                                 a_type_name, type_id);
-          break;
+          res = clone_type (ap_os, a_type_id);
+          print_types (ap_os);
         }
     }
-  return rc;
+  return res;
 }
 
 void *
 tiz_os_get_type (const tiz_os_t * ap_os, const char * a_type_name)
 {
   void * res = NULL;
+  OMX_S32 type_id = -1;
   assert (ap_os);
   assert (ap_os->p_map);
   assert (a_type_name);
-  res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
-  TIZ_TRACE (ap_os->p_hdl, "Get type [%s]->[%p] - total types [%d]",
-             a_type_name, res, tiz_map_size (ap_os->p_map));
-  if (!res)
+  if ((type_id = os_type_id (a_type_name)) >= 0)
     {
-      if (OMX_ErrorNone
-          == register_additional_type ((tiz_os_t *) ap_os, a_type_name))
-        {
-          print_types (ap_os);
-          res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
-        }
+      res = get_base_type ((tiz_os_t *) ap_os, type_id);
+    }
+  else
+    {
+      res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
     }
+  TIZ_TRACE (ap_os->p_hdl, "Get type [%s]->[%p]", a_type_name, res);
   assert (res);
   return res;
 }
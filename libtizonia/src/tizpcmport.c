@@ -92,6 +92,7 @@ pcmport_SetParameter_common (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
             {
               case 8:
               case 16:
+              case 24:
               case 32:
                 {
                   break;
@@ -0,0 +1,305 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Single-producer/single-consumer data ring
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "tizscheduler.h"
+#include "tizutils.h"
+#include "tizring.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.ring"
+#endif
+
+#define TIZ_RING_CACHE_LINE_SIZE 64
+
+/* Notification states */
+#define TIZ_RING_NOTIFY_IDLE 0    /* No notification queued */
+#define TIZ_RING_NOTIFY_PENDING 1 /* A notification is in the event queue */
+#define TIZ_RING_NOTIFY_ORPHANED \
+  2 /* The ring was destroyed while a notification was in the event queue */
+
+struct tiz_ring
+{
+  OMX_U8 * p_store;
+  size_t capacity;
+  size_t mask;
+  /* The producer and consumer indexes are free-running counters. They are
+     padded apart to avoid false sharing between the two threads. */
+  char pad0[TIZ_RING_CACHE_LINE_SIZE];
+  size_t head; /* written by the producer */
+  char pad1[TIZ_RING_CACHE_LINE_SIZE - sizeof (size_t)];
+  size_t tail; /* written by the consumer */
+  char pad2[TIZ_RING_CACHE_LINE_SIZE - sizeof (size_t)];
+  int notify_state;
+  OMX_HANDLETYPE p_hdl;
+  tiz_ring_data_avail_f pf_data_avail;
+  tiz_event_pluggable_t event;
+};
+
+static inline size_t
+next_pow2 (size_t a_n)
+{
+  size_t n = 1;
+  while (n < a_n)
+    {
+      n <<= 1;
+    }
+  return n;
+}
+
+static inline void
+free_ring (tiz_ring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      tiz_mem_free (ap_ring->p_store);
+      tiz_mem_free (ap_ring);
+    }
+}
+
+static void
+ring_notification_hdlr (OMX_PTR ap_servant, tiz_event_pluggable_t * ap_event)
+{
+  tiz_ring_t * p_ring = NULL;
+  int expected = TIZ_RING_NOTIFY_PENDING;
+
+  assert (ap_event);
+  p_ring = ap_event->p_data;
+  assert (p_ring);
+
+  /* Re-arm the notification before calling out, so that any data written
+     from now on generates a new notification. */
+  if (__atomic_compare_exchange_n (&(p_ring->notify_state), &expected,
+                                   TIZ_RING_NOTIFY_IDLE, false,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      if (p_ring->pf_data_avail)
+        {
+          p_ring->pf_data_avail (ap_servant, p_ring);
+        }
+    }
+  else
+    {
+      /* The ring was destroyed while this notification was in flight */
+      assert (TIZ_RING_NOTIFY_ORPHANED == expected);
+      free_ring (p_ring);
+    }
+}
+
+static void
+notify_consumer (tiz_ring_t * ap_ring)
+{
+  int expected = TIZ_RING_NOTIFY_IDLE;
+  assert (ap_ring);
+  if (ap_ring->p_hdl
+      && __atomic_compare_exchange_n (&(ap_ring->notify_state), &expected,
+                                      TIZ_RING_NOTIFY_PENDING, false,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      if (OMX_ErrorNone
+          != tiz_comp_event_pluggable (ap_ring->p_hdl, &(ap_ring->event)))
+        {
+          /* Let the next write try again */
+          __atomic_store_n (&(ap_ring->notify_state), TIZ_RING_NOTIFY_IDLE,
+                            __ATOMIC_RELEASE);
+        }
+    }
+}
+
+OMX_ERRORTYPE
+tiz_ring_init (tiz_ring_ptr_t * app_ring, OMX_HANDLETYPE ap_hdl,
+               OMX_PTR ap_servant, const size_t a_nbytes,
+               tiz_ring_data_avail_f apf_data_avail)
+{
+  tiz_ring_t * p_ring = NULL;
+
+  assert (app_ring);
+  assert (a_nbytes > 0);
+
+  if (!(p_ring = tiz_mem_calloc (1, sizeof (tiz_ring_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_ring->capacity = next_pow2 (a_nbytes);
+  p_ring->mask = p_ring->capacity - 1;
+  if (!(p_ring->p_store = tiz_mem_alloc (p_ring->capacity)))
+    {
+      free_ring (p_ring);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_ring->head = 0;
+  p_ring->tail = 0;
+  p_ring->notify_state = TIZ_RING_NOTIFY_IDLE;
+  p_ring->p_hdl = ap_hdl;
+  p_ring->pf_data_avail = apf_data_avail;
+  p_ring->event.p_servant = ap_servant;
+  p_ring->event.p_data = p_ring;
+  p_ring->event.pf_hdlr = ring_notification_hdlr;
+
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_ring_destroy (tiz_ring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      int expected = TIZ_RING_NOTIFY_PENDING;
+      if (!__atomic_compare_exchange_n (
+            &(ap_ring->notify_state), &expected, TIZ_RING_NOTIFY_ORPHANED,
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+          /* No notification in flight; release now. Otherwise, the
+             notification handler will release the memory. */
+          free_ring (ap_ring);
+        }
+    }
+}
+
+size_t
+tiz_ring_capacity (const tiz_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->capacity;
+}
+
+size_t
+tiz_ring_writable (const tiz_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->capacity
+         - (ap_ring->head
+            - __atomic_load_n (&(ap_ring->tail), __ATOMIC_ACQUIRE));
+}
+
+size_t
+tiz_ring_write (tiz_ring_t * ap_ring, const void * ap_data,
+                const size_t a_nbytes)
+{
+  size_t nbytes = 0;
+
+  assert (ap_ring);
+
+  if (ap_data && a_nbytes > 0)
+    {
+      const size_t head = ap_ring->head;
+      const size_t pos = head & ap_ring->mask;
+      const size_t writable = tiz_ring_writable (ap_ring);
+      size_t first = 0;
+
+      nbytes = MIN (a_nbytes, writable);
+      if (nbytes > 0)
+        {
+          first = MIN (nbytes, ap_ring->capacity - pos);
+          memcpy (ap_ring->p_store + pos, ap_data, first);
+          if (nbytes > first)
+            {
+              memcpy (ap_ring->p_store, (const OMX_U8 *) ap_data + first,
+                      nbytes - first);
+            }
+          __atomic_store_n (&(ap_ring->head), head + nbytes,
+                            __ATOMIC_RELEASE);
+          notify_consumer (ap_ring);
+        }
+    }
+  return nbytes;
+}
+
+size_t
+tiz_ring_available (const tiz_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return __atomic_load_n (&(ap_ring->head), __ATOMIC_ACQUIRE) - ap_ring->tail;
+}
+
+size_t
+tiz_ring_read (tiz_ring_t * ap_ring, void * ap_dst, const size_t a_nbytes)
+{
+  size_t nbytes = 0;
+
+  assert (ap_ring);
+
+  if (ap_dst && a_nbytes > 0)
+    {
+      const size_t tail = ap_ring->tail;
+      const size_t pos = tail & ap_ring->mask;
+      const size_t available = tiz_ring_available (ap_ring);
+      size_t first = 0;
+
+      nbytes = MIN (a_nbytes, available);
+      if (nbytes > 0)
+        {
+          first = MIN (nbytes, ap_ring->capacity - pos);
+          memcpy (ap_dst, ap_ring->p_store + pos, first);
+          if (nbytes > first)
+            {
+              memcpy ((OMX_U8 *) ap_dst + first, ap_ring->p_store,
+                      nbytes - first);
+            }
+          __atomic_store_n (&(ap_ring->tail), tail + nbytes,
+                            __ATOMIC_RELEASE);
+        }
+    }
+  return nbytes;
+}
+
+size_t
+tiz_ring_read_into_hdr (tiz_ring_t * ap_ring, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  size_t nbytes = 0;
+  assert (ap_ring);
+  assert (ap_hdr);
+  assert (ap_hdr->nAllocLen >= ap_hdr->nOffset + ap_hdr->nFilledLen);
+  nbytes = tiz_ring_read (
+    ap_ring, ap_hdr->pBuffer + ap_hdr->nOffset + ap_hdr->nFilledLen,
+    ap_hdr->nAllocLen - (ap_hdr->nOffset + ap_hdr->nFilledLen));
+  ap_hdr->nFilledLen += nbytes;
+  return nbytes;
+}
+
+void
+tiz_ring_clear (tiz_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  __atomic_store_n (&(ap_ring->tail),
+                    __atomic_load_n (&(ap_ring->head), __ATOMIC_ACQUIRE),
+                    __ATOMIC_RELEASE);
+}
@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Single-producer/single-consumer data ring
+ *
+ *
+ */
+
+#ifndef TIZRING_H
+#define TIZRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizring 'tizring' : Lock-free hand-off ring for external producers
+ *
+ * A fixed-size, single-producer/single-consumer byte ring that allows a
+ * thread that is external to the component (e.g. a third-party library's
+ * callback thread) to hand data over to the component's 'processor' without
+ * any heap allocations on the data path.
+ *
+ * The producer writes into the ring from its own thread context. The first
+ * write into the ring after the consumer has been notified triggers a new
+ * 'data available' notification. The notification is delivered as a
+ * 'pluggable' event, i.e. the callback is invoked from within the component's
+ * thread context. At most one notification is outstanding at any time, which
+ * means that the producer uses at most one slot in the component's event
+ * queue.
+ *
+ * @ingroup libtizonia
+ */
+
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Hand-off ring opaque handle.
+ * @ingroup tizring
+ */
+typedef struct tiz_ring tiz_ring_t;
+typedef /*@null@ */ tiz_ring_t * tiz_ring_ptr_t;
+
+/**
+ * 'Data available' notification prototype. This is invoked in the context of
+ * the component's thread.
+ *
+ * @ingroup tizring
+ * @param ap_servant The servant object that was registered with the ring.
+ * @param ap_ring The ring that has data available.
+ */
+typedef void (*tiz_ring_data_avail_f) (OMX_PTR ap_servant,
+                                       tiz_ring_t * ap_ring);
+
+/**
+ * Create a new hand-off ring.
+ *
+ * @ingroup tizring
+ * @param app_ring A ring handle to be initialised.
+ * @param ap_hdl The OpenMAX IL handle of the component that will consume the
+ * data. May be NULL, in which case no notifications are generated.
+ * @param ap_servant The servant object that will receive the notifications
+ * (usually the 'processor').
+ * @param a_nbytes The minimum capacity of the ring, in bytes. The actual
+ * capacity is rounded up to the next power of two.
+ * @param apf_data_avail The 'data available' notification callback.
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_ring_init (tiz_ring_ptr_t * app_ring, OMX_HANDLETYPE ap_hdl,
+               OMX_PTR ap_servant, const size_t a_nbytes,
+               tiz_ring_data_avail_f apf_data_avail);
+
+/**
+ * Destroy a hand-off ring.
+ *
+ * This must be called from the component's thread, and only once the producer
+ * has been stopped. If a notification is still queued in the component's
+ * event queue, the memory will be released when the notification is
+ * delivered.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_ring_destroy (tiz_ring_t * ap_ring);
+
+/**
+ * Retrieve the total capacity of the ring.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @return The capacity of the ring, in bytes.
+ */
+size_t
+tiz_ring_capacity (const tiz_ring_t * ap_ring);
+
+/**
+ * Retrieve the number of bytes that can be currently written. To be used from
+ * the producer's thread.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @return The number of free bytes in the ring.
+ */
+size_t
+tiz_ring_writable (const tiz_ring_t * ap_ring);
+
+/**
+ * Copy data into the ring. To be used from the producer's thread.
+ *
+ * Copies as much data as there is room for and then, if needed, posts a 'data
+ * available' notification to the component.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @param ap_data The data to be written.
+ * @param a_nbytes The number of bytes to write.
+ * @return The number of bytes actually written.
+ */
+size_t
+tiz_ring_write (tiz_ring_t * ap_ring, const void * ap_data,
+                const size_t a_nbytes);
+
+/**
+ * Retrieve the number of bytes that are available for reading. To be used from
+ * the consumer's (i.e. the component's) thread.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @return The number of bytes currently stored in the ring.
+ */
+size_t
+tiz_ring_available (const tiz_ring_t * ap_ring);
+
+/**
+ * Copy data out of the ring. To be used from the consumer's thread.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @param ap_dst The destination memory area.
+ * @param a_nbytes The maximum number of bytes to read.
+ * @return The number of bytes actually read.
+ */
+size_t
+tiz_ring_read (tiz_ring_t * ap_ring, void * ap_dst, const size_t a_nbytes);
+
+/**
+ * Drain data from the ring straight into an OpenMAX IL buffer header. To be
+ * used from the consumer's thread.
+ *
+ * Data is appended after the header's nOffset + nFilledLen, and nFilledLen is
+ * incremented accordingly.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ * @param ap_hdr The OpenMAX IL buffer header.
+ * @return The number of bytes copied into the buffer.
+ */
+size_t
+tiz_ring_read_into_hdr (tiz_ring_t * ap_ring, OMX_BUFFERHEADERTYPE * ap_hdr);
+
+/**
+ * Discard all the data currently in the ring. To be used from the consumer's
+ * thread.
+ *
+ * @ingroup tizring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_ring_clear (tiz_ring_t * ap_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZRING_H */
@@ -2694,6 +2694,10 @@ init_and_register_role (tiz_scheduler_t * ap_sched, const OMX_U32 a_role_pos)
 
       /* All servants will use the same object allocator */
       tiz_check_omx_ret_oom (tiz_srv_set_allocator (p_proc, ap_sched->p_soa));
+
+      /* This runs in the scheduler thread: apply any cpu affinity and
+         scheduling settings configured for this role. Not fatal. */
+      (void) tiz_thread_apply_sched_config ((const char *) p_rf->role);
     }
 
   return rc;
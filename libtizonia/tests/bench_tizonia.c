@@ -0,0 +1,720 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_tizonia.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - libtizonia benchmarks
+ *
+ * Scheduler dispatch benchmarks (using the test component), and an optional
+ * end-to-end benchmark of a file reader -> decoder pipeline, where this
+ * program acts as the sink for the decoder's output port. Each benchmark
+ * prints one JSON object per line on stdout (JSON Lines). Usage:
+ *
+ *   bench_tizonia [-n iterations] [-f media_file [-d decoder_name]]
+ *
+ * The pipeline benchmark requires the file reader and decoder plugins to be
+ * installed in one of the 'component-paths' of the configuration file in use
+ * (TIZONIA_RC_FILE).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <OMX_Component.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizplatform.h>
+
+#include "check_tizonia.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.bench"
+#endif
+
+#define BENCH_TEST_COMPONENT "OMX.Aratelia.tizonia.test_component"
+#define BENCH_FILE_READER "OMX.Aratelia.file_reader.binary"
+#define BENCH_DEFAULT_DECODER "OMX.Aratelia.audio_decoder.mp3"
+#define BENCH_DEFAULT_ITERATIONS 20000
+#define BENCH_MAX_BUFFERS 64
+/* Time to wait for a command completion or a buffer, in msec */
+#define BENCH_TIMEOUT 5000
+
+typedef struct bench_ctx bench_ctx_t;
+struct bench_ctx
+{
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  OMX_U32 cmds_done;
+  OMX_ERRORTYPE error;
+  OMX_BUFFERHEADERTYPE * p_done[BENCH_MAX_BUFFERS];
+  OMX_U32 ndone;
+};
+
+typedef struct bench_samples bench_samples_t;
+struct bench_samples
+{
+  OMX_U64 * p_ns;
+  size_t count;
+  size_t capacity;
+};
+
+static OMX_U64
+now_ns (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000000ULL + (OMX_U64) ts.tv_nsec;
+}
+
+/*
+ * Latency samples and reporting
+ */
+
+static OMX_ERRORTYPE
+samples_add (bench_samples_t * ap_s, const OMX_U64 a_ns)
+{
+  assert (ap_s);
+  if (ap_s->count == ap_s->capacity)
+    {
+      size_t capacity = ap_s->capacity ? ap_s->capacity * 2 : 1024;
+      OMX_U64 * p_ns
+        = tiz_mem_realloc (ap_s->p_ns, capacity * sizeof (OMX_U64));
+      tiz_check_null_ret_oom (p_ns);
+      ap_s->p_ns = p_ns;
+      ap_s->capacity = capacity;
+    }
+  ap_s->p_ns[ap_s->count++] = a_ns;
+  return OMX_ErrorNone;
+}
+
+static int
+cmp_u64 (const void * ap_left, const void * ap_right)
+{
+  const OMX_U64 left = *(const OMX_U64 *) ap_left;
+  const OMX_U64 right = *(const OMX_U64 *) ap_right;
+  return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+static OMX_U64
+percentile (const bench_samples_t * ap_s, const unsigned int a_pct)
+{
+  /* Nearest-rank; the samples must be sorted */
+  size_t rank = 0;
+  if (0 == ap_s->count)
+    {
+      return 0;
+    }
+  rank = (ap_s->count * a_pct + 99) / 100;
+  return ap_s->p_ns[rank > 0 ? rank - 1 : 0];
+}
+
+static void
+report (const char * ap_name, const char * ap_extra, bench_samples_t * ap_s,
+        const OMX_U64 a_elapsed_ns)
+{
+  const double ops_per_sec
+    = a_elapsed_ns > 0 ? (double) ap_s->count * 1e9 / (double) a_elapsed_ns
+                       : 0.0;
+
+  qsort (ap_s->p_ns, ap_s->count, sizeof (OMX_U64), cmp_u64);
+
+  fprintf (stdout,
+           "{\"suite\":\"tizonia\",\"bench\":\"%s\",%s\"ops\":%lu,"
+           "\"elapsed_ns\":%llu,\"ops_per_sec\":%.1f,\"latency_ns\":{"
+           "\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu}}\n",
+           ap_name, ap_extra ? ap_extra : "", (unsigned long) ap_s->count,
+           (unsigned long long) a_elapsed_ns, ops_per_sec,
+           (unsigned long long) percentile (ap_s, 50),
+           (unsigned long long) percentile (ap_s, 90),
+           (unsigned long long) percentile (ap_s, 99),
+           (unsigned long long) percentile (ap_s, 100));
+  fflush (stdout);
+}
+
+static void
+report_failure (const char * ap_name, const OMX_ERRORTYPE a_error)
+{
+  fprintf (stdout,
+           "{\"suite\":\"tizonia\",\"bench\":\"%s\",\"error\":\"%s\"}\n",
+           ap_name, tiz_err_to_str (a_error));
+  fflush (stdout);
+}
+
+/*
+ * IL client context
+ */
+
+static OMX_ERRORTYPE
+ctx_init (bench_ctx_t * ap_ctx)
+{
+  assert (ap_ctx);
+  tiz_mem_set (ap_ctx, 0, sizeof (bench_ctx_t));
+  tiz_check_omx (tiz_mutex_init (&ap_ctx->mutex));
+  if (OMX_ErrorNone != tiz_cond_init (&ap_ctx->cond))
+    {
+      tiz_mutex_destroy (&ap_ctx->mutex);
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+ctx_destroy (bench_ctx_t * ap_ctx)
+{
+  assert (ap_ctx);
+  tiz_cond_destroy (&ap_ctx->cond);
+  tiz_mutex_destroy (&ap_ctx->mutex);
+}
+
+/* Wait until a_ncmds commands have completed (and reset the count) */
+static OMX_ERRORTYPE
+ctx_wait_cmds (bench_ctx_t * ap_ctx, const OMX_U32 a_ncmds)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_ctx);
+  tiz_check_omx (tiz_mutex_lock (&ap_ctx->mutex));
+  while (ap_ctx->cmds_done < a_ncmds && OMX_ErrorNone == ap_ctx->error
+         && OMX_ErrorNone == rc)
+    {
+      if (OMX_ErrorNone
+          != tiz_cond_timedwait (&ap_ctx->cond, &ap_ctx->mutex, BENCH_TIMEOUT))
+        {
+          rc = OMX_ErrorTimeout;
+        }
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ap_ctx->error;
+    }
+  ap_ctx->cmds_done = 0;
+  (void) tiz_mutex_unlock (&ap_ctx->mutex);
+  return rc;
+}
+
+/* Wait for the next returned buffer header */
+static OMX_ERRORTYPE
+ctx_wait_buffer (bench_ctx_t * ap_ctx, OMX_BUFFERHEADERTYPE ** app_hdr)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_ctx);
+  assert (app_hdr);
+  tiz_check_omx (tiz_mutex_lock (&ap_ctx->mutex));
+  while (0 == ap_ctx->ndone && OMX_ErrorNone == ap_ctx->error
+         && OMX_ErrorNone == rc)
+    {
+      if (OMX_ErrorNone
+          != tiz_cond_timedwait (&ap_ctx->cond, &ap_ctx->mutex, BENCH_TIMEOUT))
+        {
+          rc = OMX_ErrorTimeout;
+        }
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ap_ctx->error;
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      *app_hdr = ap_ctx->p_done[0];
+      --ap_ctx->ndone;
+      memmove (ap_ctx->p_done, ap_ctx->p_done + 1,
+               ap_ctx->ndone * sizeof (OMX_BUFFERHEADERTYPE *));
+    }
+  (void) tiz_mutex_unlock (&ap_ctx->mutex);
+  return rc;
+}
+
+static OMX_ERRORTYPE
+bench_EventHandler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                    OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2,
+                    OMX_PTR pEventData)
+{
+  bench_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] data1 [%u] data2 [%u]",
+           tiz_evt_to_str (eEvent), nData1, nData2);
+
+  (void) tiz_mutex_lock (&p_ctx->mutex);
+  if (OMX_EventCmdComplete == eEvent)
+    {
+      ++p_ctx->cmds_done;
+      (void) tiz_cond_broadcast (&p_ctx->cond);
+    }
+  else if (OMX_EventError == eEvent)
+    {
+      p_ctx->error = (OMX_ERRORTYPE) nData1;
+      (void) tiz_cond_broadcast (&p_ctx->cond);
+    }
+  (void) tiz_mutex_unlock (&p_ctx->mutex);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_BufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                  OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  bench_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+  assert (ap_hdr);
+
+  (void) tiz_mutex_lock (&p_ctx->mutex);
+  assert (p_ctx->ndone < BENCH_MAX_BUFFERS);
+  p_ctx->p_done[p_ctx->ndone++] = ap_hdr;
+  (void) tiz_cond_broadcast (&p_ctx->cond);
+  (void) tiz_mutex_unlock (&p_ctx->mutex);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE bench_cbacks
+  = {bench_EventHandler, bench_BufferDone, bench_BufferDone};
+
+static OMX_ERRORTYPE
+get_port_def (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid,
+              OMX_PARAM_PORTDEFINITIONTYPE * ap_port_def)
+{
+  TIZ_INIT_OMX_PORT_STRUCT (*ap_port_def, a_pid);
+  return OMX_GetParameter (ap_hdl, OMX_IndexParamPortDefinition, ap_port_def);
+}
+
+static OMX_ERRORTYPE
+state_set (OMX_HANDLETYPE * ap_hdls, const OMX_U32 a_nhdls,
+           const OMX_STATETYPE a_state)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < a_nhdls; ++i)
+    {
+      tiz_check_omx (
+        OMX_SendCommand (ap_hdls[i], OMX_CommandStateSet, a_state, NULL));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+alloc_buffers (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid,
+               OMX_BUFFERHEADERTYPE ** ap_hdrs, OMX_U32 * ap_nhdrs)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_U32 i = 0;
+
+  tiz_check_omx (get_port_def (ap_hdl, a_pid, &port_def));
+  tiz_check_true_ret_val (port_def.nBufferCountActual <= BENCH_MAX_BUFFERS,
+                          OMX_ErrorInsufficientResources);
+
+  for (i = 0; i < port_def.nBufferCountActual; ++i)
+    {
+      tiz_check_omx (OMX_AllocateBuffer (ap_hdl, &ap_hdrs[i], a_pid,
+                                         (OMX_PTR) (intptr_t) i,
+                                         port_def.nBufferSize));
+    }
+  *ap_nhdrs = port_def.nBufferCountActual;
+  return OMX_ErrorNone;
+}
+
+static void
+free_buffers (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid,
+              OMX_BUFFERHEADERTYPE ** ap_hdrs, const OMX_U32 a_nhdrs)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < a_nhdrs; ++i)
+    {
+      if (ap_hdrs[i])
+        {
+          (void) OMX_FreeBuffer (ap_hdl, a_pid, ap_hdrs[i]);
+          ap_hdrs[i] = NULL;
+        }
+    }
+}
+
+/*
+ * Scheduler dispatch: synchronous API calls
+ */
+
+static OMX_ERRORTYPE
+bench_sched_get_parameter (const unsigned long a_iterations)
+{
+  bench_ctx_t ctx;
+  bench_samples_t samples = {NULL, 0, 0};
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U64 start = 0;
+  OMX_U64 t0 = 0;
+  unsigned long i = 0;
+
+  tiz_check_omx (ctx_init (&ctx));
+  rc = OMX_GetHandle (&p_hdl, BENCH_TEST_COMPONENT, &ctx, &bench_cbacks);
+
+  /* Each call is a round trip to the component's servant thread */
+  start = now_ns ();
+  for (i = 0; i < a_iterations && OMX_ErrorNone == rc; ++i)
+    {
+      t0 = now_ns ();
+      rc = get_port_def (p_hdl, 0, &port_def);
+      if (OMX_ErrorNone == rc)
+        {
+          rc = samples_add (&samples, now_ns () - t0);
+        }
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      report ("sched.get_parameter", NULL, &samples, now_ns () - start);
+    }
+
+  if (p_hdl)
+    {
+      (void) OMX_FreeHandle (p_hdl);
+    }
+  tiz_mem_free (samples.p_ns);
+  ctx_destroy (&ctx);
+  return rc;
+}
+
+/*
+ * Scheduler dispatch: buffer round trips
+ */
+
+static OMX_ERRORTYPE
+bench_sched_buffer_roundtrip (const unsigned long a_iterations)
+{
+  bench_ctx_t ctx;
+  bench_samples_t samples = {NULL, 0, 0};
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_BUFFERHEADERTYPE * p_hdrs[BENCH_MAX_BUFFERS];
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_U32 nhdrs = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U64 start = 0;
+  OMX_U64 t0 = 0;
+  unsigned long i = 0;
+
+  tiz_mem_set (p_hdrs, 0, sizeof (p_hdrs));
+  tiz_check_omx (ctx_init (&ctx));
+  rc = OMX_GetHandle (&p_hdl, BENCH_TEST_COMPONENT, &ctx, &bench_cbacks);
+
+  if (OMX_ErrorNone == rc)
+    {
+      rc = state_set (&p_hdl, 1, OMX_StateIdle);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = alloc_buffers (p_hdl, 0, p_hdrs, &nhdrs);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ctx_wait_cmds (&ctx, 1);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = state_set (&p_hdl, 1, OMX_StateExecuting);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ctx_wait_cmds (&ctx, 1);
+    }
+
+  /* One buffer in flight at a time: EmptyThisBuffer -> servant thread ->
+     processor -> EmptyBufferDone */
+  start = now_ns ();
+  for (i = 0; i < a_iterations && OMX_ErrorNone == rc; ++i)
+    {
+      p_hdr = p_hdrs[i % nhdrs];
+      p_hdr->nFilledLen = p_hdr->nAllocLen;
+      p_hdr->nOffset = 0;
+      t0 = now_ns ();
+      rc = OMX_EmptyThisBuffer (p_hdl, p_hdr);
+      if (OMX_ErrorNone == rc)
+        {
+          rc = ctx_wait_buffer (&ctx, &p_hdr);
+        }
+      if (OMX_ErrorNone == rc)
+        {
+          rc = samples_add (&samples, now_ns () - t0);
+        }
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      report ("sched.buffer_roundtrip", NULL, &samples, now_ns () - start);
+      rc = state_set (&p_hdl, 1, OMX_StateIdle);
+      if (OMX_ErrorNone == rc)
+        {
+          rc = ctx_wait_cmds (&ctx, 1);
+        }
+      if (OMX_ErrorNone == rc)
+        {
+          rc = state_set (&p_hdl, 1, OMX_StateLoaded);
+        }
+      free_buffers (p_hdl, 0, p_hdrs, nhdrs);
+      if (OMX_ErrorNone == rc)
+        {
+          rc = ctx_wait_cmds (&ctx, 1);
+        }
+    }
+
+  if (p_hdl)
+    {
+      (void) OMX_FreeHandle (p_hdl);
+    }
+  tiz_mem_free (samples.p_ns);
+  ctx_destroy (&ctx);
+  return rc;
+}
+
+/*
+ * End-to-end: file reader -> decoder -> (this program)
+ */
+
+static OMX_ERRORTYPE
+set_uri (OMX_HANDLETYPE ap_hdl, const char * ap_uri)
+{
+  const size_t uri_len = strlen (ap_uri);
+  OMX_PARAM_CONTENTURITYPE * p_uritype
+    = tiz_mem_calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + uri_len + 1);
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  tiz_check_null_ret_oom (p_uritype);
+  p_uritype->nSize = sizeof (OMX_PARAM_CONTENTURITYPE) + uri_len + 1;
+  p_uritype->nVersion.nVersion = OMX_VERSION;
+  strncpy ((char *) p_uritype->contentURI, ap_uri, uri_len + 1);
+  rc = OMX_SetParameter (ap_hdl, OMX_IndexParamContentURI, p_uritype);
+  tiz_mem_free (p_uritype);
+  return rc;
+}
+
+static OMX_ERRORTYPE
+bench_pipeline (const char * ap_file, const char * ap_decoder)
+{
+  bench_ctx_t ctx;
+  bench_samples_t samples = {NULL, 0, 0};
+  OMX_HANDLETYPE p_hdls[2] = {NULL, NULL}; /* reader, decoder */
+  OMX_BUFFERHEADERTYPE * p_hdrs[BENCH_MAX_BUFFERS];
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_U64 sent[BENCH_MAX_BUFFERS];
+  OMX_U32 nhdrs = 0;
+  OMX_U32 i = 0;
+  OMX_U64 nbytes = 0;
+  OMX_U64 start = 0;
+  OMX_BOOL eos = OMX_FALSE;
+  OMX_BOOL tunneled = OMX_FALSE;
+  OMX_BOOL allocated = OMX_FALSE;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  char extra[OMX_MAX_STRINGNAME_SIZE * 2];
+
+  tiz_mem_set (p_hdrs, 0, sizeof (p_hdrs));
+  tiz_check_omx (ctx_init (&ctx));
+
+  rc = OMX_GetHandle (&p_hdls[0], BENCH_FILE_READER, &ctx, &bench_cbacks);
+  if (OMX_ErrorNone == rc)
+    {
+      rc = OMX_GetHandle (&p_hdls[1], (OMX_STRING) ap_decoder, &ctx,
+                          &bench_cbacks);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = set_uri (p_hdls[0], ap_file);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = OMX_SetupTunnel (p_hdls[0], 0, p_hdls[1], 0);
+      tunneled = (OMX_ErrorNone == rc ? OMX_TRUE : OMX_FALSE);
+    }
+
+  /* Loaded -> Idle -> Executing. The decoder's output port is not tunneled:
+     its buffers are allocated here. */
+  if (OMX_ErrorNone == rc)
+    {
+      rc = state_set (p_hdls, 2, OMX_StateIdle);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = alloc_buffers (p_hdls[1], 1, p_hdrs, &nhdrs);
+      allocated = OMX_TRUE;
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ctx_wait_cmds (&ctx, 2);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = state_set (p_hdls, 2, OMX_StateExecuting);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      rc = ctx_wait_cmds (&ctx, 2);
+    }
+
+  start = now_ns ();
+  for (i = 0; i < nhdrs && OMX_ErrorNone == rc; ++i)
+    {
+      p_hdrs[i]->nFilledLen = 0;
+      p_hdrs[i]->nOffset = 0;
+      sent[i] = now_ns ();
+      rc = OMX_FillThisBuffer (p_hdls[1], p_hdrs[i]);
+    }
+
+  /* Latency is measured from FillThisBuffer to FillBufferDone */
+  while (OMX_ErrorNone == rc && !eos)
+    {
+      rc = ctx_wait_buffer (&ctx, &p_hdr);
+      if (OMX_ErrorNone == rc)
+        {
+          i = (OMX_U32) (intptr_t) p_hdr->pAppPrivate;
+          assert (i < nhdrs);
+          rc = samples_add (&samples, now_ns () - sent[i]);
+          nbytes += p_hdr->nFilledLen;
+          eos = (p_hdr->nFlags & OMX_BUFFERFLAG_EOS) ? OMX_TRUE : OMX_FALSE;
+        }
+      if (OMX_ErrorNone == rc && !eos)
+        {
+          p_hdr->nFilledLen = 0;
+          p_hdr->nOffset = 0;
+          p_hdr->nFlags = 0;
+          sent[i] = now_ns ();
+          rc = OMX_FillThisBuffer (p_hdls[1], p_hdr);
+        }
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      snprintf (extra, sizeof (extra), "\"decoder\":\"%s\",\"bytes\":%llu,",
+                ap_decoder, (unsigned long long) nbytes);
+      report ("pipeline.file_reader_decoder", extra, &samples,
+              now_ns () - start);
+    }
+
+  /* Executing -> Idle -> Loaded */
+  if (allocated)
+    {
+      if (OMX_ErrorNone == state_set (p_hdls, 2, OMX_StateIdle))
+        {
+          (void) ctx_wait_cmds (&ctx, 2);
+        }
+      if (OMX_ErrorNone == state_set (p_hdls, 2, OMX_StateLoaded))
+        {
+          free_buffers (p_hdls[1], 1, p_hdrs, nhdrs);
+          (void) ctx_wait_cmds (&ctx, 2);
+        }
+    }
+  if (tunneled)
+    {
+      (void) OMX_TeardownTunnel (p_hdls[0], 0, p_hdls[1], 0);
+    }
+  for (i = 0; i < 2; ++i)
+    {
+      if (p_hdls[i])
+        {
+          (void) OMX_FreeHandle (p_hdls[i]);
+        }
+    }
+  tiz_mem_free (samples.p_ns);
+  ctx_destroy (&ctx);
+  return rc;
+}
+
+int
+main (int argc, char ** argv)
+{
+  unsigned long iterations = BENCH_DEFAULT_ITERATIONS;
+  const char * p_file = NULL;
+  const char * p_decoder = BENCH_DEFAULT_DECODER;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  int failures = 0;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "n:f:d:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            iterations = strtoul (optarg, NULL, 10);
+            break;
+          case 'f':
+            p_file = optarg;
+            break;
+          case 'd':
+            p_decoder = optarg;
+            break;
+          default:
+            iterations = 0;
+            break;
+        }
+    }
+
+  if (0 == iterations)
+    {
+      fprintf (stderr,
+               "Usage: %s [-n iterations] [-f media_file [-d decoder_name]]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  /* The test configuration, unless the caller has provided one */
+  if (!getenv ("TIZONIA_RC_FILE"))
+    {
+      putenv (TIZ_PLATFORM_RC_FILE_ENV);
+    }
+
+  tiz_log_init ();
+
+  if (OMX_ErrorNone != (rc = OMX_Init ()))
+    {
+      report_failure ("init", rc);
+      tiz_log_deinit ();
+      return EXIT_FAILURE;
+    }
+
+#define BENCH_RUN(name, expr)         \
+  if (OMX_ErrorNone != (rc = (expr))) \
+    {                                 \
+      report_failure (name, rc);      \
+      ++failures;                     \
+    }
+
+  BENCH_RUN ("sched.get_parameter", bench_sched_get_parameter (iterations));
+  BENCH_RUN ("sched.buffer_roundtrip",
+             bench_sched_buffer_roundtrip (iterations));
+  if (p_file)
+    {
+      BENCH_RUN ("pipeline.file_reader_decoder",
+                 bench_pipeline (p_file, p_decoder));
+    }
+
+#undef BENCH_RUN
+
+  (void) OMX_Deinit ();
+  tiz_log_deinit ();
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_bufpool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Buffer payload pool unit tests
+ *
+ *
+ */
+
+
+#define BUFPOOL_TEST_MAX_CACHED (1 << 26) /* larger payloads aren't cached */
+
+static bool
+bufpool_test_is_aligned (const void *ap_buf)
+{
+  return 0 == ((uintptr_t) ap_buf & (TIZ_BUFPOOL_ALIGNMENT - 1));
+}
+
+START_TEST (test_bufpool_alignment)
+{
+  const size_t sizes[] = { 1, 64, 4095, 4096, 4097, 5000, 6000, 1 << 20,
+                           (1 << 21) + 1, BUFPOOL_TEST_MAX_CACHED + 1 };
+  size_t i = 0;
+
+  tiz_bufpool_trim ();
+
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+    {
+      OMX_U8 *p_buf = tiz_bufpool_alloc (sizes[i]);
+      fail_if (NULL == p_buf);
+      fail_if (!bufpool_test_is_aligned (p_buf));
+      /* The whole requested size is usable */
+      memset (p_buf, 0xa5, sizes[i]);
+      tiz_bufpool_free (p_buf);
+    }
+
+  tiz_bufpool_free (NULL);
+  tiz_bufpool_trim ();
+}
+END_TEST
+
+START_TEST (test_bufpool_size_classes)
+{
+  OMX_U8 *p_small = NULL;
+  OMX_U8 *p_mid = NULL;
+  OMX_U8 *p_buf = NULL;
+
+  tiz_bufpool_trim ();
+
+  /* Everything up to 4 KiB shares a class */
+  p_small = tiz_bufpool_alloc (1);
+  tiz_bufpool_free (p_small);
+  p_buf = tiz_bufpool_alloc (4096);
+  fail_if (p_buf != p_small);
+  tiz_bufpool_free (p_buf);
+
+  /* 4097 and 5120 both round up to 5 KiB (4 classes per power of two)... */
+  p_mid = tiz_bufpool_alloc (4097);
+  tiz_bufpool_free (p_mid);
+  p_buf = tiz_bufpool_alloc (5120);
+  fail_if (p_buf != p_mid);
+  tiz_bufpool_free (p_buf);
+
+  /* ...but 5121 belongs to the 6 KiB class, and doesn't get that payload */
+  p_buf = tiz_bufpool_alloc (5121);
+  fail_if (p_buf == p_mid);
+  tiz_bufpool_free (p_buf);
+
+  /* Same thing one octave up: 8193 and 10240 share a class */
+  p_mid = tiz_bufpool_alloc (8193);
+  tiz_bufpool_free (p_mid);
+  p_buf = tiz_bufpool_alloc (10240);
+  fail_if (p_buf != p_mid);
+  tiz_bufpool_free (p_buf);
+
+  tiz_bufpool_trim ();
+}
+END_TEST
+
+START_TEST (test_bufpool_recycling)
+{
+  OMX_U8 *p_first = NULL;
+  OMX_U8 *p_second = NULL;
+  OMX_U8 *p_buf = NULL;
+
+  tiz_bufpool_trim ();
+
+  /* Two payloads of the same class are distinct while both are in use */
+  p_first = tiz_bufpool_alloc (32 * 1024);
+  p_second = tiz_bufpool_alloc (32 * 1024);
+  fail_if (NULL == p_first || NULL == p_second);
+  fail_if (p_first == p_second);
+
+  /* Released payloads are handed out again, most recently released first,
+     and their contents are not cleared */
+  p_first[0] = 0x5a;
+  tiz_bufpool_free (p_second);
+  tiz_bufpool_free (p_first);
+  p_buf = tiz_bufpool_alloc (32 * 1024);
+  fail_if (p_buf != p_first);
+  fail_if (0x5a != p_buf[0]);
+  tiz_bufpool_free (p_buf);
+  p_buf = tiz_bufpool_alloc (32 * 1024);
+  fail_if (p_buf != p_first);
+  p_second = tiz_bufpool_alloc (32 * 1024);
+  fail_if (p_second == p_first);
+  tiz_bufpool_free (p_buf);
+  tiz_bufpool_free (p_second);
+
+  /* Payloads too large to be cached go straight back to the system */
+  p_buf = tiz_bufpool_alloc (BUFPOOL_TEST_MAX_CACHED + 1);
+  fail_if (NULL == p_buf);
+  tiz_bufpool_free (p_buf);
+
+  tiz_bufpool_trim ();
+}
+END_TEST
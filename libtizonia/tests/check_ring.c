@@ -0,0 +1,194 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_ring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Hand-off ring unit tests
+ *
+ *
+ */
+
+#define RING_TEST_NBYTES 1000     /* rounded up to 1024 */
+#define RING_TEST_TOTAL (1 << 22) /* bytes moved by the threaded test */
+
+START_TEST (test_ring_init_and_destroy)
+{
+  tiz_ring_t * p_ring = NULL;
+  OMX_ERRORTYPE error
+    = tiz_ring_init (&p_ring, NULL, NULL, RING_TEST_NBYTES, NULL);
+
+  fail_if (OMX_ErrorNone != error);
+  fail_if (NULL == p_ring);
+  fail_if (1024 != tiz_ring_capacity (p_ring));
+  fail_if (1024 != tiz_ring_writable (p_ring));
+  fail_if (0 != tiz_ring_available (p_ring));
+
+  tiz_ring_destroy (p_ring);
+}
+END_TEST
+
+START_TEST (test_ring_full_and_empty)
+{
+  tiz_ring_t * p_ring = NULL;
+  OMX_U8 src[1500];
+  OMX_U8 dst[1500];
+  size_t i = 0;
+
+  fail_if (OMX_ErrorNone
+           != tiz_ring_init (&p_ring, NULL, NULL, RING_TEST_NBYTES, NULL));
+
+  for (i = 0; i < sizeof (src); ++i)
+    {
+      src[i] = (OMX_U8) i;
+    }
+
+  /* Reading from an empty ring returns nothing */
+  fail_if (0 != tiz_ring_read (p_ring, dst, sizeof (dst)));
+
+  /* A write larger than the capacity is truncated */
+  fail_if (1024 != tiz_ring_write (p_ring, src, sizeof (src)));
+  fail_if (0 != tiz_ring_writable (p_ring));
+  fail_if (1024 != tiz_ring_available (p_ring));
+
+  /* A full ring accepts nothing */
+  fail_if (0 != tiz_ring_write (p_ring, src, 1));
+
+  fail_if (1024 != tiz_ring_read (p_ring, dst, sizeof (dst)));
+  fail_if (0 != memcmp (src, dst, 1024));
+  fail_if (0 != tiz_ring_available (p_ring));
+  fail_if (1024 != tiz_ring_writable (p_ring));
+
+  /* Clearing drops whatever was pending */
+  fail_if (100 != tiz_ring_write (p_ring, src, 100));
+  tiz_ring_clear (p_ring);
+  fail_if (0 != tiz_ring_available (p_ring));
+  fail_if (1024 != tiz_ring_writable (p_ring));
+
+  tiz_ring_destroy (p_ring);
+}
+END_TEST
+
+START_TEST (test_ring_wrap_around)
+{
+  tiz_ring_t * p_ring = NULL;
+  OMX_U8 src[700];
+  OMX_U8 dst[700];
+  OMX_BUFFERHEADERTYPE hdr;
+  size_t i = 0;
+
+  fail_if (OMX_ErrorNone
+           != tiz_ring_init (&p_ring, NULL, NULL, RING_TEST_NBYTES, NULL));
+
+  for (i = 0; i < sizeof (src); ++i)
+    {
+      src[i] = (OMX_U8) (i * 7);
+    }
+
+  /* Move the indexes close to the end of the store */
+  fail_if (700 != tiz_ring_write (p_ring, src, 700));
+  fail_if (700 != tiz_ring_read (p_ring, dst, 700));
+
+  /* This write and read straddle the end of the store */
+  fail_if (700 != tiz_ring_write (p_ring, src, 700));
+  fail_if (700 != tiz_ring_available (p_ring));
+  memset (dst, 0, sizeof (dst));
+  fail_if (500 != tiz_ring_read (p_ring, dst, 500));
+  fail_if (0 != memcmp (src, dst, 500));
+
+  /* Drain the rest into a buffer header, after some existing data */
+  memset (&hdr, 0, sizeof (hdr));
+  memset (dst, 0, sizeof (dst));
+  hdr.pBuffer = dst;
+  hdr.nAllocLen = sizeof (dst);
+  hdr.nOffset = 10;
+  hdr.nFilledLen = 40;
+  fail_if (200 != tiz_ring_read_into_hdr (p_ring, &hdr));
+  fail_if (240 != hdr.nFilledLen);
+  fail_if (0 != memcmp (src + 500, dst + 50, 200));
+  fail_if (0 != tiz_ring_available (p_ring));
+
+  tiz_ring_destroy (p_ring);
+}
+END_TEST
+
+static void *
+ring_producer_thread (void * ap_arg)
+{
+  tiz_ring_t * p_ring = ap_arg;
+  OMX_U8 chunk[333];
+  size_t sent = 0;
+
+  while (sent < RING_TEST_TOTAL)
+    {
+      size_t len = MIN (sizeof (chunk), RING_TEST_TOTAL - sent);
+      size_t written = 0;
+      size_t i = 0;
+      for (i = 0; i < len; ++i)
+        {
+          chunk[i] = (OMX_U8) ((sent + i) % 251);
+        }
+      while (written < len)
+        {
+          written += tiz_ring_write (p_ring, chunk + written, len - written);
+        }
+      sent += len;
+    }
+  return NULL;
+}
+
+START_TEST (test_ring_producer_consumer)
+{
+  tiz_ring_t * p_ring = NULL;
+  pthread_t producer;
+  OMX_U8 dst[517];
+  size_t received = 0;
+  bool in_order = true;
+
+  fail_if (OMX_ErrorNone
+           != tiz_ring_init (&p_ring, NULL, NULL, RING_TEST_NBYTES, NULL));
+  fail_if (0 != pthread_create (&producer, NULL, ring_producer_thread, p_ring));
+
+  while (received < RING_TEST_TOTAL)
+    {
+      size_t nread = tiz_ring_read (p_ring, dst, sizeof (dst));
+      size_t i = 0;
+      for (i = 0; i < nread; ++i)
+        {
+          in_order &= (dst[i] == (OMX_U8) ((received + i) % 251));
+        }
+      received += nread;
+    }
+
+  fail_if (0 != pthread_join (producer, NULL));
+  fail_if (!in_order);
+  fail_if (RING_TEST_TOTAL != received);
+  fail_if (0 != tiz_ring_available (p_ring));
+
+  tiz_ring_destroy (p_ring);
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
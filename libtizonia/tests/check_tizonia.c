@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -40,6 +41,7 @@
 #include <signal.h>
 #include <assert.h>
 #include <limits.h>
+#include <string.h>
 
 #include <OMX_Component.h>
 #include <OMX_TizoniaExt.h>
@@ -49,6 +51,8 @@
 #include "tizscheduler.h"
 #include "tizfsm.h"
 #include "tizkernel.h"
+#include "tizring.h"
+#include "tizbufpool.h"
 
 #include "check_tizonia.h"
 
@@ -57,6 +61,9 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.check"
 #endif
 
+#include "./check_ring.c"
+#include "./check_bufpool.c"
+
 char *pg_rmd_path;
 pid_t g_rmd_pid;
 
@@ -2025,6 +2032,8 @@ Suite *
 tiz_suite (void)
 {
   TCase *tc_tizonia;
+  TCase *tc_ring;
+  TCase *tc_bufpool;
   Suite *s = suite_create ("libtizonia");
 
   putenv(TIZ_PLATFORM_RC_FILE_ENV);
@@ -2072,6 +2081,21 @@ tiz_suite (void)
 
   suite_add_tcase (s, tc_tizonia);
 
+  /* Hand-off ring test cases */
+  tc_ring = tcase_create ("ring");
+  tcase_add_test (tc_ring, test_ring_init_and_destroy);
+  tcase_add_test (tc_ring, test_ring_full_and_empty);
+  tcase_add_test (tc_ring, test_ring_wrap_around);
+  tcase_add_test (tc_ring, test_ring_producer_consumer);
+  suite_add_tcase (s, tc_ring);
+
+  /* Buffer pool test cases */
+  tc_bufpool = tcase_create ("bufpool");
+  tcase_add_test (tc_bufpool, test_bufpool_alignment);
+  tcase_add_test (tc_bufpool, test_bufpool_size_classes);
+  tcase_add_test (tc_bufpool, test_bufpool_recycling);
+  suite_add_tcase (s, tc_bufpool);
+
   return s;
 }
 
@@ -282,6 +282,21 @@ tiz_buffer_seek (tiz_buffer_t * ap_buf, const long offset, const int whence)
   return rc;
 }
 
+int
+tiz_buffer_compact (tiz_buffer_t * ap_buf)
+{
+  int discarded = 0;
+  assert (ap_buf);
+  if (ap_buf->offset > 0)
+    {
+      discarded = ap_buf->offset;
+      memmove (ap_buf->p_store, (ap_buf->p_store + ap_buf->offset),
+               ap_buf->filled_len);
+      ap_buf->offset = 0;
+    }
+  return discarded;
+}
+
 void
 tiz_buffer_clear (tiz_buffer_t * ap_buf)
 {
@@ -190,6 +190,20 @@ int
 tiz_buffer_seek (tiz_buffer_t * ap_buf, const long a_offset,
                  const int a_whence);
 
+/**
+ * @brief Discard the data that precedes the current position marker.
+ *
+ * In TIZ_BUFFER_SEEKABLE mode, data that has been consumed is otherwise
+ * retained so that the position marker can be moved backwards. After this
+ * call, the start of the buffer is the current position.
+ *
+ * @ingroup tizbuffer
+ * @param ap_buf The dynamic buffer handle.
+ * @return The number of bytes discarded.
+ */
+int
+tiz_buffer_compact (tiz_buffer_t * ap_buf);
+
 #ifdef __cplusplus
 }
 #endif
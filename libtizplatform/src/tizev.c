@@ -1020,6 +1020,7 @@ event_loop_thread_func (void * p_arg)
 
   (void) tiz_thread_setname (&(p_event_loop->thread),
                              (const OMX_STRING) TIZ_EVENT_LOOP_THREAD_NAME);
+  (void) tiz_thread_apply_sched_config ("event_loop");
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "Entering the dispatcher...");
   tiz_sem_post (&(p_event_loop->sem));
@@ -1048,17 +1049,8 @@ clean_up_thread_data (tiz_event_loop_t * ap_lp)
           ap_lp->p_loop = NULL;
         }
 
-      if (ap_lp->mutex)
-        {
-          (void) tiz_mutex_destroy (&(ap_lp->mutex));
-          ap_lp->mutex = NULL;
-        }
-
-      if (ap_lp->sem)
-        {
-          (void) tiz_sem_destroy (&(ap_lp->sem));
-          ap_lp->sem = NULL;
-        }
+      (void) tiz_mutex_destroy (&(ap_lp->mutex));
+      (void) tiz_sem_destroy (&(ap_lp->sem));
 
       if (ap_lp->p_pq)
         {
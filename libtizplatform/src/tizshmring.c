@@ -0,0 +1,765 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Cross-process shared-memory slot ring
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shmring"
+#endif
+
+#define TIZ_SHM_RING_MAGIC 0x545a5352 /* "TZSR" */
+#define TIZ_SHM_RING_CACHE_LINE_SIZE 64
+#define TIZ_SHM_RING_MAX_SLOTS (1 << 16)
+#define TIZ_SHM_RING_SOCKET_PREFIX "tizonia-shmring-"
+#define TIZ_SHM_RING_NFDS 3
+#define TIZ_SHM_RING_CONNECT_TIMEOUT_SECS 2
+
+#define TIZ_SHM_RING_ROUND_UP(n) \
+  (((n) + TIZ_SHM_RING_CACHE_LINE_SIZE - 1) \
+   & ~((size_t) TIZ_SHM_RING_CACHE_LINE_SIZE - 1))
+
+/* The shared control block. Indexes are free-running counters. Each side's
+   index lives in its own cache line, next to the flag that the *other* side
+   writes when it is about to sleep, so that the hot path of either side only
+   touches one remote cache line. */
+typedef struct tiz_shm_ring_hdr tiz_shm_ring_hdr_t;
+struct tiz_shm_ring_hdr
+{
+  uint32_t magic;
+  uint32_t nslots;
+  uint32_t slot_size;
+  uint32_t slot_stride;
+  char pad0[TIZ_SHM_RING_CACHE_LINE_SIZE - 4 * sizeof (uint32_t)];
+  uint32_t head;             /* written by the producer */
+  uint32_t consumer_waiting; /* set by the consumer, cleared by the producer */
+  char pad1[TIZ_SHM_RING_CACHE_LINE_SIZE - 2 * sizeof (uint32_t)];
+  uint32_t tail;             /* written by the consumer */
+  uint32_t producer_waiting; /* set by the producer, cleared by the consumer */
+  char pad2[TIZ_SHM_RING_CACHE_LINE_SIZE - 2 * sizeof (uint32_t)];
+};
+
+/* Each slot starts with a cache line that holds the slot's metadata, so that
+   the payload is cache-line aligned. */
+typedef struct tiz_shm_ring_slot tiz_shm_ring_slot_t;
+struct tiz_shm_ring_slot
+{
+  uint32_t nbytes;
+  uint32_t flags;
+  char pad[TIZ_SHM_RING_CACHE_LINE_SIZE - 2 * sizeof (uint32_t)];
+};
+
+struct tiz_shm_ring
+{
+  tiz_shm_ring_hdr_t * p_hdr;
+  OMX_U8 * p_slots;
+  size_t map_size;
+  uint32_t mask;
+  /* Private copies of the layout, validated once on connection; the shared
+     header may be rewritten by the peer at any time */
+  uint32_t nslots;
+  uint32_t slot_size;
+  size_t slot_stride;
+  bool producer;
+  /* The connection between producer and consumer is kept open for as long as
+     the consumer holds the ring; its hang-up tells the producer that the
+     consumer is gone */
+  int peer_fd;
+  int shm_fd;
+  int listen_fd;
+  int data_efd;  /* producer -> consumer */
+  int space_efd; /* consumer -> producer */
+};
+
+static inline uint32_t
+next_pow2 (size_t a_n)
+{
+  uint32_t n = 1;
+  while (n < a_n)
+    {
+      n <<= 1;
+    }
+  return n;
+}
+
+static inline void
+close_fd (int * ap_fd)
+{
+  assert (ap_fd);
+  if (*ap_fd >= 0)
+    {
+      (void) close (*ap_fd);
+      *ap_fd = -1;
+    }
+}
+
+static inline tiz_shm_ring_slot_t *
+slot_at (const tiz_shm_ring_t * ap_ring, const uint32_t a_index)
+{
+  return (tiz_shm_ring_slot_t *) (ap_ring->p_slots
+                                  + (size_t) (a_index & ap_ring->mask)
+                                      * ap_ring->slot_stride);
+}
+
+static inline void
+signal_fd (const int a_fd)
+{
+  const uint64_t one = 1;
+  /* EAGAIN means the counter is saturated, i.e. the peer is already going to
+     wake up */
+  (void) write (a_fd, &one, sizeof (one));
+}
+
+static tiz_shm_ring_t *
+alloc_ring (const bool a_producer)
+{
+  tiz_shm_ring_t * p_ring = tiz_mem_calloc (1, sizeof (tiz_shm_ring_t));
+  if (p_ring)
+    {
+      p_ring->producer = a_producer;
+      p_ring->peer_fd = -1;
+      p_ring->shm_fd = -1;
+      p_ring->listen_fd = -1;
+      p_ring->data_efd = -1;
+      p_ring->space_efd = -1;
+    }
+  return p_ring;
+}
+
+static bool
+channel_address (const char * a_name, struct sockaddr_un * ap_addr,
+                 socklen_t * ap_len)
+{
+  int len = 0;
+  assert (a_name);
+  assert (ap_addr);
+  assert (ap_len);
+
+  /* Abstract namespace: the first byte of sun_path is NUL, so there is no
+     file system entry to clean up if the process dies */
+  memset (ap_addr, 0, sizeof (*ap_addr));
+  ap_addr->sun_family = AF_UNIX;
+  len = snprintf (ap_addr->sun_path + 1, sizeof (ap_addr->sun_path) - 1,
+                  TIZ_SHM_RING_SOCKET_PREFIX "%s", a_name);
+  if (len <= 0 || (size_t) len >= sizeof (ap_addr->sun_path) - 1)
+    {
+      return false;
+    }
+  *ap_len = offsetof (struct sockaddr_un, sun_path) + 1 + len;
+  return true;
+}
+
+static bool
+map_ring (tiz_shm_ring_t * ap_ring, const size_t a_size)
+{
+  void * p_map = NULL;
+  assert (ap_ring);
+  p_map = mmap (NULL, a_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                ap_ring->shm_fd, 0);
+  if (MAP_FAILED == p_map)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "mmap failed [%s]", strerror (errno));
+      return false;
+    }
+  ap_ring->p_hdr = p_map;
+  ap_ring->p_slots = (OMX_U8 *) p_map + sizeof (tiz_shm_ring_hdr_t);
+  ap_ring->map_size = a_size;
+  return true;
+}
+
+static int
+create_shm_object (void)
+{
+  static uint32_t counter = 0;
+  char name[64];
+  int fd = -1;
+
+  (void) snprintf (name, sizeof (name), "/tizonia-shmring-%ld-%u",
+                   (long) getpid (),
+                   __atomic_add_fetch (&counter, 1, __ATOMIC_RELAXED));
+  fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd >= 0)
+    {
+      /* The object stays alive for as long as there are descriptors or
+         mappings referring to it */
+      (void) shm_unlink (name);
+    }
+  return fd;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_create (tiz_shm_ring_ptr_t * app_ring, const char * a_name,
+                     const size_t a_nslots, const size_t a_slot_size)
+{
+  tiz_shm_ring_t * p_ring = NULL;
+  struct sockaddr_un addr;
+  socklen_t addr_len = 0;
+  uint32_t nslots = 0;
+  size_t stride = 0;
+  size_t size = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  assert (app_ring);
+  assert (a_name);
+  assert (a_nslots > 0);
+  assert (a_slot_size > 0);
+
+  if (!channel_address (a_name, &addr, &addr_len))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid channel name [%s]", a_name);
+      return OMX_ErrorContentURIError;
+    }
+
+  nslots = next_pow2 (MIN (a_nslots, TIZ_SHM_RING_MAX_SLOTS));
+  stride = sizeof (tiz_shm_ring_slot_t) + TIZ_SHM_RING_ROUND_UP (a_slot_size);
+  size = sizeof (tiz_shm_ring_hdr_t) + nslots * stride;
+
+  if (!(p_ring = alloc_ring (true)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_ring->listen_fd = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (p_ring->listen_fd < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "socket failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  if (0 != bind (p_ring->listen_fd, (struct sockaddr *) &addr, addr_len))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to bind channel [%s] [%s]", a_name,
+               strerror (errno));
+      rc = (EADDRINUSE == errno ? OMX_ErrorContentURIError
+                                : OMX_ErrorInsufficientResources);
+      goto end;
+    }
+
+  if (0 != listen (p_ring->listen_fd, 1))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "listen failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  p_ring->data_efd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  p_ring->space_efd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (p_ring->data_efd < 0 || p_ring->space_efd < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "eventfd failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  if ((p_ring->shm_fd = create_shm_object ()) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "shm_open failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  if (0 != ftruncate (p_ring->shm_fd, size) || !map_ring (p_ring, size))
+    {
+      goto end;
+    }
+
+  /* ftruncate has zero-filled the object, so head, tail and the flags all
+     start at zero */
+  p_ring->mask = nslots - 1;
+  p_ring->nslots = nslots;
+  p_ring->slot_size = TIZ_SHM_RING_ROUND_UP (a_slot_size);
+  p_ring->slot_stride = stride;
+  p_ring->p_hdr->nslots = p_ring->nslots;
+  p_ring->p_hdr->slot_size = p_ring->slot_size;
+  p_ring->p_hdr->slot_stride = p_ring->slot_stride;
+  __atomic_store_n (&(p_ring->p_hdr->magic), TIZ_SHM_RING_MAGIC,
+                    __ATOMIC_RELEASE);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE,
+           "Channel [%s] : [%u] slots of [%u] bytes ([%lu] bytes mapped)",
+           a_name, nslots, p_ring->slot_size, (unsigned long) size);
+
+  *app_ring = p_ring;
+  p_ring = NULL;
+  rc = OMX_ErrorNone;
+
+end:
+
+  tiz_shm_ring_destroy (p_ring);
+  return rc;
+}
+
+static bool
+receive_fds (const int a_sock, int * ap_fds)
+{
+  uint32_t magic = 0;
+  struct iovec iov;
+  struct msghdr msg;
+  struct cmsghdr * p_cmsg = NULL;
+  union
+  {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (TIZ_SHM_RING_NFDS * sizeof (int))];
+  } ctrl;
+  ssize_t n = 0;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = &magic;
+  iov.iov_len = sizeof (magic);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+
+  do
+    {
+      n = recvmsg (a_sock, &msg, MSG_CMSG_CLOEXEC);
+    }
+  while (n < 0 && EINTR == errno);
+
+  if (n != sizeof (magic) || TIZ_SHM_RING_MAGIC != magic)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Handshake failed [%s]",
+               n < 0 ? strerror (errno) : "bad message");
+      return false;
+    }
+
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  if (!p_cmsg || SOL_SOCKET != p_cmsg->cmsg_level
+      || SCM_RIGHTS != p_cmsg->cmsg_type
+      || p_cmsg->cmsg_len != CMSG_LEN (TIZ_SHM_RING_NFDS * sizeof (int)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Handshake failed [no descriptors]");
+      return false;
+    }
+
+  memcpy (ap_fds, CMSG_DATA (p_cmsg), TIZ_SHM_RING_NFDS * sizeof (int));
+  return true;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_connect (tiz_shm_ring_ptr_t * app_ring, const char * a_name)
+{
+  tiz_shm_ring_t * p_ring = NULL;
+  struct sockaddr_un addr;
+  socklen_t addr_len = 0;
+  struct timeval tv;
+  struct stat st;
+  int sock = -1;
+  int fds[TIZ_SHM_RING_NFDS];
+  const tiz_shm_ring_hdr_t * p_hdr = NULL;
+  uint32_t nslots = 0;
+  uint32_t slot_size = 0;
+  uint32_t slot_stride = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  assert (app_ring);
+  assert (a_name);
+
+  if (!channel_address (a_name, &addr, &addr_len))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid channel name [%s]", a_name);
+      return OMX_ErrorContentURIError;
+    }
+
+  if (!(p_ring = alloc_ring (false)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if ((sock = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "socket failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  if (0 != connect (sock, (struct sockaddr *) &addr, addr_len))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "No producer found for channel [%s] [%s]",
+               a_name, strerror (errno));
+      rc = OMX_ErrorContentURIError;
+      goto end;
+    }
+
+  /* The producer accepts from its own event loop; don't wait forever if it
+     is stuck */
+  tv.tv_sec = TIZ_SHM_RING_CONNECT_TIMEOUT_SECS;
+  tv.tv_usec = 0;
+  (void) setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+
+  if (!receive_fds (sock, fds))
+    {
+      goto end;
+    }
+
+  p_ring->shm_fd = fds[0];
+  p_ring->data_efd = fds[1];
+  p_ring->space_efd = fds[2];
+
+  if (0 != fstat (p_ring->shm_fd, &st)
+      || (size_t) st.st_size < sizeof (tiz_shm_ring_hdr_t)
+      || !map_ring (p_ring, st.st_size))
+    {
+      goto end;
+    }
+
+  /* Read the layout once; what gets validated is what gets used */
+  p_hdr = p_ring->p_hdr;
+  nslots = __atomic_load_n (&(p_hdr->nslots), __ATOMIC_RELAXED);
+  slot_size = __atomic_load_n (&(p_hdr->slot_size), __ATOMIC_RELAXED);
+  slot_stride = __atomic_load_n (&(p_hdr->slot_stride), __ATOMIC_RELAXED);
+  if (TIZ_SHM_RING_MAGIC != __atomic_load_n (&(p_hdr->magic), __ATOMIC_ACQUIRE)
+      || 0 == nslots || nslots > TIZ_SHM_RING_MAX_SLOTS
+      || (nslots & (nslots - 1)) != 0
+      || slot_stride < sizeof (tiz_shm_ring_slot_t) + (size_t) slot_size
+      || sizeof (tiz_shm_ring_hdr_t) + (size_t) nslots * slot_stride
+           > p_ring->map_size)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Channel [%s] : invalid ring layout",
+               a_name);
+      goto end;
+    }
+
+  /* The mapping keeps the object alive */
+  close_fd (&(p_ring->shm_fd));
+  p_ring->mask = nslots - 1;
+  p_ring->nslots = nslots;
+  p_ring->slot_size = slot_size;
+  p_ring->slot_stride = slot_stride;
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Connected to channel [%s] : [%u] slots",
+           a_name, nslots);
+
+  /* Hold on to the connection; closing it releases the ring */
+  p_ring->peer_fd = sock;
+  sock = -1;
+
+  *app_ring = p_ring;
+  p_ring = NULL;
+  rc = OMX_ErrorNone;
+
+end:
+
+  close_fd (&sock);
+  tiz_shm_ring_destroy (p_ring);
+  return rc;
+}
+
+void
+tiz_shm_ring_destroy (tiz_shm_ring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      if (ap_ring->p_hdr)
+        {
+          (void) munmap (ap_ring->p_hdr, ap_ring->map_size);
+        }
+      close_fd (&(ap_ring->peer_fd));
+      close_fd (&(ap_ring->shm_fd));
+      close_fd (&(ap_ring->listen_fd));
+      close_fd (&(ap_ring->data_efd));
+      close_fd (&(ap_ring->space_efd));
+      tiz_mem_free (ap_ring);
+    }
+}
+
+size_t
+tiz_shm_ring_slot_size (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->slot_size;
+}
+
+int
+tiz_shm_ring_listen_fd (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->listen_fd;
+}
+
+static bool
+has_live_consumer (tiz_shm_ring_t * ap_ring)
+{
+  struct pollfd pfd;
+  assert (ap_ring);
+
+  if (ap_ring->peer_fd < 0)
+    {
+      return false;
+    }
+
+  /* The consumer never writes to the connection; any event on it is the
+     consumer hanging up */
+  pfd.fd = ap_ring->peer_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll (&pfd, 1, 0) > 0 && 0 != pfd.revents)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Consumer has detached from the ring");
+      close_fd (&(ap_ring->peer_fd));
+      return false;
+    }
+  return true;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_accept (tiz_shm_ring_t * ap_ring)
+{
+  const uint32_t magic = TIZ_SHM_RING_MAGIC;
+  int fds[TIZ_SHM_RING_NFDS];
+  struct iovec iov;
+  struct msghdr msg;
+  struct cmsghdr * p_cmsg = NULL;
+  union
+  {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (TIZ_SHM_RING_NFDS * sizeof (int))];
+  } ctrl;
+  int sock = -1;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  assert (ap_ring);
+  assert (ap_ring->producer);
+
+  if ((sock = accept4 (ap_ring->listen_fd, NULL, NULL, SOCK_CLOEXEC)) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "accept failed [%s]", strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (has_live_consumer (ap_ring))
+    {
+      /* Single consumer only: a second one would race the first on the read
+         index. Closing the socket makes the reader's handshake fail. */
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Channel already has a consumer");
+      close_fd (&sock);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  fds[0] = ap_ring->shm_fd;
+  fds[1] = ap_ring->data_efd;
+  fds[2] = ap_ring->space_efd;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&ctrl, 0, sizeof (ctrl));
+  iov.iov_base = (void *) &magic;
+  iov.iov_len = sizeof (magic);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  p_cmsg->cmsg_level = SOL_SOCKET;
+  p_cmsg->cmsg_type = SCM_RIGHTS;
+  p_cmsg->cmsg_len = CMSG_LEN (sizeof (fds));
+  memcpy (CMSG_DATA (p_cmsg), fds, sizeof (fds));
+
+  if (sendmsg (sock, &msg, MSG_NOSIGNAL) == sizeof (magic))
+    {
+      /* A consumer that is waiting for data must learn about what was
+         published before it connected */
+      signal_fd (ap_ring->data_efd);
+      ap_ring->peer_fd = sock;
+      sock = -1;
+      rc = OMX_ErrorNone;
+    }
+  else
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "sendmsg failed [%s]", strerror (errno));
+    }
+
+  close_fd (&sock);
+  return rc;
+}
+
+int
+tiz_shm_ring_notify_fd (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->producer ? ap_ring->space_efd : ap_ring->data_efd;
+}
+
+void
+tiz_shm_ring_clear_notification (tiz_shm_ring_t * ap_ring)
+{
+  uint64_t count = 0;
+  assert (ap_ring);
+  (void) read (tiz_shm_ring_notify_fd (ap_ring), &count, sizeof (count));
+}
+
+bool
+tiz_shm_ring_prepare_to_wait (tiz_shm_ring_t * ap_ring)
+{
+  tiz_shm_ring_hdr_t * p_hdr = NULL;
+  uint32_t * p_waiting = NULL;
+  bool ready = false;
+
+  assert (ap_ring);
+  p_hdr = ap_ring->p_hdr;
+  p_waiting
+    = ap_ring->producer ? &(p_hdr->producer_waiting) : &(p_hdr->consumer_waiting);
+
+  /* Announce first, then re-check. Together with the peer's 'update index,
+     then check flag' sequence (both sequentially consistent), this
+     guarantees that either we see the peer's progress here, or the peer sees
+     our flag and signals the descriptor. */
+  __atomic_store_n (p_waiting, 1, __ATOMIC_SEQ_CST);
+  if (ap_ring->producer)
+    {
+      ready = (p_hdr->head - __atomic_load_n (&(p_hdr->tail), __ATOMIC_SEQ_CST))
+              < ap_ring->nslots;
+    }
+  else
+    {
+      ready = __atomic_load_n (&(p_hdr->head), __ATOMIC_SEQ_CST) != p_hdr->tail;
+    }
+
+  if (ready)
+    {
+      __atomic_store_n (p_waiting, 0, __ATOMIC_RELAXED);
+    }
+  return !ready;
+}
+
+void *
+tiz_shm_ring_claim (tiz_shm_ring_t * ap_ring, size_t * ap_capacity)
+{
+  const tiz_shm_ring_hdr_t * p_hdr = NULL;
+  uint32_t head = 0;
+
+  assert (ap_ring);
+  assert (ap_ring->producer);
+
+  p_hdr = ap_ring->p_hdr;
+  head = p_hdr->head;
+  if (head - __atomic_load_n (&(p_hdr->tail), __ATOMIC_ACQUIRE)
+      >= ap_ring->nslots)
+    {
+      return NULL;
+    }
+
+  if (ap_capacity)
+    {
+      *ap_capacity = ap_ring->slot_size;
+    }
+  return slot_at (ap_ring, head) + 1;
+}
+
+void
+tiz_shm_ring_publish (tiz_shm_ring_t * ap_ring, const size_t a_nbytes,
+                      const OMX_U32 a_flags)
+{
+  tiz_shm_ring_hdr_t * p_hdr = NULL;
+  tiz_shm_ring_slot_t * p_slot = NULL;
+  uint32_t head = 0;
+
+  assert (ap_ring);
+  assert (ap_ring->producer);
+
+  p_hdr = ap_ring->p_hdr;
+  head = p_hdr->head;
+  assert (head - p_hdr->tail < ap_ring->nslots);
+  assert (a_nbytes <= ap_ring->slot_size);
+
+  p_slot = slot_at (ap_ring, head);
+  p_slot->nbytes = a_nbytes;
+  p_slot->flags = a_flags;
+  __atomic_store_n (&(p_hdr->head), head + 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n (&(p_hdr->consumer_waiting), __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n (&(p_hdr->consumer_waiting), 0, __ATOMIC_SEQ_CST))
+    {
+      signal_fd (ap_ring->data_efd);
+    }
+}
+
+const void *
+tiz_shm_ring_peek (tiz_shm_ring_t * ap_ring, size_t * ap_nbytes,
+                   OMX_U32 * ap_flags)
+{
+  const tiz_shm_ring_hdr_t * p_hdr = NULL;
+  const tiz_shm_ring_slot_t * p_slot = NULL;
+  uint32_t tail = 0;
+
+  assert (ap_ring);
+  assert (!ap_ring->producer);
+  assert (ap_nbytes);
+
+  p_hdr = ap_ring->p_hdr;
+  tail = p_hdr->tail;
+  if (__atomic_load_n (&(p_hdr->head), __ATOMIC_ACQUIRE) == tail)
+    {
+      return NULL;
+    }
+
+  p_slot = slot_at (ap_ring, tail);
+  /* Never trust the peer with the slot boundaries */
+  *ap_nbytes = MIN (p_slot->nbytes, ap_ring->slot_size);
+  if (ap_flags)
+    {
+      *ap_flags = p_slot->flags;
+    }
+  return p_slot + 1;
+}
+
+void
+tiz_shm_ring_consume (tiz_shm_ring_t * ap_ring)
+{
+  tiz_shm_ring_hdr_t * p_hdr = NULL;
+
+  assert (ap_ring);
+  assert (!ap_ring->producer);
+
+  p_hdr = ap_ring->p_hdr;
+  assert (p_hdr->head != p_hdr->tail);
+  __atomic_store_n (&(p_hdr->tail), p_hdr->tail + 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_load_n (&(p_hdr->producer_waiting), __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n (&(p_hdr->producer_waiting), 0, __ATOMIC_SEQ_CST))
+    {
+      signal_fd (ap_ring->space_efd);
+    }
+}
@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Cross-process shared-memory slot ring
+ *
+ *
+ */
+
+#ifndef TIZSHMRING_H
+#define TIZSHMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @defgroup tizshmring Cross-process, single-producer/single-consumer ring of
+* fixed-size slots in shared memory.
+*
+* The producer creates the ring (a POSIX shared memory object) and publishes
+* it under a channel name. A consumer, typically living in another process,
+* connects to the channel by name and maps the same memory. The ring's
+* descriptors are handed over through a local (abstract namespace) unix
+* socket; after that, data never goes through the kernel: the producer writes
+* straight into a slot and the consumer reads straight from it.
+*
+* Each side exposes a pollable 'notification' file descriptor (an eventfd) so
+* that the ring can be integrated in the component's event loop. A side only
+* signals its peer when the peer has announced that it is about to sleep (see
+* @ref tiz_shm_ring_prepare_to_wait), so in steady state publishing and
+* consuming slots involves no system calls at all.
+*
+* @ingroup libtizplatform
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Shared-memory ring opaque handle.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shm_ring tiz_shm_ring_t;
+typedef /*@null@ */ tiz_shm_ring_t * tiz_shm_ring_ptr_t;
+
+/**
+ * Create a new ring and publish it under a channel name (producer side).
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param a_name The channel name. Only one producer per channel name may exist
+ * on a given host at any time.
+ * @param a_nslots The minimum number of slots in the ring. The actual number
+ * of slots is rounded up to the next power of two.
+ * @param a_slot_size The payload capacity of each slot, in bytes.
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources if the
+ * ring could not be created, or OMX_ErrorContentURIError if the channel name
+ * is already in use.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_create (tiz_shm_ring_ptr_t * app_ring, const char * a_name,
+                     const size_t a_nslots, const size_t a_slot_size);
+
+/**
+ * Connect to an existing ring (consumer side).
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param a_name The channel name used by the producer.
+ * @return OMX_ErrorNone on success, OMX_ErrorContentURIError if no producer
+ * is found for the channel, or OMX_ErrorInsufficientResources on any other
+ * error.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_connect (tiz_shm_ring_ptr_t * app_ring, const char * a_name);
+
+/**
+ * Unmap the ring and close all its descriptors.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_destroy (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Retrieve the payload capacity of a slot.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return The slot size, in bytes.
+ */
+size_t
+tiz_shm_ring_slot_size (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * Retrieve the descriptor where consumers' connection requests arrive
+ * (producer side). The producer must call @ref tiz_shm_ring_accept when the
+ * descriptor becomes readable.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return The listening socket descriptor, or -1 on the consumer side.
+ */
+int
+tiz_shm_ring_listen_fd (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * Accept a pending consumer and hand it the ring's descriptors (producer
+ * side). The ring has a single consumer: while one holds the ring, further
+ * connection requests are refused, and their handshake fails. Once that
+ * consumer has destroyed its handle (or its process is gone), a new one may
+ * connect and carry on from the ring's current read position.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources if the
+ * consumer could not be accepted or the ring already has a live one.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_accept (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Retrieve the descriptor that becomes readable when the peer has made
+ * progress: new data published (consumer side) or slots released (producer
+ * side).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return The notification descriptor.
+ */
+int
+tiz_shm_ring_notify_fd (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * Reset the notification descriptor after it has been found readable.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_clear_notification (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Announce that the caller is about to wait on the notification descriptor.
+ *
+ * After this, the peer will signal the descriptor on its next publish
+ * (consumer waiting) or consume (producer waiting) operation. The ring is
+ * re-checked after the announcement, so that no wake-up can be lost.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return true if the caller should wait on the notification descriptor,
+ * false if the ring is already ready (i.e. the caller should retry without
+ * waiting).
+ */
+bool
+tiz_shm_ring_prepare_to_wait (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Obtain the next free slot (producer side).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param ap_capacity On return, the payload capacity of the slot (optional).
+ * @return A pointer to the slot's payload area, or NULL if the ring is full.
+ */
+void *
+tiz_shm_ring_claim (tiz_shm_ring_t * ap_ring, size_t * ap_capacity);
+
+/**
+ * Make the slot previously obtained with @ref tiz_shm_ring_claim visible to
+ * the consumer (producer side).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_nbytes The number of bytes written in the slot.
+ * @param a_flags Opaque flags to be delivered along with the data (e.g.
+ * OpenMAX IL buffer flags).
+ */
+void
+tiz_shm_ring_publish (tiz_shm_ring_t * ap_ring, const size_t a_nbytes,
+                      const OMX_U32 a_flags);
+
+/**
+ * Obtain the oldest published slot (consumer side).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param ap_nbytes On return, the number of bytes in the slot.
+ * @param ap_flags On return, the flags that were published with the slot
+ * (optional).
+ * @return A pointer to the slot's payload area, or NULL if the ring is empty.
+ */
+const void *
+tiz_shm_ring_peek (tiz_shm_ring_t * ap_ring, size_t * ap_nbytes,
+                   OMX_U32 * ap_flags);
+
+/**
+ * Release the slot previously obtained with @ref tiz_shm_ring_peek back to
+ * the producer (consumer side).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_consume (tiz_shm_ring_t * ap_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHMRING_H */
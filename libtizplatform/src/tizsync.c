@@ -34,427 +34,481 @@
 
 #include <string.h>
 #include <errno.h>
-#include <sys/time.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <pthread.h>
-#include <semaphore.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.platform.sync"
 #endif
 
-#define SEM_SUCCESS 0
 #define PTHREAD_SUCCESS 0
 
-OMX_ERRORTYPE
-tiz_sem_init (tiz_sem_t * app_sem, OMX_U32 a_value)
+/* Mutex states */
+#define TIZ_MUTEX_UNLOCKED 0
+#define TIZ_MUTEX_LOCKED 1
+#define TIZ_MUTEX_CONTENDED 2
+
+/* How many times a contended lock polls the owner before going to sleep */
+#define TIZ_MUTEX_SPIN_COUNT 100
+
+#ifdef TIZ_SYNC_STATS
+#define sync_count(counter) \
+  (void) __atomic_fetch_add (&(counter), 1, __ATOMIC_RELAXED)
+#else
+#define sync_count(counter) \
+  do                        \
+    {                       \
+    }                       \
+  while (0)
+#endif
+
+static inline int
+futex_wait (int * ap_word, const int a_val, const struct timespec * ap_timeout)
 {
-  sem_t * p_sem = 0;
+  return syscall (SYS_futex, ap_word, FUTEX_WAIT_PRIVATE, a_val, ap_timeout,
+                  NULL, 0);
+}
 
-  assert (app_sem);
+static inline int
+futex_wake (int * ap_word, const int a_nwake)
+{
+  return syscall (SYS_futex, ap_word, FUTEX_WAKE_PRIVATE, a_nwake, NULL, NULL,
+                  0);
+}
 
-  if (!(p_sem = (sem_t *) tiz_mem_alloc (sizeof (sem_t))))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorInsufficientResources");
-      return OMX_ErrorInsufficientResources;
-    }
+static inline void
+cpu_relax (void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__ ("pause" ::: "memory");
+#else
+  __asm__ __volatile__ ("" ::: "memory");
+#endif
+}
 
-  if (SEM_SUCCESS != sem_init (p_sem, 0, a_value))
+/* Returns the value the word had; the swap happened if that is a_expected */
+static inline int
+cas (int * ap_word, int a_expected, const int a_desired)
+{
+  (void) __atomic_compare_exchange_n (ap_word, &a_expected, a_desired, false,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+  return a_expected;
+}
+
+static inline void
+millis_to_timespec (const OMX_U32 a_millis, struct timespec * ap_ts)
+{
+  assert (ap_ts);
+  ap_ts->tv_sec = a_millis / 1000;
+  ap_ts->tv_nsec = (a_millis % 1000) * 1000000L;
+}
+
+/* Semaphore handling */
+
+OMX_ERRORTYPE
+tiz_sem_init (tiz_sem_t * ap_sem, OMX_U32 a_value)
+{
+  assert (ap_sem);
+  if (a_value > INT_MAX)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (errno));
-      tiz_mem_free (p_sem);
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : value [%u]", a_value);
       return OMX_ErrorUndefined;
     }
-
-  *app_sem = p_sem;
-
+  ap_sem->value = a_value;
+  ap_sem->nwaiters = 0;
+  ap_sem->ncontended = 0;
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_sem_destroy (tiz_sem_t * app_sem)
+tiz_sem_destroy (tiz_sem_t * ap_sem)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-
-  if (app_sem)
+  if (ap_sem)
     {
-      sem_t * p_sem = *app_sem;
-
-      if (p_sem && (SEM_SUCCESS != sem_destroy (p_sem)))
+      if (__atomic_load_n (&(ap_sem->nwaiters), __ATOMIC_SEQ_CST) > 0)
         {
-          TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s",
-                   strerror (errno));
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "OMX_ErrorUndefined : sem [%p] still has waiters", ap_sem);
           rc = OMX_ErrorUndefined;
         }
-
-      tiz_mem_free (p_sem);
-      *app_sem = 0;
+#ifdef TIZ_SYNC_STATS
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "sem [%p] : [%u] waits blocked", ap_sem,
+               ap_sem->ncontended);
+#endif
     }
-
   return rc;
 }
 
 OMX_ERRORTYPE
-tiz_sem_wait (tiz_sem_t * app_sem)
+tiz_sem_wait (tiz_sem_t * ap_sem)
 {
-  sem_t * p_sem;
-
-  assert (app_sem);
-  assert (*app_sem);
+  int value = 0;
+  bool counted = false;
 
-  p_sem = *app_sem;
+  assert (ap_sem);
 
-  if (SEM_SUCCESS != sem_wait (p_sem))
+  value = __atomic_load_n (&(ap_sem->value), __ATOMIC_RELAXED);
+  for (;;)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (errno));
-      return OMX_ErrorUndefined;
-    }
+      while (value > 0)
+        {
+          if (__atomic_compare_exchange_n (&(ap_sem->value), &value, value - 1,
+                                           true, __ATOMIC_ACQUIRE,
+                                           __ATOMIC_RELAXED))
+            {
+              return OMX_ErrorNone;
+            }
+        }
 
-  return OMX_ErrorNone;
+      if (!counted)
+        {
+          sync_count (ap_sem->ncontended);
+          counted = true;
+        }
+
+      /* The kernel re-checks the value, so a post that slips in between is
+         not lost */
+      (void) __atomic_fetch_add (&(ap_sem->nwaiters), 1, __ATOMIC_SEQ_CST);
+      (void) futex_wait (&(ap_sem->value), 0, NULL);
+      (void) __atomic_fetch_sub (&(ap_sem->nwaiters), 1, __ATOMIC_SEQ_CST);
+      value = __atomic_load_n (&(ap_sem->value), __ATOMIC_RELAXED);
+    }
 }
 
 OMX_ERRORTYPE
-tiz_sem_post (tiz_sem_t * app_sem)
+tiz_sem_post (tiz_sem_t * ap_sem)
 {
-  sem_t * p_sem;
-
-  assert (app_sem);
-  assert (*app_sem);
+  assert (ap_sem);
 
-  p_sem = *app_sem;
-
-  if (SEM_SUCCESS != sem_post (p_sem))
+  if (__atomic_fetch_add (&(ap_sem->value), 1, __ATOMIC_SEQ_CST) == INT_MAX)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (errno));
+      (void) __atomic_fetch_sub (&(ap_sem->value), 1, __ATOMIC_SEQ_CST);
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s",
+               strerror (EOVERFLOW));
       return OMX_ErrorUndefined;
     }
 
+  /* No system call unless somebody is (about to be) asleep */
+  if (__atomic_load_n (&(ap_sem->nwaiters), __ATOMIC_SEQ_CST) > 0)
+    {
+      (void) futex_wake (&(ap_sem->value), 1);
+    }
+
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_sem_getvalue (tiz_sem_t * app_sem, OMX_S32 * ap_sval)
+tiz_sem_getvalue (tiz_sem_t * ap_sem, OMX_S32 * ap_sval)
 {
-  sem_t * p_sem;
-
-  assert (app_sem);
-  assert (*app_sem);
-
-  p_sem = *app_sem;
-
-  if (SEM_SUCCESS != sem_getvalue (p_sem, (int *) ap_sval))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (errno));
-      return OMX_ErrorUndefined;
-    }
-
+  assert (ap_sem);
+  assert (ap_sval);
+  *ap_sval = __atomic_load_n (&(ap_sem->value), __ATOMIC_RELAXED);
   return OMX_ErrorNone;
 }
 
-OMX_ERRORTYPE
-tiz_mutex_init (tiz_mutex_t * app_mutex)
+OMX_U32
+tiz_sem_get_contention (const tiz_sem_t * ap_sem)
 {
-  pthread_mutex_t * p_mutex;
-  int error = 0;
+  assert (ap_sem);
+  return __atomic_load_n (&(ap_sem->ncontended), __ATOMIC_RELAXED);
+}
+
+/* Mutex handling */
 
-  assert (app_mutex);
+/* Spins for a little while in case the owner is about to let go, then sleeps
+   on the futex, marking the mutex as contended so that the owner knows it
+   has to wake somebody up */
+static void
+mutex_lock_slow (tiz_mutex_t * ap_mutex, int a_state)
+{
+  int spins = 0;
 
-  if (!(p_mutex = (pthread_mutex_t *) tiz_mem_alloc (sizeof (pthread_mutex_t))))
+  assert (ap_mutex);
+  sync_count (ap_mutex->ncontended);
+
+  for (spins = 0; spins < TIZ_MUTEX_SPIN_COUNT
+                  && TIZ_MUTEX_CONTENDED != a_state;
+       ++spins)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorInsufficientResources");
-      return OMX_ErrorInsufficientResources;
+      cpu_relax ();
+      a_state = __atomic_load_n (&(ap_mutex->state), __ATOMIC_RELAXED);
+      if (TIZ_MUTEX_UNLOCKED == a_state
+          && TIZ_MUTEX_UNLOCKED
+               == (a_state = cas (&(ap_mutex->state), TIZ_MUTEX_UNLOCKED,
+                                  TIZ_MUTEX_LOCKED)))
+        {
+          return;
+        }
     }
 
-  if (PTHREAD_SUCCESS != (error = pthread_mutex_init (p_mutex, NULL)))
+  if (TIZ_MUTEX_CONTENDED != a_state)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      tiz_mem_free (p_mutex);
-      return OMX_ErrorUndefined;
+      a_state = __atomic_exchange_n (&(ap_mutex->state), TIZ_MUTEX_CONTENDED,
+                                     __ATOMIC_ACQUIRE);
     }
 
-  *app_mutex = p_mutex;
+  while (TIZ_MUTEX_UNLOCKED != a_state)
+    {
+      (void) futex_wait (&(ap_mutex->state), TIZ_MUTEX_CONTENDED, NULL);
+      a_state = __atomic_exchange_n (&(ap_mutex->state), TIZ_MUTEX_CONTENDED,
+                                     __ATOMIC_ACQUIRE);
+    }
+}
+
+/* Used after a condition wait, when other threads may be queued too */
+static void
+mutex_lock_contended (tiz_mutex_t * ap_mutex)
+{
+  assert (ap_mutex);
+  while (TIZ_MUTEX_UNLOCKED
+         != __atomic_exchange_n (&(ap_mutex->state), TIZ_MUTEX_CONTENDED,
+                                 __ATOMIC_ACQUIRE))
+    {
+      (void) futex_wait (&(ap_mutex->state), TIZ_MUTEX_CONTENDED, NULL);
+    }
+}
 
+OMX_ERRORTYPE
+tiz_mutex_init (tiz_mutex_t * ap_mutex)
+{
+  assert (ap_mutex);
+  ap_mutex->state = TIZ_MUTEX_UNLOCKED;
+  ap_mutex->ncontended = 0;
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_mutex_destroy (tiz_mutex_t * app_mutex)
+tiz_mutex_destroy (tiz_mutex_t * ap_mutex)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-
-  if (NULL == app_mutex)
+  if (ap_mutex)
     {
-      return rc;
+      if (TIZ_MUTEX_UNLOCKED
+          != __atomic_load_n (&(ap_mutex->state), __ATOMIC_RELAXED))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s",
+                   strerror (EBUSY));
+          rc = OMX_ErrorUndefined;
+        }
+#ifdef TIZ_SYNC_STATS
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "mutex [%p] : [%u] locks contended",
+               ap_mutex, ap_mutex->ncontended);
+#endif
     }
-
-  {
-    int error = 0;
-    pthread_mutex_t * p_mutex = *app_mutex;
-
-    if (p_mutex
-        && (PTHREAD_SUCCESS != (error = pthread_mutex_destroy (p_mutex))))
-      {
-        TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s",
-                 strerror (error));
-        rc = OMX_ErrorUndefined;
-      }
-
-    tiz_mem_free (p_mutex);
-    *app_mutex = 0;
-  }
-
   return rc;
 }
 
 OMX_ERRORTYPE
-tiz_mutex_lock (tiz_mutex_t * app_mutex)
+tiz_mutex_lock (tiz_mutex_t * ap_mutex)
 {
-  pthread_mutex_t * p_mutex;
-  int error;
+  int state = TIZ_MUTEX_UNLOCKED;
 
-  assert (app_mutex);
-  assert (*app_mutex);
+  assert (ap_mutex);
 
-  p_mutex = *app_mutex;
-
-  if (PTHREAD_SUCCESS != (error = pthread_mutex_lock (p_mutex)))
+  /* Uncontended case: a single atomic instruction */
+  if (TIZ_MUTEX_UNLOCKED
+      != (state = cas (&(ap_mutex->state), TIZ_MUTEX_UNLOCKED,
+                       TIZ_MUTEX_LOCKED)))
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
+      mutex_lock_slow (ap_mutex, state);
     }
 
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_mutex_unlock (tiz_mutex_t * app_mutex)
+tiz_mutex_unlock (tiz_mutex_t * ap_mutex)
 {
-  pthread_mutex_t * p_mutex;
-  int error;
-
-  assert (app_mutex);
-  assert (*app_mutex);
-
-  p_mutex = *app_mutex;
+  assert (ap_mutex);
+  assert (TIZ_MUTEX_UNLOCKED
+          != __atomic_load_n (&(ap_mutex->state), __ATOMIC_RELAXED));
 
-  if (PTHREAD_SUCCESS != (error = pthread_mutex_unlock (p_mutex)))
+  /* Uncontended case: a single atomic instruction, no system call */
+  if (TIZ_MUTEX_LOCKED
+      != __atomic_fetch_sub (&(ap_mutex->state), 1, __ATOMIC_RELEASE))
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
+      __atomic_store_n (&(ap_mutex->state), TIZ_MUTEX_UNLOCKED,
+                        __ATOMIC_RELEASE);
+      (void) futex_wake (&(ap_mutex->state), 1);
     }
 
   return OMX_ErrorNone;
 }
 
-OMX_ERRORTYPE
-tiz_cond_init (tiz_cond_t * app_cond)
+OMX_U32
+tiz_mutex_get_contention (const tiz_mutex_t * ap_mutex)
 {
-  pthread_cond_t * p_cond;
-  int error;
-
-  assert (app_cond);
-
-  if (!(p_cond = (pthread_cond_t *) tiz_mem_alloc (sizeof (pthread_cond_t))))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorInsufficientResources");
-      return OMX_ErrorInsufficientResources;
-    }
-
-  if (PTHREAD_SUCCESS != (error = pthread_cond_init (p_cond, NULL)))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      assert (EINVAL != error);
-      tiz_mem_free (p_cond);
-      return OMX_ErrorUndefined;
-    }
+  assert (ap_mutex);
+  return __atomic_load_n (&(ap_mutex->ncontended), __ATOMIC_RELAXED);
+}
 
-  *app_cond = p_cond;
+/* Condition variable handling */
 
+OMX_ERRORTYPE
+tiz_cond_init (tiz_cond_t * ap_cond)
+{
+  assert (ap_cond);
+  ap_cond->seq = 0;
+  ap_cond->nwaiters = 0;
+  ap_cond->ncontended = 0;
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_cond_destroy (tiz_cond_t * app_cond)
+tiz_cond_destroy (tiz_cond_t * ap_cond)
 {
-  pthread_cond_t * p_cond;
-  int error = 0;
-
-  assert (app_cond);
-  p_cond = *app_cond;
-
-  if (p_cond && (PTHREAD_SUCCESS != (error = pthread_cond_destroy (p_cond))))
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_cond);
+  if (__atomic_load_n (&(ap_cond->nwaiters), __ATOMIC_SEQ_CST) > 0)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s",
+               strerror (EBUSY));
+      rc = OMX_ErrorUndefined;
     }
-
-  tiz_mem_free (p_cond);
-  *app_cond = 0;
-
-  return OMX_ErrorNone;
+#ifdef TIZ_SYNC_STATS
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "cond [%p] : [%u] waits", ap_cond,
+           ap_cond->ncontended);
+#endif
+  return rc;
 }
 
-OMX_ERRORTYPE
-tiz_cond_signal (tiz_cond_t * app_cond)
+static OMX_ERRORTYPE
+cond_wait (tiz_cond_t * ap_cond, tiz_mutex_t * ap_mutex,
+           const struct timespec * ap_timeout)
 {
-  pthread_cond_t * p_cond;
+  int seq = 0;
+  int ret = 0;
   int error = 0;
 
-  assert (app_cond);
-  assert (*app_cond);
+  assert (ap_cond);
+  assert (ap_mutex);
+
+  sync_count (ap_cond->ncontended);
 
-  p_cond = *app_cond;
+  /* Registered while the mutex is still held, so a signaller that changes
+     the predicate under the mutex always sees us */
+  (void) __atomic_fetch_add (&(ap_cond->nwaiters), 1, __ATOMIC_SEQ_CST);
+  seq = __atomic_load_n (&(ap_cond->seq), __ATOMIC_SEQ_CST);
 
-  if (PTHREAD_SUCCESS != (error = pthread_cond_signal (p_cond)))
+  (void) tiz_mutex_unlock (ap_mutex);
+  ret = futex_wait (&(ap_cond->seq), seq, ap_timeout);
+  error = errno;
+  (void) __atomic_fetch_sub (&(ap_cond->nwaiters), 1, __ATOMIC_SEQ_CST);
+  mutex_lock_contended (ap_mutex);
+
+  if (-1 == ret && ETIMEDOUT == error)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
+      /* Not an error as such, but callers tell timeouts apart this way */
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "cond [%p] : %s", ap_cond,
+               strerror (error));
       return OMX_ErrorUndefined;
     }
 
+  /* EAGAIN (signalled before we slept) and EINTR are spurious wake-ups,
+     which the caller's predicate loop takes care of */
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_cond_broadcast (tiz_cond_t * app_cond)
+tiz_cond_signal (tiz_cond_t * ap_cond)
 {
-  pthread_cond_t * p_cond;
-  int error = 0;
-
-  assert (app_cond);
-  assert (*app_cond);
-
-  p_cond = *app_cond;
-
-  if (PTHREAD_SUCCESS != (error = pthread_cond_broadcast (p_cond)))
+  assert (ap_cond);
+  (void) __atomic_fetch_add (&(ap_cond->seq), 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&(ap_cond->nwaiters), __ATOMIC_SEQ_CST) > 0)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
+      (void) futex_wake (&(ap_cond->seq), 1);
     }
-
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_cond_wait (tiz_cond_t * app_cond, tiz_mutex_t * app_mutex)
+tiz_cond_broadcast (tiz_cond_t * ap_cond)
 {
-  pthread_cond_t * p_cond;
-  pthread_mutex_t * p_mutex;
-  int error = 0;
-
-  assert (app_cond);
-  assert (app_mutex);
-  assert (*app_cond);
-  assert (*app_mutex);
-
-  p_cond = *app_cond;
-  p_mutex = *app_mutex;
-
-  if (PTHREAD_SUCCESS != (error = pthread_cond_wait (p_cond, p_mutex)))
+  assert (ap_cond);
+  (void) __atomic_fetch_add (&(ap_cond->seq), 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&(ap_cond->nwaiters), __ATOMIC_SEQ_CST) > 0)
     {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
+      (void) futex_wake (&(ap_cond->seq), INT_MAX);
     }
-
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_cond_timedwait (tiz_cond_t * app_cond, tiz_mutex_t * app_mutex,
+tiz_cond_wait (tiz_cond_t * ap_cond, tiz_mutex_t * ap_mutex)
+{
+  return cond_wait (ap_cond, ap_mutex, NULL);
+}
+
+OMX_ERRORTYPE
+tiz_cond_timedwait (tiz_cond_t * ap_cond, tiz_mutex_t * ap_mutex,
                     OMX_U32 a_millis)
 {
-  pthread_cond_t * p_cond;
-  pthread_mutex_t * p_mutex;
-  int error = 0;
-  OMX_U32 timeout_us;
   struct timespec timeout;
-  struct timeval now;
-
-  assert (app_cond);
-  assert (app_mutex);
-  assert (*app_cond);
-  assert (*app_mutex);
-
-  p_cond = *app_cond;
-  p_mutex = *app_mutex;
-
-  gettimeofday (&now, NULL);
-  timeout_us = now.tv_usec + 1000 * a_millis;
-  timeout.tv_sec = now.tv_sec + timeout_us / 1000000;
-  timeout.tv_nsec = (timeout_us % 1000000) * 1000;
-
-  if (PTHREAD_SUCCESS
-      != (error = pthread_cond_timedwait (p_cond, p_mutex, &timeout)))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      return OMX_ErrorUndefined;
-    }
+  millis_to_timespec (a_millis, &timeout);
+  return cond_wait (ap_cond, ap_mutex, &timeout);
+}
 
-  return OMX_ErrorNone;
+OMX_U32
+tiz_cond_get_contention (const tiz_cond_t * ap_cond)
+{
+  assert (ap_cond);
+  return __atomic_load_n (&(ap_cond->ncontended), __ATOMIC_RELAXED);
 }
 
+/* Read-write mutex handling */
+
 OMX_ERRORTYPE
-tiz_rwmutex_init (tiz_rwmutex_t * app_rwmutex)
+tiz_rwmutex_init (tiz_rwmutex_t * ap_rwmutex)
 {
-  pthread_rwlock_t * p_mutex;
   int error = 0;
 
-  assert (app_rwmutex);
-
-  if (!(p_mutex
-        = (pthread_rwlock_t *) tiz_mem_alloc (sizeof (pthread_rwlock_t))))
-    {
-      TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorInsufficientResources");
-      return OMX_ErrorInsufficientResources;
-    }
+  assert (ap_rwmutex);
 
-  if (PTHREAD_SUCCESS != (error = pthread_rwlock_init (p_mutex, NULL)))
+  if (PTHREAD_SUCCESS
+      != (error = pthread_rwlock_init (&(ap_rwmutex->rwlock), NULL)))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
-      tiz_mem_free (p_mutex);
       return OMX_ErrorUndefined;
     }
 
-  *app_rwmutex = p_mutex;
-
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_rwmutex_destroy (tiz_rwmutex_t * app_rwmutex)
+tiz_rwmutex_destroy (tiz_rwmutex_t * ap_rwmutex)
 {
-  pthread_rwlock_t * p_mutex;
   int error = 0;
 
-  assert (app_rwmutex);
-  p_mutex = *app_rwmutex;
+  assert (ap_rwmutex);
 
-  if (p_mutex
-      && (PTHREAD_SUCCESS != (error = pthread_rwlock_destroy (p_mutex))))
+  if (PTHREAD_SUCCESS
+      != (error = pthread_rwlock_destroy (&(ap_rwmutex->rwlock))))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
       return OMX_ErrorUndefined;
     }
 
-  tiz_mem_free (p_mutex);
-  *app_rwmutex = 0;
-
   return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
-tiz_rwmutex_rdlock (tiz_rwmutex_t * app_rwmutex)
+tiz_rwmutex_rdlock (tiz_rwmutex_t * ap_rwmutex)
 {
-  pthread_rwlock_t * p_mutex;
-  int error;
-
-  assert (app_rwmutex);
-  assert (*app_rwmutex);
+  int error = 0;
 
-  p_mutex = *app_rwmutex;
+  assert (ap_rwmutex);
 
-  if (PTHREAD_SUCCESS != (error = pthread_rwlock_rdlock (p_mutex)))
+  if (PTHREAD_SUCCESS
+      != (error = pthread_rwlock_rdlock (&(ap_rwmutex->rwlock))))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
       return OMX_ErrorUndefined;
@@ -464,17 +518,14 @@ tiz_rwmutex_rdlock (tiz_rwmutex_t * app_rwmutex)
 }
 
 OMX_ERRORTYPE
-tiz_rwmutex_rwlock (tiz_rwmutex_t * app_rwmutex)
+tiz_rwmutex_rwlock (tiz_rwmutex_t * ap_rwmutex)
 {
-  pthread_rwlock_t * p_mutex;
-  int error;
-
-  assert (app_rwmutex);
-  assert (*app_rwmutex);
+  int error = 0;
 
-  p_mutex = *app_rwmutex;
+  assert (ap_rwmutex);
 
-  if (PTHREAD_SUCCESS != (error = pthread_rwlock_wrlock (p_mutex)))
+  if (PTHREAD_SUCCESS
+      != (error = pthread_rwlock_wrlock (&(ap_rwmutex->rwlock))))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
       return OMX_ErrorUndefined;
@@ -484,17 +535,14 @@ tiz_rwmutex_rwlock (tiz_rwmutex_t * app_rwmutex)
 }
 
 OMX_ERRORTYPE
-tiz_rwmutex_unlock (tiz_rwmutex_t * app_rwmutex)
+tiz_rwmutex_unlock (tiz_rwmutex_t * ap_rwmutex)
 {
-  pthread_rwlock_t * p_mutex;
-  int error;
-
-  assert (app_rwmutex);
-  assert (*app_rwmutex);
+  int error = 0;
 
-  p_mutex = *app_rwmutex;
+  assert (ap_rwmutex);
 
-  if (PTHREAD_SUCCESS != (error = pthread_rwlock_unlock (p_mutex)))
+  if (PTHREAD_SUCCESS
+      != (error = pthread_rwlock_unlock (&(ap_rwmutex->rwlock))))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR, "OMX_ErrorUndefined : %s", strerror (error));
       return OMX_ErrorUndefined;
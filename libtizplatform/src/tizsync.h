@@ -41,35 +41,68 @@ extern "C" {
  * @ingroup libtizplatform
  */
 
+#include <pthread.h>
+
 #include <OMX_Core.h>
 #include <OMX_Types.h>
 
-#define TIZ_STATIC_MUTEX NULL
-#define TIZ_STATIC_CONDITION NULL
+#define TIZ_STATIC_MUTEX \
+  {                      \
+    0, 0                 \
+  }
+#define TIZ_STATIC_CONDITION \
+  {                          \
+    0, 0, 0                  \
+  }
 
 /**
- * Mutex opaque handle.
+ * Mutex. A futex-based lock meant to be embedded in its owner; the
+ * uncontended lock and unlock are a single atomic instruction each. A
+ * zero-filled mutex is a valid, unlocked mutex.
  * @ingroup tizsync
  */
-typedef void * tiz_mutex_t;
+typedef struct tiz_mutex tiz_mutex_t;
+struct tiz_mutex
+{
+  int state;          /* 0: unlocked, 1: locked, 2: locked, maybe waiters */
+  OMX_U32 ncontended; /* Locks that could not be taken straight away */
+};
 
 /**
- * Semaphore opaque handle.
+ * Semaphore. A futex-based counting semaphore meant to be embedded in its
+ * owner.
  * @ingroup tizsync
  */
-typedef void * tiz_sem_t;
+typedef struct tiz_sem tiz_sem_t;
+struct tiz_sem
+{
+  int value;
+  int nwaiters;
+  OMX_U32 ncontended; /* Waits that had to block */
+};
 
 /**
- * Conditional variable opaque handle.
+ * Conditional variable. A futex-based sequence counter meant to be embedded
+ * in its owner.
  * @ingroup tizsync
  */
-typedef void * tiz_cond_t;
+typedef struct tiz_cond tiz_cond_t;
+struct tiz_cond
+{
+  int seq;
+  int nwaiters;
+  OMX_U32 ncontended; /* Waits performed */
+};
 
 /**
- * Read-write mutex opaque handle.
+ * Read-write mutex.
  * @ingroup tizsync
  */
-typedef void * tiz_rwmutex_t;
+typedef struct tiz_rwmutex tiz_rwmutex_t;
+struct tiz_rwmutex
+{
+  pthread_rwlock_t rwlock;
+};
 
 /* Semaphore handling */
 
@@ -78,8 +111,8 @@ typedef void * tiz_rwmutex_t;
  *
  * @ingroup tizsync
  *
- * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources or
- * OMX_ErrorUndefined otherwise.
+ * @return OMX_ErrorNone if success, OMX_ErrorUndefined if a_value is too
+ * large.
  */
 OMX_ERRORTYPE
 tiz_sem_init (/*@out@*/ tiz_sem_t * ap_sem, OMX_U32 a_value);
@@ -124,6 +157,15 @@ tiz_sem_post (tiz_sem_t * ap_sem);
 OMX_ERRORTYPE
 tiz_sem_getvalue (tiz_sem_t * ap_sem, OMX_S32 * ap_sval);
 
+/**
+ * Number of waits on this semaphore that had to block. Only counted when
+ * the library is configured with --enable-sync-stats; zero otherwise.
+ *
+ * @ingroup tizsync
+ */
+OMX_U32
+tiz_sem_get_contention (const tiz_sem_t * ap_sem);
+
 /* Mutex handling APIs */
 
 /**
@@ -131,8 +173,7 @@ tiz_sem_getvalue (tiz_sem_t * ap_sem, OMX_S32 * ap_sval);
  *
  * @ingroup tizsync
  *
- * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources or
- * OMX_ErrorUndefined otherwise.
+ * @return OMX_ErrorNone.
  */
 OMX_ERRORTYPE
 tiz_mutex_init (/*@out@*/ tiz_mutex_t * ap_mutex);
@@ -167,6 +208,16 @@ tiz_mutex_lock (tiz_mutex_t * ap_mutex);
 OMX_ERRORTYPE
 tiz_mutex_unlock (tiz_mutex_t * ap_mutex);
 
+/**
+ * Number of lock attempts on this mutex that found it already taken. Only
+ * counted when the library is configured with --enable-sync-stats; zero
+ * otherwise.
+ *
+ * @ingroup tizsync
+ */
+OMX_U32
+tiz_mutex_get_contention (const tiz_mutex_t * ap_mutex);
+
 /* Read-write mutex handling APIs */
 
 /**
@@ -227,8 +278,7 @@ tiz_rwmutex_unlock (tiz_rwmutex_t * ap_rwmutex);
  *
  * @ingroup tizsync
  *
- * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources or
- * OMX_ErrorUndefined otherwise.
+ * @return OMX_ErrorNone.
  */
 OMX_ERRORTYPE
 tiz_cond_init (tiz_cond_t * ap_cond);
@@ -286,6 +336,15 @@ tiz_cond_timedwait (tiz_cond_t * ap_cond, tiz_mutex_t * ap_mutex,
 OMX_ERRORTYPE
 tiz_cond_broadcast (tiz_cond_t * ap_cond);
 
+/**
+ * Number of waits performed on this condition variable. Only counted when
+ * the library is configured with --enable-sync-stats; zero otherwise.
+ *
+ * @ingroup tizsync
+ */
+OMX_U32
+tiz_cond_get_contention (const tiz_cond_t * ap_cond);
+
 #ifdef __cplusplus
 }
 #endif
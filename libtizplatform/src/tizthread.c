@@ -36,8 +36,12 @@
 
 #include <string.h>
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <sched.h>
 #include <sys/syscall.h>
+#include <sys/resource.h>
 #include <pthread.h>
 #include <assert.h>
 
@@ -55,6 +59,9 @@
 
 #define PTHREAD_SUCCESS 0
 
+#define TIZ_THREAD_SCHED_SECTION "ilcore"
+#define TIZ_THREAD_SCHED_KEY_MAX 128
+
 OMX_ERRORTYPE
 tiz_thread_create (tiz_thread_t * ap_thread, size_t a_stack_size,
                    OMX_U32 a_priority, OMX_PTR (*a_pf_routine) (OMX_PTR),
@@ -137,6 +144,267 @@ tiz_thread_create (tiz_thread_t * ap_thread, size_t a_stack_size,
   return rc;
 }
 
+/* Looks up 'ap_prefix.ap_class' and then 'ap_prefix.<ap_class up to the
+   first dot>' */
+static const char *
+sched_config_value (const char * ap_prefix, const char * ap_class)
+{
+  char key[TIZ_THREAD_SCHED_KEY_MAX];
+  const char * p_value = NULL;
+  const char * p_dot = NULL;
+
+  (void) snprintf (key, sizeof (key), "%s.%s", ap_prefix, ap_class);
+  p_value = tiz_rcfile_get_value (TIZ_THREAD_SCHED_SECTION, key);
+  if (!p_value && (p_dot = strchr (ap_class, '.')))
+    {
+      (void) snprintf (key, sizeof (key), "%s.%.*s", ap_prefix,
+                       (int) (p_dot - ap_class), ap_class);
+      p_value = tiz_rcfile_get_value (TIZ_THREAD_SCHED_SECTION, key);
+    }
+  return p_value;
+}
+
+static bool
+parse_int (const char * ap_str, int * ap_value)
+{
+  char * p_end = NULL;
+  long value = 0;
+
+  assert (ap_str);
+  assert (ap_value);
+
+  errno = 0;
+  value = strtol (ap_str, &p_end, 10);
+  if (errno || p_end == ap_str || *p_end != '\0')
+    {
+      return false;
+    }
+  *ap_value = (int) value;
+  return true;
+}
+
+static OMX_ERRORTYPE
+apply_affinity (const char * ap_class, const char * ap_cpus)
+{
+#ifdef CPU_SET
+  cpu_set_t cpus;
+  const char * p_next = ap_cpus;
+  int error = 0;
+
+  CPU_ZERO (&cpus);
+  while (p_next && *p_next)
+    {
+      char * p_end = NULL;
+      long first = strtol (p_next, &p_end, 10);
+      long last = first;
+
+      if (p_end == p_next || first < 0)
+        {
+          break;
+        }
+      if ('-' == *p_end)
+        {
+          p_next = p_end + 1;
+          last = strtol (p_next, &p_end, 10);
+          if (p_end == p_next || last < first)
+            {
+              break;
+            }
+        }
+      for (; first <= last && first < CPU_SETSIZE; ++first)
+        {
+          CPU_SET (first, &cpus);
+        }
+      p_next = (',' == *p_end) ? p_end + 1 : p_end;
+    }
+
+  if (p_next && *p_next)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : bad cpu list [%s]", ap_class,
+               ap_cpus);
+      return OMX_ErrorUndefined;
+    }
+
+  if (PTHREAD_SUCCESS
+      != (error = pthread_setaffinity_np (pthread_self (), sizeof (cpus),
+                                          &cpus)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "[%s] : could not set the cpu affinity to [%s] (%s). "
+               "Continuing...",
+               ap_class, ap_cpus, strerror (error));
+      return OMX_ErrorUndefined;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : cpu affinity [%s]", ap_class, ap_cpus);
+  return OMX_ErrorNone;
+#else
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] : cpu affinity not supported",
+           ap_class);
+  return OMX_ErrorUndefined;
+#endif
+}
+
+static OMX_ERRORTYPE
+apply_nice (const char * ap_class, int a_nice)
+{
+  struct rlimit limit;
+
+  if (0 == setpriority (PRIO_PROCESS, tiz_thread_id (), a_nice))
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : nice [%d]", ap_class, a_nice);
+      return OMX_ErrorNone;
+    }
+
+  /* An unprivileged thread may still lower its nice value down to the limit
+     set by RLIMIT_NICE (i.e. 20 - rlim_cur) */
+  if ((EACCES == errno || EPERM == errno)
+      && 0 == getrlimit (RLIMIT_NICE, &limit) && RLIM_INFINITY != limit.rlim_cur
+      && limit.rlim_cur > 0 && a_nice < 20 - (int) limit.rlim_cur
+      && 0 == setpriority (PRIO_PROCESS, tiz_thread_id (),
+                           20 - (int) limit.rlim_cur))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "[%s] : nice [%d] not permitted; using [%d] instead", ap_class,
+               a_nice, 20 - (int) limit.rlim_cur);
+      return OMX_ErrorNone;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] : could not set nice [%d] (%s). "
+           "Continuing...", ap_class, a_nice, strerror (errno));
+  return OMX_ErrorUndefined;
+}
+
+static OMX_ERRORTYPE
+apply_policy (const char * ap_class, const int a_policy, int a_priority)
+{
+  struct sched_param param;
+  struct rlimit limit;
+  const int min_prio = sched_get_priority_min (a_policy);
+  const int max_prio = sched_get_priority_max (a_policy);
+  int error = 0;
+
+  a_priority = MAX (min_prio, MIN (a_priority, max_prio));
+  param.sched_priority = a_priority;
+  if (PTHREAD_SUCCESS
+      == (error = pthread_setschedparam (pthread_self (), a_policy, &param)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : policy [%d] priority [%d]",
+               ap_class, a_policy, a_priority);
+      return OMX_ErrorNone;
+    }
+
+  /* Without CAP_SYS_NICE, real-time priorities up to RLIMIT_RTPRIO are
+     still allowed (this is what e.g. PAM's limits.conf grants to the audio
+     group) */
+  if (EPERM == error && SCHED_OTHER != a_policy
+      && 0 == getrlimit (RLIMIT_RTPRIO, &limit)
+      && RLIM_INFINITY != limit.rlim_cur && (int) limit.rlim_cur >= min_prio
+      && (int) limit.rlim_cur < a_priority)
+    {
+      param.sched_priority = (int) limit.rlim_cur;
+      if (PTHREAD_SUCCESS
+          == (error
+              = pthread_setschedparam (pthread_self (), a_policy, &param)))
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "[%s] : priority [%d] not permitted; using [%d] instead",
+                   ap_class, a_priority, param.sched_priority);
+          return OMX_ErrorNone;
+        }
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE,
+           "[%s] : could not set policy [%d] priority [%d] (%s). "
+           "Continuing...",
+           ap_class, a_policy, a_priority, strerror (error));
+  return OMX_ErrorUndefined;
+}
+
+OMX_ERRORTYPE
+tiz_thread_apply_sched_config (const char * ap_class)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const char * p_affinity = NULL;
+  const char * p_policy = NULL;
+  const char * p_priority = NULL;
+  const char * p_nice = NULL;
+  int policy = SCHED_OTHER;
+  int priority = 0;
+  int nice = 0;
+  bool have_nice = false;
+
+  assert (ap_class);
+
+  p_affinity = sched_config_value ("thread-affinity", ap_class);
+  p_policy = sched_config_value ("thread-policy", ap_class);
+  p_priority = sched_config_value ("thread-priority", ap_class);
+  p_nice = sched_config_value ("thread-nice", ap_class);
+
+  if (p_affinity && OMX_ErrorNone != apply_affinity (ap_class, p_affinity))
+    {
+      rc = OMX_ErrorUndefined;
+    }
+
+  if (p_nice && !(have_nice = parse_int (p_nice, &nice)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : bad nice value [%s]", ap_class,
+               p_nice);
+      rc = OMX_ErrorUndefined;
+    }
+
+  if (p_policy)
+    {
+      if (0 == strcmp (p_policy, "fifo"))
+        {
+          policy = SCHED_FIFO;
+        }
+      else if (0 == strcmp (p_policy, "rr"))
+        {
+          policy = SCHED_RR;
+        }
+      else if (0 != strcmp (p_policy, "other"))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : bad policy [%s]", ap_class,
+                   p_policy);
+          rc = OMX_ErrorUndefined;
+        }
+    }
+
+  if (p_priority && !parse_int (p_priority, &priority))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : bad priority [%s]", ap_class,
+               p_priority);
+      rc = OMX_ErrorUndefined;
+    }
+
+  if (SCHED_OTHER != policy)
+    {
+      if (OMX_ErrorNone != apply_policy (ap_class, policy, priority))
+        {
+          rc = OMX_ErrorUndefined;
+          /* Fall back to the nice value, if one is configured */
+          if (have_nice)
+            {
+              (void) apply_nice (ap_class, nice);
+            }
+        }
+    }
+  else
+    {
+      if (p_policy && OMX_ErrorNone != apply_policy (ap_class, policy, 0))
+        {
+          rc = OMX_ErrorUndefined;
+        }
+      if (have_nice && OMX_ErrorNone != apply_nice (ap_class, nice))
+        {
+          rc = OMX_ErrorUndefined;
+        }
+    }
+
+  return rc;
+}
+
 void
 tiz_thread_exit (OMX_PTR a_status)
 {
@@ -86,6 +86,34 @@ tiz_thread_join (tiz_thread_t * ap_thread, void ** app_result);
 OMX_ERRORTYPE
 tiz_thread_setname (tiz_thread_t * ap_thread, const OMX_STRING a_name);
 
+/**
+ * Apply to the calling thread the scheduling settings configured for a
+ * class of threads in the [ilcore] section of tizonia.conf. The settings
+ * are looked up first with the full class name (e.g. 'audio_renderer.pcm')
+ * and then with the part before the first dot (e.g. 'audio_renderer'):
+ *
+ * - thread-affinity.<class> : list of cpus, e.g. '2,3' or '0-1,4'.
+ * - thread-policy.<class> : one of 'other', 'fifo' or 'rr'.
+ * - thread-priority.<class> : real-time priority, for 'fifo' and 'rr'.
+ * - thread-nice.<class> : nice value, for 'other'; also used as a fallback
+ *   when the real-time policy cannot be applied.
+ *
+ * Settings that are not permitted (e.g. no CAP_SYS_NICE and a RLIMIT_RTPRIO
+ * of zero) are degraded to the nearest permitted ones, or skipped, and a
+ * notice is logged. A failure to apply them is never fatal.
+ *
+ * @ingroup tizthread
+ *
+ * @param ap_class The thread class (e.g. a component role, or
+ * 'event_loop').
+ *
+ * @return OMX_ErrorNone if all the configured settings (if any) were
+ * applied, possibly degraded, OMX_ErrorUndefined if one or more were
+ * invalid or could not be applied at all.
+ */
+OMX_ERRORTYPE
+tiz_thread_apply_sched_config (const char * ap_class);
+
 /**
  * Terminate the calling thread.
  *
@@ -0,0 +1,464 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_tizplatform.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Micro-benchmarks
+ *
+ * Each benchmark prints one JSON object per line on stdout (JSON Lines), so
+ * that the results of two runs can be compared by a script. Usage:
+ *
+ *   bench_tizplatform [iterations]
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.bench"
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS 1000000
+#define BENCH_QUEUE_CAPACITY 64
+#define BENCH_PQUEUE_PRIORITIES 4
+#define BENCH_BUFFER_CHUNK 4096
+#define BENCH_SOA_BATCH 64
+
+static OMX_U64
+now_ns (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000000ULL + (OMX_U64) ts.tv_nsec;
+}
+
+static void
+report (const char * ap_name, const unsigned long a_ops,
+        const OMX_U64 a_elapsed_ns)
+{
+  const double ns_per_op
+    = a_ops > 0 ? (double) a_elapsed_ns / (double) a_ops : 0.0;
+  const double ops_per_sec
+    = a_elapsed_ns > 0 ? (double) a_ops * 1e9 / (double) a_elapsed_ns : 0.0;
+  fprintf (stdout,
+           "{\"suite\":\"tizplatform\",\"bench\":\"%s\",\"ops\":%lu,"
+           "\"elapsed_ns\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f}\n",
+           ap_name, a_ops, (unsigned long long) a_elapsed_ns, ns_per_op,
+           ops_per_sec);
+  fflush (stdout);
+}
+
+static void
+report_failure (const char * ap_name, const OMX_ERRORTYPE a_error)
+{
+  fprintf (stdout,
+           "{\"suite\":\"tizplatform\",\"bench\":\"%s\",\"error\":\"%s\"}\n",
+           ap_name, tiz_err_to_str (a_error));
+  fflush (stdout);
+}
+
+/*
+ * tiz_queue
+ */
+
+static OMX_ERRORTYPE
+bench_queue_send_receive (const unsigned long a_iterations)
+{
+  tiz_queue_t * p_q = NULL;
+  OMX_PTR p_data = NULL;
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  int j = 0;
+
+  tiz_check_omx (tiz_queue_init (&p_q, BENCH_QUEUE_CAPACITY));
+
+  /* Fill and drain the queue in batches, so that both the empty and the
+     non-empty paths are exercised */
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_QUEUE_CAPACITY)
+    {
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          (void) tiz_queue_send (p_q, (OMX_PTR) (i + j + 1));
+        }
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          (void) tiz_queue_receive (p_q, &p_data);
+        }
+    }
+  report ("queue.send_receive", i, now_ns () - start);
+
+  tiz_queue_destroy (p_q);
+  return OMX_ErrorNone;
+}
+
+typedef struct bench_queue_peer bench_queue_peer_t;
+struct bench_queue_peer
+{
+  tiz_queue_t * p_q;
+  unsigned long count;
+};
+
+static OMX_PTR
+queue_consumer_thread (OMX_PTR ap_arg)
+{
+  bench_queue_peer_t * p_peer = ap_arg;
+  OMX_PTR p_data = NULL;
+  unsigned long i = 0;
+  assert (p_peer);
+  for (i = 0; i < p_peer->count; ++i)
+    {
+      (void) tiz_queue_receive (p_peer->p_q, &p_data);
+    }
+  return NULL;
+}
+
+static OMX_ERRORTYPE
+bench_queue_producer_consumer (const unsigned long a_iterations)
+{
+  bench_queue_peer_t peer;
+  tiz_thread_t thread;
+  OMX_PTR p_result = NULL;
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+
+  peer.p_q = NULL;
+  peer.count = a_iterations;
+  tiz_check_omx (tiz_queue_init (&peer.p_q, BENCH_QUEUE_CAPACITY));
+
+  start = now_ns ();
+  tiz_check_omx (tiz_thread_create (&thread, 0, 0, queue_consumer_thread,
+                                    &peer));
+  for (i = 0; i < a_iterations; ++i)
+    {
+      (void) tiz_queue_send (peer.p_q, (OMX_PTR) (i + 1));
+    }
+  (void) tiz_thread_join (&thread, &p_result);
+  report ("queue.producer_consumer", a_iterations, now_ns () - start);
+
+  tiz_queue_destroy (peer.p_q);
+  return OMX_ErrorNone;
+}
+
+/*
+ * tiz_pqueue
+ */
+
+static OMX_S32
+pqueue_cmp (OMX_PTR ap_left, OMX_PTR ap_right)
+{
+  return (OMX_S32) ((intptr_t) ap_left - (intptr_t) ap_right);
+}
+
+static OMX_ERRORTYPE
+bench_pqueue_send_receive (const unsigned long a_iterations,
+                           tiz_soa_t * ap_soa, const char * ap_name)
+{
+  tiz_pqueue_t * p_pq = NULL;
+  OMX_PTR p_data = NULL;
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  int j = 0;
+
+  tiz_check_omx (tiz_pqueue_init (&p_pq, BENCH_PQUEUE_PRIORITIES - 1,
+                                  pqueue_cmp, ap_soa, "bench"));
+
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_QUEUE_CAPACITY)
+    {
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          (void) tiz_pqueue_send (p_pq, (OMX_PTR) (i + j + 1),
+                                  j % BENCH_PQUEUE_PRIORITIES);
+        }
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          (void) tiz_pqueue_receive (p_pq, &p_data);
+        }
+    }
+  report (ap_name, i, now_ns () - start);
+
+  tiz_pqueue_destroy (p_pq);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_pqueue_remove (const unsigned long a_iterations)
+{
+  tiz_pqueue_t * p_pq = NULL;
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  int j = 0;
+
+  tiz_check_omx (tiz_pqueue_init (&p_pq, BENCH_PQUEUE_PRIORITIES - 1,
+                                  pqueue_cmp, NULL, "bench"));
+
+  /* Removal by value, the way the kernel retrieves a specific header */
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_QUEUE_CAPACITY)
+    {
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          (void) tiz_pqueue_send (p_pq, (OMX_PTR) (intptr_t) (j + 1),
+                                  j % BENCH_PQUEUE_PRIORITIES);
+        }
+      for (j = BENCH_QUEUE_CAPACITY; j > 0; --j)
+        {
+          (void) tiz_pqueue_remove (p_pq, (OMX_PTR) (intptr_t) j);
+        }
+    }
+  report ("pqueue.send_remove", i, now_ns () - start);
+
+  tiz_pqueue_destroy (p_pq);
+  return OMX_ErrorNone;
+}
+
+/*
+ * tiz_soa
+ */
+
+static OMX_ERRORTYPE
+bench_soa_alloc_free (const unsigned long a_iterations)
+{
+  /* Sizes that map to the different chunk classes */
+  static const size_t sizes[] = {24, 48, 96, 160, 200};
+  const size_t nsizes = sizeof (sizes) / sizeof (sizes[0]);
+  tiz_soa_t * p_soa = NULL;
+  void * p_objs[BENCH_SOA_BATCH];
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  int j = 0;
+
+  tiz_check_omx (tiz_soa_init (&p_soa));
+
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_SOA_BATCH)
+    {
+      for (j = 0; j < BENCH_SOA_BATCH; ++j)
+        {
+          p_objs[j] = tiz_soa_calloc (p_soa, sizes[(i + j) % nsizes]);
+        }
+      for (j = 0; j < BENCH_SOA_BATCH; ++j)
+        {
+          tiz_soa_free (p_soa, p_objs[j]);
+        }
+    }
+  report ("soa.calloc_free", i, now_ns () - start);
+
+  tiz_soa_destroy (p_soa);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_mem_alloc_free (const unsigned long a_iterations)
+{
+  /* Baseline for the soa numbers */
+  static const size_t sizes[] = {24, 48, 96, 160, 200};
+  const size_t nsizes = sizeof (sizes) / sizeof (sizes[0]);
+  void * p_objs[BENCH_SOA_BATCH];
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  int j = 0;
+
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_SOA_BATCH)
+    {
+      for (j = 0; j < BENCH_SOA_BATCH; ++j)
+        {
+          p_objs[j] = tiz_mem_calloc (1, sizes[(i + j) % nsizes]);
+        }
+      for (j = 0; j < BENCH_SOA_BATCH; ++j)
+        {
+          tiz_mem_free (p_objs[j]);
+        }
+    }
+  report ("mem.calloc_free", i, now_ns () - start);
+  return OMX_ErrorNone;
+}
+
+/*
+ * tiz_buffer
+ */
+
+static OMX_ERRORTYPE
+bench_buffer_push_advance (const unsigned long a_iterations)
+{
+  tiz_buffer_t * p_buf = NULL;
+  char chunk[BENCH_BUFFER_CHUNK];
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+
+  memset (chunk, 0xa5, sizeof (chunk));
+  tiz_check_omx (tiz_buffer_init (&p_buf, BENCH_BUFFER_CHUNK * 4));
+
+  /* Two chunks in, one and a half out: the store grows and the consumed
+     data is periodically discarded, as in a demuxer's input store */
+  start = now_ns ();
+  for (i = 0; i < a_iterations; ++i)
+    {
+      (void) tiz_buffer_push (p_buf, chunk, BENCH_BUFFER_CHUNK);
+      (void) tiz_buffer_advance (p_buf, BENCH_BUFFER_CHUNK / 2);
+      if (tiz_buffer_available (p_buf) > BENCH_BUFFER_CHUNK * 8)
+        {
+          (void) tiz_buffer_advance (p_buf, tiz_buffer_available (p_buf));
+          (void) tiz_buffer_compact (p_buf);
+        }
+    }
+  report ("buffer.push_advance", a_iterations, now_ns () - start);
+
+  tiz_buffer_destroy (p_buf);
+  return OMX_ErrorNone;
+}
+
+/*
+ * tiz_vector
+ */
+
+static OMX_ERRORTYPE
+bench_vector_push_back_at (const unsigned long a_iterations)
+{
+  tiz_vector_t * p_vec = NULL;
+  OMX_U64 start = 0;
+  OMX_U64 sum = 0;
+  unsigned long i = 0;
+  OMX_S32 j = 0;
+  OMX_S32 len = 0;
+
+  tiz_check_omx (tiz_vector_init (&p_vec, sizeof (OMX_U64)));
+
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_QUEUE_CAPACITY)
+    {
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          OMX_U64 item = i + j;
+          (void) tiz_vector_push_back (p_vec, &item);
+        }
+      len = tiz_vector_length (p_vec);
+      for (j = 0; j < len; ++j)
+        {
+          sum += *(OMX_U64 *) tiz_vector_at (p_vec, j);
+        }
+      tiz_vector_clear (p_vec);
+    }
+  report ("vector.push_back_at", i, now_ns () - start);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "sum [%llu]", (unsigned long long) sum);
+
+  tiz_vector_destroy (p_vec);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_vector_insert_erase (const unsigned long a_iterations)
+{
+  tiz_vector_t * p_vec = NULL;
+  OMX_U64 start = 0;
+  unsigned long i = 0;
+  OMX_S32 j = 0;
+
+  tiz_check_omx (tiz_vector_init (&p_vec, sizeof (OMX_PTR)));
+
+  /* Front insertion and removal, the worst case for a contiguous vector */
+  start = now_ns ();
+  for (i = 0; i < a_iterations; i += BENCH_QUEUE_CAPACITY)
+    {
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          OMX_PTR p_item = (OMX_PTR) (i + j + 1);
+          (void) tiz_vector_insert (p_vec, &p_item, 0);
+        }
+      for (j = 0; j < BENCH_QUEUE_CAPACITY; ++j)
+        {
+          tiz_vector_erase (p_vec, 0, 1);
+        }
+    }
+  report ("vector.insert_erase_front", i, now_ns () - start);
+
+  tiz_vector_destroy (p_vec);
+  return OMX_ErrorNone;
+}
+
+int
+main (int argc, char ** argv)
+{
+  unsigned long iterations = BENCH_DEFAULT_ITERATIONS;
+  tiz_soa_t * p_soa = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  int failures = 0;
+
+  if (argc > 1)
+    {
+      iterations = strtoul (argv[1], NULL, 10);
+      if (0 == iterations)
+        {
+          fprintf (stderr, "Usage: %s [iterations]\n", argv[0]);
+          return EXIT_FAILURE;
+        }
+    }
+
+  tiz_log_init ();
+
+#define BENCH_RUN(name, expr)    \
+  if (OMX_ErrorNone != (rc = (expr))) \
+    {                            \
+      report_failure (name, rc); \
+      ++failures;                \
+    }
+
+  BENCH_RUN ("queue.send_receive", bench_queue_send_receive (iterations));
+  BENCH_RUN ("queue.producer_consumer",
+             bench_queue_producer_consumer (iterations));
+  BENCH_RUN ("pqueue.send_receive",
+             bench_pqueue_send_receive (iterations, NULL,
+                                        "pqueue.send_receive"));
+  if (OMX_ErrorNone == tiz_soa_init (&p_soa))
+    {
+      BENCH_RUN ("pqueue.send_receive_soa",
+                 bench_pqueue_send_receive (iterations, p_soa,
+                                            "pqueue.send_receive_soa"));
+      tiz_soa_destroy (p_soa);
+    }
+  BENCH_RUN ("pqueue.send_remove", bench_pqueue_remove (iterations / 8));
+  BENCH_RUN ("soa.calloc_free", bench_soa_alloc_free (iterations));
+  BENCH_RUN ("mem.calloc_free", bench_mem_alloc_free (iterations));
+  BENCH_RUN ("buffer.push_advance", bench_buffer_push_advance (iterations));
+  BENCH_RUN ("vector.push_back_at", bench_vector_push_back_at (iterations));
+  BENCH_RUN ("vector.insert_erase_front",
+             bench_vector_insert_erase (iterations / 8));
+
+#undef BENCH_RUN
+
+  tiz_log_deinit ();
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -57,6 +57,62 @@ START_TEST (test_mutex_lock_and_unlock)
 }
 END_TEST
 
+#define MUTEX_TEST_NTHREADS 4
+#define MUTEX_TEST_NITERATIONS 100000
+
+typedef struct mutex_test_data mutex_test_data_t;
+struct mutex_test_data
+{
+  tiz_mutex_t mutex;
+  long counter;
+};
+
+static void *
+mutex_test_thread (void * ap_arg)
+{
+  mutex_test_data_t * p_data = ap_arg;
+  int i = 0;
+  for (i = 0; i < MUTEX_TEST_NITERATIONS; ++i)
+    {
+      tiz_mutex_lock (&(p_data->mutex));
+      p_data->counter++;
+      tiz_mutex_unlock (&(p_data->mutex));
+    }
+  return NULL;
+}
+
+START_TEST (test_mutex_contended_lock)
+{
+
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  mutex_test_data_t data;
+  pthread_t threads[MUTEX_TEST_NTHREADS];
+  int i = 0;
+
+  data.counter = 0;
+  error = tiz_mutex_init (&(data.mutex));
+
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < MUTEX_TEST_NTHREADS; ++i)
+    {
+      fail_if (0 != pthread_create (&threads[i], NULL, mutex_test_thread,
+                                    &data));
+    }
+
+  for (i = 0; i < MUTEX_TEST_NTHREADS; ++i)
+    {
+      fail_if (0 != pthread_join (threads[i], NULL));
+    }
+
+  fail_if (MUTEX_TEST_NTHREADS * MUTEX_TEST_NITERATIONS != data.counter);
+
+  error = tiz_mutex_destroy (&(data.mutex));
+  fail_if (error != OMX_ErrorNone);
+
+}
+END_TEST
+
 START_TEST (test_mutex_init_null)
 {
   OMX_ERRORTYPE error = tiz_mutex_init (0);
@@ -0,0 +1,358 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Shared-memory slot ring API unit tests
+ *
+ *
+ */
+
+#define SHMRING_TEST_NSLOTS 4
+#define SHMRING_TEST_SLOT_SIZE 100
+#define SHMRING_TEST_POLL_TIMEOUT_MS 2000
+
+/* These mirror the private layout in tizshmring.c: a 3-cache-line control
+   block, followed by the slots, each one with a cache line of metadata */
+#define SHMRING_TEST_HDR_SIZE (3 * 64)
+#define SHMRING_TEST_SLOT_HDR_SIZE 64
+
+typedef struct shmring_test_reader shmring_test_reader_t;
+struct shmring_test_reader
+{
+  const char *p_name;
+  tiz_shm_ring_t *p_ring;
+  OMX_ERRORTYPE rc;
+};
+
+static void *
+shmring_test_connect_thread (void *ap_arg)
+{
+  shmring_test_reader_t *p_reader = ap_arg;
+  p_reader->rc = tiz_shm_ring_connect (&(p_reader->p_ring), p_reader->p_name);
+  return NULL;
+}
+
+static void
+shmring_test_channel_name (char *ap_name, size_t a_len, const char *ap_test)
+{
+  (void) snprintf (ap_name, a_len, "check-%s-%ld", ap_test, (long) getpid ());
+}
+
+/* Connects a reader from a separate thread, while this thread plays the
+   producer's event loop and accepts it */
+static OMX_ERRORTYPE
+shmring_test_connect (tiz_shm_ring_t *ap_producer, const char *ap_name,
+                      tiz_shm_ring_t **app_consumer, OMX_ERRORTYPE *ap_accept_rc)
+{
+  shmring_test_reader_t reader;
+  pthread_t thread;
+  struct pollfd pfd;
+
+  reader.p_name = ap_name;
+  reader.p_ring = NULL;
+  reader.rc = OMX_ErrorUndefined;
+
+  fail_if (0 != pthread_create (&thread, NULL, shmring_test_connect_thread,
+                                &reader));
+
+  pfd.fd = tiz_shm_ring_listen_fd (ap_producer);
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  fail_if (1 != poll (&pfd, 1, SHMRING_TEST_POLL_TIMEOUT_MS));
+  *ap_accept_rc = tiz_shm_ring_accept (ap_producer);
+
+  fail_if (0 != pthread_join (thread, NULL));
+  *app_consumer = reader.p_ring;
+  return reader.rc;
+}
+
+static uint32_t *
+shmring_test_header (tiz_shm_ring_t *ap_producer)
+{
+  OMX_U8 *p_payload = tiz_shm_ring_claim (ap_producer, NULL);
+  fail_if (NULL == p_payload);
+  /* Only valid while the producer's head is still at slot zero */
+  return (uint32_t *) (p_payload - SHMRING_TEST_SLOT_HDR_SIZE
+                       - SHMRING_TEST_HDR_SIZE);
+}
+
+START_TEST (test_shmring_create_and_destroy)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_shm_ring_t *p_ring = NULL;
+  tiz_shm_ring_t *p_dup = NULL;
+  char name[64];
+
+  shmring_test_channel_name (name, sizeof (name), "create");
+
+  error = tiz_shm_ring_create (&p_ring, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (NULL == p_ring);
+
+  /* Slots are rounded up to whole cache lines */
+  fail_if (128 != tiz_shm_ring_slot_size (p_ring));
+  fail_if (tiz_shm_ring_listen_fd (p_ring) < 0);
+  fail_if (tiz_shm_ring_notify_fd (p_ring) < 0);
+
+  /* A channel name can only be bound once */
+  error = tiz_shm_ring_create (&p_dup, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorContentURIError);
+  fail_if (NULL != p_dup);
+
+  tiz_shm_ring_destroy (p_ring);
+
+  /* Nobody is listening on this channel now */
+  error = tiz_shm_ring_connect (&p_dup, name);
+  fail_if (error != OMX_ErrorContentURIError);
+  fail_if (NULL != p_dup);
+}
+END_TEST
+
+START_TEST (test_shmring_write_peek_and_consume)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_ERRORTYPE accept_rc = OMX_ErrorUndefined;
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  const OMX_U8 *p_data = NULL;
+  OMX_U8 *p_slot = NULL;
+  size_t capacity = 0;
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  char name[64];
+  int i = 0;
+
+  shmring_test_channel_name (name, sizeof (name), "transfer");
+
+  error = tiz_shm_ring_create (&p_prod, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (accept_rc != OMX_ErrorNone);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (NULL == p_cons);
+  fail_if (tiz_shm_ring_slot_size (p_prod) != tiz_shm_ring_slot_size (p_cons));
+  fail_if (tiz_shm_ring_listen_fd (p_cons) >= 0);
+
+  /* Nothing published yet */
+  fail_if (NULL != tiz_shm_ring_peek (p_cons, &nbytes, &flags));
+  fail_if (!tiz_shm_ring_prepare_to_wait (p_cons));
+
+  /* Fill the ring */
+  for (i = 0; i < SHMRING_TEST_NSLOTS; ++i)
+    {
+      p_slot = tiz_shm_ring_claim (p_prod, &capacity);
+      fail_if (NULL == p_slot);
+      fail_if (tiz_shm_ring_slot_size (p_prod) != capacity);
+      memset (p_slot, 'a' + i, i + 1);
+      tiz_shm_ring_publish (p_prod, i + 1,
+                            (SHMRING_TEST_NSLOTS - 1 == i) ? OMX_BUFFERFLAG_EOS
+                                                           : 0);
+    }
+  fail_if (NULL != tiz_shm_ring_claim (p_prod, &capacity));
+  fail_if (!tiz_shm_ring_prepare_to_wait (p_prod));
+
+  /* The consumer was waiting, so it must have been notified */
+  tiz_shm_ring_clear_notification (p_cons);
+
+  /* Drain it, in order */
+  for (i = 0; i < SHMRING_TEST_NSLOTS; ++i)
+    {
+      p_data = tiz_shm_ring_peek (p_cons, &nbytes, &flags);
+      fail_if (NULL == p_data);
+      fail_if ((size_t) (i + 1) != nbytes);
+      fail_if (p_data[0] != 'a' + i || p_data[nbytes - 1] != 'a' + i);
+      fail_if (((SHMRING_TEST_NSLOTS - 1 == i) ? OMX_BUFFERFLAG_EOS : 0)
+               != flags);
+      tiz_shm_ring_consume (p_cons);
+    }
+  fail_if (NULL != tiz_shm_ring_peek (p_cons, &nbytes, &flags));
+
+  /* The producer can make progress again */
+  fail_if (NULL == tiz_shm_ring_claim (p_prod, &capacity));
+
+  tiz_shm_ring_destroy (p_cons);
+  tiz_shm_ring_destroy (p_prod);
+}
+END_TEST
+
+START_TEST (test_shmring_single_consumer)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_ERRORTYPE accept_rc = OMX_ErrorUndefined;
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  tiz_shm_ring_t *p_other = NULL;
+  char name[64];
+
+  shmring_test_channel_name (name, sizeof (name), "single");
+
+  error = tiz_shm_ring_create (&p_prod, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (accept_rc != OMX_ErrorNone);
+  fail_if (error != OMX_ErrorNone);
+
+  /* A second reader is turned away */
+  error = shmring_test_connect (p_prod, name, &p_other, &accept_rc);
+  fail_if (accept_rc == OMX_ErrorNone);
+  fail_if (error == OMX_ErrorNone);
+  fail_if (NULL != p_other);
+
+  tiz_shm_ring_destroy (p_cons);
+  tiz_shm_ring_destroy (p_prod);
+}
+END_TEST
+
+START_TEST (test_shmring_reconnect)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_ERRORTYPE accept_rc = OMX_ErrorUndefined;
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  tiz_shm_ring_t *p_other = NULL;
+  const OMX_U8 *p_data = NULL;
+  OMX_U8 *p_slot = NULL;
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  char name[64];
+  int i = 0;
+
+  shmring_test_channel_name (name, sizeof (name), "reconnect");
+
+  error = tiz_shm_ring_create (&p_prod, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < 2; ++i)
+    {
+      p_slot = tiz_shm_ring_claim (p_prod, NULL);
+      fail_if (NULL == p_slot);
+      p_slot[0] = 'a' + i;
+      tiz_shm_ring_publish (p_prod, 1, 0);
+    }
+
+  /* The first reader takes one slot and goes away */
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (accept_rc != OMX_ErrorNone);
+  fail_if (error != OMX_ErrorNone);
+  p_data = tiz_shm_ring_peek (p_cons, &nbytes, &flags);
+  fail_if (NULL == p_data || 'a' != p_data[0]);
+  tiz_shm_ring_consume (p_cons);
+  tiz_shm_ring_destroy (p_cons);
+  p_cons = NULL;
+
+  /* A new reader is accepted, and resumes where the first one left off */
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (accept_rc != OMX_ErrorNone);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (NULL == p_cons);
+  p_data = tiz_shm_ring_peek (p_cons, &nbytes, &flags);
+  fail_if (NULL == p_data || 'b' != p_data[0] || 1 != nbytes);
+
+  /* ... and it is the only one again */
+  error = shmring_test_connect (p_prod, name, &p_other, &accept_rc);
+  fail_if (accept_rc == OMX_ErrorNone);
+  fail_if (error == OMX_ErrorNone);
+  fail_if (NULL != p_other);
+
+  tiz_shm_ring_destroy (p_cons);
+  tiz_shm_ring_destroy (p_prod);
+}
+END_TEST
+
+START_TEST (test_shmring_invalid_layout)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_ERRORTYPE accept_rc = OMX_ErrorUndefined;
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  uint32_t *p_hdr = NULL;
+  char name[64];
+
+  shmring_test_channel_name (name, sizeof (name), "invalid");
+
+  error = tiz_shm_ring_create (&p_prod, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+
+  /* nslots is not a power of two */
+  p_hdr = shmring_test_header (p_prod);
+  p_hdr[1] = SHMRING_TEST_NSLOTS - 1;
+
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (accept_rc != OMX_ErrorNone);
+  fail_if (error == OMX_ErrorNone);
+  fail_if (NULL != p_cons);
+
+  tiz_shm_ring_destroy (p_prod);
+}
+END_TEST
+
+START_TEST (test_shmring_layout_is_cached)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_ERRORTYPE accept_rc = OMX_ErrorUndefined;
+  tiz_shm_ring_t *p_prod = NULL;
+  tiz_shm_ring_t *p_cons = NULL;
+  uint32_t *p_hdr = NULL;
+  const OMX_U8 *p_data = NULL;
+  size_t slot_size = 0;
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  char name[64];
+
+  shmring_test_channel_name (name, sizeof (name), "cached");
+
+  error = tiz_shm_ring_create (&p_prod, name, SHMRING_TEST_NSLOTS,
+                               SHMRING_TEST_SLOT_SIZE);
+  fail_if (error != OMX_ErrorNone);
+
+  error = shmring_test_connect (p_prod, name, &p_cons, &accept_rc);
+  fail_if (error != OMX_ErrorNone);
+  slot_size = tiz_shm_ring_slot_size (p_cons);
+
+  /* The peer rewrites the layout after the consumer has validated it */
+  p_hdr = shmring_test_header (p_prod);
+  p_hdr[2] = 0x7fffffff;
+  p_hdr[3] = 0x7fffffff;
+
+  /* ...and publishes a slot that claims to be larger than the ring's slots */
+  (void) tiz_shm_ring_claim (p_prod, NULL);
+  tiz_shm_ring_publish (p_prod, 0, 0);
+  ((uint32_t *) ((OMX_U8 *) p_hdr + SHMRING_TEST_HDR_SIZE))[0] = 0x7fffffff;
+
+  fail_if (slot_size != tiz_shm_ring_slot_size (p_cons));
+  p_data = tiz_shm_ring_peek (p_cons, &nbytes, &flags);
+  fail_if (NULL == p_data);
+  fail_if (slot_size != nbytes);
+  tiz_shm_ring_consume (p_cons);
+
+  tiz_shm_ring_destroy (p_cons);
+  tiz_shm_ring_destroy (p_prod);
+}
+END_TEST
@@ -30,6 +30,9 @@
 #include <stdlib.h>
 #include <check.h>
 #include <signal.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <linux/limits.h>
 #include "../src/tizplatform.h"
@@ -51,6 +54,7 @@
 #include "./check_event.c"
 #include "./check_http_parser.c"
 #include "./check_map.c"
+#include "./check_shmring.c"
 
 #define EVENT_API_TEST_TIMEOUT 100
 
@@ -84,6 +88,7 @@ platform_sync_suite (void)
   tcase_add_test_raise_signal (tc_sem, test_sem_post_null, SIGABRT);
   tcase_add_test (tc_sem, test_mutex_init_and_destroy);
   tcase_add_test (tc_sem, test_mutex_lock_and_unlock);
+  tcase_add_test (tc_sem, test_mutex_contended_lock);
   tcase_add_test_raise_signal (tc_sem, test_mutex_init_null, SIGABRT);
   tcase_add_test (tc_sem, test_mutex_destroy_null);
   tcase_add_test_raise_signal (tc_sem, test_mutex_lock_null, SIGABRT);
@@ -227,6 +232,25 @@ platform_map_suite (void)
 
 }
 
+Suite *
+platform_shmring_suite (void)
+{
+  TCase *tc_shmring;
+  Suite *s = suite_create ("shmring");
+
+  /* shared-memory ring API test cases */
+  tc_shmring = tcase_create ("shared-memory ring API");
+  tcase_add_test (tc_shmring, test_shmring_create_and_destroy);
+  tcase_add_test (tc_shmring, test_shmring_write_peek_and_consume);
+  tcase_add_test (tc_shmring, test_shmring_single_consumer);
+  tcase_add_test (tc_shmring, test_shmring_reconnect);
+  tcase_add_test (tc_shmring, test_shmring_invalid_layout);
+  tcase_add_test (tc_shmring, test_shmring_layout_is_cached);
+  suite_add_tcase (s, tc_shmring);
+
+  return s;
+}
+
 int
 main (void)
 {
@@ -246,6 +270,7 @@ main (void)
   srunner_add_suite (sr, platform_soa_suite ());
   srunner_add_suite (sr, platform_http_parser_suite ());
   srunner_add_suite (sr, platform_map_suite ());
+  srunner_add_suite (sr, platform_shmring_suite ());
 /*   srunner_add_suite (sr, platform_event_suite ()); */
   srunner_run_all (sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed (sr);
@@ -126,3 +126,9 @@ bool graph::decops::is_disabled_evt_required () const
   // disabled in the graph. See comment in do_disable_comp_ports.
   return false;
 }
+
+bool graph::decops::is_poolable () const
+{
+  // The component list of a decoder graph never changes.
+  return true;
+}
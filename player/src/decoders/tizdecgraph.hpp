@@ -64,6 +64,7 @@ namespace tiz
     public:
       void do_disable_comp_ports (const int comp_id, const int port_id);
       bool is_disabled_evt_required () const;
+      bool is_poolable () const;
     };
 
   }  // namespace graph
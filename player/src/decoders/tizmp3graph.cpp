@@ -139,7 +139,9 @@ void graph::mp3decops::get_pcm_codec_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
   assert (probe_ptr_);
   probe_ptr_->get_pcm_codec_info (pcmtype);
 
-  // Ammend the endianness, sign, and interleave cofig as per the decoder values
+  // Ammend the sample size, endianness, sign, and interleave cofig as per the
+  // decoder values (the decoder may output 16-bit or float samples)
+  pcmtype.nBitPerSample = dec_pcmtype.nBitPerSample;
   pcmtype.eEndian = dec_pcmtype.eEndian;
   pcmtype.eNumData = dec_pcmtype.eNumData;
   pcmtype.bInterleaved = dec_pcmtype.bInterleaved;
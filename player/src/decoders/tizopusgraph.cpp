@@ -122,10 +122,29 @@ void graph::opusdecops::do_configure ()
   G_OPS_BAIL_IF_ERROR (
       tiz::graph::util::set_pcm_mode (
           handles_[2], 0,
-          boost::bind (&tiz::probe::get_pcm_codec_info, probe_ptr_, _1)),
+          boost::bind (&tiz::graph::opusdecops::get_pcm_codec_info, this, _1)),
       "Unable to set OMX_IndexParamAudioPcm");
 }
 
+void graph::opusdecops::get_pcm_codec_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
+{
+  OMX_U32 dec_port_id = 1;
+  OMX_AUDIO_PARAM_PCMMODETYPE dec_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (dec_pcmtype, dec_port_id);
+
+  G_OPS_BAIL_IF_ERROR (
+      OMX_GetParameter (handles_[1], OMX_IndexParamAudioPcm, &dec_pcmtype),
+      "Unable to get OMX_IndexParamAudioPcm from decoder");
+
+  probe_ptr_->get_pcm_codec_info (pcmtype);
+
+  // The decoder outputs 16-bit, 24-bit or float (i.e. 32 bit) samples, as per
+  // its configuration
+  pcmtype.nBitPerSample = dec_pcmtype.nBitPerSample;
+  pcmtype.eEndian = dec_pcmtype.eEndian;
+  pcmtype.eNumData = dec_pcmtype.eNumData;
+}
+
 OMX_ERRORTYPE
 graph::opusdecops::set_opus_settings ()
 {
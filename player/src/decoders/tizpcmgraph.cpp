@@ -135,4 +135,16 @@ void graph::pcmdecops::get_pcm_codec_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
   pcmtype.eEndian = dec_pcmtype.eEndian;
   pcmtype.eNumData = dec_pcmtype.eNumData;
   pcmtype.bInterleaved = dec_pcmtype.bInterleaved;
+
+  // The decoder outputs 16-bit, packed 24-bit, or float samples (i.e. 32
+  // bits), depending on the resolution of the source; anything below 24 bits
+  // is delivered as 16-bit
+  if (pcmtype.nBitPerSample < 24)
+  {
+    pcmtype.nBitPerSample = 16;
+  }
+  else if (pcmtype.nBitPerSample > 24)
+  {
+    pcmtype.nBitPerSample = 32;
+  }
 }
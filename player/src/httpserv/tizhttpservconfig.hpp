@@ -48,11 +48,13 @@ namespace tiz
                       const std::vector< std::string > &bitrate_mode_list,
                       const std::string &station_name,
                       const std::string &station_genre,
-                      const bool &icy_metadata_enabled)
+                      const bool &icy_metadata_enabled,
+                      const std::vector<int> &bitrate_ladder = std::vector<int> ())
         : config (playlist), host_ (host), addr_ (ip_address), port_ (port),
           sampling_rate_list_ (sampling_rate_list), bitrate_mode_list_ (bitrate_mode_list),
           station_name_ (station_name), station_genre_ (station_genre),
-          icy_metadata_enabled_ (icy_metadata_enabled)
+          icy_metadata_enabled_ (icy_metadata_enabled),
+          bitrate_ladder_ (bitrate_ladder)
       {
       }
 
@@ -100,6 +102,13 @@ namespace tiz
         return icy_metadata_enabled_;
       }
 
+      // The mp3 bitrates (in kbps) that the media is re-encoded to. When
+      // empty, the media is streamed as is.
+      const std::vector<int> &get_bitrate_ladder () const
+      {
+        return bitrate_ladder_;
+      }
+
     protected:
       const std::string host_;
       const std::string addr_;
@@ -109,6 +118,7 @@ namespace tiz
       const std::string station_name_;
       const std::string station_genre_;
       const bool icy_metadata_enabled_;
+      const std::vector<int> bitrate_ladder_;
     };
   }  // namespace graph
 }  // namespace tiz
@@ -53,8 +53,9 @@ namespace graph = tiz::graph;
 //
 // httpserver
 //
-graph::httpserver::httpserver ()
+graph::httpserver::httpserver (const int nrungs)
   : graph::graph ("httpservgraph"),
+    nrungs_ (nrungs),
     fsm_ (boost::msm::back::states_
           << tiz::graph::hsfsm::fsm::configuring (&p_ops_)
           << tiz::graph::hsfsm::fsm::skipping (&p_ops_),
@@ -65,14 +66,34 @@ graph::httpserver::httpserver ()
 graph::ops *graph::httpserver::do_init ()
 {
   omx_comp_name_lst_t comp_list;
-  comp_list.push_back ("OMX.Aratelia.audio_metadata_eraser.mp3");
-  comp_list.push_back ("OMX.Aratelia.audio_renderer.http");
-
   omx_comp_role_lst_t role_list;
+
+  comp_list.push_back ("OMX.Aratelia.audio_metadata_eraser.mp3");
   role_list.push_back ("audio_metadata_eraser.mp3");
-  role_list.push_back ("audio_renderer.http");
 
-  return new httpservops (this, comp_list, role_list);
+  if (nrungs_ > 0)
+  {
+    // Bitrate ladder: decode once, split the pcm stream and re-encode it in
+    // parallel. See httpservops for the layout of this graph.
+    comp_list.push_back ("OMX.Aratelia.audio_decoder.mp3");
+    role_list.push_back ("audio_decoder.mp3");
+    comp_list.push_back ("OMX.Aratelia.audio_splitter.pcm");
+    role_list.push_back ("audio_splitter.pcm");
+    for (int i = 0; i < nrungs_; ++i)
+    {
+      comp_list.push_back ("OMX.Aratelia.audio_encoder.mp3");
+      role_list.push_back ("audio_encoder.mp3");
+      comp_list.push_back ("OMX.Aratelia.audio_renderer.http");
+      role_list.push_back ("audio_renderer.http");
+    }
+  }
+  else
+  {
+    comp_list.push_back ("OMX.Aratelia.audio_renderer.http");
+    role_list.push_back ("audio_renderer.http");
+  }
+
+  return new httpservops (this, comp_list, role_list, nrungs_);
 }
 
 bool graph::httpserver::dispatch_cmd (const tiz::graph::cmd *p_cmd)
@@ -44,13 +44,17 @@ namespace tiz
     {
 
     public:
-      httpserver ();
+      // When nrungs is greater than zero, the graph decodes the media once and
+      // re-encodes it to nrungs mp3 bitrates in parallel, each served by its
+      // own http renderer.
+      explicit httpserver (const int nrungs = 0);
 
     protected:
       ops *do_init ();
       bool dispatch_cmd (const tiz::graph::cmd *p_cmd);
 
     protected:
+      const int nrungs_;
       hsfsm::fsm fsm_;
     };
   }  // namespace graph
@@ -30,8 +30,10 @@
 #endif
 
 #include <algorithm>
+#include <vector>
 
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
 
 #include <OMX_Core.h>
@@ -55,16 +57,104 @@ namespace graph = tiz::graph;
 namespace
 {
   const OMX_U32 TIZ_DEFAULT_ICY_METADATA_INTERVAL = 8192;
+
+  // Component layout of the bitrate ladder graph:
+  //
+  //  eraser -> mp3 decoder -> pcm tee -+-> mp3 encoder #0 -> http renderer #0
+  //                                    +-> mp3 encoder #1 -> http renderer #1
+  //                                    +-> ...
+  //
+  // Tunnel #0 (eraser -> decoder) is the only one that is cycled between
+  // tracks, just like in the regular graph.
+  const int TIZ_LADDER_SOURCE_INDEX = 0;
+  const int TIZ_LADDER_DECODER_INDEX = 1;
+  const int TIZ_LADDER_TEE_INDEX = 2;
+  // This matches the number of outputs of the pcm tee component
+  const int TIZ_LADDER_MAX_RUNGS = 4;
+
+  int ladder_encoder_index (const int rung)
+  {
+    return TIZ_LADDER_TEE_INDEX + 1 + 2 * rung;
+  }
+
+  int ladder_renderer_index (const int rung)
+  {
+    return ladder_encoder_index (rung) + 1;
+  }
+
+  struct ladder_link
+  {
+    ladder_link (const int out_comp, const OMX_U32 out_port,
+                 const int in_comp, const OMX_U32 in_port)
+      : out_comp_ (out_comp),
+        out_port_ (out_port),
+        in_comp_ (in_comp),
+        in_port_ (in_port)
+    {
+    }
+    int out_comp_;
+    OMX_U32 out_port_;
+    int in_comp_;
+    OMX_U32 in_port_;
+  };
+
+  std::vector< ladder_link > ladder_links (const int nrungs)
+  {
+    std::vector< ladder_link > links;
+    links.push_back (
+        ladder_link (TIZ_LADDER_SOURCE_INDEX, 0, TIZ_LADDER_DECODER_INDEX, 0));
+    links.push_back (
+        ladder_link (TIZ_LADDER_DECODER_INDEX, 1, TIZ_LADDER_TEE_INDEX, 0));
+    for (int i = 0; i < nrungs; ++i)
+    {
+      links.push_back (ladder_link (TIZ_LADDER_TEE_INDEX, 1 + i,
+                                    ladder_encoder_index (i), 0));
+      links.push_back (ladder_link (ladder_encoder_index (i), 1,
+                                    ladder_renderer_index (i), 0));
+    }
+    return links;
+  }
 }
 //
 // httpservops
 //
 graph::httpservops::httpservops (graph *p_graph,
                                  const omx_comp_name_lst_t &comp_lst,
-                                 const omx_comp_role_lst_t &role_lst)
+                                 const omx_comp_role_lst_t &role_lst,
+                                 const int nrungs)
   : tiz::graph::ops (p_graph, comp_lst, role_lst),
-    is_initial_configuration_ (true)
+    is_initial_configuration_ (true),
+    nrungs_ (nrungs),
+    ladder_sample_rate_ (0),
+    ladder_channels_ (0)
 {
+  assert (nrungs_ >= 0 && nrungs_ <= TIZ_LADDER_MAX_RUNGS);
+}
+
+void graph::httpservops::do_setup ()
+{
+  if (0 == nrungs_)
+  {
+    tiz::graph::ops::do_setup ();
+  }
+  else if (last_op_succeeded ())
+  {
+    G_OPS_BAIL_IF_ERROR (setup_ladder_tunnels (),
+                         "Unable to setup the bitrate ladder tunnels.");
+  }
+}
+
+void graph::httpservops::do_tear_down_tunnels ()
+{
+  if (0 == nrungs_)
+  {
+    tiz::graph::ops::do_tear_down_tunnels ();
+  }
+  else
+  {
+    G_OPS_BAIL_IF_ERROR (tear_down_ladder_tunnels (),
+                         "Unable to tear down the bitrate ladder tunnels.");
+  }
 }
 
 void graph::httpservops::do_probe ()
@@ -119,6 +209,11 @@ void graph::httpservops::do_configure_stream ()
           boost::bind (&tiz::graph::httpservops::get_mp3_codec_info, this, _1),
           need_port_settings_changed_evt),
       "Unable to set OMX_IndexParamAudioMp3");
+  if (nrungs_ > 0 && is_initial_configuration_)
+  {
+    G_OPS_BAIL_IF_ERROR (configure_ladder_codecs (),
+                         "Unable to configure the bitrate ladder codecs");
+  }
   G_OPS_BAIL_IF_ERROR (configure_stream_metadata (),
                        "Unable to set OMX_TizoniaIndexConfigIcecastMetadata");
 }
@@ -136,31 +231,89 @@ void graph::httpservops::do_flag_initial_config_done ()
   is_initial_configuration_ = false;
 }
 
+bool graph::httpservops::is_last_component (const OMX_HANDLETYPE handle) const
+{
+  // In ladder mode, the end of each track is signalled by the pcm tee; the
+  // encoders and renderers see one continuous stream.
+  if (nrungs_ > 0)
+  {
+    return handles_.size () > (size_t)TIZ_LADDER_TEE_INDEX
+           && handles_[TIZ_LADDER_TEE_INDEX] == handle;
+  }
+  return tiz::graph::ops::is_last_component (handle);
+}
+
 OMX_ERRORTYPE
 graph::httpservops::configure_server ()
+{
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+
+  if (0 == nrungs_)
+  {
+    return configure_server (1, srv_config->get_port ());
+  }
+
+  // Each rung of the ladder is served on its own port
+  for (int i = 0; i < nrungs_; ++i)
+  {
+    tiz_check_omx (configure_server (ladder_renderer_index (i),
+                                     srv_config->get_port () + i));
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::configure_server (const int renderer_id,
+                                      const long int port)
 {
   OMX_TIZONIA_HTTPSERVERTYPE httpsrv;
   httpsrv.nSize = sizeof(OMX_TIZONIA_HTTPSERVERTYPE);
   httpsrv.nVersion.nVersion = OMX_VERSION;
 
   tiz_check_omx (OMX_GetParameter (
-      handles_[1],
+      handles_[renderer_id],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpServer), &httpsrv));
 
-  tizhttpservconfig_ptr_t srv_config
-      = boost::dynamic_pointer_cast< httpservconfig >(config_);
-  assert (srv_config);
-  httpsrv.nListeningPort = srv_config->get_port ();
+  httpsrv.nListeningPort = port;
   httpsrv.nMaxClients = 1;  // the http renderer component supports only one
   // client, for now
 
   return OMX_SetParameter (
-      handles_[1],
+      handles_[renderer_id],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpServer), &httpsrv);
 }
 
 OMX_ERRORTYPE
 graph::httpservops::configure_station ()
+{
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+
+  if (0 == nrungs_)
+  {
+    return configure_station (1, srv_config->get_port (), "/");
+  }
+
+  const std::vector< int > &ladder = srv_config->get_bitrate_ladder ();
+  assert (ladder.size () == (size_t)nrungs_);
+  for (int i = 0; i < nrungs_; ++i)
+  {
+    char mount_name[OMX_MAX_STRINGNAME_SIZE];
+    snprintf (mount_name, sizeof(mount_name), "/%dk", ladder[i]);
+    tiz_check_omx (configure_station (ladder_renderer_index (i),
+                                      srv_config->get_port () + i,
+                                      mount_name));
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::configure_station (const int renderer_id,
+                                       const long int port,
+                                       const std::string &mount_name)
 {
   OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mount;
   mount.nSize = sizeof(OMX_TIZONIA_ICECASTMOUNTPOINTTYPE);
@@ -172,14 +325,15 @@ graph::httpservops::configure_station ()
   assert (srv_config);
 
   tiz_check_omx (OMX_GetParameter (
-      handles_[1],
+      handles_[renderer_id],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamIcecastMountpoint),
       &mount));
 
-  snprintf ((char *)mount.cMountName, sizeof(mount.cMountName), "/");
+  snprintf ((char *)mount.cMountName, sizeof(mount.cMountName), "%s",
+            mount_name.c_str ());
   snprintf ((char *)mount.cStationName, sizeof(mount.cStationName),
             "%s (%s:%ld)", srv_config->get_station_name ().c_str (),
-            srv_config->get_host_name ().c_str (), srv_config->get_port ());
+            srv_config->get_host_name ().c_str (), port);
   snprintf ((char *)mount.cStationDescription,
             sizeof(mount.cStationDescription),
             "Tizonia Streaming Server");
@@ -197,13 +351,28 @@ graph::httpservops::configure_station ()
   mount.eEncoding = OMX_AUDIO_CodingMP3;
   mount.nMaxClients = 1;
   return OMX_SetParameter (
-      handles_[1],
+      handles_[renderer_id],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamIcecastMountpoint),
       &mount);
 }
 
 OMX_ERRORTYPE
 graph::httpservops::configure_stream_metadata ()
+{
+  if (0 == nrungs_)
+  {
+    return configure_stream_metadata (1);
+  }
+
+  for (int i = 0; i < nrungs_; ++i)
+  {
+    tiz_check_omx (configure_stream_metadata (ladder_renderer_index (i)));
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::configure_stream_metadata (const int renderer_id)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
 
@@ -231,7 +400,7 @@ graph::httpservops::configure_stream_metadata ()
     TIZ_LOG (TIZ_PRIORITY_TRACE, "p_metadata->cStreamTitle [%s]...",
              p_metadata->cStreamTitle);
 
-    rc = OMX_SetConfig (handles_[1], static_cast< OMX_INDEXTYPE >(
+    rc = OMX_SetConfig (handles_[renderer_id], static_cast< OMX_INDEXTYPE >(
                                          OMX_TizoniaIndexConfigIcecastMetadata),
                         p_metadata);
 
@@ -242,6 +411,101 @@ graph::httpservops::configure_stream_metadata ()
   return rc;
 }
 
+OMX_ERRORTYPE
+graph::httpservops::configure_ladder_codecs ()
+{
+  assert (nrungs_ > 0);
+  assert (probe_ptr_);
+
+  // The pcm settings of the decoder's output, the tee and the encoders'
+  // inputs are fixed for the lifetime of the graph.
+  tiz_check_omx (tiz::graph::util::set_pcm_mode (
+      handles_[TIZ_LADDER_DECODER_INDEX], 1,
+      boost::bind (&tiz::graph::httpservops::get_ladder_pcm_info, this, _1,
+                   1)));
+  for (OMX_U32 pid = 0; pid <= (OMX_U32)nrungs_; ++pid)
+  {
+    tiz_check_omx (tiz::graph::util::set_pcm_mode (
+        handles_[TIZ_LADDER_TEE_INDEX], pid,
+        boost::bind (&tiz::graph::httpservops::get_ladder_pcm_info, this, _1,
+                     pid)));
+  }
+
+  for (int i = 0; i < nrungs_; ++i)
+  {
+    bool need_port_settings_changed_evt = false;  // not needed here
+    tiz_check_omx (tiz::graph::util::set_pcm_mode (
+        handles_[ladder_encoder_index (i)], 0,
+        boost::bind (&tiz::graph::httpservops::get_ladder_pcm_info, this, _1,
+                     0)));
+    tiz_check_omx (tiz::graph::util::set_mp3_type (
+        handles_[ladder_encoder_index (i)], 1,
+        boost::bind (&tiz::graph::httpservops::get_ladder_mp3_info, this, _1,
+                     1, i),
+        need_port_settings_changed_evt));
+    tiz_check_omx (tiz::graph::util::set_mp3_type (
+        handles_[ladder_renderer_index (i)], 0,
+        boost::bind (&tiz::graph::httpservops::get_ladder_mp3_info, this, _1,
+                     0, i),
+        need_port_settings_changed_evt));
+  }
+
+  OMX_AUDIO_PARAM_MP3TYPE mp3type;
+  probe_ptr_->get_mp3_codec_info (mp3type);
+  ladder_sample_rate_ = mp3type.nSampleRate;
+  ladder_channels_ = mp3type.nChannels;
+
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::setup_ladder_tunnels ()
+{
+  const std::vector< ladder_link > links = ladder_links (nrungs_);
+  OMX_PARAM_BUFFERSUPPLIERTYPE supplier;
+  TIZ_INIT_OMX_PORT_STRUCT (supplier, 0);
+  supplier.eBufferSupplier = OMX_BufferSupplyInput;
+
+  BOOST_FOREACH (const ladder_link &link, links)
+  {
+    supplier.nPortIndex = link.out_port_;
+    tiz_check_omx (OMX_SetParameter (handles_[link.out_comp_],
+                                     OMX_IndexParamCompBufferSupplier,
+                                     &supplier));
+    supplier.nPortIndex = link.in_port_;
+    tiz_check_omx (OMX_SetParameter (handles_[link.in_comp_],
+                                     OMX_IndexParamCompBufferSupplier,
+                                     &supplier));
+    tiz_check_omx (OMX_SetupTunnel (handles_[link.out_comp_], link.out_port_,
+                                    handles_[link.in_comp_], link.in_port_));
+  }
+
+  // Disable the tee outputs that are not in use
+  for (int i = nrungs_; i < TIZ_LADDER_MAX_RUNGS; ++i)
+  {
+    tiz_check_omx (
+        tiz::graph::util::disable_port (handles_[TIZ_LADDER_TEE_INDEX], 1 + i));
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::tear_down_ladder_tunnels ()
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const std::vector< ladder_link > links = ladder_links (nrungs_);
+  BOOST_FOREACH (const ladder_link &link, links)
+  {
+    if (OMX_ErrorNone
+        != (rc = OMX_TeardownTunnel (handles_[link.out_comp_], link.out_port_,
+                                     handles_[link.in_comp_], link.in_port_)))
+    {
+      break;
+    }
+  }
+  return rc;
+}
+
 OMX_ERRORTYPE
 graph::httpservops::switch_tunnel (const int tunnel_id,
     const OMX_COMMANDTYPE to_disabled_or_enabled)
@@ -293,6 +557,50 @@ void graph::httpservops::get_mp3_codec_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type)
     }
 }
 
+void graph::httpservops::get_ladder_pcm_info (
+    OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype, const OMX_U32 port_id)
+{
+  // Start from the decoder's output port, with the rate and channels of the
+  // media. The format itself is pinned to native 16-bit samples, the only
+  // one the mp3 encoder takes (lame_encode_buffer_interleaved); this applies
+  // to the decoder's output too.
+  OMX_AUDIO_PARAM_PCMMODETYPE dec_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (dec_pcmtype, 1);
+  G_OPS_BAIL_IF_ERROR (
+      OMX_GetParameter (handles_[TIZ_LADDER_DECODER_INDEX],
+                        OMX_IndexParamAudioPcm, &dec_pcmtype),
+      "Unable to get OMX_IndexParamAudioPcm from decoder");
+
+  assert (probe_ptr_);
+  OMX_AUDIO_PARAM_MP3TYPE mp3type;
+  probe_ptr_->get_mp3_codec_info (mp3type);
+
+  pcmtype = dec_pcmtype;
+  pcmtype.nPortIndex = port_id;
+  pcmtype.nChannels = mp3type.nChannels;
+  pcmtype.nSamplingRate = mp3type.nSampleRate;
+  pcmtype.nBitPerSample = 16;
+  pcmtype.eNumData = OMX_NumericalDataSigned;
+  pcmtype.eEndian = OMX_EndianLittle;
+}
+
+void graph::httpservops::get_ladder_mp3_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type,
+                                              const OMX_U32 port_id,
+                                              const int rung)
+{
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+  assert (probe_ptr_);
+  assert (rung >= 0 && rung < nrungs_);
+
+  probe_ptr_->get_mp3_codec_info (mp3type);
+  mp3type.nPortIndex = port_id;
+  // OpenMAX IL bitrates are in bits per second
+  mp3type.nBitRate = srv_config->get_bitrate_ladder ()[rung] * 1000;
+  mp3type.eFormat = OMX_AUDIO_MP3StreamFormatMP1Layer3;
+}
+
 bool graph::httpservops::probe_stream_hook ()
 {
   bool rc = false;
@@ -329,6 +637,17 @@ bool graph::httpservops::probe_stream_hook ()
                        probe_ptr_->is_cbr_stream () ? "CBR" : "VBR")
         != bitrate_types.end ();
     }
+
+    // In ladder mode, the encoders are configured with the first track's
+    // settings; skip streams that would need a reconfiguration.
+    if (nrungs_ > 0 && !is_initial_configuration_)
+    {
+      rc &= (mp3type.nSampleRate == ladder_sample_rate_
+             && mp3type.nChannels == ladder_channels_);
+      TIZ_LOG (TIZ_PRIORITY_TRACE,
+               "ladder nSampleRate [%d] nChannels [%d] match [%s]...",
+               mp3type.nSampleRate, mp3type.nChannels, rc ? "YES" : "NO");
+    }
   }
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "return () [%s]...", rc ? "YES" : "NO");
@@ -41,9 +41,11 @@ namespace tiz
     {
     public:
       httpservops (graph *p_graph, const omx_comp_name_lst_t &comp_lst,
-                   const omx_comp_role_lst_t &role_lst);
+                   const omx_comp_role_lst_t &role_lst, const int nrungs = 0);
 
     public:
+      void do_setup ();
+      void do_tear_down_tunnels ();
       void do_probe ();
       void do_exe2pause ();
       void do_pause2exe ();
@@ -56,20 +58,39 @@ namespace tiz
       bool is_initial_configuration () const;
       void do_flag_initial_config_done ();
 
+      bool is_last_component (const OMX_HANDLETYPE handle) const;
+
     private:
       OMX_ERRORTYPE configure_server ();
+      OMX_ERRORTYPE configure_server (const int renderer_id, const long int port);
       OMX_ERRORTYPE configure_station ();
+      OMX_ERRORTYPE configure_station (const int renderer_id, const long int port,
+                                       const std::string &mount_name);
       OMX_ERRORTYPE configure_stream_metadata ();
+      OMX_ERRORTYPE configure_stream_metadata (const int renderer_id);
+      OMX_ERRORTYPE configure_ladder_codecs ();
+      OMX_ERRORTYPE setup_ladder_tunnels ();
+      OMX_ERRORTYPE tear_down_ladder_tunnels ();
       OMX_ERRORTYPE switch_tunnel (const int tunnel_id,
           const OMX_COMMANDTYPE to_disabled_or_enabled);
 
     private:
       void get_mp3_codec_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type);
+      void get_ladder_pcm_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype,
+                                const OMX_U32 port_id);
+      void get_ladder_mp3_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type,
+                                const OMX_U32 port_id, const int rung);
       // re-implemented from the base class
       bool probe_stream_hook ();
 
     private:
       bool is_initial_configuration_;
+      const int nrungs_;
+      // In ladder mode, tracks with a different sampling rate or number of
+      // channels than the first one are skipped, as the encoders are only
+      // configured once.
+      OMX_U32 ladder_sample_rate_;
+      OMX_U32 ladder_channels_;
     };
   }  // namespace graph
 }  // namespace tiz
@@ -514,14 +514,25 @@ graph::dirbleops::set_channels_and_rate_on_renderer (
   renderer_pcmtype_.nChannels = channels;
   renderer_pcmtype_.nSamplingRate = sampling_rate;
   renderer_pcmtype_.eNumData = OMX_NumericalDataSigned;
-  renderer_pcmtype_.eEndian
-      = (encoding_ == OMX_AUDIO_CodingMP3 ? OMX_EndianBig : OMX_EndianLittle);
+  renderer_pcmtype_.eEndian = OMX_EndianLittle;
 
   if (OMX_AUDIO_CodingOPUS == encoding_ || OMX_AUDIO_CodingVORBIS == encoding_)
   {
     // Opus and Vorbis decoders output 32 bit samples (floats)
     renderer_pcmtype_.nBitPerSample = 32;
   }
+  else if (OMX_AUDIO_CodingMP3 == encoding_
+           || OMX_AUDIO_CodingAAC == encoding_)
+  {
+    // The MP3 and AAC decoders output either 16 bit or float samples, as
+    // configured, so the sample format is taken from the decoder
+    OMX_AUDIO_PARAM_PCMMODETYPE decoder_pcmtype;
+    TIZ_INIT_OMX_PORT_STRUCT (decoder_pcmtype, 1);  // decoder's output port
+    tiz_check_omx (OMX_GetParameter (handles_[1], OMX_IndexParamAudioPcm,
+                                     &decoder_pcmtype));
+    renderer_pcmtype_.nBitPerSample = decoder_pcmtype.nBitPerSample;
+    renderer_pcmtype_.eEndian = decoder_pcmtype.eEndian;
+  }
 
   // Set the new pcm settings
   tiz_check_omx (
@@ -374,8 +374,19 @@ graph::scloudops::set_channels_and_rate_on_renderer (
   renderer_pcmtype_.nChannels = channels;
   renderer_pcmtype_.nSamplingRate = sampling_rate;
   renderer_pcmtype_.eNumData = OMX_NumericalDataSigned;
-  renderer_pcmtype_.eEndian
-      = (encoding_ == OMX_AUDIO_CodingMP3 ? OMX_EndianBig : OMX_EndianLittle);
+  renderer_pcmtype_.eEndian = OMX_EndianLittle;
+
+  if (OMX_AUDIO_CodingMP3 == encoding_)
+  {
+    // The MP3 decoder outputs either 16 bit or float samples, as configured,
+    // so the sample format is taken from the decoder
+    OMX_AUDIO_PARAM_PCMMODETYPE decoder_pcmtype;
+    TIZ_INIT_OMX_PORT_STRUCT (decoder_pcmtype, 1);  // decoder's output port
+    tiz_check_omx (OMX_GetParameter (handles_[1], OMX_IndexParamAudioPcm,
+                                     &decoder_pcmtype));
+    renderer_pcmtype_.nBitPerSample = decoder_pcmtype.nBitPerSample;
+    renderer_pcmtype_.eEndian = decoder_pcmtype.eEndian;
+  }
 
   // Set the new pcm settings
   tiz_check_omx (
@@ -44,6 +44,7 @@
 #include <tizmacros.h>
 
 #include "tizgraphfactory.hpp"
+#include "tizgraphpool.hpp"
 #include "tizgraph.hpp"
 #include "tizgraphconfig.hpp"
 #include "tizgraphutil.hpp"
@@ -103,6 +104,18 @@ void graph::ops::do_load ()
       "Unable to verify the role list.");
 
   tiz::graph::cbackhandler &cbacks = p_graph_->cback_handler_;
+  if (is_poolable () && handles_.empty ()
+      && pool::acquire (comp_lst_, role_lst_, &(cbacks),
+                        cbacks.get_omx_cbacks (), handles_))
+  {
+    // These components are already in OMX_StateLoaded, with their roles set
+    for (size_t i = 0; i < handles_.size (); ++i)
+    {
+      h2n_[handles_[i]] = comp_lst_[i];
+    }
+    return;
+  }
+
   G_OPS_BAIL_IF_ERROR (
       util::instantiate_comp_list (comp_lst_, handles_, h2n_,
                                    &(cbacks), cbacks.get_omx_cbacks ()),
@@ -558,7 +571,13 @@ void graph::ops::do_tear_down_tunnels ()
 
 void graph::ops::do_destroy_graph ()
 {
-  util::destroy_list (handles_);
+  // If the graph was unloaded cleanly, park the components for the next
+  // graph with the same codec/renderer combination.
+  if (!(is_poolable () && last_op_succeeded ()
+        && pool::release (comp_lst_, role_lst_, handles_)))
+  {
+    util::destroy_list (handles_);
+  }
   handles_.clear ();
   h2n_.clear ();
   comp_lst_.clear();
@@ -628,6 +647,14 @@ bool graph::ops::is_disabled_evt_required () const
   return false;
 }
 
+bool graph::ops::is_poolable () const
+{
+  // Only graphs with a fixed list of components can be pooled. Graphs that
+  // add or remove components while running (e.g. after auto-detecting the
+  // stream's encoding) cannot.
+  return false;
+}
+
 bool graph::ops::is_fatal_error (const OMX_ERRORTYPE error) const
 {
   TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] ", tiz_err_to_str (error));
@@ -154,6 +154,7 @@ namespace tiz
 
       virtual bool is_port_settings_evt_required () const;
       virtual bool is_disabled_evt_required () const;
+      virtual bool is_poolable () const;
       virtual bool is_fatal_error (const OMX_ERRORTYPE error) const;
       virtual bool is_tunnel_altered (const int tunnel_id,
                                       const OMX_HANDLETYPE handle,
@@ -164,7 +165,7 @@ namespace tiz
       std::string internal_error_msg () const;
 
     public:
-      bool is_last_component (const OMX_HANDLETYPE handle) const;
+      virtual bool is_last_component (const OMX_HANDLETYPE handle) const;
       bool is_first_component (const OMX_HANDLETYPE handle) const;
       bool is_trans_complete (const OMX_HANDLETYPE handle,
                               const OMX_STATETYPE to_state);
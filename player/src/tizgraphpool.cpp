@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizgraphpool.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Pool of idle, loaded component graphs - implementation
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <list>
+
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <OMX_Component.h>
+#include <tizplatform.h>
+
+#include "tizgraphpool.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.graph.pool"
+#endif
+
+#define GRAPH_POOL_DEFAULT_SIZE 2
+
+namespace graph = tiz::graph;
+
+namespace
+{
+  struct entry
+  {
+    std::string key_;
+    omx_comp_handle_lst_t handles_;
+  };
+
+  typedef std::list< entry > entry_lst_t;
+
+  boost::mutex g_mutex;
+  entry_lst_t g_entries;  // most recently parked first
+  int g_max_entries = -1;
+
+  // Parked components are not expected to produce any events; should they do
+  // so anyway, the events are discarded.
+  OMX_ERRORTYPE
+  parked_event_handler (OMX_HANDLETYPE, OMX_PTR, OMX_EVENTTYPE, OMX_U32,
+                        OMX_U32, OMX_PTR)
+  {
+    return OMX_ErrorNone;
+  }
+
+  OMX_ERRORTYPE
+  parked_buffer_done (OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE *)
+  {
+    return OMX_ErrorNone;
+  }
+
+  OMX_CALLBACKTYPE g_parked_cbacks
+      = {parked_event_handler, parked_buffer_done, parked_buffer_done};
+
+  int max_entries ()
+  {
+    if (g_max_entries < 0)
+    {
+      const char *p_size = tiz_rcfile_get_value ("tizonia", "graph-pool-size");
+      g_max_entries = p_size ? atoi (p_size) : GRAPH_POOL_DEFAULT_SIZE;
+      if (g_max_entries < 0)
+      {
+        g_max_entries = 0;
+      }
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "graph pool size [%d]", g_max_entries);
+    }
+    return g_max_entries;
+  }
+
+  // The key identifies the codec/renderer combination
+  std::string make_key (const omx_comp_name_lst_t &comp_lst,
+                        const omx_comp_role_lst_t &role_lst)
+  {
+    std::string key;
+    assert (comp_lst.size () == role_lst.size ());
+    for (size_t i = 0; i < comp_lst.size (); ++i)
+    {
+      key.append (comp_lst[i]).append (":").append (role_lst[i]).append (";");
+    }
+    return key;
+  }
+
+  void free_handles (const omx_comp_handle_lst_t &hdl_lst)
+  {
+    BOOST_FOREACH (OMX_HANDLETYPE handle, hdl_lst)
+    {
+      if (handle)
+      {
+        OMX_FreeHandle (handle);
+      }
+    }
+  }
+}
+
+bool graph::pool::acquire (const omx_comp_name_lst_t &comp_lst,
+                           const omx_comp_role_lst_t &role_lst,
+                           OMX_PTR ap_app_data, OMX_CALLBACKTYPE *ap_callbacks,
+                           omx_comp_handle_lst_t &hdl_lst)
+{
+  const std::string key (make_key (comp_lst, role_lst));
+  omx_comp_handle_lst_t handles;
+
+  assert (hdl_lst.empty ());
+
+  {
+    boost::mutex::scoped_lock lock (g_mutex);
+    for (entry_lst_t::iterator it = g_entries.begin (); it != g_entries.end ();
+         ++it)
+    {
+      if (it->key_ == key)
+      {
+        handles.swap (it->handles_);
+        g_entries.erase (it);
+        break;
+      }
+    }
+  }
+
+  if (handles.empty ())
+  {
+    return false;
+  }
+
+  BOOST_FOREACH (OMX_HANDLETYPE handle, handles)
+  {
+    if (OMX_ErrorNone != OMX_SetCallbacks (handle, ap_callbacks, ap_app_data))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to set the callbacks; discarding");
+      free_handles (handles);
+      return false;
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Reusing [%s]", key.c_str ());
+  hdl_lst.swap (handles);
+  return true;
+}
+
+bool graph::pool::release (const omx_comp_name_lst_t &comp_lst,
+                           const omx_comp_role_lst_t &role_lst,
+                           const omx_comp_handle_lst_t &hdl_lst)
+{
+  entry parked;
+  entry_lst_t evicted;
+
+  if (hdl_lst.empty () || hdl_lst.size () != comp_lst.size ())
+  {
+    return false;
+  }
+
+  BOOST_FOREACH (OMX_HANDLETYPE handle, hdl_lst)
+  {
+    OMX_STATETYPE state = OMX_StateMax;
+    if (!handle || OMX_ErrorNone != OMX_GetState (handle, &state)
+        || OMX_StateLoaded != state
+        || OMX_ErrorNone
+               != OMX_SetCallbacks (handle, &g_parked_cbacks, NULL))
+    {
+      return false;
+    }
+  }
+
+  parked.key_ = make_key (comp_lst, role_lst);
+  parked.handles_ = hdl_lst;
+
+  {
+    boost::mutex::scoped_lock lock (g_mutex);
+    const int max = max_entries ();
+    if (0 == max)
+    {
+      return false;
+    }
+    g_entries.push_front (parked);
+    while (g_entries.size () > static_cast< size_t > (max))
+    {
+      evicted.splice (evicted.end (), g_entries, --g_entries.end ());
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Parked [%s]", parked.key_.c_str ());
+
+  // Free the evicted components outside the lock
+  BOOST_FOREACH (const entry &e, evicted)
+  {
+    free_handles (e.handles_);
+  }
+
+  return true;
+}
+
+void graph::pool::clear ()
+{
+  entry_lst_t entries;
+
+  {
+    boost::mutex::scoped_lock lock (g_mutex);
+    entries.swap (g_entries);
+  }
+
+  BOOST_FOREACH (const entry &e, entries)
+  {
+    free_handles (e.handles_);
+  }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizgraphpool.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Pool of idle, loaded component graphs
+ *
+ *
+ */
+
+#ifndef TIZGRAPHPOOL_HPP
+#define TIZGRAPHPOOL_HPP
+
+#include <string>
+
+#include <boost/utility.hpp>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  namespace graph
+  {
+    /**
+     * A process-wide pool of idle component sets. When a graph is unloaded
+     * cleanly, its components are parked here in OMX_StateLoaded (with the
+     * tunnels torn down) instead of being freed. The next graph with the
+     * same component and role lists (i.e. the same codec/renderer
+     * combination) takes them over, skipping OMX_GetHandle and the
+     * components' initialisation.
+     *
+     * The pool size is configured with 'graph-pool-size' in the [tizonia]
+     * section of tizonia.conf (0 disables the pool).
+     */
+    class pool : boost::noncopyable
+    {
+
+    public:
+      static bool acquire (const omx_comp_name_lst_t &comp_lst,
+                           const omx_comp_role_lst_t &role_lst,
+                           OMX_PTR ap_app_data, OMX_CALLBACKTYPE *ap_callbacks,
+                           omx_comp_handle_lst_t &hdl_lst);
+      static bool release (const omx_comp_name_lst_t &comp_lst,
+                           const omx_comp_role_lst_t &role_lst,
+                           const omx_comp_handle_lst_t &hdl_lst);
+      static void clear ();
+    };
+  }  // namespace graph
+}  // namespace tiz
+
+#endif  // TIZGRAPHPOOL_HPP
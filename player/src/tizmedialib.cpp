@@ -0,0 +1,542 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizmedialib.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent local media library index
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread.hpp>
+
+#include <tizplatform.h>
+
+#include "tizmedialib.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.medialib"
+#endif
+
+#define TIZ_MEDIALIB_INDEX_HEADER "tizonia-medialib 1"
+#define TIZ_MEDIALIB_MIN_SCAN_THREADS 4
+#define TIZ_MEDIALIB_MAX_SCAN_THREADS 16
+
+namespace bfs = boost::filesystem;
+
+namespace  // unnamed namespace
+{
+  // Modification time used for directories whose cached listing must not be
+  // trusted on the next scan.
+  const std::time_t untrusted_mtime = static_cast< std::time_t >(-1);
+
+  std::string join_path (const std::string &dir, const std::string &name)
+  {
+    return (bfs::path (dir) / name).string ();
+  }
+
+  // Keys of the paths strictly below 'root_dir' form the contiguous range
+  // [root_dir + "/", root_dir + "0") of an ordered map ('0' follows '/').
+  std::string subtree_first (const std::string &root_dir)
+  {
+    return root_dir == "/" ? root_dir : root_dir + "/";
+  }
+
+  std::string subtree_last (const std::string &root_dir)
+  {
+    return root_dir == "/" ? std::string ("0") : root_dir + "0";
+  }
+
+  bool has_newline (const std::string &str)
+  {
+    return str.find ('\n') != std::string::npos;
+  }
+
+  // Splits "<n1> <n2> ... <rest>" into 'nfields' numbers and the remainder
+  // of the line, which may contain spaces.
+  bool split_record (const std::string &line, const int nfields,
+                     std::vector< long long > &fields, std::string &rest)
+  {
+    size_t pos = 2;  // skip the record type and the separator
+    fields.clear ();
+    for (int i = 0; i < nfields; ++i)
+    {
+      const size_t sep = line.find (' ', pos);
+      if (sep == std::string::npos)
+      {
+        return false;
+      }
+      std::istringstream iss (line.substr (pos, sep - pos));
+      long long value = 0;
+      if (!(iss >> value))
+      {
+        return false;
+      }
+      fields.push_back (value);
+      pos = sep + 1;
+    }
+    rest = line.substr (std::min (pos, line.size ()));
+    return !rest.empty ();
+  }
+
+  std::string codec_of (const std::string &name)
+  {
+    std::string extension (bfs::path (name).extension ().string ());
+    boost::algorithm::to_lower (extension);
+    return extension;
+  }
+}  // unnamed namespace
+
+//
+// medialib::scanner
+//
+// Walks a directory tree using a pool of threads. Each thread takes one
+// directory at a time from a shared queue, lists it (or reuses its cached
+// listing) and queues its subdirectories.
+//
+class tiz::medialib::scanner
+{
+public:
+  scanner (const dir_map_t &cache, dir_map_t &results)
+    : cache_ (cache),
+      results_ (results),
+      queue_ (),
+      pending_ (0),
+      listed_ (0),
+      reused_ (0),
+      scan_start_ (std::time (NULL)),
+      mutex_ (),
+      cond_ ()
+  {
+  }
+
+  void run (const std::string &root_dir)
+  {
+    const unsigned int nthreads = std::min (
+        static_cast< unsigned int >(TIZ_MEDIALIB_MAX_SCAN_THREADS),
+        std::max (static_cast< unsigned int >(TIZ_MEDIALIB_MIN_SCAN_THREADS),
+                  2 * boost::thread::hardware_concurrency ()));
+    boost::thread_group workers;
+
+    queue_.push_back (root_dir);
+    pending_ = 1;
+
+    for (unsigned int i = 0; i < nthreads; ++i)
+    {
+      workers.create_thread (boost::bind (&scanner::work, this));
+    }
+    workers.join_all ();
+  }
+
+  int listed () const
+  {
+    return listed_;
+  }
+
+  int reused () const
+  {
+    return reused_;
+  }
+
+private:
+  void work ()
+  {
+    for (;;)
+    {
+      std::string dir;
+      {
+        boost::unique_lock< boost::mutex > lock (mutex_);
+        while (queue_.empty () && pending_ > 0)
+        {
+          cond_.wait (lock);
+        }
+        if (queue_.empty ())
+        {
+          // All directories have been visited
+          return;
+        }
+        dir = queue_.front ();
+        queue_.pop_front ();
+      }
+
+      dir_entry entry;
+      bool reused = false;
+      bool visited = false;
+      try
+      {
+        visited = visit (dir, entry, reused);
+      }
+      catch (...)
+      {
+        TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : unable to list directory",
+                 dir.c_str ());
+      }
+
+      {
+        boost::unique_lock< boost::mutex > lock (mutex_);
+        if (visited)
+        {
+          std::vector< std::string >::const_iterator it
+              = entry.subdirs_.begin ();
+          for (; it != entry.subdirs_.end (); ++it)
+          {
+            queue_.push_back (join_path (dir, *it));
+            ++pending_;
+          }
+          reused ? ++reused_ : ++listed_;
+          std::swap (results_[dir], entry);
+        }
+        --pending_;
+        cond_.notify_all ();
+      }
+    }
+  }
+
+  bool visit (const std::string &dir, dir_entry &entry, bool &reused) const
+  {
+    boost::system::error_code ec;
+    const std::time_t mtime = bfs::last_write_time (dir, ec);
+    if (ec)
+    {
+      return false;
+    }
+
+    // A directory's mtime changes whenever an entry is added, removed or
+    // renamed in it, so an unchanged mtime means the cached listing is
+    // still valid.
+    dir_map_t::const_iterator cached = cache_.find (dir);
+    if (cached != cache_.end () && cached->second.mtime_ != untrusted_mtime
+        && cached->second.mtime_ == mtime)
+    {
+      entry = cached->second;
+      reused = true;
+      return true;
+    }
+
+    // The mtime has a one-second resolution; a directory modified during
+    // the current second could change again unnoticed after being listed.
+    entry.mtime_ = (mtime >= scan_start_ - 1) ? untrusted_mtime : mtime;
+
+    bfs::directory_iterator it (dir, ec);
+    bfs::directory_iterator end;
+    for (; !ec && it != end; it.increment (ec))
+    {
+      boost::system::error_code sec;
+      const std::string name (it->path ().filename ().string ());
+      // Like recursive_directory_iterator, do not follow directory symlinks
+      if (bfs::is_directory (it->symlink_status (sec)))
+      {
+        entry.subdirs_.push_back (name);
+      }
+      else if (bfs::is_regular_file (it->status (sec)))
+      {
+        file_entry file;
+        file.name_ = name;
+        file.codec_ = codec_of (name);
+        file.size_ = bfs::file_size (it->path (), sec);
+        file.mtime_ = bfs::last_write_time (it->path (), sec);
+        entry.files_.push_back (file);
+      }
+    }
+    reused = false;
+    return true;
+  }
+
+private:
+  const dir_map_t &cache_;
+  dir_map_t &results_;
+  std::deque< std::string > queue_;
+  int pending_;
+  int listed_;
+  int reused_;
+  const std::time_t scan_start_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+};
+
+//
+// medialib
+//
+tiz::medialib::medialib (const std::string &index_file)
+  : index_file_ (index_file), dirs_ (), dirs_listed_ (0), dirs_reused_ (0)
+{
+}
+
+std::string tiz::medialib::default_index_file ()
+{
+  std::string cache_dir;
+  const char *p_xdg_cache = getenv ("XDG_CACHE_HOME");
+  const char *p_home = getenv ("HOME");
+  if (p_xdg_cache && *p_xdg_cache)
+  {
+    cache_dir.assign (p_xdg_cache);
+  }
+  else if (p_home && *p_home)
+  {
+    cache_dir.assign (join_path (p_home, ".cache"));
+  }
+  return cache_dir.empty ()
+             ? cache_dir
+             : join_path (join_path (cache_dir, "tizonia"), "medialib.idx");
+}
+
+bool tiz::medialib::load ()
+{
+  std::ifstream in (index_file_.c_str ());
+  std::string line;
+  std::vector< long long > fields;
+  std::string rest;
+  dir_entry *p_dir = NULL;
+
+  dirs_.clear ();
+
+  if (!in || !std::getline (in, line) || line != TIZ_MEDIALIB_INDEX_HEADER)
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : no usable index",
+             index_file_.c_str ());
+    return false;
+  }
+
+  while (std::getline (in, line))
+  {
+    if (line.size () < 3 || line[1] != ' ')
+    {
+      continue;
+    }
+    switch (line[0])
+    {
+      case 'D':
+      {
+        p_dir = NULL;
+        if (split_record (line, 1, fields, rest))
+        {
+          p_dir = &dirs_[rest];
+          p_dir->mtime_ = static_cast< std::time_t >(fields[0]);
+        }
+      }
+      break;
+      case 'S':
+      {
+        if (p_dir)
+        {
+          p_dir->subdirs_.push_back (line.substr (2));
+        }
+      }
+      break;
+      case 'F':
+      {
+        if (p_dir && split_record (line, 2, fields, rest))
+        {
+          file_entry file;
+          file.name_ = rest;
+          file.codec_ = codec_of (rest);
+          file.size_ = static_cast< boost::uintmax_t >(fields[0]);
+          file.mtime_ = static_cast< std::time_t >(fields[1]);
+          p_dir->files_.push_back (file);
+        }
+      }
+      break;
+      default:
+        break;
+    };
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : loaded [%zu] directories",
+           index_file_.c_str (), dirs_.size ());
+  return true;
+}
+
+bool tiz::medialib::save () const
+{
+  boost::system::error_code ec;
+
+  if (index_file_.empty ())
+  {
+    return false;
+  }
+
+  const bfs::path index_dir (bfs::path (index_file_).parent_path ());
+  if (!index_dir.empty ())
+  {
+    bfs::create_directories (index_dir, ec);
+  }
+  if (ec)
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : %s", index_file_.c_str (),
+             ec.message ().c_str ());
+    return false;
+  }
+
+  // Each writer gets its own temporary file, in the index's directory so
+  // that the final rename stays within one filesystem
+  std::vector< char > tmp_template (index_file_.begin (), index_file_.end ());
+  const char suffix[] = ".XXXXXX";
+  tmp_template.insert (tmp_template.end (), suffix, suffix + sizeof (suffix));
+  const int tmp_fd = mkstemp (&tmp_template[0]);
+  if (tmp_fd < 0)
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : mkstemp failed [%s]",
+             index_file_.c_str (), strerror (errno));
+    return false;
+  }
+  (void) close (tmp_fd);
+  const std::string tmp_file (&tmp_template[0]);
+
+  {
+    std::ofstream out (tmp_file.c_str (), std::ios::out | std::ios::trunc);
+    out << TIZ_MEDIALIB_INDEX_HEADER << '\n';
+    for (dir_map_t::const_iterator it = dirs_.begin ();
+         out && it != dirs_.end (); ++it)
+    {
+      const dir_entry &dir = it->second;
+      bool skip = has_newline (it->first);
+      for (size_t i = 0; !skip && i < dir.subdirs_.size (); ++i)
+      {
+        skip = has_newline (dir.subdirs_[i]);
+      }
+      for (size_t i = 0; !skip && i < dir.files_.size (); ++i)
+      {
+        skip = has_newline (dir.files_[i].name_);
+      }
+      if (skip)
+      {
+        // This directory will simply be listed again on the next scan
+        continue;
+      }
+
+      out << "D " << static_cast< long long >(dir.mtime_) << ' ' << it->first
+          << '\n';
+      for (size_t i = 0; i < dir.subdirs_.size (); ++i)
+      {
+        out << "S " << dir.subdirs_[i] << '\n';
+      }
+      for (size_t i = 0; i < dir.files_.size (); ++i)
+      {
+        const file_entry &file = dir.files_[i];
+        out << "F " << static_cast< long long >(file.size_) << ' '
+            << static_cast< long long >(file.mtime_) << ' ' << file.name_
+            << '\n';
+      }
+    }
+    out.flush ();
+    if (!out)
+    {
+      bfs::remove (tmp_file, ec);
+      return false;
+    }
+  }
+
+  // Replace the old index atomically
+  bfs::rename (tmp_file, index_file_, ec);
+  if (ec)
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : %s", index_file_.c_str (),
+             ec.message ().c_str ());
+    bfs::remove (tmp_file, ec);
+    return false;
+  }
+  return true;
+}
+
+bool tiz::medialib::scan (const std::string &root_dir, uri_lst_t &uri_list,
+                          std::string &error_msg)
+{
+  dir_map_t results;
+
+  try
+  {
+    scanner dir_scanner (dirs_, results);
+    dir_scanner.run (root_dir);
+    dirs_listed_ = dir_scanner.listed ();
+    dirs_reused_ = dir_scanner.reused ();
+  }
+  catch (std::exception const &e)
+  {
+    error_msg.assign (e.what ());
+    return false;
+  }
+
+  if (results.find (root_dir) == results.end ())
+  {
+    error_msg.assign ("File not found.");
+    return false;
+  }
+
+  // Directories under 'root_dir' that were not reached in this scan no
+  // longer exist.
+  purge (root_dir);
+  dirs_.insert (results.begin (), results.end ());
+  collect (results, uri_list);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "[%s] : [%d] directories listed, [%d] reused, [%zu] files",
+           root_dir.c_str (), dirs_listed_, dirs_reused_, uri_list.size ());
+
+  return true;
+}
+
+int tiz::medialib::dirs_listed () const
+{
+  return dirs_listed_;
+}
+
+int tiz::medialib::dirs_reused () const
+{
+  return dirs_reused_;
+}
+
+void tiz::medialib::purge (const std::string &root_dir)
+{
+  dirs_.erase (root_dir);
+  dirs_.erase (dirs_.lower_bound (subtree_first (root_dir)),
+               dirs_.lower_bound (subtree_last (root_dir)));
+}
+
+void tiz::medialib::collect (const dir_map_t &dirs, uri_lst_t &uri_list)
+{
+  dir_map_t::const_iterator it = dirs.begin ();
+  for (; it != dirs.end (); ++it)
+  {
+    const file_entry_lst_t &files = it->second.files_;
+    for (size_t i = 0; i < files.size (); ++i)
+    {
+      uri_list.push_back (join_path (it->first, files[i].name_));
+    }
+  }
+}
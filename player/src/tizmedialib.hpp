@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizmedialib.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent local media library index
+ *
+ *
+ */
+
+#ifndef TIZMEDIALIB_HPP
+#define TIZMEDIALIB_HPP
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  /**
+   * An on-disk index of the files found under one or more local directory
+   * trees.
+   *
+   * The index is organised per directory. A directory is only listed again
+   * when its modification time has changed (i.e. when entries have been added,
+   * removed or renamed in it). For unchanged directories, the cached entries
+   * are used without touching the files. Directories that need listing are
+   * processed by a small pool of threads, which hides most of the latency of
+   * network file systems.
+   */
+  class medialib
+  {
+
+  public:
+    struct file_entry
+    {
+      file_entry () : name_ (), codec_ (), size_ (0), mtime_ (0)
+      {
+      }
+      std::string name_;   // file name, relative to its directory
+      std::string codec_;  // lower-case file extension, e.g. ".mp3"
+      boost::uintmax_t size_;
+      std::time_t mtime_;
+    };
+    typedef std::vector< file_entry > file_entry_lst_t;
+
+  public:
+    explicit medialib (const std::string &index_file);
+
+    static std::string default_index_file ();
+
+    bool load ();
+    bool save () const;
+
+    bool scan (const std::string &root_dir, uri_lst_t &uri_list,
+               std::string &error_msg);
+
+    int dirs_listed () const;
+    int dirs_reused () const;
+
+  private:
+    struct dir_entry
+    {
+      dir_entry () : mtime_ (0), subdirs_ (), files_ ()
+      {
+      }
+      std::time_t mtime_;
+      std::vector< std::string > subdirs_;
+      file_entry_lst_t files_;
+    };
+    typedef std::map< std::string, dir_entry > dir_map_t;
+
+  private:
+    class scanner;
+
+    void purge (const std::string &root_dir);
+    static void collect (const dir_map_t &dirs, uri_lst_t &uri_list);
+
+  private:
+    std::string index_file_;
+    dir_map_t dirs_;
+    int dirs_listed_;
+    int dirs_reused_;
+  };
+}  // namespace tiz
+
+#endif  // TIZMEDIALIB_HPP
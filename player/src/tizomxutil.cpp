@@ -40,6 +40,7 @@
 
 #include "tizplatform.h"
 
+#include "tizgraphpool.hpp"
 #include "tizomxutil.hpp"
 
 void tiz::omxutil::init ()
@@ -56,6 +57,8 @@ void tiz::omxutil::init ()
 
 void tiz::omxutil::deinit ()
 {
+  // Free any components that are still parked in the graph pool
+  tiz::graph::pool::clear ();
   (void)OMX_Deinit ();
 }
 
@@ -588,6 +588,9 @@ tiz::playapp::serve_stream ()
   const std::vector< int > &sampling_rate_list = popts_.sampling_rate_list ();
   const std::string &bitrates = popts_.bitrates ();
   const std::vector< std::string > &bitrate_list = popts_.bitrate_list ();
+  const std::string &bitrate_ladder = popts_.bitrate_ladder ();
+  const std::vector< int > &bitrate_ladder_list
+      = popts_.bitrate_ladder_list ();
   const std::string &station_name = popts_.station_name ();
   const std::string &station_genre = popts_.station_genre ();
 
@@ -620,8 +623,21 @@ tiz::playapp::serve_stream ()
     struct hostent *p_hostent = gethostbyname (hostname);
     struct in_addr ip_addr = *(struct in_addr *)(p_hostent->h_addr);
     ip_address = inet_ntoa (ip_addr);
-    fprintf (stdout, "[%s]: Server streaming on http://%s:%ld\n",
-             station_name.c_str (), hostname, port);
+    if (bitrate_ladder_list.empty ())
+    {
+      fprintf (stdout, "[%s]: Server streaming on http://%s:%ld\n",
+               station_name.c_str (), hostname, port);
+    }
+    else
+    {
+      for (size_t i = 0; i < bitrate_ladder_list.size (); ++i)
+      {
+        fprintf (stdout,
+                 "[%s]: Server streaming %d kbps on http://%s:%ld/%dk\n",
+                 station_name.c_str (), bitrate_ladder_list[i], hostname,
+                 port + i, bitrate_ladder_list[i]);
+      }
+    }
 
     fprintf (stdout, "[%s]: Streaming media with sampling rates [%s].\n",
              station_name.c_str (),
@@ -632,6 +648,11 @@ tiz::playapp::serve_stream ()
       fprintf (stdout, "[%s]: Streaming media with bitrate modes [%s].\n",
                station_name.c_str (), bitrates.c_str ());
     }
+    if (!bitrate_ladder_list.empty ())
+    {
+      fprintf (stdout, "[%s]: Re-encoding media to bitrates [%s] kbps.\n",
+               station_name.c_str (), bitrate_ladder.c_str ());
+    }
     fprintf (stdout, "\n");
   }
 
@@ -646,10 +667,11 @@ tiz::playapp::serve_stream ()
   // manager at the end of the playlist.
   playlist->set_loop_playback (true);
 
-  tizgraphconfig_ptr_t config
-      = boost::make_shared< tiz::graph::httpservconfig > (
-          playlist, hostname, ip_address, port, sampling_rate_list,
-          bitrate_list, station_name, station_genre, icy_metadata);
+  // NOTE: boost::make_shared takes at most nine arguments without variadic
+  // templates
+  tizgraphconfig_ptr_t config (new tiz::graph::httpservconfig (
+      playlist, hostname, ip_address, port, sampling_rate_list, bitrate_list,
+      station_name, station_genre, icy_metadata, bitrate_ladder_list));
 
   // Instantiate the http streaming manager
   tiz::graphmgr::mgr_ptr_t p_mgr
@@ -38,6 +38,7 @@
 
 #include <tizplatform.h>
 
+#include "tizmedialib.hpp"
 #include "tizplaylist.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -100,6 +101,41 @@ namespace  // unnamed namespace
     return OMX_ErrorContentURIError;
   }
 
+  bool is_media_library_index_enabled ()
+  {
+    const char *p_enabled
+        = tiz_rcfile_get_value ("tizonia", "media-library-index");
+    return (p_enabled && std::string (p_enabled).compare ("true") == 0);
+  }
+
+  OMX_ERRORTYPE
+  process_base_dir_indexed (const std::string &dir, uri_lst_t &uri_list)
+  {
+    const std::string index_file (tiz::medialib::default_index_file ());
+    std::string error_msg;
+
+    if (!index_file.empty ())
+    {
+      tiz::medialib library (index_file);
+      (void)library.load ();
+      if (library.scan (dir, uri_list, error_msg))
+      {
+        if (!library.save ())
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : unable to save the index",
+                   index_file.c_str ());
+        }
+        return uri_list.empty () ? OMX_ErrorContentURIError : OMX_ErrorNone;
+      }
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : %s", dir.c_str (),
+               error_msg.c_str ());
+      uri_list.clear ();
+    }
+
+    // Fall back to a plain directory walk
+    return process_base_uri (dir, uri_list, true);
+  }
+
   OMX_ERRORTYPE
   filter_unknown_media (const file_extension_lst_t &extension_list,
                         uri_lst_t &uri_list,
@@ -207,7 +243,16 @@ bool tiz::playlist::assemble_play_list (
       goto end;
     }
 
-    if (OMX_ErrorNone != process_base_uri (canonical_base_uri, uri_list, recurse))
+    // Recursive scans of (possibly large) directory trees are served from
+    // the persistent media library index, when enabled.
+    const bool use_index
+        = recurse && boost::filesystem::is_directory (canonical_base_uri)
+          && is_media_library_index_enabled ();
+
+    if (OMX_ErrorNone
+        != (use_index
+                ? process_base_dir_indexed (canonical_base_uri, uri_list)
+                : process_base_uri (canonical_base_uri, uri_list, recurse)))
     {
       error_msg.assign ("File not found.");
       goto end;
@@ -71,6 +71,8 @@ namespace
 {
   const int TIZ_STREAMING_SERVER_DEFAULT_PORT = 8010;
   const int TIZ_MAX_BITRATE_MODES = 2;
+  // This matches the number of outputs of the PCM tee component
+  const int TIZ_MAX_BITRATE_LADDER_RUNGS = 4;
 
   struct program_option_is_defaulted
   {
@@ -146,6 +148,35 @@ namespace
     return rc;
   }
 
+  bool is_valid_bitrate_ladder (const std::vector< std::string > &kbps_strings,
+                                std::vector< int > &ladder)
+  {
+    // The MPEG-1 Layer III bitrates supported by the mp3 encoder
+    const int valid_kbps[] = {32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192,
+                              224, 256, 320};
+    const int *p_valid_end
+        = valid_kbps + sizeof (valid_kbps) / sizeof (valid_kbps[0]);
+    bool rc = true;
+    ladder.clear ();
+    for (unsigned int i = 0; i < kbps_strings.size () && rc; ++i)
+    {
+      try
+      {
+        ladder.push_back (boost::lexical_cast< int > (kbps_strings[i]));
+      }
+      catch (const boost::bad_lexical_cast &)
+      {
+        rc = false;
+        break;
+      }
+      rc = (std::find (valid_kbps, p_valid_end, ladder[i]) != p_valid_end)
+           && (std::count (ladder.begin (), ladder.end (), ladder[i]) == 1);
+    }
+    rc &= !ladder.empty ();
+    rc &= (ladder.size () <= TIZ_MAX_BITRATE_LADDER_RUNGS);
+    return rc;
+  }
+
   bool omx_conflicting_options (const po::variables_map &vm, const char *opt1,
                                 const char *opt2)
   {
@@ -289,6 +320,8 @@ tiz::programopts::programopts (int argc, char *argv[])
     bitrate_list_ (),
     sampling_rates_ (),
     sampling_rate_list_ (),
+    bitrate_ladder_ (),
+    bitrate_ladder_list_ (),
     uri_list_ (),
     spotify_user_ (),
     spotify_pass_ (),
@@ -613,6 +646,16 @@ const std::vector< int > &tiz::programopts::sampling_rate_list () const
   return sampling_rate_list_;
 }
 
+const std::string &tiz::programopts::bitrate_ladder () const
+{
+  return bitrate_ladder_;
+}
+
+const std::vector< int > &tiz::programopts::bitrate_ladder_list () const
+{
+  return bitrate_ladder_list_;
+}
+
 const std::vector< std::string > &tiz::programopts::uri_list () const
 {
   return uri_list_;
@@ -1076,6 +1119,14 @@ void tiz::programopts::init_streaming_server_options ()
        "of sampling rates. Only media with these rates will in the "
        "playlist. Default: any.")
       /* TIZ_CLASS_COMMENT: */
+      ("bitrate-ladder", po::value (&bitrate_ladder_),
+       "A comma-separated list "
+       /* TIZ_CLASS_COMMENT: */
+       "of up to 4 mp3 bitrates in kbps (e.g. '64,128,320'). The media is "
+       "decoded once and re-encoded at each bitrate in parallel. Each "
+       "bitrate is served on its own TCP port, starting at the server port "
+       "and in the order given. Default: none (serve the media as is).")
+      /* TIZ_CLASS_COMMENT: */
       ;
 
   // Give a default value to the bitrate list
@@ -1086,7 +1137,7 @@ void tiz::programopts::init_streaming_server_options ()
   all_streaming_server_options_
       = boost::assign::list_of ("server") ("port") ("station-name") (
             "station-genre") ("no-icy-metadata") ("bitrate-modes") (
-            "sampling-rates")
+            "sampling-rates") ("bitrate-ladder")
             .convert_to_container< std::vector< std::string > > ();
 }
 
@@ -1496,6 +1547,7 @@ int tiz::programopts::consume_streaming_server_options (bool &done,
     PO_RETURN_IF_FAIL (validate_port_argument (msg));
     PO_RETURN_IF_FAIL (validate_bitrates_argument (msg));
     PO_RETURN_IF_FAIL (validate_sampling_rates_argument (msg));
+    PO_RETURN_IF_FAIL (validate_bitrate_ladder_argument (msg));
     rc = consume_input_file_uris_option ();
     if (EXIT_SUCCESS == rc)
     {
@@ -2143,6 +2195,27 @@ bool tiz::programopts::validate_sampling_rates_argument (std::string &msg)
   return rc;
 }
 
+bool tiz::programopts::validate_bitrate_ladder_argument (std::string &msg)
+{
+  bool rc = true;
+  if (vm_.count ("bitrate-ladder"))
+  {
+    std::vector< std::string > kbps_str_list;
+    boost::split (kbps_str_list, bitrate_ladder_, boost::is_any_of (","));
+    if (!is_valid_bitrate_ladder (kbps_str_list, bitrate_ladder_list_))
+    {
+      rc = false;
+      std::ostringstream oss;
+      oss << "Invalid argument : " << bitrate_ladder_ << "\n"
+          << "Valid bitrate ladder : up to " << TIZ_MAX_BITRATE_LADDER_RUNGS
+          << " distinct values from\n"
+          << "[32,40,48,56,64,80,96,112,128,160,192,224,256,320].";
+      msg.assign (oss.str ());
+    }
+  }
+  return rc;
+}
+
 void tiz::programopts::register_consume_function (const consume_mem_fn_t cf)
 {
   consume_functions_.push_back (boost::bind (boost::mem_fn (cf), this, _1, _2));
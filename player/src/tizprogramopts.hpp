@@ -74,6 +74,8 @@ namespace tiz
     const std::vector< std::string > &bitrate_list () const;
     const std::string &sampling_rates () const;
     const std::vector< int > &sampling_rate_list () const;
+    const std::string &bitrate_ladder () const;
+    const std::vector< int > &bitrate_ladder_list () const;
     const std::vector< std::string > &uri_list () const;
     const std::string &spotify_user () const;
     const std::string &spotify_password () const;
@@ -140,6 +142,7 @@ namespace tiz
     bool validate_port_argument (std::string &msg) const;
     bool validate_bitrates_argument (std::string &msg);
     bool validate_sampling_rates_argument (std::string &msg);
+    bool validate_bitrate_ladder_argument (std::string &msg);
 
     int call_handler (const option_handlers_map_t::const_iterator &handler_it);
 
@@ -181,6 +184,8 @@ namespace tiz
     std::vector< std::string > bitrate_list_;
     std::string sampling_rates_;
     std::vector< int > sampling_rate_list_;
+    std::string bitrate_ladder_;
+    std::vector< int > bitrate_ladder_list_;
     std::vector< std::string > uri_list_;
     std::string spotify_user_;
     std::string spotify_pass_;
@@ -51,6 +51,7 @@ extern "C" {
 #define ARATELIA_AAC_DECODER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_AAC_DECODER_PORT_ALIGNMENT 0
 #define ARATELIA_AAC_DECODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_AAC_DECODER_DEFAULT_BITS_PER_SAMPLE 16
 
 #ifdef __cplusplus
 }
@@ -47,6 +47,13 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.aac_decoder.prc"
 #endif
 
+#define AACDEC_ID3_HEADER_LEN 10
+#define AACDEC_ADTS_HEADER_LEN 7
+#define AACDEC_LOAS_HEADER_LEN 3
+/* How much data is searched for a sync word before the stream is taken to be
+   headerless */
+#define AACDEC_MAX_SYNC_SEARCH (FAAD_MIN_STREAMSIZE * MAX_CHANNELS * 4)
+
 /* Forward declarations */
 static OMX_ERRORTYPE aacdec_prc_deallocate_resources (void *);
 
@@ -75,21 +82,98 @@ static inline void deallocate_temp_data_store (
   ap_prc->p_store_ = NULL;
 }
 
-static void skip_id3_tag (aacdec_prc_t *ap_prc)
+static inline void consume_input (OMX_BUFFERHEADERTYPE *ap_in,
+                                  const OMX_U32 a_nbytes)
 {
-  OMX_U8 *p_buffer = tiz_buffer_get (ap_prc->p_store_);
+  assert (ap_in);
+  assert (a_nbytes <= ap_in->nFilledLen);
+  ap_in->nOffset += a_nbytes;
+  ap_in->nFilledLen -= a_nbytes;
+}
 
-  assert (ap_prc);
+static inline OMX_U32 header_length (const aacdec_framing_t a_framing)
+{
+  return EAacdecFramingLoas == a_framing ? AACDEC_LOAS_HEADER_LEN
+                                         : AACDEC_ADTS_HEADER_LEN;
+}
 
-  if (!memcmp (p_buffer, "ID3", 3))
+/* Returns the length of the frame whose header starts at ap_data, or zero if
+   there is no plausible header there. At least header_length bytes must be
+   readable. */
+static OMX_U32 frame_length (const aacdec_framing_t a_framing,
+                             const OMX_U8 *ap_data)
+{
+  OMX_U32 len = 0;
+  assert (ap_data);
+  if (EAacdecFramingLoas == a_framing)
     {
-      int tagsize = 0;
-      /* high bit is not used */
-      tagsize = (p_buffer[6] << 21) | (p_buffer[7] << 14) | (p_buffer[8] << 7)
-                | (p_buffer[9] << 0);
-      tagsize += 10;
-      tiz_buffer_advance (ap_prc->p_store_, tagsize);
+      /* AudioSyncStream: 11-bit sync word 0x2B7, 13-bit length */
+      if (0x56 == ap_data[0] && 0xE0 == (ap_data[1] & 0xE0))
+        {
+          len = AACDEC_LOAS_HEADER_LEN
+                + (((ap_data[1] & 0x1F) << 8) | ap_data[2]);
+        }
+    }
+  else
+    {
+      /* 12-bit sync word, layer 0 and a valid sampling frequency index */
+      if (0xFF == ap_data[0] && 0xF0 == (ap_data[1] & 0xF6)
+          && ((ap_data[2] >> 2) & 0x0F) < 12)
+        {
+          len = ((ap_data[3] & 0x03) << 11) | (ap_data[4] << 3)
+                | (ap_data[5] >> 5);
+          if (len < AACDEC_ADTS_HEADER_LEN)
+            {
+              len = 0;
+            }
+        }
+    }
+  return len;
+}
+
+/* Returns the offset of the first header in the region that is confirmed by
+   the header of the frame that follows it (or whose frame runs past the end
+   of the region, so it can't be confirmed yet), or -1 if there is none. */
+static long find_sync (const aacdec_framing_t a_framing, const OMX_U8 *ap_data,
+                       const OMX_U32 a_len)
+{
+  const OMX_U32 hdr_len = header_length (a_framing);
+  OMX_U32 i = 0;
+  assert (ap_data);
+  for (i = 0; i + hdr_len <= a_len; ++i)
+    {
+      const OMX_U32 len = frame_length (a_framing, ap_data + i);
+      if (len > 0 && (i + len + hdr_len > a_len
+                      || frame_length (a_framing, ap_data + i + len) > 0))
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+static aacdec_framing_t detect_framing (const OMX_U8 *ap_data,
+                                        const OMX_U32 a_len, long *ap_offset)
+{
+  const long adts = find_sync (EAacdecFramingAdts, ap_data, a_len);
+  const long loas = find_sync (EAacdecFramingLoas, ap_data, a_len);
+  assert (ap_offset);
+  *ap_offset = 0;
+  if (a_len >= 4 && !memcmp (ap_data, "ADIF", 4))
+    {
+      return EAacdecFramingRaw;
+    }
+  if (adts >= 0 && (loas < 0 || adts <= loas))
+    {
+      *ap_offset = adts;
+      return EAacdecFramingAdts;
     }
+  if (loas >= 0)
+    {
+      *ap_offset = loas;
+      return EAacdecFramingLoas;
+    }
+  return EAacdecFramingUnknown;
 }
 
 static inline OMX_ERRORTYPE retrieve_aac_settings (
@@ -127,7 +211,7 @@ static OMX_ERRORTYPE set_decoder_config (aacdec_prc_t *ap_prc)
       p_config->defSampleRate = aactype.nSampleRate;
       p_config->defObjectType = aactype.eAACProfile;
       p_config->outputFormat
-          = FAAD_FMT_16BIT;           /* we making this fixed for now */
+          = 4 == ap_prc->sample_size_ ? FAAD_FMT_FLOAT : FAAD_FMT_16BIT;
       p_config->downMatrix = 1;       /* Down matrix 5.1 to 2 channels */
       p_config->useOldADTSFormat = 0; /* we making this fixed for now */
       /* config->dontUpSampleImplicitSBR = 1; */
@@ -331,37 +415,164 @@ static void store_stream_metadata (aacdec_prc_t *ap_prc)
   (void)store_metadata (ap_prc, "AAC", info);
 }
 
-static OMX_ERRORTYPE init_aac_decoder (aacdec_prc_t *ap_prc)
+static OMX_ERRORTYPE release_input_header (aacdec_prc_t *ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  long nbytes = 0;
   OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
       ap_prc, ARATELIA_AAC_DECODER_INPUT_PORT_INDEX);
 
+  assert (ap_prc);
+
+  if (p_in)
+    {
+      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+        {
+          /* Let's propagate EOS flag to output */
+          TIZ_TRACE (handleOf (ap_prc), "Let's propagate EOS flag to output");
+          tiz_filter_prc_update_eos_flag (ap_prc, true);
+          p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
+          if (tiz_buffer_available (ap_prc->p_store_) > 0)
+            {
+              TIZ_DEBUG (handleOf (ap_prc),
+                         "Dropping [%d] bytes of incomplete frame at EOS",
+                         tiz_buffer_available (ap_prc->p_store_));
+              tiz_buffer_clear (ap_prc->p_store_);
+            }
+        }
+      p_in->nFilledLen = 0;
+      tiz_check_omx (tiz_filter_prc_release_header (
+          ap_prc, ARATELIA_AAC_DECODER_INPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+/* Copies the last decoded frame straight from libfaad's output buffer into as
+   many output buffers as it takes, in whole sample frames. The next frame is
+   not decoded until all of it has been written out. */
+static OMX_ERRORTYPE write_pcm (aacdec_prc_t *ap_prc)
+{
+  assert (ap_prc);
+
+  while (ap_prc->pcm_len_ > 0)
+    {
+      const OMX_U32 frame_len
+          = ap_prc->sample_size_ * ap_prc->pcmmode_.nChannels;
+      OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
+          ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX);
+      OMX_U32 room = 0;
+      OMX_U32 nbytes = 0;
+
+      if (!p_out)
+        {
+          TIZ_TRACE (handleOf (ap_prc),
+                     "No more output buffers available at the moment");
+          return OMX_ErrorNotReady;
+        }
+
+      assert (frame_len > 0);
+      room = (TIZ_OMX_BUF_AVAIL (p_out) / frame_len) * frame_len;
+      nbytes = MIN (room, ap_prc->pcm_len_);
+      memcpy (TIZ_OMX_BUF_PTR (p_out) + p_out->nFilledLen, ap_prc->p_pcm_,
+              nbytes);
+      p_out->nFilledLen += nbytes;
+      ap_prc->p_pcm_ = (OMX_U8 *)ap_prc->p_pcm_ + nbytes;
+      ap_prc->pcm_len_ -= nbytes;
+
+      if (room == nbytes)
+        {
+          /* This one is full */
+          tiz_check_omx (tiz_filter_prc_release_header (
+              ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE init_aac_decoder (aacdec_prc_t *ap_prc,
+                                       OMX_BUFFERHEADERTYPE *ap_in)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  const bool eos = (ap_in->nFlags & OMX_BUFFERFLAG_EOS) > 0;
+  long nbytes = 0;
+  long offset = 0;
+  OMX_U8 *p_data = NULL;
+  OMX_U32 avail = 0;
+
   assert (ap_prc);
   assert (ap_prc->p_aac_dec_);
-  assert (p_in);
+  assert (ap_in);
+
+  /* The rest of an ID3 tag that did not fit in the previous buffers */
+  if (ap_prc->id3_skip_ > 0)
+    {
+      const OMX_U32 nskip = MIN (ap_prc->id3_skip_, ap_in->nFilledLen);
+      consume_input (ap_in, nskip);
+      ap_prc->id3_skip_ -= nskip;
+    }
 
-  if (tiz_buffer_push (ap_prc->p_store_, p_in->pBuffer + p_in->nOffset,
-                             p_in->nFilledLen) < p_in->nFilledLen)
+  /* Until the stream's framing is known, data is accumulated in the store */
+  if (tiz_buffer_push (ap_prc->p_store_, TIZ_OMX_BUF_PTR (ap_in),
+                       ap_in->nFilledLen) < ap_in->nFilledLen)
     {
       TIZ_ERROR (handleOf (ap_prc), "[%s] : Unable to store all the data.",
                  tiz_err_to_str (rc));
       return rc;
     }
-  p_in->nFilledLen = 0;
+  ap_in->nFilledLen = 0;
+
+  p_data = tiz_buffer_get (ap_prc->p_store_);
+  avail = tiz_buffer_available (ap_prc->p_store_);
 
   /* Skip the ID3 tag */
-  skip_id3_tag (ap_prc);
+  if (avail < AACDEC_ID3_HEADER_LEN && !eos)
+    {
+      return release_input_header (ap_prc);
+    }
+  if (avail >= AACDEC_ID3_HEADER_LEN && !memcmp (p_data, "ID3", 3))
+    {
+      /* high bit is not used */
+      const OMX_U32 tagsize = ((p_data[6] << 21) | (p_data[7] << 14)
+                               | (p_data[8] << 7) | (p_data[9] << 0))
+                              + AACDEC_ID3_HEADER_LEN;
+      if (tagsize > avail)
+        {
+          ap_prc->id3_skip_ = tagsize - avail;
+          tiz_buffer_clear (ap_prc->p_store_);
+          return release_input_header (ap_prc);
+        }
+      tiz_buffer_advance (ap_prc->p_store_, tagsize);
+      p_data = tiz_buffer_get (ap_prc->p_store_);
+      avail = tiz_buffer_available (ap_prc->p_store_);
+    }
+
+  if (0 == avail)
+    {
+      return release_input_header (ap_prc);
+    }
+
+  ap_prc->framing_ = detect_framing (p_data, avail, &offset);
+  if (EAacdecFramingUnknown == ap_prc->framing_)
+    {
+      if (avail < AACDEC_MAX_SYNC_SEARCH && !eos)
+        {
+          /* Give the sync search some more data */
+          return release_input_header (ap_prc);
+        }
+      /* No sync word anywhere, so this must be headerless AAC */
+      ap_prc->framing_ = EAacdecFramingRaw;
+    }
+  tiz_buffer_advance (ap_prc->p_store_, offset);
+
+  TIZ_DEBUG (handleOf (ap_prc), "framing [%s] offset [%ld]",
+             EAacdecFramingAdts == ap_prc->framing_
+                 ? "ADTS"
+                 : (EAacdecFramingLoas == ap_prc->framing_ ? "LOAS" : "RAW"),
+             offset);
 
   /* Set the decoder configuration according to the configuration found on the
      input port
      (useful in case of raw aac files) */
   tiz_check_omx (set_decoder_config (ap_prc));
 
-  /* Retrieve againg the pointer to the current position in the buffer
-     (skip_id3_tag may have modified it */
-
   /* Initialise the library using one of the initialization functions */
   nbytes = NeAACDecInit (ap_prc->p_aac_dec_,
                          tiz_buffer_get (ap_prc->p_store_),
@@ -379,152 +590,280 @@ static OMX_ERRORTYPE init_aac_decoder (aacdec_prc_t *ap_prc)
       /* Make sure the the output port parameters are up to date */
       tiz_check_omx (update_pcm_mode (ap_prc, ap_prc->samplerate_,
                                           ap_prc->channels_));
-      /* We will skip this many bytes the next time we read from this buffer */
+      /* We will skip this many bytes the next time we read from the store */
       tiz_buffer_advance (ap_prc->p_store_, nbytes);
       TIZ_DEBUG (handleOf (ap_prc), "samplerate [%d] channels [%d]",
                  ap_prc->samplerate_, (int)ap_prc->channels_);
       store_stream_metadata (ap_prc);
-      rc = OMX_ErrorNone;
+      ap_prc->first_buffer_read_ = true;
+      /* At EOS, the header is held (and EOS stays pending) until the frames
+         already in the store have been decoded; releasing it now would drop
+         them as an incomplete tail */
+      rc = (eos && tiz_buffer_available (ap_prc->p_store_) > 0)
+               ? OMX_ErrorNone
+               : release_input_header (ap_prc);
     }
   return rc;
 }
 
-static OMX_ERRORTYPE transform_buffer (aacdec_prc_t *ap_prc)
+/* Decodes one frame. The audio stays in libfaad's own output buffer until
+   write_pcm has copied it out. Returns OMX_ErrorStreamCorrupt if the frame
+   could not be decoded, so that the caller may resynchronise. */
+static OMX_ERRORTYPE decode_frame (aacdec_prc_t *ap_prc, OMX_U8 *ap_data,
+                                   const OMX_U32 a_len)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
-      ap_prc, ARATELIA_AAC_DECODER_INPUT_PORT_INDEX);
-  OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
-      ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX);
+  void *p_samples = NULL;
 
-  if (NULL == p_in || NULL == p_out)
+  assert (ap_prc);
+  assert (ap_data);
+
+  /* Decode the AAC data passed in the buffer. Returns a pointer to a
+     sample buffer or NULL. Info about the decoded frame is filled in the
+     NeAACDecFrameInfo structure. This structure holds information about
+     errors during decoding, number of sample, number of channels and
+     samplerate. The returned buffer contains the channel interleaved
+     samples of the frame. */
+  p_samples = NeAACDecDecode (ap_prc->p_aac_dec_, &(ap_prc->aac_info_),
+                              ap_data, a_len);
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "len = [%d] bytesconsumed = [%d] samples = [%d] error [%d]",
+             a_len, ap_prc->aac_info_.bytesconsumed,
+             ap_prc->aac_info_.samples, ap_prc->aac_info_.error);
+
+  if (ap_prc->aac_info_.error != 0)
     {
-      TIZ_TRACE (handleOf (ap_prc), "IN HEADER [%p] OUT HEADER [%p]", p_in,
-                 p_out);
-      return OMX_ErrorNone;
+      ++ap_prc->nerrors_;
+      TIZ_WARN (handleOf (ap_prc), "Skipping corrupt frame (%s) - errors [%d]",
+                NeAACDecGetErrorMessage (ap_prc->aac_info_.error),
+                ap_prc->nerrors_);
+      return OMX_ErrorStreamCorrupt;
     }
 
-  assert (ap_prc);
-  assert (ap_prc->p_aac_dec_);
+  if (!ap_prc->second_buffer_read_)
+    {
+      store_stream_metadata (ap_prc);
+      ap_prc->second_buffer_read_ = true;
+    }
 
-  if (0 == p_in->nFilledLen && tiz_buffer_available (ap_prc->p_store_)
-                               == 0)
+  if (p_samples && ap_prc->aac_info_.samples > 0)
     {
-      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
-                 p_in->nFlags);
-      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+      if (ap_prc->aac_info_.samplerate != ap_prc->pcmmode_.nSamplingRate
+          || ap_prc->aac_info_.channels != ap_prc->pcmmode_.nChannels)
         {
-          /* Inmediately propagate EOS flag to output */
-          TIZ_TRACE (handleOf (ap_prc),
-                     "Propagate EOS flag to output HEADER [%p]", p_out);
-          p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-          tiz_filter_prc_update_eos_flag (ap_prc, true);
-          p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
-          tiz_check_omx (tiz_filter_prc_release_header (
-              ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX));
+          /* Audio in the new format must not share a buffer with the old */
+          OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
+              ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX);
+          if (p_out && p_out->nFilledLen > 0)
+            {
+              tiz_check_omx (tiz_filter_prc_release_header (
+                  ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX));
+            }
+          ap_prc->samplerate_ = ap_prc->aac_info_.samplerate;
+          ap_prc->channels_ = ap_prc->aac_info_.channels;
+          tiz_check_omx (update_pcm_mode (ap_prc, ap_prc->samplerate_,
+                                          ap_prc->channels_));
+          store_stream_metadata (ap_prc);
         }
+      ap_prc->p_pcm_ = p_samples;
+      ap_prc->pcm_len_ = ap_prc->aac_info_.samples * ap_prc->sample_size_;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE top_up_store (aacdec_prc_t *ap_prc,
+                                   OMX_BUFFERHEADERTYPE *ap_in,
+                                   const OMX_U32 a_nbytes)
+{
+  const OMX_U32 nbytes = MIN (a_nbytes, ap_in->nFilledLen);
+  assert (ap_prc);
+  if (tiz_buffer_push (ap_prc->p_store_, TIZ_OMX_BUF_PTR (ap_in), nbytes)
+      < nbytes)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to store all the data.");
+      return OMX_ErrorInsufficientResources;
     }
+  consume_input (ap_in, nbytes);
+  return OMX_ErrorNone;
+}
+
+/* A frame that spans input buffers is assembled in the store, topping it up
+   with only as many bytes as the frame still needs. */
+static OMX_ERRORTYPE decode_from_store (aacdec_prc_t *ap_prc,
+                                        OMX_BUFFERHEADERTYPE *ap_in)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const OMX_U32 hdr_len = header_length (ap_prc->framing_);
+  OMX_U32 avail = tiz_buffer_available (ap_prc->p_store_);
+  OMX_U32 len = 0;
 
-  if (p_in->nFilledLen > 0)
+  if (avail < hdr_len)
     {
-      if (tiz_buffer_push (
-              ap_prc->p_store_, p_in->pBuffer + p_in->nOffset, p_in->nFilledLen)
-          < p_in->nFilledLen)
+      tiz_check_omx (top_up_store (ap_prc, ap_in, hdr_len - avail));
+      if ((avail = tiz_buffer_available (ap_prc->p_store_)) < hdr_len)
         {
-          rc = OMX_ErrorInsufficientResources;
-          TIZ_ERROR (handleOf (ap_prc), "[%s] : Unable to store all the data.",
-                     tiz_err_to_str (rc));
-          return rc;
+          return release_input_header (ap_prc);
         }
-      p_in->nFilledLen = 0;
     }
 
-  if (tiz_buffer_available (ap_prc->p_store_) > 0)
+  if (0 == (len = frame_length (ap_prc->framing_,
+                                tiz_buffer_get (ap_prc->p_store_))))
     {
-      /* Decode the AAC data passed in the buffer. Returns a pointer to a
-         sample buffer or NULL. Info about the decoded frame is filled in the
-         NeAACDecFrameInfo structure. This structure holds information about
-         errors during decoding, number of sample, number of channels and
-         samplerate. The returned buffer contains the channel interleaved
-         samples of the frame. */
-      short *p_sample_buf
-          = NeAACDecDecode (ap_prc->p_aac_dec_, &(ap_prc->aac_info_),
-                            tiz_buffer_get (ap_prc->p_store_),
-                            tiz_buffer_available (ap_prc->p_store_));
+      const long offset = find_sync (
+          ap_prc->framing_, tiz_buffer_get (ap_prc->p_store_), avail);
+      TIZ_DEBUG (handleOf (ap_prc), "Lost sync in the store");
+      tiz_buffer_advance (ap_prc->p_store_,
+                          offset > 0 ? offset : avail - (hdr_len - 1));
+      return OMX_ErrorNone;
+    }
 
-      if (ap_prc->first_buffer_read_ && !ap_prc->second_buffer_read_)
+  if (avail < len)
+    {
+      tiz_check_omx (top_up_store (ap_prc, ap_in, len - avail));
+      if (tiz_buffer_available (ap_prc->p_store_) < len)
         {
-          store_stream_metadata (ap_prc);
-          ap_prc->second_buffer_read_ = true;
+          return release_input_header (ap_prc);
         }
+    }
 
-      TIZ_TRACE (handleOf (ap_prc),
-                 "bytes_available = [%d] bytesconsumed = [%d] "
-                 "samples = [%d] error [%d]",
-                 tiz_buffer_available (ap_prc->p_store_),
-                 ap_prc->aac_info_.bytesconsumed, ap_prc->aac_info_.samples,
-                 ap_prc->aac_info_.error);
+  rc = decode_frame (ap_prc, tiz_buffer_get (ap_prc->p_store_), len);
+  if (OMX_ErrorStreamCorrupt == rc)
+    {
+      /* Drop a byte; the next call looks for the next sync word */
+      len = 1;
+      rc = OMX_ErrorNone;
+    }
+  tiz_buffer_advance (ap_prc->p_store_, len);
+  return rc;
+}
 
-      tiz_buffer_advance (ap_prc->p_store_, ap_prc->aac_info_.bytesconsumed);
+/* Whole frames are fed to libfaad straight from the input buffer */
+static OMX_ERRORTYPE decode_in_place (aacdec_prc_t *ap_prc,
+                                      OMX_BUFFERHEADERTYPE *ap_in)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const OMX_U32 hdr_len = header_length (ap_prc->framing_);
+  OMX_U8 *p_data = TIZ_OMX_BUF_PTR (ap_in);
+  OMX_U32 len = 0;
+
+  if (ap_in->nFilledLen < hdr_len)
+    {
+      return top_up_store (ap_prc, ap_in, ap_in->nFilledLen);
+    }
+
+  if (0 == (len = frame_length (ap_prc->framing_, p_data)))
+    {
+      const long offset = find_sync (ap_prc->framing_, p_data,
+                                     ap_in->nFilledLen);
+      const OMX_U32 nskip
+          = offset >= 0 ? offset : ap_in->nFilledLen - (hdr_len - 1);
+      TIZ_WARN (handleOf (ap_prc), "Lost sync - skipping [%d] bytes", nskip);
+      consume_input (ap_in, nskip);
+      return OMX_ErrorNone;
+    }
+
+  if (len > ap_in->nFilledLen)
+    {
+      /* This frame continues in the next buffer */
+      return top_up_store (ap_prc, ap_in, ap_in->nFilledLen);
+    }
+
+  rc = decode_frame (ap_prc, p_data, len);
+  if (OMX_ErrorStreamCorrupt == rc)
+    {
+      /* Drop a byte; the next call looks for the next sync word */
+      len = 1;
+      rc = OMX_ErrorNone;
+    }
+  consume_input (ap_in, len);
+  return rc;
+}
+
+/* ADIF and headerless streams can't be split into frames up front, so they
+   are still decoded from the store, as much as libfaad consumes at a time */
+static OMX_ERRORTYPE decode_raw (aacdec_prc_t *ap_prc,
+                                 OMX_BUFFERHEADERTYPE *ap_in)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const bool eos = (ap_in->nFlags & OMX_BUFFERFLAG_EOS) > 0;
+  OMX_U32 avail = 0;
 
-      if ((ap_prc->aac_info_.error == 0) && (ap_prc->aac_info_.samples > 0))
+  tiz_check_omx (top_up_store (ap_prc, ap_in, ap_in->nFilledLen));
+
+  avail = tiz_buffer_available (ap_prc->p_store_);
+  if (avail >= FAAD_MIN_STREAMSIZE * MAX_CHANNELS || (eos && avail > 0))
+    {
+      rc = decode_frame (ap_prc, tiz_buffer_get (ap_prc->p_store_), avail);
+      if (OMX_ErrorStreamCorrupt == rc)
         {
-          int i = 0;
-          char *p_data = (char *)(p_out->pBuffer + p_out->nOffset);
-          for (i = 0; i < ap_prc->aac_info_.samples; ++i)
+          if (!eos)
             {
-              p_data[i * 2] = (char)(p_sample_buf[i] & 0xFF);
-              p_data[i * 2 + 1] = (char)((p_sample_buf[i] >> 8) & 0xFF);
+              /* No sync words to recover with */
+              TIZ_ERROR (handleOf (ap_prc),
+                         "[OMX_ErrorStreamCorruptFatal] : "
+                         "While decoding the input stream (%s).",
+                         NeAACDecGetErrorMessage (ap_prc->aac_info_.error));
+              return OMX_ErrorStreamCorruptFatal;
             }
-          p_out->nFilledLen = ap_prc->aac_info_.samples * ap_prc->channels_ * 1;
+          tiz_buffer_clear (ap_prc->p_store_);
+          return OMX_ErrorNone;
         }
-      else if (ap_prc->aac_info_.error != 0)
+      if (0 == ap_prc->aac_info_.bytesconsumed)
         {
-          /* Some error occurred while decoding this frame */
-          TIZ_ERROR (handleOf (ap_prc),
-                     "[OMX_ErrorStreamCorruptFatal] : "
-                     "While decoding the input stream (%s).",
-                     NeAACDecGetErrorMessage (ap_prc->aac_info_.error));
-          rc = OMX_ErrorStreamCorruptFatal;
+          tiz_buffer_clear (ap_prc->p_store_);
         }
+      tiz_buffer_advance (ap_prc->p_store_, ap_prc->aac_info_.bytesconsumed);
+      return rc;
     }
 
-  if (OMX_ErrorNone == rc && 0 == p_in->nFilledLen
-      && tiz_buffer_available (ap_prc->p_store_) < FAAD_MIN_STREAMSIZE
-                                                         * ap_prc->channels_)
+  return release_input_header (ap_prc);
+}
+
+static OMX_ERRORTYPE transform_buffer (aacdec_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE *p_in = NULL;
+
+  assert (ap_prc);
+  assert (ap_prc->p_aac_dec_);
+
+  /* Audio already decoded goes out before the next frame is decoded */
+  if (OMX_ErrorNone != (rc = write_pcm (ap_prc)))
     {
-      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
-                 p_in->nFlags);
-      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
-        {
-          /* Let's propagate EOS flag to output */
-          TIZ_TRACE (handleOf (ap_prc), "Let's propagate EOS flag to output");
-          tiz_filter_prc_update_eos_flag (ap_prc, true);
-          p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
-        }
-      rc = tiz_filter_prc_release_header (
-          ap_prc, ARATELIA_AAC_DECODER_INPUT_PORT_INDEX);
+      return rc;
     }
 
-  if (tiz_filter_prc_is_eos (ap_prc))
+  if (!(p_in = tiz_filter_prc_get_header (
+            ap_prc, ARATELIA_AAC_DECODER_INPUT_PORT_INDEX)))
     {
-      /* Propagate EOS flag to output */
-      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-      tiz_filter_prc_update_eos_flag (ap_prc, false);
-      TIZ_TRACE (handleOf (ap_prc), "Propagating EOS flag to output");
+      return OMX_ErrorNotReady;
     }
 
-  if (OMX_ErrorNone == rc && p_out->nFilledLen > 0)
+  TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFilledLen [%d] nFlags [%d] ",
+             p_in, p_in->nFilledLen, p_in->nFlags);
+
+  if (!ap_prc->first_buffer_read_)
     {
-      TIZ_TRACE (handleOf (ap_prc),
-                 "Releasing output HEADER [%p] nFilledLen [%d]", p_out,
-                 p_out->nFilledLen);
-      TIZ_PRINTF_DBG_GRN ("Releasing buffer [%p] with size [%u].",
-                          p_out, (unsigned int)p_out->nFilledLen);
-      rc = tiz_filter_prc_release_header (
-          ap_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX);
+      rc = init_aac_decoder (ap_prc, p_in);
+    }
+  else if (EAacdecFramingRaw == ap_prc->framing_)
+    {
+      rc = decode_raw (ap_prc, p_in);
+    }
+  else if (tiz_buffer_available (ap_prc->p_store_) > 0)
+    {
+      rc = decode_from_store (ap_prc, p_in);
+    }
+  else if (p_in->nFilledLen > 0)
+    {
+      rc = decode_in_place (ap_prc, p_in);
+    }
+  else
+    {
+      rc = release_input_header (ap_prc);
     }
-
   return rc;
 }
 
@@ -537,6 +876,15 @@ static void reset_stream_parameters (aacdec_prc_t *ap_prc)
   ap_prc->nbytes_read_ = 0;
   ap_prc->first_buffer_read_ = false;
   ap_prc->second_buffer_read_ = false;
+  ap_prc->framing_ = EAacdecFramingUnknown;
+  ap_prc->id3_skip_ = 0;
+  ap_prc->p_pcm_ = NULL;
+  ap_prc->pcm_len_ = 0;
+  ap_prc->nerrors_ = 0;
+  if (ap_prc->p_store_)
+    {
+      tiz_buffer_clear (ap_prc->p_store_);
+    }
   tiz_filter_prc_update_eos_flag (ap_prc, false);
 }
 
@@ -552,8 +900,9 @@ static void *aacdec_prc_ctor (void *ap_obj, va_list *app)
   TIZ_DEBUG (handleOf (ap_obj), "libfaad2 caps: %X", cap);
   /*   Open the faad library */
   p_prc->p_aac_dec_ = NeAACDecOpen ();
-  reset_stream_parameters (p_prc);
   p_prc->p_store_ = NULL;
+  p_prc->sample_size_ = 2;
+  reset_stream_parameters (p_prc);
   return p_prc;
 }
 
@@ -600,6 +949,18 @@ static OMX_ERRORTYPE aacdec_prc_prepare_to_transfer (void *ap_obj,
   tiz_check_omx (tiz_api_GetParameter
                      (tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
                       OMX_IndexParamAudioPcm, &(p_prc->pcmmode_)));
+
+  /* libfaad can produce either 16-bit or float samples */
+  if (16 != p_prc->pcmmode_.nBitPerSample
+      && 32 != p_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_ERROR (handleOf (p_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "unsupported bits per sample [%d]",
+                 p_prc->pcmmode_.nBitPerSample);
+      return OMX_ErrorUnsupportedSetting;
+    }
+  p_prc->sample_size_ = p_prc->pcmmode_.nBitPerSample / 8;
   return OMX_ErrorNone;
 }
 
@@ -622,27 +983,42 @@ static OMX_ERRORTYPE aacdec_prc_buffers_ready (const void *ap_prc)
 {
   aacdec_prc_t *p_prc = (aacdec_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE *p_out = NULL;
 
   assert (ap_prc);
 
   TIZ_TRACE (handleOf (p_prc), "eos [%s] ",
              tiz_filter_prc_is_eos (p_prc) ? "YES" : "NO");
-  while (tiz_filter_prc_headers_available (p_prc) && OMX_ErrorNone == rc)
+  while (OMX_ErrorNone == rc)
     {
-      if (!p_prc->first_buffer_read_)
+      rc = transform_buffer (p_prc);
+    }
+
+  if (OMX_ErrorNotReady == rc)
+    {
+      rc = OMX_ErrorNone;
+    }
+
+  if (OMX_ErrorNone == rc && 0 == p_prc->pcm_len_
+      && (p_out = tiz_filter_prc_get_header (
+              p_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX)))
+    {
+      /* Input has run dry; don't sit on a partially filled buffer */
+      if (tiz_filter_prc_is_eos (p_prc))
         {
-          rc = init_aac_decoder (p_prc);
-          if (OMX_ErrorNone == rc)
-            {
-              p_prc->first_buffer_read_ = true;
-            }
+          /* Propagate EOS flag to output */
+          TIZ_TRACE (handleOf (p_prc), "Propagating EOS flag to output");
+          p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+          tiz_filter_prc_update_eos_flag (p_prc, false);
+          tiz_check_omx (tiz_filter_prc_release_header (
+              p_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX));
         }
-      else
+      else if (p_out->nFilledLen > 0)
         {
-          rc = transform_buffer (p_prc);
+          tiz_check_omx (tiz_filter_prc_release_header (
+              p_prc, ARATELIA_AAC_DECODER_OUTPUT_PORT_INDEX));
         }
     }
-
   return rc;
 }
 
@@ -42,6 +42,15 @@ extern "C" {
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
 
+typedef enum aacdec_framing aacdec_framing_t;
+enum aacdec_framing
+{
+  EAacdecFramingUnknown = 0,
+  EAacdecFramingAdts, /* self-synchronising, decoded in place */
+  EAacdecFramingLoas, /* LATM in an AudioSyncStream, decoded in place */
+  EAacdecFramingRaw   /* ADIF or headerless, decoded from the store */
+};
+
 typedef struct aacdec_prc aacdec_prc_t;
 struct aacdec_prc
 {
@@ -56,6 +65,12 @@ struct aacdec_prc
   bool first_buffer_read_;
   bool second_buffer_read_;
   tiz_buffer_t *p_store_;
+  aacdec_framing_t framing_;
+  OMX_U32 id3_skip_;
+  void *p_pcm_;
+  OMX_U32 pcm_len_;
+  OMX_U32 sample_size_;
+  OMX_U32 nerrors_;
 };
 
 typedef struct aacdec_prc_class aacdec_prc_class_t;
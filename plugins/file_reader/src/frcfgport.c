@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   frcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  A specialised config port class for the binary file reader
+ *
+ * Besides the content URI, this port holds the byte offset that a downstream
+ * component may ask the reader to reposition the stream at (see
+ * OMX_TizoniaIndexConfigStreamPosition). Other sources don't register that
+ * index, which lets the requester find out whether repositioning is supported.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "frcfgport.h"
+#include "frcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.file_reader.cfgport"
+#endif
+
+/*
+ * frcfgport class
+ */
+
+static void *
+fr_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  fr_cfgport_t * p_obj = super_ctor (typeOf (ap_obj, "frcfgport"), ap_obj, app);
+
+  assert (p_obj);
+
+  tiz_check_omx_ret_null (
+    tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigStreamPosition));
+
+  /* Initialize the OMX_TIZONIA_STREAMPOSITIONTYPE structure */
+  TIZ_INIT_OMX_PORT_STRUCT (p_obj->stream_position_, OMX_ALL);
+  p_obj->stream_position_.nOffset = 0;
+
+  return p_obj;
+}
+
+static void *
+fr_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "frcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+fr_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const fr_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "GetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigStreamPosition == a_index)
+    {
+      memcpy (ap_struct, &(p_obj->stream_position_),
+              sizeof (OMX_TIZONIA_STREAMPOSITIONTYPE));
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "frcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+fr_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  fr_cfgport_t * p_obj = (fr_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "SetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigStreamPosition == a_index)
+    {
+      memcpy (&(p_obj->stream_position_), ap_struct,
+              sizeof (OMX_TIZONIA_STREAMPOSITIONTYPE));
+      TIZ_TRACE (ap_hdl, "Stream position [%llu]...",
+                 (unsigned long long) p_obj->stream_position_.nOffset);
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "frcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * fr_cfgport_class
+ */
+
+static void *
+fr_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "frcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+fr_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * frcfgport_class
+    = factory_new (classOf (tizuricfgport), "frcfgport_class",
+                   classOf (tizuricfgport), sizeof (fr_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, fr_cfgport_class_ctor, 0);
+  return frcfgport_class;
+}
+
+void *
+fr_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * frcfgport_class = tiz_get_type (ap_hdl, "frcfgport_class");
+  TIZ_LOG_CLASS (frcfgport_class);
+  void * frcfgport = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (frcfgport_class, "frcfgport", tizuricfgport, sizeof (fr_cfgport_t),
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, fr_cfgport_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, fr_cfgport_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, fr_cfgport_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, fr_cfgport_SetConfig,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+
+  return frcfgport;
+}
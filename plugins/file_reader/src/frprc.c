@@ -37,6 +37,7 @@
 #include <assert.h>
 
 #include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
 
 #include <tizplatform.h>
 
@@ -80,6 +81,7 @@ reset_stream_parameters (fr_prc_t * ap_prc)
   assert (ap_prc);
   ap_prc->counter_ = 0;
   ap_prc->eos_ = false;
+  ap_prc->position_flags_ = 0;
   if (ap_prc->p_file_)
     {
       rewind (ap_prc->p_file_);
@@ -160,6 +162,11 @@ read_into_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
       p_hdr->nFilledLen = bytes_read;
       p_prc->counter_ += p_hdr->nFilledLen;
 
+      /* Let the downstream component know whether this is the first buffer
+         after the requested position */
+      p_hdr->nFlags |= p_prc->position_flags_;
+      p_prc->position_flags_ = 0;
+
       TIZ_TRACE (handleOf (p_prc),
                  "Reading into HEADER [%p]...nFilledLen[%d] "
                  "counter [%d] bytes_read[%d]",
@@ -255,28 +262,67 @@ fr_prc_buffers_ready (const void * ap_obj)
 
   assert (ap_obj);
 
-  if (!p_prc->eos_)
+  while (!p_prc->eos_)
     {
       OMX_BUFFERHEADERTYPE * p_hdr = NULL;
       tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)),
                                                ARATELIA_FILE_READER_PORT_INDEX,
                                                0, &p_hdr));
-      if (p_hdr)
+      if (!p_hdr)
         {
-          TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...nFilledLen [%d]",
-                     p_hdr, p_hdr->nFilledLen);
-          p_hdr->nOffset = 0;
-          p_hdr->nFilledLen = 0;
-          tiz_check_omx (read_into_buffer (p_prc, p_hdr));
-          tiz_check_omx (
-            tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
-                                    ARATELIA_FILE_READER_PORT_INDEX, p_hdr));
+          break;
         }
+      TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...nFilledLen [%d]",
+                 p_hdr, p_hdr->nFilledLen);
+      p_hdr->nOffset = 0;
+      p_hdr->nFilledLen = 0;
+      tiz_check_omx (read_into_buffer (p_prc, p_hdr));
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
+                                             ARATELIA_FILE_READER_PORT_INDEX,
+                                             p_hdr));
     }
 
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+fr_prc_config_change (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid),
+                      OMX_INDEXTYPE a_config_idx)
+{
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigStreamPosition == a_config_idx && p_prc->p_file_)
+    {
+      OMX_TIZONIA_STREAMPOSITIONTYPE position;
+      TIZ_INIT_OMX_PORT_STRUCT (position, OMX_ALL);
+      tiz_check_omx (tiz_api_GetConfig (tiz_get_krn (handleOf (p_prc)),
+                                        handleOf (p_prc),
+                                        OMX_TizoniaIndexConfigStreamPosition,
+                                        &position));
+      TIZ_DEBUG (handleOf (p_prc), "Repositioning to offset [%llu]",
+                 (unsigned long long) position.nOffset);
+      if (0 != fseeko (p_prc->p_file_, (off_t) position.nOffset, SEEK_SET))
+        {
+          /* The file position is unchanged; the requester still needs an
+             answer, which goes on the next buffer (an empty EOS one if the
+             end of the file had already been reached) */
+          TIZ_WARN (handleOf (p_prc), "Unable to reposition to [%llu] : %s",
+                    (unsigned long long) position.nOffset, strerror (errno));
+          p_prc->position_flags_ = OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR;
+        }
+      else
+        {
+          p_prc->counter_ = position.nOffset;
+          p_prc->position_flags_ = OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION;
+        }
+      p_prc->eos_ = false;
+      /* Buffers may have been left idle after an earlier EOS */
+      return fr_prc_buffers_ready (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * fr_prc_class
  */
@@ -335,6 +381,8 @@ fr_prc_init (void * ap_tos, void * ap_hdl)
      tiz_srv_stop_and_return, fr_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, fr_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_config_change, fr_prc_config_change,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -46,6 +46,7 @@ struct fr_prc
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   OMX_U32 counter_;
   bool eos_;
+  OMX_U32 position_flags_;
 };
 
 typedef struct fr_prc_class fr_prc_class_t;
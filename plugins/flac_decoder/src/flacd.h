@@ -44,6 +44,7 @@ extern "C" {
 #define ARATELIA_FLAC_DECODER_PORT_MIN_BUF_COUNT 10
 #define ARATELIA_FLAC_DECODER_PORT_MIN_INPUT_BUF_SIZE 150 * 1024
 #define ARATELIA_FLAC_DECODER_PORT_MIN_OUTPUT_BUF_SIZE 8192 * 20
+#define ARATELIA_FLAC_DECODER_MAX_CHANNELS 8
 #define ARATELIA_FLAC_DECODER_BUFFER_THRESHOLD     \
   ARATELIA_FLAC_DECODER_PORT_MIN_INPUT_BUF_SIZE *( \
     ARATELIA_FLAC_DECODER_PORT_MIN_BUF_COUNT - 1)
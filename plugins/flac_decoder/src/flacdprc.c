@@ -51,6 +51,76 @@
 static OMX_ERRORTYPE
 flacd_prc_deallocate_resources (void *);
 
+/* FLAC channel assignments, as per the format specification */
+static const OMX_AUDIO_CHANNELTYPE
+  flac_channel_order[ARATELIA_FLAC_DECODER_MAX_CHANNELS]
+                    [ARATELIA_FLAC_DECODER_MAX_CHANNELS]
+  = {
+      {OMX_AUDIO_ChannelCF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelCF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelLR,
+       OMX_AUDIO_ChannelRR},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelCF,
+       OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelCF,
+       OMX_AUDIO_ChannelLFE, OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelCF,
+       OMX_AUDIO_ChannelLFE, OMX_AUDIO_ChannelCS, OMX_AUDIO_ChannelLS,
+       OMX_AUDIO_ChannelRS},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelCF,
+       OMX_AUDIO_ChannelLFE, OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR,
+       OMX_AUDIO_ChannelLS, OMX_AUDIO_ChannelRS},
+  };
+
+static void
+set_channel_mapping (flacd_prc_t * ap_prc, const OMX_U32 a_channels)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < OMX_AUDIO_MAXCHANNELS; ++i)
+    {
+      ap_prc->pcmmode_.eChannelMapping[i]
+        = (a_channels > 0 && a_channels <= ARATELIA_FLAC_DECODER_MAX_CHANNELS
+           && i < a_channels)
+            ? flac_channel_order[a_channels - 1][i]
+            : OMX_AUDIO_ChannelNone;
+    }
+}
+
+static OMX_ERRORTYPE
+update_pcm_mode (flacd_prc_t * ap_prc, const OMX_U32 a_samplerate,
+                 const OMX_U32 a_channels, const OMX_U32 a_bps)
+{
+  assert (ap_prc);
+  if (a_samplerate != ap_prc->pcmmode_.nSamplingRate
+      || a_channels != ap_prc->pcmmode_.nChannels
+      || a_bps != ap_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating pcm mode : samplerate [%d]->[%d] "
+                 "channels [%d]->[%d] bps [%d]->[%d]",
+                 ap_prc->pcmmode_.nSamplingRate, a_samplerate,
+                 ap_prc->pcmmode_.nChannels, a_channels,
+                 ap_prc->pcmmode_.nBitPerSample, a_bps);
+      ap_prc->pcmmode_.nSamplingRate = a_samplerate;
+      ap_prc->pcmmode_.nChannels = a_channels;
+      /* 32-bit streams are delivered as float samples */
+      ap_prc->pcmmode_.nBitPerSample = a_bps;
+      set_channel_mapping (ap_prc, a_channels);
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX,
+                           OMX_IndexParamAudioPcm, /* the index of the
+                                                      struct that has
+                                                      been modififed */
+                           NULL);
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 alloc_temp_data_store (flacd_prc_t * ap_prc)
 {
@@ -318,41 +388,14 @@ static inline OMX_ERRORTYPE
 do_flush (flacd_prc_t * ap_prc)
 {
   TIZ_TRACE (handleOf (ap_prc), "do_flush");
+  /* Discard any decoded data not yet delivered */
+  ap_prc->pcm_store_len_ = 0;
+  ap_prc->pcm_store_offset_ = 0;
+  ap_prc->out_eos_ = false;
   /* Release any buffers held  */
   return release_all_headers (ap_prc, OMX_ALL);
 }
 
-static OMX_ERRORTYPE
-transform_stream (const flacd_prc_t * ap_prc)
-{
-  flacd_prc_t * p_prc = (flacd_prc_t *) ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  FLAC__bool decode_ok = 1;
-
-  assert (p_prc);
-  assert (p_prc->p_flac_dec_);
-
-  TIZ_TRACE (handleOf (ap_prc), "output buffers avail [%s]",
-             output_buffers_available (p_prc) ? "YES" : "NO");
-  while (decode_ok > 0 && input_data_available (p_prc)
-         && output_buffers_available (p_prc))
-    {
-      TIZ_TRACE (handleOf (ap_prc), "decoding");
-      decode_ok = FLAC__stream_decoder_process_single (p_prc->p_flac_dec_);
-      TIZ_TRACE (handleOf (ap_prc), "decode_ok [%d]", decode_ok);
-      if (!decode_ok)
-        {
-          TIZ_ERROR (handleOf (ap_prc), "error [%s]",
-                     FLAC__stream_decoder_get_resolved_state_string (
-                       p_prc->p_flac_dec_));
-          rc = OMX_ErrorStreamCorrupt;
-          break;
-        }
-    }
-
-  return rc;
-}
-
 static int
 dump_temp_store (flacd_prc_t * ap_prc, OMX_U8 * ap_buffer, size_t nbytes_avail)
 {
@@ -422,61 +465,230 @@ read_cb (const FLAC__StreamDecoder * ap_decoder, FLAC__byte buffer[],
   return rc;
 }
 
-static void
-write_pcm_block_8 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                   const unsigned int a_nsamples,
-                   const unsigned int a_nchannels)
+/* Planar to interleaved packing. Each variant is instantiated for a
+   compile-time channel count, so that the inner loop is fully unrolled and
+   the compiler is free to vectorise the stores. */
+
+static inline void
+interleave_8 (FLAC__int8 * ap_to, const FLAC__int32 * const ap_buffer[],
+              const unsigned int a_nframes, const unsigned int a_nchannels)
 {
   size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
+  unsigned int k = 0;
+  for (i = 0; i < a_nframes; ++i)
     {
-      FLAC__int8 * out = (FLAC__int8 *) (ap_to) + i;
-      int k;
       for (k = 0; k < a_nchannels; ++k)
         {
-          out[k] = (FLAC__int8) ap_buffer[k][j];
+          *ap_to++ = (FLAC__int8) ap_buffer[k][i];
         }
     }
 }
 
-static void
-write_pcm_block_16 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                    const unsigned int a_nsamples,
-                    const unsigned int a_nchannels)
+static inline void
+interleave_16 (FLAC__int16 * ap_to, const FLAC__int32 * const ap_buffer[],
+               const unsigned int a_nframes, const unsigned int a_nchannels)
 {
   size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
+  unsigned int k = 0;
+  for (i = 0; i < a_nframes; ++i)
     {
-      FLAC__int16 * out = (FLAC__int16 *) (ap_to) + i;
-      int k;
       for (k = 0; k < a_nchannels; ++k)
         {
-          out[k] = (FLAC__int16) ap_buffer[k][j];
+          *ap_to++ = (FLAC__int16) ap_buffer[k][i];
         }
     }
 }
 
-static void
-write_pcm_block_24 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                    const unsigned int a_nsamples,
-                    const unsigned int a_nchannels)
+static inline void
+interleave_24 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
+               const unsigned int a_nframes, const unsigned int a_nchannels)
 {
   size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
+  unsigned int k = 0;
+  for (i = 0; i < a_nframes; ++i)
     {
-      unsigned char * out = (unsigned char *) (ap_to) + (i * 3);
-      int k;
       for (k = 0; k < a_nchannels; ++k)
         {
-          unsigned long word32 = (unsigned long) ap_buffer[k][j];
-          *out++ = (unsigned char) (word32 >> 0);
-          *out++ = (unsigned char) (word32 >> 8);
-          *out++ = (unsigned char) (word32 >> 16);
+          const FLAC__uint32 word32 = (FLAC__uint32) ap_buffer[k][i];
+          ap_to[0] = (uint8_t) (word32 >> 0);
+          ap_to[1] = (uint8_t) (word32 >> 8);
+          ap_to[2] = (uint8_t) (word32 >> 16);
+          ap_to += 3;
+        }
+    }
+}
+
+/* In this tree, 32 bits per sample means float32; 32-bit integer FLAC
+   samples are scaled into [-1.0, 1.0) */
+static inline void
+interleave_32 (float * ap_to, const FLAC__int32 * const ap_buffer[],
+               const unsigned int a_nframes, const unsigned int a_nchannels)
+{
+  const float scale = 1.0f / 2147483648.0f;
+  size_t i = 0;
+  unsigned int k = 0;
+  for (i = 0; i < a_nframes; ++i)
+    {
+      for (k = 0; k < a_nchannels; ++k)
+        {
+          *ap_to++ = (float) ap_buffer[k][i] * scale;
+        }
+    }
+}
+
+#define FLACD_INTERLEAVE(fn, to, buf, nframes, nchannels) \
+  switch (nchannels)                                      \
+    {                                                     \
+      case 1:                                             \
+        fn (to, buf, nframes, 1);                         \
+        break;                                            \
+      case 2:                                             \
+        fn (to, buf, nframes, 2);                         \
+        break;                                            \
+      case 3:                                             \
+        fn (to, buf, nframes, 3);                         \
+        break;                                            \
+      case 4:                                             \
+        fn (to, buf, nframes, 4);                         \
+        break;                                            \
+      case 5:                                             \
+        fn (to, buf, nframes, 5);                         \
+        break;                                            \
+      case 6:                                             \
+        fn (to, buf, nframes, 6);                         \
+        break;                                            \
+      case 7:                                             \
+        fn (to, buf, nframes, 7);                         \
+        break;                                            \
+      case 8:                                             \
+        fn (to, buf, nframes, 8);                         \
+        break;                                            \
+      default:                                            \
+        assert (0);                                       \
+        break;                                            \
+    };
+
+static void
+write_pcm_block (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
+                 const unsigned int a_nframes, const unsigned int a_nchannels,
+                 const unsigned int a_bps)
+{
+  switch (a_bps)
+    {
+      case 8:
+        {
+          FLACD_INTERLEAVE (interleave_8, (FLAC__int8 *) ap_to, ap_buffer,
+                            a_nframes, a_nchannels);
+        }
+        break;
+      case 16:
+        {
+          FLACD_INTERLEAVE (interleave_16, (FLAC__int16 *) ap_to, ap_buffer,
+                            a_nframes, a_nchannels);
+        }
+        break;
+      case 24:
+        {
+          FLACD_INTERLEAVE (interleave_24, ap_to, ap_buffer, a_nframes,
+                            a_nchannels);
+        }
+        break;
+      case 32:
+        {
+          FLACD_INTERLEAVE (interleave_32, (float *) ap_to, ap_buffer,
+                            a_nframes, a_nchannels);
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+static inline bool
+is_pcm_format_supported (const unsigned int a_nchannels,
+                         const unsigned int a_bps)
+{
+  return (a_nchannels >= 1 && a_nchannels <= ARATELIA_FLAC_DECODER_MAX_CHANNELS
+          && (a_bps == 8 || a_bps == 16 || a_bps == 24 || a_bps == 32));
+}
+
+static inline OMX_U32
+out_space (const OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_hdr);
+  return ap_hdr->nAllocLen - (ap_hdr->nOffset + ap_hdr->nFilledLen);
+}
+
+static inline bool
+pcm_store_empty (const flacd_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (ap_prc->pcm_store_offset_ >= ap_prc->pcm_store_len_);
+}
+
+static void
+drain_pcm_store (flacd_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+
+  assert (ap_prc);
+
+  while (!pcm_store_empty (ap_prc)
+         && (p_out
+             = get_header (ap_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX)))
+    {
+      const OMX_U32 nbytes = MIN (
+        out_space (p_out), ap_prc->pcm_store_len_ - ap_prc->pcm_store_offset_);
+      memcpy (p_out->pBuffer + p_out->nOffset + p_out->nFilledLen,
+              ap_prc->p_pcm_store_ + ap_prc->pcm_store_offset_, nbytes);
+      p_out->nFilledLen += nbytes;
+      ap_prc->pcm_store_offset_ += nbytes;
+      if (0 == out_space (p_out))
+        {
+          release_header (ap_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
         }
     }
+
+  if (pcm_store_empty (ap_prc))
+    {
+      ap_prc->pcm_store_len_ = 0;
+      ap_prc->pcm_store_offset_ = 0;
+    }
+}
+
+static void
+complete_output (flacd_prc_t * ap_prc, const OMX_U32 a_next_nbytes)
+{
+  assert (ap_prc);
+
+  if (!pcm_store_empty (ap_prc))
+    {
+      /* Still draining a previous frame */
+      return;
+    }
+
+  if (ap_prc->out_eos_)
+    {
+      OMX_BUFFERHEADERTYPE * p_out
+        = get_header (ap_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+      if (p_out)
+        {
+          /* Propagate EOS flag to output */
+          p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+          ap_prc->out_eos_ = false;
+          release_header (ap_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+        }
+    }
+  else if (ap_prc->p_out_hdr_ && ap_prc->p_out_hdr_->nFilledLen > 0
+           && out_space (ap_prc->p_out_hdr_) < a_next_nbytes)
+    {
+      /* Assume the next frame is similar in size to the last one; if it won't
+         fit, send this buffer now */
+      release_header (ap_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+    }
 }
 
 static FLAC__StreamDecoderWriteStatus
@@ -486,79 +698,90 @@ write_cb (const FLAC__StreamDecoder * ap_decoder, const FLAC__Frame * ap_frame,
   flacd_prc_t * p_prc = (flacd_prc_t *) ap_client_data;
   FLAC__StreamDecoderWriteStatus rc
     = FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+  unsigned int nframes = 0;
+  unsigned int nchannels = 0;
+  unsigned int bps = 0;
 
   (void) ap_decoder;
   assert (p_prc);
   assert (ap_frame);
   assert (ap_buffer);
 
+  nframes = ap_frame->header.blocksize;
+  nchannels = ap_frame->header.channels;
+  bps = ap_frame->header.bits_per_sample;
+
   TIZ_TRACE (handleOf (p_prc), "blocksize : [%d] channels [%d] bps [%d]",
-             ap_frame->header.blocksize, ap_frame->header.channels,
-             ap_frame->header.bits_per_sample);
+             nframes, nchannels, bps);
 
-  if (p_prc->channels_ > 2 || (ap_frame->header.bits_per_sample != 8
-                               && ap_frame->header.bits_per_sample != 16
-                               && ap_frame->header.bits_per_sample != 24))
+  if (!is_pcm_format_supported (nchannels, bps))
     {
       TIZ_ERROR (handleOf (p_prc),
-                 "Only stereo streams are supported"
-                 "at 8, 16, or 24 bits per sample.");
+                 "Only streams with up to %d channels are supported "
+                 "at 8, 16, 24, or 32 bits per sample "
+                 "(channels [%d] bps [%d]).",
+                 ARATELIA_FLAC_DECODER_MAX_CHANNELS, nchannels, bps);
       /* TODO: Signal client */
       rc = FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
+  else if (OMX_ErrorNone
+           != update_pcm_mode (p_prc, ap_frame->header.sample_rate, nchannels,
+                               bps))
+    {
+      rc = FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+    }
   else
     {
       /* write decoded PCM samples */
-      size_t nsamples = ap_frame->header.blocksize * p_prc->channels_;
+      const OMX_U32 nbytes = nframes * nchannels * (bps / 8);
       OMX_BUFFERHEADERTYPE * p_out
         = get_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
-      assert (p_out);
 
-      if (nsamples * (p_prc->bps_ / 8) > p_out->nAllocLen)
+      assert (pcm_store_empty (p_prc));
+
+      if (p_out && p_out->nFilledLen > 0 && nbytes > out_space (p_out))
         {
-          nsamples = p_out->nAllocLen / (p_prc->bps_ / 8);
+          release_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+          p_out = get_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
         }
-      assert (nsamples <= p_out->nAllocLen);
 
-      {
-        uint8_t * p_to = p_out->pBuffer + p_out->nOffset;
-
-        switch (ap_frame->header.bits_per_sample)
-          {
-            case 8:
-              {
-                write_pcm_block_8 (p_to, ap_buffer, nsamples,
-                                   ap_frame->header.channels);
-              }
-              break;
-            case 16:
-              {
-                write_pcm_block_16 (p_to, ap_buffer, nsamples,
-                                    ap_frame->header.channels);
-              }
-              break;
-            case 24:
-              {
-                write_pcm_block_24 (p_to, ap_buffer, nsamples,
-                                    ap_frame->header.channels);
-              }
-              break;
-            default:
-              {
-                assert (0);
-              }
-              break;
-          };
-
-        p_out->nFilledLen = nsamples * (p_prc->bps_ / 8);
-        if ((p_prc->eos_ && p_prc->store_offset_ == 0))
-          {
-            /* Propagate EOS flag to output */
-            p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-            p_prc->eos_ = false;
-          }
-        release_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
-      }
+      if (p_out && nbytes <= out_space (p_out))
+        {
+          /* Common case: interleave straight into the output buffer,
+             appending to whatever previous frames are already there. */
+          write_pcm_block (p_out->pBuffer + p_out->nOffset
+                             + p_out->nFilledLen,
+                           ap_buffer, nframes, nchannels, bps);
+          p_out->nFilledLen += nbytes;
+        }
+      else
+        {
+          /* The frame is larger than the output buffer, or there are no
+             output buffers at this time. Keep the interleaved samples around
+             until they can be delivered. */
+          if (nbytes > p_prc->pcm_store_size_)
+            {
+              OMX_U8 * p_new_store = tiz_mem_realloc (p_prc->p_pcm_store_,
+                                                      nbytes);
+              if (!p_new_store)
+                {
+                  TIZ_ERROR (handleOf (p_prc),
+                             "[OMX_ErrorInsufficientResources] : "
+                             "Unable to allocate [%u] bytes.",
+                             nbytes);
+                  return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+                }
+              p_prc->p_pcm_store_ = p_new_store;
+              p_prc->pcm_store_size_ = nbytes;
+            }
+          write_pcm_block (p_prc->p_pcm_store_, ap_buffer, nframes, nchannels,
+                           bps);
+          p_prc->pcm_store_len_ = nbytes;
+          p_prc->pcm_store_offset_ = 0;
+          drain_pcm_store (p_prc);
+        }
+
+      complete_output (p_prc, nbytes);
     }
 
   return rc;
@@ -588,6 +811,12 @@ metadata_cb (const FLAC__StreamDecoder * ap_decoder,
       TIZ_TRACE (handleOf (p_prc), "bits per sample : [%u]", p_prc->bps_);
       TIZ_TRACE (handleOf (p_prc), "total samples   : [%llu]",
                  p_prc->total_samples_);
+
+      if (is_pcm_format_supported (p_prc->channels_, p_prc->bps_))
+        {
+          (void) update_pcm_mode (p_prc, p_prc->sample_rate_,
+                                  p_prc->channels_, p_prc->bps_);
+        }
     }
 }
 
@@ -612,6 +841,64 @@ reset_stream_parameters (flacd_prc_t * ap_prc)
   ap_prc->bps_ = 0;
 }
 
+static OMX_ERRORTYPE
+transform_stream (const flacd_prc_t * ap_prc)
+{
+  flacd_prc_t * p_prc = (flacd_prc_t *) ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  FLAC__bool decode_ok = 1;
+
+  assert (p_prc);
+  assert (p_prc->p_flac_dec_);
+
+  /* Deliver any leftovers from a previous frame first */
+  drain_pcm_store (p_prc);
+  complete_output (p_prc, 0);
+
+  TIZ_TRACE (handleOf (ap_prc), "output buffers avail [%s]",
+             output_buffers_available (p_prc) ? "YES" : "NO");
+  while (decode_ok > 0 && pcm_store_empty (p_prc)
+         && (input_data_available (p_prc) || p_prc->eos_)
+         && output_buffers_available (p_prc))
+    {
+      TIZ_TRACE (handleOf (ap_prc), "decoding");
+      decode_ok = FLAC__stream_decoder_process_single (p_prc->p_flac_dec_);
+      TIZ_TRACE (handleOf (ap_prc), "decode_ok [%d]", decode_ok);
+      if (!decode_ok)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "error [%s]",
+                     FLAC__stream_decoder_get_resolved_state_string (
+                       p_prc->p_flac_dec_));
+          rc = OMX_ErrorStreamCorrupt;
+          break;
+        }
+
+      if (FLAC__STREAM_DECODER_END_OF_STREAM
+          == FLAC__stream_decoder_get_state (p_prc->p_flac_dec_))
+        {
+          /* All the frames buffered inside the decoder have been delivered;
+             get ready for the next stream. */
+          p_prc->eos_ = false;
+          p_prc->out_eos_ = true;
+          complete_output (p_prc, 0);
+          (void) FLAC__stream_decoder_reset (p_prc->p_flac_dec_);
+          reset_stream_parameters (p_prc);
+          break;
+        }
+    }
+
+  /* Don't hold on to a partially filled buffer while waiting for more
+     input */
+  if (rc == OMX_ErrorNone && pcm_store_empty (p_prc) && p_prc->p_out_hdr_
+      && p_prc->p_out_hdr_->nFilledLen > 0 && !input_data_available (p_prc)
+      && !p_prc->eos_)
+    {
+      release_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+    }
+
+  return rc;
+}
+
 /*
  * flacdprc
  */
@@ -630,6 +917,11 @@ flacd_prc_ctor (void * ap_obj, va_list * app)
   p_prc->p_store_ = NULL;
   p_prc->store_offset_ = 0;
   p_prc->store_size_ = 0;
+  p_prc->p_pcm_store_ = NULL;
+  p_prc->pcm_store_size_ = 0;
+  p_prc->pcm_store_len_ = 0;
+  p_prc->pcm_store_offset_ = 0;
+  p_prc->out_eos_ = false;
   reset_stream_parameters (p_prc);
   return p_prc;
 }
@@ -675,6 +967,11 @@ flacd_prc_deallocate_resources (void * ap_obj)
       p_prc->p_flac_dec_ = NULL;
     }
   dealloc_temp_data_store (p_prc);
+  tiz_mem_free (p_prc->p_pcm_store_);
+  p_prc->p_pcm_store_ = NULL;
+  p_prc->pcm_store_size_ = 0;
+  p_prc->pcm_store_len_ = 0;
+  p_prc->pcm_store_offset_ = 0;
   return OMX_ErrorNone;
 }
 
@@ -703,8 +1000,17 @@ flacd_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
       return OMX_ErrorInsufficientResources;
     }
 
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
+                          OMX_IndexParamAudioPcm, &(p_prc->pcmmode_)));
+
   reset_stream_parameters (p_prc);
   p_prc->store_offset_ = 0;
+  p_prc->pcm_store_len_ = 0;
+  p_prc->pcm_store_offset_ = 0;
+  p_prc->out_eos_ = false;
   return OMX_ErrorNone;
 }
 
@@ -56,6 +56,12 @@ struct flacd_prc
   OMX_U8 * p_store_;
   OMX_U32 store_offset_;
   OMX_U32 store_size_;
+  OMX_U8 * p_pcm_store_;
+  OMX_U32 pcm_store_size_;
+  OMX_U32 pcm_store_len_;
+  OMX_U32 pcm_store_offset_;
+  bool out_eos_;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
 };
 
 typedef struct flacd_prc_class flacd_prc_class_t;
@@ -21,7 +21,7 @@
  * @file   inprocsrc.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader constants
+ * @brief  Tizonia - Shared-memory inproc reader constants
  *
  *
  */
@@ -47,6 +47,7 @@ extern "C"
 #define ARATELIA_INPROC_READER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_READER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_READER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_READER_URI_SCHEME         "inproc://"
 
 #ifdef __cplusplus
 }
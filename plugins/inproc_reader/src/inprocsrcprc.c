@@ -21,7 +21,7 @@
  * @file   inprocsrcprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Shared-memory inproc reader
  *
  *
  */
@@ -31,6 +31,8 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,6 +48,176 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_reader.prc"
 #endif
 
+static OMX_ERRORTYPE
+obtain_uri (inprocsrc_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const long pathname_max = PATH_MAX + NAME_MAX;
+
+  assert (ap_prc);
+  assert (NULL == ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_
+    = tiz_mem_calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + pathname_max + 1);
+
+  tiz_check_null_ret_oom (ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_->nSize
+    = sizeof (OMX_PARAM_CONTENTURITYPE) + pathname_max + 1;
+  ap_prc->p_uri_param_->nVersion.nVersion = OMX_VERSION;
+
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetParameter (
+            tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+            OMX_IndexParamContentURI, ap_prc->p_uri_param_)))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving the URI param from port",
+                 tiz_err_to_str (rc));
+    }
+  return rc;
+}
+
+static const char *
+channel_name (const inprocsrc_prc_t * ap_prc)
+{
+  const char * p_uri = NULL;
+  const size_t scheme_len = strlen (ARATELIA_INPROC_READER_URI_SCHEME);
+  assert (ap_prc);
+  assert (ap_prc->p_uri_param_);
+  /* 'inproc://name' and 'name' both refer to the channel 'name' */
+  p_uri = (const char *) ap_prc->p_uri_param_->contentURI;
+  if (0 == strncmp (p_uri, ARATELIA_INPROC_READER_URI_SCHEME, scheme_len))
+    {
+      p_uri += scheme_len;
+    }
+  return p_uri;
+}
+
+static inline OMX_ERRORTYPE
+start_io_watcher (inprocsrc_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  assert (ap_prc->p_ev_io_);
+  if (!ap_prc->awaiting_io_ev_)
+    {
+      rc = tiz_srv_io_watcher_start (ap_prc, ap_prc->p_ev_io_);
+    }
+  ap_prc->awaiting_io_ev_ = true;
+  return rc;
+}
+
+static inline void
+stop_io_watcher (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_io_ && ap_prc->awaiting_io_ev_)
+    {
+      (void) tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_io_);
+    }
+  ap_prc->awaiting_io_ev_ = false;
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (!ap_prc->port_disabled_ && !ap_prc->p_outhdr_)
+    {
+      if (OMX_ErrorNone
+          == tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_INPROC_READER_PORT_INDEX, 0,
+                                   &ap_prc->p_outhdr_)
+          && ap_prc->p_outhdr_)
+        {
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFlags = 0;
+        }
+    }
+  return ap_prc->p_outhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_outhdr_)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] nFilledLen [%u]",
+                 ap_prc->p_outhdr_, ap_prc->p_outhdr_->nFilledLen);
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                             ARATELIA_INPROC_READER_PORT_INDEX,
+                                             ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+read_from_ring (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_ring_);
+
+  while (!ap_prc->eos_ && !ap_prc->awaiting_io_ev_
+         && (p_hdr = get_header (ap_prc)))
+    {
+      size_t nbytes = 0;
+      size_t ncopy = 0;
+      OMX_U32 flags = 0;
+      const OMX_U8 * p_slot
+        = tiz_shm_ring_peek (ap_prc->p_ring_, &nbytes, &flags);
+
+      if (!p_slot)
+        {
+          /* Don't sit on data while the writer is idle */
+          if (p_hdr->nFilledLen > 0)
+            {
+              tiz_check_omx (release_header (ap_prc));
+            }
+          if (tiz_shm_ring_prepare_to_wait (ap_prc->p_ring_))
+            {
+              return start_io_watcher (ap_prc);
+            }
+          continue;
+        }
+
+      /* A slot may be larger than the space left in the header; the offset
+         within the current slot is kept across headers */
+      assert (ap_prc->slot_offset_ <= nbytes);
+      ncopy = MIN (nbytes - ap_prc->slot_offset_,
+                   p_hdr->nAllocLen - p_hdr->nOffset - p_hdr->nFilledLen);
+      memcpy (p_hdr->pBuffer + p_hdr->nOffset + p_hdr->nFilledLen,
+              p_slot + ap_prc->slot_offset_, ncopy);
+      p_hdr->nFilledLen += ncopy;
+      ap_prc->slot_offset_ += ncopy;
+
+      if (ap_prc->slot_offset_ == nbytes)
+        {
+          ap_prc->slot_offset_ = 0;
+          tiz_shm_ring_consume (ap_prc->p_ring_);
+          if (flags & OMX_BUFFERFLAG_EOS)
+            {
+              TIZ_DEBUG (handleOf (ap_prc), "EOS in HEADER [%p]", p_hdr);
+              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+              tiz_check_omx (release_header (ap_prc));
+              continue;
+            }
+        }
+
+      if (p_hdr->nOffset + p_hdr->nFilledLen == p_hdr->nAllocLen)
+        {
+          tiz_check_omx (release_header (ap_prc));
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
 /*
  * inprocsrcprc
  */
@@ -54,6 +226,13 @@ static void *
 inprocsrc_prc_ctor (void *ap_obj, va_list * app)
 {
   inprocsrc_prc_t *p_obj = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
+  p_obj->p_outhdr_ = NULL;
+  p_obj->p_uri_param_ = NULL;
+  p_obj->p_ring_ = NULL;
+  p_obj->p_ev_io_ = NULL;
+  p_obj->slot_offset_ = 0;
+  p_obj->port_disabled_ = false;
+  p_obj->awaiting_io_ev_ = false;
   p_obj->eos_ = false;
   return p_obj;
 }
@@ -64,12 +243,6 @@ inprocsrc_prc_dtor (void *ap_obj)
   return super_dtor (typeOf (ap_obj, "inprocsrcprc"), ap_obj);
 }
 
-static OMX_ERRORTYPE
-inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
-{
-  return OMX_ErrorNone;
-}
-
 /*
  * from tizsrv class
  */
@@ -77,18 +250,48 @@ inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
 static OMX_ERRORTYPE
 inprocsrc_prc_allocate_resources (void *ap_obj, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  assert (!p_prc->p_ring_);
+
+  tiz_check_omx (obtain_uri (p_prc));
+
+  /* The writer must have created the channel already */
+  if (OMX_ErrorNone
+      != (rc = tiz_shm_ring_connect (&(p_prc->p_ring_), channel_name (p_prc))))
+    {
+      TIZ_ERROR (handleOf (p_prc), "[%s] : Unable to connect to channel [%s]",
+                 tiz_err_to_str (rc), channel_name (p_prc));
+      return rc;
+    }
+
+  return tiz_srv_io_watcher_init (p_prc, &(p_prc->p_ev_io_),
+                                  tiz_shm_ring_notify_fd (p_prc->p_ring_),
+                                  TIZ_EVENT_READ, true);
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_deallocate_resources (void *ap_obj)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  stop_io_watcher (p_prc);
+  tiz_srv_io_watcher_destroy (p_prc, p_prc->p_ev_io_);
+  p_prc->p_ev_io_ = NULL;
+  tiz_shm_ring_destroy (p_prc->p_ring_);
+  p_prc->p_ring_ = NULL;
+  tiz_mem_free (p_prc->p_uri_param_);
+  p_prc->p_uri_param_ = NULL;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
 
@@ -101,7 +304,10 @@ inprocsrc_prc_transfer_and_process (void *ap_obj, OMX_U32 a_pid)
 static OMX_ERRORTYPE
 inprocsrc_prc_stop_and_return (void *ap_obj)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  stop_io_watcher (p_prc);
+  return release_header (p_prc);
 }
 
 /*
@@ -111,6 +317,62 @@ inprocsrc_prc_stop_and_return (void *ap_obj)
 static OMX_ERRORTYPE
 inprocsrc_prc_buffers_ready (const void *ap_obj)
 {
+  return read_from_ring ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_io_ready (void *ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                        int a_events)
+{
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->awaiting_io_ev_)
+    {
+      p_prc->awaiting_io_ev_ = false;
+      tiz_shm_ring_clear_notification (p_prc->p_ring_);
+      return read_from_ring (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_pause (const void *ap_obj)
+{
+  stop_io_watcher ((inprocsrc_prc_t *) ap_obj);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_resume (const void *ap_obj)
+{
+  return read_from_ring ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_flush (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  stop_io_watcher (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_disable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_io_watcher (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_enable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
   return OMX_ErrorNone;
 }
 
@@ -171,7 +433,19 @@ inprocsrc_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, inprocsrc_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, inprocsrc_prc_io_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, inprocsrc_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, inprocsrc_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, inprocsrc_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, inprocsrc_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, inprocsrc_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, inprocsrc_prc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -20,7 +20,7 @@
  * @file   inprocsrcprc_decls.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader declarations
+ * @brief  Tizonia - Shared-memory inproc reader declarations
  *
  *
  */
@@ -37,6 +37,8 @@ extern "C"
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
   typedef struct inprocsrc_prc inprocsrc_prc_t;
@@ -44,6 +46,13 @@ extern "C"
   {
     /* Object */
     const tiz_prc_t _;
+    OMX_BUFFERHEADERTYPE *p_outhdr_;
+    OMX_PARAM_CONTENTURITYPE *p_uri_param_;
+    tiz_shm_ring_t *p_ring_;
+    tiz_event_io_t *p_ev_io_;
+    size_t slot_offset_;
+    bool port_disabled_;
+    bool awaiting_io_ev_;
     bool eos_;
   };
 
@@ -21,7 +21,7 @@
  * @file   inprocrnd.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer
+ * @brief  Tizonia - Shared-memory inproc writer
  *
  *
  */
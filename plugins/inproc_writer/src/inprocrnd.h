@@ -21,7 +21,7 @@
  * @file   inprocrnd.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer constants
+ * @brief  Tizonia - Shared-memory inproc writer constants
  *
  *
  */
@@ -47,6 +47,9 @@ extern "C"
 #define ARATELIA_INPROC_WRITER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_WRITER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_WRITER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_WRITER_URI_SCHEME         "inproc://"
+#define ARATELIA_INPROC_WRITER_DEFAULT_SLOT_COUNT 32
+#define ARATELIA_INPROC_WRITER_DEFAULT_SLOT_SIZE  ARATELIA_INPROC_WRITER_PORT_MIN_BUF_SIZE
 
 #ifdef __cplusplus
 }
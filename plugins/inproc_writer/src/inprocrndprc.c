@@ -21,7 +21,7 @@
  * @file   inprocrndprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer processor
+ * @brief  Tizonia - Shared-memory inproc writer processor
  *
  *
  */
@@ -31,6 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,28 +49,6 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_writer.prc"
 #endif
 
-#define goto_end_on_zmq_null_pointer(expr, prc, msg)  \
-  do                                                  \
-    {                                                 \
-      if (NULL == (expr))                             \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
-
-#define goto_end_on_zmq_error(expr, prc, msg)         \
-  do                                                  \
-    {                                                 \
-      if (0 != (expr))                                \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
-
 static OMX_BUFFERHEADERTYPE *get_header (inprocrnd_prc_t *ap_prc)
 {
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
@@ -100,31 +81,82 @@ static bool ready_to_process (inprocrnd_prc_t *ap_prc)
              ap_prc->port_disabled_ ? "YES" : "NO",
              ap_prc->stopped_ ? "YES" : "NO");
   return (!ap_prc->paused_ && !ap_prc->port_disabled_ && !ap_prc->stopped_
-          && get_header (ap_prc));
+          && !ap_prc->awaiting_space_ && get_header (ap_prc));
+}
+
+static size_t get_uint_setting (const char *ap_key, const size_t a_default)
+{
+  const char *p_value
+      = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  const unsigned long value = p_value ? strtoul (p_value, NULL, 10) : 0;
+  return value > 0 ? value : a_default;
 }
 
-static bool ready_to_write_to_zmq_sock (inprocrnd_prc_t *ap_prc)
+static OMX_ERRORTYPE obtain_uri (inprocrnd_prc_t *ap_prc)
 {
-  int zmq_rc = 0;
-  int zevents = 0;
-  size_t zevents_len = sizeof(zevents);
-  bool sock_ready = false;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const long pathname_max = PATH_MAX + NAME_MAX;
+
   assert (ap_prc);
+  assert (NULL == ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_ = tiz_mem_calloc (
+      1, sizeof(OMX_PARAM_CONTENTURITYPE) + pathname_max + 1);
 
-  if (ap_prc->p_zmq_sock_)
+  tiz_check_null_ret_oom (ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_->nSize
+      = sizeof(OMX_PARAM_CONTENTURITYPE) + pathname_max + 1;
+  ap_prc->p_uri_param_->nVersion.nVersion = OMX_VERSION;
+
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetParameter (
+              tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+              OMX_IndexParamContentURI, ap_prc->p_uri_param_)))
     {
-      zmq_rc = zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_EVENTS, &zevents,
-                               &zevents_len);
-      if (!zmq_rc)
-        {
-          if (zevents & ZMQ_POLLOUT)
-            {
-              // We can write to the ZeroMQ socket
-              sock_ready = true;
-            }
-        }
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving the URI param from port",
+                 tiz_err_to_str (rc));
+    }
+  return rc;
+}
+
+static const char *channel_name (const inprocrnd_prc_t *ap_prc)
+{
+  const char *p_uri = NULL;
+  const size_t scheme_len = strlen (ARATELIA_INPROC_WRITER_URI_SCHEME);
+  assert (ap_prc);
+  assert (ap_prc->p_uri_param_);
+  /* 'inproc://name' and 'name' both refer to the channel 'name' */
+  p_uri = (const char *)ap_prc->p_uri_param_->contentURI;
+  if (0 == strncmp (p_uri, ARATELIA_INPROC_WRITER_URI_SCHEME, scheme_len))
+    {
+      p_uri += scheme_len;
+    }
+  return p_uri;
+}
+
+static OMX_ERRORTYPE start_space_watcher (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  assert (ap_prc->p_ev_space_);
+  if (!ap_prc->awaiting_space_)
+    {
+      rc = tiz_srv_io_watcher_start (ap_prc, ap_prc->p_ev_space_);
     }
-  return sock_ready;
+  ap_prc->awaiting_space_ = true;
+  return rc;
+}
+
+static void stop_space_watcher (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_space_ && ap_prc->awaiting_space_)
+    {
+      (void)tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_space_);
+    }
+  ap_prc->awaiting_space_ = false;
 }
 
 static OMX_ERRORTYPE release_header (inprocrnd_prc_t *ap_prc)
@@ -155,6 +187,7 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
     {
       TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
                  ap_prc->p_inhdr_);
+      ap_prc->eos_ = true;
       tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventBufferFlag, 0,
                            ap_prc->p_inhdr_->nFlags, NULL);
     }
@@ -164,27 +197,49 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
 
 static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   assert (ap_prc);
+  assert (ap_prc->p_ring_);
 
-  while ((p_hdr = get_header (ap_prc)))
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
     {
-      if (p_hdr->nFilledLen > 0)
+      /* An empty header still needs a slot if it carries a flag the reader
+         must see (e.g. EOS) */
+      if (p_hdr->nFilledLen > 0 || p_hdr->nFlags != 0)
         {
-          const int bytes_to_write = 0;
-          p_hdr->nFilledLen -= bytes_to_write;
-          p_hdr->nOffset += bytes_to_write;
+          size_t capacity = 0;
+          size_t nbytes = 0;
+          OMX_U8 *p_slot = tiz_shm_ring_claim (ap_prc->p_ring_, &capacity);
+
+          if (!p_slot)
+            {
+              /* The ring is full; if the reader has released slots in the
+                 meantime, just retry */
+              if (tiz_shm_ring_prepare_to_wait (ap_prc->p_ring_))
+                {
+                  TIZ_TRACE (handleOf (ap_prc), "Ring full; waiting");
+                  return start_space_watcher (ap_prc);
+                }
+              continue;
+            }
+
+          /* Headers larger than a slot are split across consecutive slots;
+             the flags travel with the last chunk */
+          nbytes = MIN (capacity, p_hdr->nFilledLen);
+          memcpy (p_slot, p_hdr->pBuffer + p_hdr->nOffset, nbytes);
+          p_hdr->nFilledLen -= nbytes;
+          p_hdr->nOffset += nbytes;
+          tiz_shm_ring_publish (ap_prc->p_ring_, nbytes,
+                                0 == p_hdr->nFilledLen ? p_hdr->nFlags : 0);
         }
 
       if (0 == p_hdr->nFilledLen)
         {
-          rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          tiz_check_omx (buffer_emptied (ap_prc));
         }
     }
 
-  return rc;
+  return OMX_ErrorNone;
 }
 
 /*
@@ -195,12 +250,15 @@ static void *inprocrnd_prc_ctor (void *ap_prc, va_list *app)
 {
   inprocrnd_prc_t *p_prc
       = super_ctor (typeOf (ap_prc, "inprocrndprc"), ap_prc, app);
+  p_prc->p_inhdr_ = NULL;
   p_prc->port_disabled_ = false;
   p_prc->paused_ = false;
   p_prc->stopped_ = true;
-  p_prc->p_zmq_ctx_ = NULL;
-  p_prc->p_zmq_sock_ = NULL;
-  p_prc->zmq_fd_ = -1;
+  p_prc->p_uri_param_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->p_ev_accept_ = NULL;
+  p_prc->p_ev_space_ = NULL;
+  p_prc->awaiting_space_ = false;
   p_prc->eos_ = false;
   return p_prc;
 }
@@ -218,48 +276,59 @@ static OMX_ERRORTYPE inprocrnd_prc_allocate_resources (void *ap_prc,
                                                        OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t nslots = 0;
+  size_t slot_size = 0;
   assert (p_prc);
+  assert (!p_prc->p_ring_);
+
+  tiz_check_omx (obtain_uri (p_prc));
+
+  nslots = get_uint_setting (ARATELIA_INPROC_WRITER_COMPONENT_NAME
+                             ".slot_count",
+                             ARATELIA_INPROC_WRITER_DEFAULT_SLOT_COUNT);
+  slot_size = get_uint_setting (ARATELIA_INPROC_WRITER_COMPONENT_NAME
+                                ".slot_size",
+                                ARATELIA_INPROC_WRITER_DEFAULT_SLOT_SIZE);
+
+  /* The ring is created here, so that a reader can connect to the channel as
+     soon as this component reaches the Idle state */
+  if (OMX_ErrorNone != (rc = tiz_shm_ring_create (&(p_prc->p_ring_),
+                                                  channel_name (p_prc),
+                                                  nslots, slot_size)))
+    {
+      TIZ_ERROR (handleOf (p_prc), "[%s] : Unable to create channel [%s]",
+                 tiz_err_to_str (rc), channel_name (p_prc));
+      return rc;
+    }
 
-  /* Create the zmq context */
-  p_prc->p_zmq_ctx_ = zmq_ctx_new ();
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_ctx_, p_prc, zmq_strerror (errno));
-
-  /* No need for io threads (since inproc transport) */
-  zmq_ctx_set (p_prc->p_zmq_ctx_, ZMQ_IO_THREADS, 0);
-
-  /* Create the zmq PUB socket */
-  p_prc->p_zmq_sock_ = zmq_socket (p_prc->p_zmq_ctx_, ZMQ_PUB);
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_sock_, p_prc,
-                                zmq_strerror (errno));
-
-  /* Bind the socket to the inproc address */
-  zmq_rc = zmq_bind (p_prc->p_zmq_sock_, "inproc://broadcast");
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All good */
-  rc = OMX_ErrorNone;
-
-end:
+  tiz_check_omx (tiz_srv_io_watcher_init (
+      p_prc, &(p_prc->p_ev_accept_), tiz_shm_ring_listen_fd (p_prc->p_ring_),
+      TIZ_EVENT_READ, false));
+  tiz_check_omx (tiz_srv_io_watcher_init (
+      p_prc, &(p_prc->p_ev_space_), tiz_shm_ring_notify_fd (p_prc->p_ring_),
+      TIZ_EVENT_READ, true));
 
-  return rc;
+  return tiz_srv_io_watcher_start (p_prc, p_prc->p_ev_accept_);
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
   assert (p_prc);
-  if (p_prc->p_zmq_sock_)
-    {
-      zmq_close (p_prc->p_zmq_sock_);
-      p_prc->p_zmq_sock_ = NULL;
-    }
-  if (p_prc->p_zmq_ctx_)
+  stop_space_watcher (p_prc);
+  if (p_prc->p_ev_accept_)
     {
-      zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
-      p_prc->p_zmq_ctx_ = NULL;
+      (void)tiz_srv_io_watcher_stop (p_prc, p_prc->p_ev_accept_);
     }
+  tiz_srv_io_watcher_destroy (p_prc, p_prc->p_ev_accept_);
+  p_prc->p_ev_accept_ = NULL;
+  tiz_srv_io_watcher_destroy (p_prc, p_prc->p_ev_space_);
+  p_prc->p_ev_space_ = NULL;
+  tiz_shm_ring_destroy (p_prc->p_ring_);
+  p_prc->p_ring_ = NULL;
+  tiz_mem_free (p_prc->p_uri_param_);
+  p_prc->p_uri_param_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -267,33 +336,27 @@ static OMX_ERRORTYPE inprocrnd_prc_prepare_to_transfer (void *ap_prc,
                                                         OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
-  size_t fd_len = 0;
   assert (p_prc);
-
-  fd_len = sizeof(p_prc->zmq_fd_);
-  zmq_rc
-      = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_, &fd_len);
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All goood */
-  rc = OMX_ErrorNone;
-
-end:
-
-  return rc;
+  p_prc->eos_ = false;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_transfer_and_process (void *ap_prc,
                                                          OMX_U32 a_pid)
 {
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_stop_and_return (void *ap_prc)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  stop_space_watcher (p_prc);
+  return release_header (p_prc);
 }
 
 /*
@@ -307,8 +370,21 @@ static OMX_ERRORTYPE inprocrnd_prc_io_ready (void *ap_prc,
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
+
+  if (ap_ev_io == p_prc->p_ev_accept_)
     {
+      /* A reader is connecting to the channel. A failed hand-over only
+         affects that reader. */
+      if (OMX_ErrorNone != tiz_shm_ring_accept (p_prc->p_ring_))
+        {
+          TIZ_WARN (handleOf (p_prc), "Unable to accept reader on [%s]",
+                    channel_name (p_prc));
+        }
+    }
+  else if (ap_ev_io == p_prc->p_ev_space_ && p_prc->awaiting_space_)
+    {
+      p_prc->awaiting_space_ = false;
+      tiz_shm_ring_clear_notification (p_prc->p_ring_);
       rc = write_buffer (p_prc);
     }
   return rc;
@@ -326,6 +402,52 @@ static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE inprocrnd_prc_pause (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_space_watcher (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_resume (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return inprocrnd_prc_buffers_ready (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_flush (const void *ap_prc,
+                                               OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  stop_space_watcher (p_prc);
+  /* Data already published belongs to the reader now */
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_disable (const void *ap_prc,
+                                                 OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_space_watcher (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_enable (const void *ap_prc,
+                                                OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return OMX_ErrorNone;
+}
+
 /*
  * inprocrnd_prc_class
  */
@@ -384,6 +506,16 @@ void *inprocrnd_prc_init (void *ap_tos, void *ap_hdl)
        tiz_srv_io_ready, inprocrnd_prc_io_ready,
        /* TIZ_CLASS_COMMENT: */
        tiz_prc_buffers_ready, inprocrnd_prc_buffers_ready,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_pause, inprocrnd_prc_pause,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_resume, inprocrnd_prc_resume,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_flush, inprocrnd_prc_port_flush,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_disable, inprocrnd_prc_port_disable,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_enable, inprocrnd_prc_port_enable,
        /* TIZ_CLASS_COMMENT: stop value */
        0);
 
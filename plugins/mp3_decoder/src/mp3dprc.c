@@ -381,6 +381,23 @@ update_pcm_mode (mp3d_prc_t * ap_prc, const OMX_U32 a_samplerate,
   return OMX_ErrorNone;
 }
 
+static inline unsigned char *
+write_sample (unsigned char * ap_output, const signed short a_sample,
+              const bool a_little_endian)
+{
+  if (a_little_endian)
+    {
+      *(ap_output++) = a_sample & 0xff;
+      *(ap_output++) = a_sample >> 8;
+    }
+  else
+    {
+      *(ap_output++) = a_sample >> 8;
+      *(ap_output++) = a_sample & 0xff;
+    }
+  return ap_output;
+}
+
 static int
 synthesize_samples (const void * ap_obj, int next_sample)
 {
@@ -390,6 +407,8 @@ synthesize_samples (const void * ap_obj, int next_sample)
   unsigned char * p_output
     = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nFilledLen;
   bool buffer_full = (p_bufend == p_output);
+  /* Big-endian, unless the output port has been configured otherwise */
+  const bool little_endian = (OMX_EndianLittle == p_prc->pcmmode_.eEndian);
   int i;
 
   for (i = next_sample; i < p_prc->synth_.pcm.length && !buffer_full; i++)
@@ -398,8 +417,7 @@ synthesize_samples (const void * ap_obj, int next_sample)
 
       /* Left channel */
       sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[0][i]);
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+      p_output = write_sample (p_output, sample, little_endian);
 
       /* Right channel. If the decoded stream is monophonic then
        * the right output channel is the same as the left one.
@@ -408,8 +426,7 @@ synthesize_samples (const void * ap_obj, int next_sample)
         {
           sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[1][i]);
         }
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+      p_output = write_sample (p_output, sample, little_endian);
 
       p_prc->p_outhdr_->nFilledLen += 4;
 
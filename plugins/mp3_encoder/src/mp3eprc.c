@@ -317,7 +317,11 @@ set_lame_mp3_settings (void *ap_obj, OMX_HANDLETYPE ap_hdl, void *ap_krn)
 
   (void) lame_set_num_channels (p_prc->lame_, p_prc->mp3type_.nChannels);
   (void) lame_set_in_samplerate (p_prc->lame_, p_prc->mp3type_.nSampleRate);
-  (void) lame_set_brate (p_prc->lame_, p_prc->mp3type_.nBitRate);
+  /* OpenMAX IL specifies nBitRate in bits per second; LAME expects kbps. Small
+     values are assumed to be in kbps already. */
+  (void) lame_set_brate (p_prc->lame_, p_prc->mp3type_.nBitRate >= 1000
+                                          ? p_prc->mp3type_.nBitRate / 1000
+                                          : p_prc->mp3type_.nBitRate);
 
   switch (p_prc->mp3type_.eChannelMode)
     {
@@ -42,10 +42,14 @@ extern "C"
   /* With libtizonia, port indexes must start at index 0 */
 #define ARATELIA_MP3_METADATA_ERASER_PORT_INDEX         0
 #define ARATELIA_MP3_METADATA_ERASER_PORT_MIN_BUF_COUNT 2
-#define ARATELIA_MP3_METADATA_ERASER_PORT_MIN_BUF_SIZE  8192
+#define ARATELIA_MP3_METADATA_ERASER_PORT_MIN_BUF_SIZE  (64 * 1024)
 #define ARATELIA_MP3_METADATA_ERASER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_MP3_METADATA_ERASER_PORT_ALIGNMENT     0
 #define ARATELIA_MP3_METADATA_ERASER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+/* Upper bound on the amount of audio (in ms) packed into a single output
+   buffer. Can be overridden in tizonia.conf. 0 means no limit other than the
+   buffer size */
+#define ARATELIA_MP3_METADATA_ERASER_DEFAULT_MAX_LATENCY_MS 1000
 
 #ifdef __cplusplus
 }
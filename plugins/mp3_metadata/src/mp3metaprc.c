@@ -33,6 +33,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <tizplatform.h>
@@ -152,59 +153,177 @@ static inline bool buffers_available (mp3meta_prc_t *ap_prc)
   return (get_header (ap_prc));
 }
 
+static void obtain_max_latency (mp3meta_prc_t *ap_prc)
+{
+  const char *p_max_latency = NULL;
+  assert (ap_prc);
+
+  ap_prc->max_latency_ms_ = ARATELIA_MP3_METADATA_ERASER_DEFAULT_MAX_LATENCY_MS;
+  p_max_latency = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      ARATELIA_MP3_METADATA_ERASER_COMPONENT_NAME ".max_latency_ms");
+  if (p_max_latency)
+    {
+      ap_prc->max_latency_ms_ = strtoul (p_max_latency, NULL, 10);
+    }
+  TIZ_TRACE (handleOf (ap_prc), "max latency [%u] ms",
+             ap_prc->max_latency_ms_);
+}
+
+static OMX_TICKS frame_duration (mp3meta_prc_t *ap_prc)
+{
+  struct mpg123_frameinfo info;
+  OMX_TICKS duration = 0;
+  assert (ap_prc);
+  if (MPG123_OK == mpg123_info (ap_prc->p_mpg123_, &info) && info.rate > 0)
+    {
+      duration = ((OMX_TICKS)mpg123_spf (ap_prc->p_mpg123_)
+                  * OMX_TICKS_PER_SECOND) / info.rate;
+    }
+  return duration;
+}
+
+static inline bool latency_cap_reached (const mp3meta_prc_t *ap_prc,
+                                        const OMX_TICKS a_duration)
+{
+  assert (ap_prc);
+  return (ap_prc->max_latency_ms_ > 0
+          && a_duration >= ((OMX_TICKS)ap_prc->max_latency_ms_
+                            * OMX_TICKS_PER_SECOND) / 1000);
+}
+
+/* Copies the frame currently held by mpg123 into the output buffer, if there
+   is room for it. mpg123's frame data remains valid until the next call to
+   mpg123_framebyframe_next, so a frame that doesn't fit can simply be left
+   pending until the next buffer arrives. */
+static bool write_frame (mp3meta_prc_t *ap_prc, OMX_BUFFERHEADERTYPE *ap_hdr)
+{
+  unsigned long header;
+  unsigned char *bodydata;
+  size_t bodybytes;
+
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  if (mpg123_framedata (ap_prc->p_mpg123_, &header, &bodydata, &bodybytes)
+      != MPG123_OK)
+    {
+      /* Nothing to write; skip it */
+      ap_prc->frame_pending_ = false;
+      return true;
+    }
+
+  if (4 + bodybytes > ap_hdr->nAllocLen - ap_hdr->nFilledLen)
+    {
+      if (0 == ap_hdr->nFilledLen)
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "Frame too large [%zu bytes] for buffer [%u bytes] "
+                     "- dropping", 4 + bodybytes, ap_hdr->nAllocLen);
+          ap_prc->frame_pending_ = false;
+        }
+      return false;
+    }
+
+  {
+    /* Need to extract the 4 header bytes from the native storage in the
+     * correct order. */
+    OMX_U8 *p_to = ap_hdr->pBuffer + ap_hdr->nFilledLen;
+    int i;
+    for (i = 0; i < 4; ++i)
+      {
+        p_to[i] = (unsigned char)((header >> ((3 - i) * 8)) & 0xff);
+      }
+
+    /* Now write out both header and data, fire and forget. */
+    memcpy (p_to + 4, bodydata, bodybytes);
+    ap_hdr->nFilledLen += 4 + bodybytes;
+    TIZ_TRACE (handleOf (ap_prc), "%zu: header 0x%08x, %zu body bytes",
+               ++ap_prc->counter_, header, bodybytes);
+  }
+
+  ap_prc->frame_pending_ = false;
+  return true;
+}
+
 static OMX_ERRORTYPE remove_metadata (mp3meta_prc_t *ap_prc)
 {
   int ret = MPG123_OK;
   OMX_BUFFERHEADERTYPE *p_out = NULL;
+  OMX_U32 nframes = 0;
+  OMX_TICKS duration = 0;
+  bool done = false;
 
   assert (ap_prc);
   assert (ap_prc->p_mpg123_);
 
   p_out = get_header (ap_prc);
   assert (p_out);
+  p_out->nOffset = 0;
   p_out->nFilledLen = 0;
   p_out->nFlags = 0;
+  p_out->nTimeStamp = ap_prc->position_;
 
-  if (((ret = mpg123_framebyframe_next (ap_prc->p_mpg123_)) == MPG123_OK
-       || MPG123_NEW_FORMAT == ret))
+  /* Pack as many whole frames as will fit in the buffer, or as many as
+     needed to reach the latency cap, whichever comes first */
+  while (!done)
     {
-      unsigned long header;
-      unsigned char *bodydata;
-      size_t bodybytes;
-      if (mpg123_framedata (ap_prc->p_mpg123_, &header, &bodydata, &bodybytes)
-          == MPG123_OK)
+      if (!ap_prc->frame_pending_)
         {
-          /* Need to extract the 4 header bytes from the native storage in the
-           * correct order. */
-          unsigned char hbuf[4];
-          int i;
-          for (i = 0; i < 4; ++i)
+          if (((ret = mpg123_framebyframe_next (ap_prc->p_mpg123_)) == MPG123_OK
+               || MPG123_NEW_FORMAT == ret))
+            {
+              ap_prc->frame_pending_ = true;
+            }
+          else if (MPG123_DONE == ret)
+            {
+              TIZ_NOTICE (handleOf (ap_prc),
+                          "HEADER [%p] Adding OMX_BUFFERFLAG_EOS", p_out);
+              p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+              done = true;
+            }
+          else if (MPG123_NEED_MORE == ret)
+            {
+              TIZ_WARN (handleOf (ap_prc), "ret=[MPG123_NEED_MORE] HEADER [%p]",
+                        p_out);
+              done = true;
+            }
+          else
             {
-              hbuf[i] = (unsigned char)((header >> ((3 - i) * 8)) & 0xff);
+              TIZ_ERROR (handleOf (ap_prc), "ret=[%d] HEADER [%p]", ret, p_out);
+              done = true;
             }
+        }
 
-          /* Now write out both header and data, fire and forget. */
-          memcpy (p_out->pBuffer, hbuf, 4);
-          memcpy (p_out->pBuffer + 4, bodydata, bodybytes);
-          p_out->nFilledLen = 4 + bodybytes;
-          TIZ_TRACE (handleOf (ap_prc), "%zu: header 0x%08x, %zu body bytes",
-                     ++ap_prc->counter_, header, bodybytes);
+      if (ap_prc->frame_pending_)
+        {
+          const OMX_U32 filled = p_out->nFilledLen;
+          if (!write_frame (ap_prc, p_out))
+            {
+              /* Buffer full */
+              done = true;
+            }
+          else if (p_out->nFilledLen > filled)
+            {
+              const OMX_TICKS frame_time = frame_duration (ap_prc);
+              ++nframes;
+              duration += frame_time;
+              ap_prc->position_ += frame_time;
+              done = latency_cap_reached (ap_prc, duration);
+            }
         }
     }
-  else if (MPG123_DONE == ret)
-    {
-      TIZ_NOTICE (handleOf (ap_prc), "HEADER [%p] Adding OMX_BUFFERFLAG_EOS",
-                  p_out);
-      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-      ap_prc->eos_ = true;
-    }
-  else if (MPG123_NEED_MORE == ret)
-    {
-      TIZ_WARN (handleOf (ap_prc), "ret=[MPG123_NEED_MORE] HEADER [%p]", p_out);
-    }
-  else
+
+  if (p_out->nFilledLen > 0)
     {
-      TIZ_ERROR (handleOf (ap_prc), "ret=[%d] HEADER [%p]", ret, p_out);
+      /* Only whole frames go out in each buffer */
+      p_out->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
+      TIZ_TRACE (handleOf (ap_prc),
+                 "HEADER [%p] frames [%u] bytes [%u] start [%lld] "
+                 "duration [%lld] us",
+                 p_out, nframes, p_out->nFilledLen,
+                 (long long)p_out->nTimeStamp, (long long)duration);
     }
 
   if (p_out->nFilledLen > 0 || ap_prc->eos_)
@@ -228,6 +347,9 @@ static void *mp3meta_prc_ctor (void *ap_obj, va_list *app)
   p_prc->p_out_hdr_ = NULL;
   p_prc->p_uri_param_ = NULL;
   p_prc->counter_ = 0;
+  p_prc->position_ = 0;
+  p_prc->max_latency_ms_ = ARATELIA_MP3_METADATA_ERASER_DEFAULT_MAX_LATENCY_MS;
+  p_prc->frame_pending_ = false;
   p_prc->eos_ = false;
   p_prc->out_port_disabled_ = false;
 
@@ -262,6 +384,7 @@ static OMX_ERRORTYPE mp3meta_prc_allocate_resources (void *ap_obj,
   assert (NULL == p_prc->p_uri_param_);
 
   tiz_check_omx (obtain_uri (p_prc));
+  obtain_max_latency (p_prc);
 
   assert (p_prc->p_uri_param_);
 
@@ -319,6 +442,8 @@ static OMX_ERRORTYPE mp3meta_prc_prepare_to_transfer (void *ap_obj,
   mp3meta_prc_t *p_prc = ap_obj;
   assert (p_prc);
   p_prc->counter_ = 0;
+  p_prc->position_ = 0;
+  p_prc->frame_pending_ = false;
   p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
@@ -329,6 +454,8 @@ static OMX_ERRORTYPE mp3meta_prc_transfer_and_process (void *ap_obj,
   mp3meta_prc_t *p_prc = ap_obj;
   assert (p_prc);
   p_prc->counter_ = 0;
+  p_prc->position_ = 0;
+  p_prc->frame_pending_ = false;
   p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
@@ -50,6 +50,9 @@ struct mp3meta_prc
   OMX_BUFFERHEADERTYPE *p_out_hdr_;
   OMX_PARAM_CONTENTURITYPE *p_uri_param_;
   OMX_U32 counter_;
+  OMX_TICKS position_;
+  OMX_U32 max_latency_ms_;
+  bool frame_pending_;
   bool eos_;
   bool out_port_disabled_;
 };
@@ -124,6 +124,18 @@ static OMX_PTR instantiate_mp2_port (OMX_HANDLETYPE ap_hdl)
                       &encodings, &mp2type);
 }
 
+static OMX_U32 default_bits_per_sample (void)
+{
+  const char *p_format = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      ARATELIA_MPG123_DECODER_COMPONENT_NAME ".output_format");
+  if (p_format && 0 == strcmp (p_format, "float"))
+    {
+      return 32;
+    }
+  return ARATELIA_MPG123_DECODER_DEFAULT_BITS_PER_SAMPLE;
+}
+
 static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
 {
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
@@ -149,9 +161,9 @@ static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
   pcmmode.nPortIndex = ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX;
   pcmmode.nChannels = 2;
   pcmmode.eNumData = OMX_NumericalDataSigned;
-  pcmmode.eEndian = OMX_EndianBig;
+  pcmmode.eEndian = OMX_EndianLittle;
   pcmmode.bInterleaved = OMX_TRUE;
-  pcmmode.nBitPerSample = 16;
+  pcmmode.nBitPerSample = default_bits_per_sample ();
   pcmmode.nSamplingRate = 48000;
   pcmmode.ePCMMode = OMX_AUDIO_PCMModeLinear;
   pcmmode.eChannelMapping[0] = OMX_AUDIO_ChannelLF;
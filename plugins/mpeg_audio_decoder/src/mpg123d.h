@@ -49,7 +49,7 @@ extern "C"
 #define ARATELIA_MPG123_DECODER_PORT_ALIGNMENT           0
 #define ARATELIA_MPG123_DECODER_PORT_SUPPLIERPREF        OMX_BufferSupplyInput
 
-#define ARATELIA_MPG123_DECODER_BUF_FILL_THRESHOLD       2 * ARATELIA_MPG123_DECODER_PORT_MIN_INPUT_BUF_SIZE
+#define ARATELIA_MPG123_DECODER_DEFAULT_BITS_PER_SAMPLE  16
 
 #ifdef __cplusplus
 }
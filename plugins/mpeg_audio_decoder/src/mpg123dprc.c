@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
+#include <strings.h>
 
 #include <tizplatform.h>
 
@@ -80,6 +81,22 @@
 /* Forward declarations */
 static OMX_ERRORTYPE mpg123d_prc_deallocate_resources (void *);
 
+static long retrieve_rva_mode (void)
+{
+  const char *p_mode = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      ARATELIA_MPG123_DECODER_COMPONENT_NAME ".replaygain");
+  if (p_mode && 0 == strcmp (p_mode, "track"))
+    {
+      return MPG123_RVA_MIX;
+    }
+  else if (p_mode && 0 == strcmp (p_mode, "album"))
+    {
+      return MPG123_RVA_ALBUM;
+    }
+  return MPG123_RVA_OFF;
+}
+
 static const char *mpeg_version_to_str (enum mpg123_version version)
 {
   switch (version)
@@ -188,7 +205,7 @@ static const char *mpeg_output_encoding_to_str (const int encoding)
   return "Unknown Encoding";
 }
 
-OMX_ERRORTYPE release_in_hdr (mpg123d_prc_t *ap_prc)
+static OMX_ERRORTYPE release_in_hdr (mpg123d_prc_t *ap_prc)
 {
   OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
       ap_prc, ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX);
@@ -205,46 +222,180 @@ OMX_ERRORTYPE release_in_hdr (mpg123d_prc_t *ap_prc)
           tiz_util_reset_eos_flag (p_in);
         }
       TIZ_TRACE (handleOf (ap_prc), "Releasing IN HEADER [%p]", p_in);
-      tiz_filter_prc_release_header (ap_prc,
-                                     ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX);
+      p_in->nFilledLen = 0;
+      tiz_check_omx (tiz_filter_prc_release_header (
+          ap_prc, ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX));
     }
   return OMX_ErrorNone;
 }
 
-static long get_mpg123_buffer_fill (mpg123d_prc_t *ap_prc)
-{
-  double fval;
-  long buffer_fill;
-  assert (ap_prc);
-  (void)mpg123_getstate (ap_prc->p_mpg123_, MPG123_BUFFERFILL, &buffer_fill,
-                         &fval);
-  return buffer_fill;
-}
-
-OMX_ERRORTYPE release_out_hdr (mpg123d_prc_t *ap_prc)
+static OMX_ERRORTYPE release_out_hdr (mpg123d_prc_t *ap_prc)
 {
   OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
       ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
   if (p_out)
     {
-      if (tiz_filter_prc_is_eos (ap_prc)
-          && (get_mpg123_buffer_fill (ap_prc) == 0
-              || ap_prc->need_to_feed_more_))
-        {
-          TIZ_TRACE (handleOf (ap_prc), "Propagating EOS flag - fill [%ld]",
-                     get_mpg123_buffer_fill (ap_prc));
-          tiz_util_set_eos_flag (p_out);
-        }
       TIZ_TRACE (handleOf (ap_prc),
                  "Releasing OUT HEADER [%p] nFilledLen [%d] nAllocLen [%d]",
                  p_out, p_out->nFilledLen, p_out->nAllocLen);
-      tiz_filter_prc_release_header (ap_prc,
-                                     ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+      tiz_check_omx (tiz_filter_prc_release_header (
+          ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE store_metadata (mpg123d_prc_t *ap_prc,
+                                     const char *ap_header_name,
+                                     const char *ap_header_info)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_CONFIG_METADATAITEMTYPE *p_meta = NULL;
+  size_t metadata_len = 0;
+  size_t info_len = 0;
+
+  assert (ap_prc);
+  if (ap_header_name && ap_header_info)
+    {
+      info_len = strnlen (ap_header_info, OMX_MAX_STRINGNAME_SIZE - 1) + 1;
+      metadata_len = sizeof(OMX_CONFIG_METADATAITEMTYPE) + info_len;
+
+      if (NULL == (p_meta = (OMX_CONFIG_METADATAITEMTYPE *)tiz_mem_calloc (
+                       1, metadata_len)))
+        {
+          rc = OMX_ErrorInsufficientResources;
+        }
+      else
+        {
+          const size_t name_len
+              = strnlen (ap_header_name, OMX_MAX_STRINGNAME_SIZE - 1) + 1;
+          strncpy ((char *)p_meta->nKey, ap_header_name, name_len - 1);
+          p_meta->nKey[name_len - 1] = '\0';
+          p_meta->nKeySizeUsed = name_len;
+
+          strncpy ((char *)p_meta->nValue, ap_header_info, info_len - 1);
+          p_meta->nValue[info_len - 1] = '\0';
+          p_meta->nValueMaxSize = info_len;
+          p_meta->nValueSizeUsed = info_len;
+
+          p_meta->nSize = metadata_len;
+          p_meta->nVersion.nVersion = OMX_VERSION;
+          p_meta->eScopeMode = OMX_MetadataScopeAllLevels;
+          p_meta->nScopeSpecifier = 0;
+          p_meta->nMetadataItemIndex = 0;
+          p_meta->eSearchMode = OMX_MetadataSearchValueSizeByIndex;
+          p_meta->eKeyCharset = OMX_MetadataCharsetASCII;
+          p_meta->eValueCharset = OMX_MetadataCharsetASCII;
+
+          rc = tiz_krn_store_metadata (tiz_get_krn (handleOf (ap_prc)), p_meta);
+        }
+    }
+  return rc;
+}
+
+/* Publishes what mpg123 knows about the stream once the first frame has been
+   parsed: the LAME/Xing gapless info and any ReplayGain values */
+static void store_stream_metadata (mpg123d_prc_t *ap_prc)
+{
+  struct mpg123_frameinfo mi;
+  mpg123_id3v2 *p_id3v2 = NULL;
+  char info[100];
+
+  assert (ap_prc);
+
+  (void)tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+
+  if (MPG123_OK == mpg123_info (ap_prc->p_mpg123_, &mi))
+    {
+      snprintf (info, 99, "MPEG %s layer %d, %d kbps%s, %ld Hz, %d ch",
+                MPG123_1_0 == mi.version
+                    ? "1"
+                    : (MPG123_2_0 == mi.version ? "2" : "2.5"),
+                mi.layer, mi.bitrate, mi.vbr != 0 ? " (VBR)" : "", mi.rate,
+                (int)ap_prc->pcmmode_.nChannels);
+      info[99] = '\000';
+      (void)store_metadata (ap_prc, "Audio Stream", info);
+    }
+
+  if (ap_prc->gapless_)
+    {
+      long accurate = 0;
+      double fval = 0;
+      const off_t length = mpg123_length (ap_prc->p_mpg123_);
+      (void)mpg123_getstate (ap_prc->p_mpg123_, MPG123_ACCURATE, &accurate,
+                             &fval);
+      if (length > 0 && accurate)
+        {
+          snprintf (info, 99, "on, %ld samples", (long)length);
+        }
+      else
+        {
+          snprintf (info, 99, "on, no encoder delay info");
+        }
+      info[99] = '\000';
+      (void)store_metadata (ap_prc, "Gapless", info);
+    }
+
+  if (MPG123_RVA_OFF != ap_prc->rva_mode_)
+    {
+      double base = 0;
+      double really = 0;
+      double rva_db = 0;
+      (void)mpg123_getvolume (ap_prc->p_mpg123_, &base, &really, &rva_db);
+      snprintf (info, 99, "%+.2f dB (%s)", rva_db,
+                MPG123_RVA_ALBUM == ap_prc->rva_mode_ ? "album" : "track");
+      info[99] = '\000';
+      (void)store_metadata (ap_prc, "ReplayGain", info);
+    }
+
+  /* ReplayGain values carried in ID3v2 TXXX frames */
+  if ((mpg123_meta_check (ap_prc->p_mpg123_) & MPG123_ID3)
+      && MPG123_OK == mpg123_id3 (ap_prc->p_mpg123_, NULL, &p_id3v2)
+      && p_id3v2)
+    {
+      size_t i = 0;
+      for (i = 0; i < p_id3v2->extras; ++i)
+        {
+          const mpg123_text *p_txxx = &(p_id3v2->extra[i]);
+          if (p_txxx->description.fill > 0 && p_txxx->text.fill > 0
+              && 0 == strncasecmp (p_txxx->description.p, "replaygain_", 11))
+            {
+              (void)store_metadata (ap_prc, p_txxx->description.p,
+                                    p_txxx->text.p);
+            }
+        }
+    }
+}
+
+static OMX_ERRORTYPE update_pcm_mode (mpg123d_prc_t *ap_prc,
+                                      const OMX_U32 a_samplerate,
+                                      const OMX_U32 a_channels)
+{
+  assert (ap_prc);
+  if (a_samplerate != ap_prc->pcmmode_.nSamplingRate
+      || a_channels != ap_prc->pcmmode_.nChannels)
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating pcm mode : old samplerate [%d] new samplerate [%d]",
+                 ap_prc->pcmmode_.nSamplingRate, a_samplerate);
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating pcm mode : old channels [%d] new channels [%d]",
+                 ap_prc->pcmmode_.nChannels, a_channels);
+      ap_prc->pcmmode_.nSamplingRate = a_samplerate;
+      ap_prc->pcmmode_.nChannels = a_channels;
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+          tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+          OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
+      tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX,
+                           OMX_IndexParamAudioPcm, /* the index of the
+                                                      struct that has
+                                                      been modififed */
+                           NULL);
     }
   return OMX_ErrorNone;
 }
 
-static void retrieve_stream_format (mpg123d_prc_t *ap_prc)
+static OMX_ERRORTYPE retrieve_stream_format (mpg123d_prc_t *ap_prc)
 {
   struct mpg123_frameinfo mi;
   long rate;
@@ -261,144 +412,233 @@ static void retrieve_stream_format (mpg123d_prc_t *ap_prc)
   TIZ_TRACE (handleOf (ap_prc),
              "output format : rate [%ld] channels [%d] encoding [%s]", rate,
              channels, mpeg_output_encoding_to_str (encoding));
+
+  /* Audio in the new format must not share a buffer with the old */
+  {
+    OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
+        ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+    if (p_out && p_out->nFilledLen > 0
+        && (rate != ap_prc->pcmmode_.nSamplingRate
+            || channels != ap_prc->pcmmode_.nChannels))
+      {
+        tiz_check_omx (release_out_hdr (ap_prc));
+      }
+  }
+
+  ap_prc->frame_size_ = mpg123_encsize (encoding) * channels;
+  ap_prc->found_format_ = true;
+  tiz_check_omx (update_pcm_mode (ap_prc, rate, channels));
+  store_stream_metadata (ap_prc);
+  return OMX_ErrorNone;
 }
 
-static OMX_ERRORTYPE consume_decoded_data (mpg123d_prc_t *ap_prc)
+/* Copies audio that had to be decoded into the scratch buffer into as many
+   output buffers as it takes, in whole sample frames */
+static OMX_ERRORTYPE write_pcm (mpg123d_prc_t *ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
-      ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+  assert (ap_prc);
 
-  if (p_out)
+  while (ap_prc->pcm_len_ > 0)
     {
-      size_t bytes_decoded;
-      const int ret
-          = mpg123_read (ap_prc->p_mpg123_, TIZ_OMX_BUF_PTR (p_out),
-                         TIZ_OMX_BUF_ALLOC_LEN (p_out), &bytes_decoded);
-      switch (ret)
+      OMX_BUFFERHEADERTYPE *p_out = tiz_filter_prc_get_header (
+          ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+      size_t room = 0;
+      size_t nbytes = 0;
+
+      if (!p_out)
         {
-          case MPG123_OK:
-            ap_prc->need_to_feed_more_ = false;
-            break;
-          case MPG123_NEED_MORE:
-            ap_prc->need_to_feed_more_ = true;
-            break;
-          default:
-            {
-              TIZ_ERROR (handleOf (ap_prc),
-                         "[OMX_ErrorInsufficientResources] : "
-                         "mpg123_read error : [%s]",
-                         mpg123_plain_strerror (ret));
-              rc = OMX_ErrorInsufficientResources;
-            }
-            break;
-        };
+          TIZ_TRACE (handleOf (ap_prc),
+                     "No more output buffers available at the moment");
+          return OMX_ErrorNotReady;
+        }
 
-      if (OMX_ErrorNone == rc)
+      assert (ap_prc->frame_size_ > 0);
+      room = (TIZ_OMX_BUF_AVAIL (p_out) / ap_prc->frame_size_)
+             * ap_prc->frame_size_;
+      nbytes = MIN (room, ap_prc->pcm_len_);
+      memcpy (TIZ_OMX_BUF_PTR (p_out) + p_out->nFilledLen, ap_prc->p_pcm_,
+              nbytes);
+      p_out->nFilledLen += nbytes;
+      ap_prc->p_pcm_ += nbytes;
+      ap_prc->pcm_len_ -= nbytes;
+
+      if (room == nbytes)
         {
-          p_out->nFilledLen = bytes_decoded;
-          if (p_out->nFilledLen > 0)
-            {
-              rc = release_out_hdr (ap_prc);
-            }
+          /* This one is full */
+          tiz_check_omx (release_out_hdr (ap_prc));
         }
     }
-  return rc;
+  return OMX_ErrorNone;
 }
 
-static bool need_to_feed_more_data (mpg123d_prc_t *ap_prc)
+/* The whole input buffer is handed to mpg123 in one go; frames are then
+   decoded until mpg123 asks for more */
+static OMX_ERRORTYPE feed_encoded_data (mpg123d_prc_t *ap_prc,
+                                        OMX_BUFFERHEADERTYPE *ap_in)
 {
-  bool rc = false;
-  if (get_mpg123_buffer_fill (ap_prc)
-      < ARATELIA_MPG123_DECODER_BUF_FILL_THRESHOLD)
+  assert (ap_prc);
+  assert (ap_in);
+
+  if (ap_in->nFilledLen > 0)
     {
-      rc = true;
+      const int ret = mpg123_feed (ap_prc->p_mpg123_, TIZ_OMX_BUF_PTR (ap_in),
+                                   TIZ_OMX_BUF_FILL_LEN (ap_in));
+      if (ret != MPG123_OK)
+        {
+          TIZ_ERROR (
+              handleOf (ap_prc),
+              "[OMX_ErrorInsufficientResources] : mpg123_feed error : [%s]",
+              mpg123_plain_strerror (ret));
+          return OMX_ErrorInsufficientResources;
+        }
     }
-  return rc;
+  ap_prc->need_to_feed_more_ = false;
+  return release_in_hdr (ap_prc);
 }
 
-static bool may_consume_more_data (mpg123d_prc_t *ap_prc)
-{
-  bool rc = false;
-  assert (ap_prc);
-  rc = !(ap_prc->need_to_feed_more_)
-       && (tiz_filter_prc_get_header (
-                       ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX));
-  return rc;
-}
-
-static OMX_ERRORTYPE feed_encoded_data (mpg123d_prc_t *ap_prc)
+/* mpg123 decodes the next frame straight into the output buffer when there is
+   room for a whole frame in it, and into the scratch buffer otherwise */
+static OMX_ERRORTYPE decode_frame (mpg123d_prc_t *ap_prc,
+                                   OMX_BUFFERHEADERTYPE *ap_out)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
-      ap_prc, ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX);
+  const size_t room = TIZ_OMX_BUF_AVAIL (ap_out);
+  const bool in_place = ap_prc->found_format_ && room >= ap_prc->outblock_;
+  unsigned char *p_dst = in_place
+                             ? TIZ_OMX_BUF_PTR (ap_out) + ap_out->nFilledLen
+                             : ap_prc->p_scratch_;
+  unsigned char *p_audio = NULL;
+  size_t bytes = 0;
+  off_t num = 0;
+  int ret = 0;
 
   assert (ap_prc);
+  assert (ap_prc->p_mpg123_);
 
-  if (p_in)
+  goto_end_on_mpg123_error (mpg123_replace_buffer (
+      ap_prc->p_mpg123_, p_dst, in_place ? room : ap_prc->outblock_));
+
+  ret = mpg123_decode_frame (ap_prc->p_mpg123_, &num, &p_audio, &bytes);
+  switch (ret)
     {
-      const int ret = mpg123_feed (ap_prc->p_mpg123_, TIZ_OMX_BUF_PTR (p_in),
-                                   TIZ_OMX_BUF_FILL_LEN (p_in));
-      if (ret != MPG123_OK)
+      case MPG123_OK:
+        break;
+      case MPG123_NEW_FORMAT:
+        TIZ_TRACE (handleOf (ap_prc), "Found new format");
+        return retrieve_stream_format (ap_prc);
+      case MPG123_NEED_MORE:
+      case MPG123_DONE:
+        ap_prc->need_to_feed_more_ = true;
+        break;
+      default:
         {
-          TIZ_ERROR (
-              handleOf (ap_prc),
-              "[OMX_ErrorInsufficientResources] : mpg123_feed error : [%s]",
-              mpg123_plain_strerror (ret));
-          rc = OMX_ErrorInsufficientResources;
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[OMX_ErrorInsufficientResources] : "
+                     "mpg123_decode_frame error : [%s]",
+                     mpg123_plain_strerror (ret));
+          return OMX_ErrorInsufficientResources;
+        }
+    };
+
+  if (bytes > 0 && p_audio)
+    {
+      if (in_place)
+        {
+          if (p_audio != p_dst)
+            {
+              memmove (p_dst, p_audio, bytes);
+            }
+          ap_out->nFilledLen += bytes;
+          if (TIZ_OMX_BUF_AVAIL (ap_out) < ap_prc->outblock_)
+            {
+              /* The next frame won't fit */
+              rc = release_out_hdr (ap_prc);
+            }
         }
       else
         {
-          p_in->nFilledLen = 0;
-          rc = release_in_hdr (ap_prc);
+          ap_prc->p_pcm_ = p_audio;
+          ap_prc->pcm_len_ = bytes;
         }
     }
   return rc;
+
+end:
+
+  return OMX_ErrorInsufficientResources;
 }
 
-static OMX_ERRORTYPE decode_stream (mpg123d_prc_t *ap_prc)
+static OMX_ERRORTYPE transform_buffer (mpg123d_prc_t *ap_prc)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE *p_out = NULL;
+
   assert (ap_prc);
-  do
+
+  /* Audio decoded into the scratch buffer goes out first */
+  if (OMX_ErrorNone != (rc = write_pcm (ap_prc)))
     {
-      if (need_to_feed_more_data (ap_prc))
+      return rc;
+    }
+
+  if (ap_prc->need_to_feed_more_)
+    {
+      OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
+          ap_prc, ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX);
+      if (!p_in)
         {
-          tiz_check_omx (feed_encoded_data (ap_prc));
+          return OMX_ErrorNotReady;
         }
-      tiz_check_omx (consume_decoded_data (ap_prc));
+      return feed_encoded_data (ap_prc, p_in);
     }
-  while (may_consume_more_data (ap_prc));
-  return OMX_ErrorNone;
+
+  if (!(p_out = tiz_filter_prc_get_header (
+            ap_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX)))
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  return decode_frame (ap_prc, p_out);
 }
 
-static OMX_ERRORTYPE query_format (mpg123d_prc_t *ap_prc)
+static OMX_ERRORTYPE set_output_format (mpg123d_prc_t *ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE *p_in = tiz_filter_prc_get_header (
-      ap_prc, ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX);
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  const int encoding = 32 == ap_prc->pcmmode_.nBitPerSample
+                           ? MPG123_ENC_FLOAT_32
+                           : MPG123_ENC_SIGNED_16;
+  const long *p_rates = NULL;
+  size_t nrates = 0;
+  size_t i = 0;
 
-  if (p_in)
-    {
-      int mpg123_ret = 0;
-      size_t bytes_decoded = 0;
-      assert (ap_prc);
-      assert (ap_prc->p_mpg123_);
-
-      mpg123_ret = mpg123_decode (ap_prc->p_mpg123_, TIZ_OMX_BUF_PTR (p_in),
-                                  TIZ_OMX_BUF_FILL_LEN (p_in), NULL, 0,
-                                  &bytes_decoded);
-      p_in->nFilledLen = 0;
+  assert (ap_prc);
+  assert (ap_prc->p_mpg123_);
 
-      if (MPG123_NEW_FORMAT == mpg123_ret)
-        {
-          TIZ_TRACE (handleOf (ap_prc), "Found new format");
-          ap_prc->found_format_ = true;
-          retrieve_stream_format (ap_prc);
-          rc = consume_decoded_data (ap_prc);
-        }
-      (void)release_in_hdr (ap_prc);
+  /* Same sample format at every rate and channel count; mono streams stay
+     mono */
+  mpg123_rates (&p_rates, &nrates);
+  goto_end_on_mpg123_error (mpg123_format_none (ap_prc->p_mpg123_));
+  for (i = 0; i < nrates; ++i)
+    {
+      goto_end_on_mpg123_error (mpg123_format (ap_prc->p_mpg123_, p_rates[i],
+                                               MPG123_MONO | MPG123_STEREO,
+                                               encoding));
     }
 
+  /* The largest frame mpg123 may hand back in this format */
+  ap_prc->outblock_ = mpg123_outblock (ap_prc->p_mpg123_);
+  tiz_mem_free (ap_prc->p_scratch_);
+  goto_end_on_null (ap_prc->p_scratch_ = tiz_mem_alloc (ap_prc->outblock_));
+
+  TIZ_TRACE (handleOf (ap_prc), "encoding [%s] outblock [%lu]",
+             mpeg_output_encoding_to_str (encoding),
+             (unsigned long)ap_prc->outblock_);
+
+  /* Everything went well  */
+  rc = OMX_ErrorNone;
+
+end:
+
   return rc;
 }
 
@@ -407,6 +647,19 @@ static void reset_stream_parameters (mpg123d_prc_t *ap_prc)
   assert (ap_prc);
   ap_prc->found_format_ = false;
   ap_prc->need_to_feed_more_ = true;
+  ap_prc->p_pcm_ = NULL;
+  ap_prc->pcm_len_ = 0;
+  if (ap_prc->p_mpg123_)
+    {
+      /* mpg123 must not be left pointing at an output buffer */
+      if (ap_prc->p_scratch_)
+        {
+          (void)mpg123_replace_buffer (ap_prc->p_mpg123_, ap_prc->p_scratch_,
+                                       ap_prc->outblock_);
+        }
+      /* Drop whatever was left in mpg123's input queue */
+      (void)mpg123_open_feed (ap_prc->p_mpg123_);
+    }
   tiz_filter_prc_update_eos_flag (ap_prc, false);
 }
 
@@ -420,6 +673,11 @@ static void *mpg123d_prc_ctor (void *ap_obj, va_list *app)
       = super_ctor (typeOf (ap_obj, "mpg123dprc"), ap_obj, app);
   assert (p_prc);
   p_prc->p_mpg123_ = NULL;
+  p_prc->p_scratch_ = NULL;
+  p_prc->outblock_ = 0;
+  p_prc->frame_size_ = 0;
+  p_prc->gapless_ = false;
+  p_prc->rva_mode_ = MPG123_RVA_OFF;
   reset_stream_parameters (p_prc);
   if (MPG123_OK != mpg123_init ())
     {
@@ -455,6 +713,22 @@ static OMX_ERRORTYPE mpg123d_prc_allocate_resources (void *ap_prc,
   ret = mpg123_open_feed (p_prc->p_mpg123_);
   goto_end_on_mpg123_error (ret);
 
+  /* Gapless playback trims the encoder delay and padding announced in the
+     LAME/Xing header */
+  p_prc->gapless_ = (0 != tiz_rcfile_compare_value (
+                              TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                              ARATELIA_MPG123_DECODER_COMPONENT_NAME ".gapless",
+                              "false"));
+  ret = mpg123_param (p_prc->p_mpg123_,
+                      p_prc->gapless_ ? MPG123_ADD_FLAGS : MPG123_REMOVE_FLAGS,
+                      MPG123_GAPLESS, 0.);
+  goto_end_on_mpg123_error (ret);
+
+  /* ReplayGain, from the LAME header or ID3v2 RVA2/TXXX frames */
+  p_prc->rva_mode_ = retrieve_rva_mode ();
+  ret = mpg123_param (p_prc->p_mpg123_, MPG123_RVA, p_prc->rva_mode_, 0.);
+  goto_end_on_mpg123_error (ret);
+
   /* Everything went well  */
   rc = OMX_ErrorNone;
 
@@ -475,6 +749,8 @@ static OMX_ERRORTYPE mpg123d_prc_deallocate_resources (void *ap_obj)
   assert (p_prc);
   mpg123_delete (p_prc->p_mpg123_); /* Closes, too. */
   p_prc->p_mpg123_ = NULL;
+  tiz_mem_free (p_prc->p_scratch_);
+  p_prc->p_scratch_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -483,6 +759,24 @@ static OMX_ERRORTYPE mpg123d_prc_prepare_to_transfer (void *ap_obj,
 {
   mpg123d_prc_t *p_prc = ap_obj;
   assert (p_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
+                                       handleOf (p_prc), OMX_IndexParamAudioPcm,
+                                       &(p_prc->pcmmode_)));
+
+  /* mpg123 can produce either 16-bit or float samples */
+  if (16 != p_prc->pcmmode_.nBitPerSample
+      && 32 != p_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_ERROR (handleOf (p_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "unsupported bits per sample [%d]",
+                 p_prc->pcmmode_.nBitPerSample);
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  tiz_check_omx (set_output_format (p_prc));
   reset_stream_parameters (p_prc);
   return OMX_ErrorNone;
 }
@@ -506,11 +800,37 @@ static OMX_ERRORTYPE mpg123d_prc_buffers_ready (const void *ap_prc)
 {
   mpg123d_prc_t *p_prc = (mpg123d_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE *p_out = NULL;
 
   assert (ap_prc);
 
-  rc = !p_prc->found_format_ ? query_format (p_prc) : decode_stream (p_prc);
+  while (OMX_ErrorNone == rc)
+    {
+      rc = transform_buffer (p_prc);
+    }
+
+  if (OMX_ErrorNotReady == rc)
+    {
+      rc = OMX_ErrorNone;
+    }
 
+  if (OMX_ErrorNone == rc && 0 == p_prc->pcm_len_
+      && (p_out = tiz_filter_prc_get_header (
+              p_prc, ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX)))
+    {
+      /* Input has run dry; don't sit on a partially filled buffer */
+      if (tiz_filter_prc_is_eos (p_prc))
+        {
+          TIZ_TRACE (handleOf (p_prc), "Propagating EOS flag");
+          tiz_util_set_eos_flag (p_out);
+          tiz_filter_prc_update_eos_flag (p_prc, false);
+          tiz_check_omx (release_out_hdr (p_prc));
+        }
+      else if (p_out->nFilledLen > 0)
+        {
+          tiz_check_omx (release_out_hdr (p_prc));
+        }
+    }
   return rc;
 }
 
@@ -45,9 +45,17 @@ struct mpg123d_prc
 {
   /* Object */
   const tiz_filter_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   mpg123_handle *p_mpg123_;
   bool found_format_;
   bool need_to_feed_more_;
+  bool gapless_;
+  long rva_mode_;
+  size_t frame_size_;
+  size_t outblock_;
+  unsigned char *p_scratch_;
+  unsigned char *p_pcm_;
+  size_t pcm_len_;
 };
 
 typedef struct mpg123d_prc_class mpg123d_prc_class_t;
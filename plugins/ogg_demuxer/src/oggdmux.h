@@ -52,6 +52,9 @@ extern "C" {
 #define TIZ_OGG_DEMUXER_INITIAL_READ_BLOCKSIZE 16384
 #define TIZ_OGG_DEMUXER_DEFAULT_READ_BLOCKSIZE 512
 #define TIZ_OGG_DEMUXER_DEFAULT_BUFFER_UTILISATION .75
+#define TIZ_OGG_DEMUXER_DEFAULT_READAHEAD_SIZE (1024 * 1024)
+#define TIZ_OGG_DEMUXER_MIN_READAHEAD_SIZE (64 * 1024)
+#define TIZ_OGG_DEMUXER_READAHEAD_ALIGNMENT 4096
 #define ALL_OGG_STREAMS -1
 
 #ifdef __cplusplus
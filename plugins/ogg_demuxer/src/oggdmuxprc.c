@@ -33,8 +33,10 @@
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
+#include <stdlib.h>
 
 #include <tizplatform.h>
 
@@ -103,17 +105,66 @@ is_video_content (const OggzStreamContent content)
     };
 }
 
+/* The file is read in large, page-aligned windows; oggz's small reads are
+   served from memory. After each refill the kernel is asked to start
+   reading the next window, so that by the time it is needed it is normally
+   already in the page cache and the refill doesn't wait for the disk. */
+static bool
+fill_readahead (oggdmux_prc_t * ap_prc)
+{
+  ssize_t nread = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->fd_ >= 0);
+  assert (ap_prc->p_ra_buf_);
+
+  ap_prc->ra_file_off_ += ap_prc->ra_len_;
+  ap_prc->ra_len_ = 0;
+  ap_prc->ra_pos_ = 0;
+
+  do
+    {
+      nread = read (ap_prc->fd_, ap_prc->p_ra_buf_, ap_prc->ra_size_);
+    }
+  while (nread < 0 && EINTR == errno);
+
+  if (nread <= 0)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "read returned [%d] at offset [%lld]",
+                 (int) nread, (long long) ap_prc->ra_file_off_);
+      return false;
+    }
+
+  ap_prc->ra_len_ = nread;
+#ifdef POSIX_FADV_WILLNEED
+  (void) posix_fadvise (ap_prc->fd_, ap_prc->ra_file_off_ + nread,
+                        ap_prc->ra_size_, POSIX_FADV_WILLNEED);
+#endif
+  return true;
+}
+
 static size_t
 og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
-  ssize_t bytes_read = 0;
+  size_t bytes_read = 0;
 
   assert (p_prc);
-  f = p_prc->p_file_;
 
-  bytes_read = read (fileno (f), ap_buf, n);
+  while (bytes_read < n)
+    {
+      size_t len = 0;
+      if (p_prc->ra_pos_ == p_prc->ra_len_ && !fill_readahead (p_prc))
+        {
+          break;
+        }
+      len = MIN (n - bytes_read, p_prc->ra_len_ - p_prc->ra_pos_);
+      memcpy ((OMX_U8 *) ap_buf + bytes_read, p_prc->p_ra_buf_ + p_prc->ra_pos_,
+              len);
+      p_prc->ra_pos_ += len;
+      bytes_read += len;
+    }
+
   if (0 == bytes_read)
     {
       TIZ_TRACE (handleOf (p_prc), "Zero bytes_read buf [%p] n [%d]", ap_buf,
@@ -122,24 +173,58 @@ og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
   return bytes_read;
 }
 
-static int
-og_io_seek (void * ap_user_handle, long offset, int whence)
+static long
+og_io_tell (void * ap_user_handle)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
   assert (p_prc);
-  f = p_prc->p_file_;
-  return (fseek (f, offset, whence));
+  return p_prc->ra_file_off_ + p_prc->ra_pos_;
 }
 
-static long
-og_io_tell (void * ap_user_handle)
+static int
+og_io_seek (void * ap_user_handle, long offset, int whence)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
+  off_t target = 0;
   assert (p_prc);
-  f = p_prc->p_file_;
-  return ftell (f);
+
+  switch (whence)
+    {
+      case SEEK_SET:
+        target = offset;
+        break;
+      case SEEK_CUR:
+        target = og_io_tell (p_prc) + offset;
+        break;
+      case SEEK_END:
+        {
+          if ((target = lseek (p_prc->fd_, offset, SEEK_END)) < 0)
+            {
+              return -1;
+            }
+          p_prc->ra_file_off_ = target;
+          p_prc->ra_len_ = p_prc->ra_pos_ = 0;
+          return 0;
+        }
+      default:
+        return -1;
+    };
+
+  if (target >= p_prc->ra_file_off_
+      && target <= p_prc->ra_file_off_ + (off_t) p_prc->ra_len_)
+    {
+      /* Still inside the current window */
+      p_prc->ra_pos_ = target - p_prc->ra_file_off_;
+      return 0;
+    }
+
+  if (lseek (p_prc->fd_, target, SEEK_SET) < 0)
+    {
+      return -1;
+    }
+  p_prc->ra_file_off_ = target;
+  p_prc->ra_len_ = p_prc->ra_pos_ = 0;
+  return 0;
 }
 
 static OMX_ERRORTYPE
@@ -185,12 +270,53 @@ alloc_uri (oggdmux_prc_t * ap_prc)
 static OMX_ERRORTYPE
 alloc_file (oggdmux_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const char * p_ra_size = NULL;
+  void * p_buf = NULL;
+
   assert (ap_prc);
-  assert (!ap_prc->p_file_);
-  tiz_check_null_ret_oom (
-    (ap_prc->p_file_ = fopen ((const char *) ap_prc->p_uri_->contentURI, "r")));
-  return rc;
+  assert (ap_prc->fd_ < 0);
+  assert (!ap_prc->p_ra_buf_);
+
+  if ((ap_prc->fd_
+       = open ((const char *) ap_prc->p_uri_->contentURI, O_RDONLY))
+      < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to open [%s] (%s)",
+                 ap_prc->p_uri_->contentURI, strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+  (void) posix_fadvise (ap_prc->fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  p_ra_size
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            ARATELIA_OGG_DEMUXER_COMPONENT_NAME ".readahead_size");
+  ap_prc->ra_size_ = p_ra_size ? strtoul (p_ra_size, NULL, 10)
+                               : TIZ_OGG_DEMUXER_DEFAULT_READAHEAD_SIZE;
+  ap_prc->ra_size_ = MAX (ap_prc->ra_size_, TIZ_OGG_DEMUXER_MIN_READAHEAD_SIZE);
+  ap_prc->ra_size_ = (ap_prc->ra_size_ + TIZ_OGG_DEMUXER_READAHEAD_ALIGNMENT - 1)
+                     & ~((size_t) TIZ_OGG_DEMUXER_READAHEAD_ALIGNMENT - 1);
+
+  if (0 != posix_memalign (&p_buf, TIZ_OGG_DEMUXER_READAHEAD_ALIGNMENT,
+                           ap_prc->ra_size_))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Unable to allocate the readahead buffer");
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_prc->p_ra_buf_ = p_buf;
+  ap_prc->ra_len_ = 0;
+  ap_prc->ra_pos_ = 0;
+  ap_prc->ra_file_off_ = 0;
+
+  TIZ_TRACE (handleOf (ap_prc), "readahead size [%lu] batch packets [%s]",
+             (unsigned long) ap_prc->ra_size_,
+             ap_prc->batch_packets_ ? "YES" : "NO");
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -253,15 +379,21 @@ alloc_oggz (oggdmux_prc_t * ap_prc)
 
 static inline void
 dealloc_file (/*@special@ */ oggdmux_prc_t * ap_prc)
-/*@releases ap_prc->p_file_ @ */
-/*@ensures isnull ap_prc->p_file_@ */
+/*@releases ap_prc->p_ra_buf_ @ */
+/*@ensures isnull ap_prc->p_ra_buf_@ */
 {
   assert (ap_prc);
-  if (ap_prc->p_file_)
+  if (ap_prc->fd_ >= 0)
     {
-      (void) fclose (ap_prc->p_file_);
-      ap_prc->p_file_ = NULL;
+      (void) close (ap_prc->fd_);
+      ap_prc->fd_ = -1;
     }
+  free (ap_prc->p_ra_buf_);
+  ap_prc->p_ra_buf_ = NULL;
+  ap_prc->ra_size_ = 0;
+  ap_prc->ra_len_ = 0;
+  ap_prc->ra_pos_ = 0;
+  ap_prc->ra_file_off_ = 0;
 }
 
 static inline void
@@ -644,10 +776,23 @@ flush_ogg_packet (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
 
   while ((p_hdr = get_header (ap_prc, a_pid)))
     {
+      if (ap_prc->batch_packets_ && p_hdr->nFilledLen > 0
+          && nbytes_remaining > p_hdr->nAllocLen - p_hdr->nFilledLen)
+        {
+          /* Only whole packets are batched; this one starts a new buffer */
+          release_header (ap_prc, a_pid);
+          continue;
+        }
       nbytes_copied = dump_ogg_data (ap_prc, a_pid, ap_ogg_data + op_offset,
                                      nbytes_remaining, p_hdr);
       nbytes_remaining -= nbytes_copied;
       op_offset += nbytes_copied;
+      if (ap_prc->batch_packets_ && 0 == nbytes_remaining
+          && p_hdr->nFilledLen < p_hdr->nAllocLen)
+        {
+          /* There may be room for more packets in this buffer */
+          break;
+        }
 #ifdef _DEBUG
       if (a_pid == ARATELIA_OGG_DEMUXER_AUDIO_PORT_BASE_INDEX)
         {
@@ -732,6 +877,12 @@ read_packet (OGGZ * ap_oggz, oggz_packet * ap_zp, long serialno,
   /* Try to empty the ogg packet out to an omx buffer */
   op_offset = flush_ogg_packet (p_prc, a_pid, p_op->packet, p_op->bytes);
 
+  if (p_prc->batch_packets_ && *p_eos && 0 == op_offset)
+    {
+      /* Don't leave the last batch of the stream sitting in the buffer */
+      (void) release_header_with_eos (p_prc, a_pid);
+    }
+
   if (0 == op_offset)
     {
       if (*p_eos || !get_header (p_prc, a_pid)
@@ -1080,7 +1231,17 @@ oggdmux_prc_ctor (void * ap_obj, va_list * app)
   oggdmux_prc_t * p_prc
     = super_ctor (typeOf (ap_obj, "oggdmuxprc"), ap_obj, app);
   assert (p_prc);
-  p_prc->p_file_ = NULL;
+  p_prc->fd_ = -1;
+  p_prc->p_ra_buf_ = NULL;
+  p_prc->ra_size_ = 0;
+  p_prc->ra_len_ = 0;
+  p_prc->ra_pos_ = 0;
+  p_prc->ra_file_off_ = 0;
+  p_prc->batch_packets_
+    = (0 == tiz_rcfile_compare_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                      ARATELIA_OGG_DEMUXER_COMPONENT_NAME
+                                      ".packet_batching",
+                                      "true"));
   p_prc->p_uri_ = NULL;
   p_prc->p_oggz_ = NULL;
 
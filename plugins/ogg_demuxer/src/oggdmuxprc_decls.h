@@ -34,6 +34,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <sys/types.h>
 #include <oggz/oggz.h>
 
 #include <tizprc_decls.h>
@@ -43,7 +44,13 @@ struct oggdmux_prc
 {
   /* Object */
   const tiz_prc_t _;
-  FILE * p_file_;
+  int fd_;
+  OMX_U8 * p_ra_buf_;
+  size_t ra_size_;
+  size_t ra_len_;
+  size_t ra_pos_;
+  off_t ra_file_off_;
+  bool batch_packets_;
   OMX_PARAM_CONTENTURITYPE * p_uri_;
   OGGZ * p_oggz_;
   OggzTable * p_tracks_;
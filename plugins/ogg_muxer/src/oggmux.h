@@ -70,9 +70,9 @@ extern "C" {
 #define ARATELIA_OGG_MUXER_VIDEO_PORT_SUPPLIERPREF OMX_BufferSupplyInput
 
 /* Sink role - additional configs */
-#define ARATELIA_OGG_MUXER_DEFAULT_RECONNECT_TIMEOUT 3.0F
-#define ARATELIA_OGG_MUXER_DEFAULT_BIT_RATE_KBITS 128
-#define ARATELIA_OGG_MUXER_DEFAULT_CACHE_SECONDS 10
+#define ARATELIA_OGG_MUXER_DEFAULT_WRITE_BUFFER_SIZE (256 * 1024)
+#define ARATELIA_OGG_MUXER_WRITE_ALIGNMENT 4096
+#define ARATELIA_OGG_MUXER_WRITE_TIMEOUT_MS 5000
 
 #ifdef __cplusplus
 }
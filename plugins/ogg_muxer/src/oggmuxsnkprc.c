@@ -23,7 +23,10 @@
  *
  * @brief  Tizonia - Ogg muxer sink processor
  *
- * NOTE: This processor implementation is just a skeleton for now!
+ * Audio packets are stamped with granule positions computed from the codec
+ * headers (Opus or Vorbis, detected in-band), and the resulting pages are
+ * coalesced into a large aligned buffer before being written to a file, a
+ * pipe or a socket.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -32,15 +35,25 @@
 
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
 
 #include <OMX_TizoniaExt.h>
 
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizport.h>
+#include <tizport-macros.h>
 #include <tizscheduler.h>
 
 #include "oggmux.h"
@@ -67,152 +80,711 @@
     }                                                      \
   while (0)
 
+#define OGGMUXSNK_OPUS_MAX_PACKET_SAMPLES 5760 /* 120 ms at 48 kHz */
+#define OGGMUXSNK_VORBIS_MAX_MODES 64
+
 /* Forward declarations */
 static OMX_ERRORTYPE
 oggmuxsnk_prc_deallocate_resources (void *);
+
+static inline void
+le32 (unsigned char * p, int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+/* write a little-endian 16 bit int */
+static inline void
+le16 (unsigned char * p, int v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+}
+
+static inline OMX_U32
+get_le16 (const OMX_U8 * p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static inline bool
+is_port_enabled (oggmuxsnk_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  void * p_port = tiz_krn_get_port (tiz_get_krn (handleOf (ap_prc)), a_pid);
+  assert (p_port);
+  return TIZ_PORT_IS_ENABLED (p_port);
+}
+
+/*
+ * Output
+ */
+
 static OMX_ERRORTYPE
-release_buffer (oggmuxsnk_prc_t *);
+write_fully (oggmuxsnk_prc_t * ap_prc, const OMX_U8 * ap_data, size_t a_len)
+{
+  assert (ap_prc);
+  assert (ap_prc->fd_ >= 0);
+
+  while (a_len > 0)
+    {
+      /* MSG_NOSIGNAL: a peer that goes away must not raise SIGPIPE */
+      ssize_t n = ap_prc->is_socket_
+                    ? send (ap_prc->fd_, ap_data, a_len, MSG_NOSIGNAL)
+                    : write (ap_prc->fd_, ap_data, a_len);
+      if (n > 0)
+        {
+          ap_data += n;
+          a_len -= n;
+        }
+      else if (n < 0 && EINTR == errno)
+        {
+          continue;
+        }
+      else if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+          /* Non-blocking pipe or socket handed over by the IL client, or a
+             blocking socket whose send timeout has expired */
+          struct pollfd pfd = {ap_prc->fd_, POLLOUT, 0};
+          const int ready
+            = poll (&pfd, 1, ARATELIA_OGG_MUXER_WRITE_TIMEOUT_MS);
+          if (ready < 0 && EINTR == errno)
+            {
+              continue;
+            }
+          if (ready <= 0)
+            {
+              TIZ_ERROR (handleOf (ap_prc),
+                         "[OMX_ErrorInsufficientResources] : "
+                         "output not writable after %d ms",
+                         ARATELIA_OGG_MUXER_WRITE_TIMEOUT_MS);
+              return OMX_ErrorInsufficientResources;
+            }
+        }
+      else
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[OMX_ErrorInsufficientResources] : write error (%s)",
+                     (n < 0 ? strerror (errno) : "zero bytes written"));
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+  return OMX_ErrorNone;
+}
 
 static OMX_ERRORTYPE
-audio_hungry (oggmuxsnk_prc_t * ap_prc)
+flush_write_buffer (oggmuxsnk_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  if (ap_prc->wr_len_ > 0 && ap_prc->fd_ >= 0)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "writing [%zu] bytes", ap_prc->wr_len_);
+      rc = write_fully (ap_prc, ap_prc->p_wr_buf_, ap_prc->wr_len_);
+      ap_prc->wr_len_ = 0;
+    }
+  return rc;
+}
+
+static size_t
+og_io_write (void * ap_user_handle, void * ap_buf, size_t n)
+{
+  oggmuxsnk_prc_t * p_prc = ap_user_handle;
+  const OMX_U8 * p_src = ap_buf;
+  size_t remaining = n;
+
+  assert (p_prc);
+  assert (p_prc->p_wr_buf_);
+
+  /* Pages are coalesced in the write buffer; the file only sees writes of
+     the (aligned) buffer size, except for the last one */
+  while (remaining > 0)
+    {
+      const size_t chunk = MIN (remaining, p_prc->wr_size_ - p_prc->wr_len_);
+      memcpy (p_prc->p_wr_buf_ + p_prc->wr_len_, p_src, chunk);
+      p_prc->wr_len_ += chunk;
+      p_src += chunk;
+      remaining -= chunk;
+      if (p_prc->wr_len_ == p_prc->wr_size_
+          && OMX_ErrorNone != flush_write_buffer (p_prc))
+        {
+          p_prc->io_error_ = true;
+          return 0;
+        }
+    }
+  return n;
+}
+
+static int
+og_io_flush (void * ap_user_handle)
+{
+  oggmuxsnk_prc_t * p_prc = ap_user_handle;
+  assert (p_prc);
+  return (OMX_ErrorNone == flush_write_buffer (p_prc) ? 0 : -1);
+}
+
+/*
+ * Granule positions
+ */
+
+/* Number of 48 kHz samples in an Opus packet, from its TOC byte (RFC 6716,
+   section 3.1) */
+static OMX_U32
+opus_packet_samples (const OMX_U8 * ap_data, const long a_len)
+{
+  OMX_U32 frames = 0;
+  OMX_U32 frame_size = 0;
+  OMX_U8 toc = 0;
+
+  if (a_len < 1)
+    {
+      return 0;
+    }
+
+  toc = ap_data[0];
+  switch (toc & 0x3)
+    {
+      case 0:
+        frames = 1;
+        break;
+      case 1:
+      case 2:
+        frames = 2;
+        break;
+      default:
+        frames = (a_len < 2 ? 0 : ap_data[1] & 0x3F);
+        break;
+    };
+
+  if (toc & 0x80)
+    {
+      /* CELT-only: 2.5, 5, 10 or 20 ms */
+      frame_size = 120 << ((toc >> 3) & 0x3);
+    }
+  else if (0x60 == (toc & 0x60))
+    {
+      /* Hybrid: 10 or 20 ms */
+      frame_size = (toc & 0x08) ? 960 : 480;
+    }
+  else
+    {
+      /* SILK-only: 10, 20, 40 or 60 ms */
+      frame_size = (3 == ((toc >> 3) & 0x3)) ? 2880 : 480 << ((toc >> 3) & 0x3);
+    }
+
+  return (frames * frame_size > OGGMUXSNK_OPUS_MAX_PACKET_SAMPLES
+            ? 0
+            : frames * frame_size);
+}
+
+static inline int
+vorbis_bit (const OMX_U8 * ap_data, const long a_bit)
+{
+  /* Vorbis packs bits LSb first */
+  return (ap_data[a_bit >> 3] >> (a_bit & 7)) & 1;
+}
+
+static OMX_U32
+vorbis_read_backwards (const OMX_U8 * ap_data, long * ap_bit, const int a_nbits)
+{
+  OMX_U32 value = 0;
+  int i = 0;
+  for (i = 0; i < a_nbits; ++i)
+    {
+      value = (value << 1) | vorbis_bit (ap_data, *ap_bit);
+      (*ap_bit)--;
+    }
+  return value;
+}
+
+static int
+ilog (OMX_U32 v)
+{
+  int ret = 0;
+  while (v)
+    {
+      ret++;
+      v >>= 1;
+    }
+  return ret;
+}
+
+static bool
+parse_vorbis_id_header (oggmuxsnk_prc_t * ap_prc, const OMX_U8 * ap_data,
+                        const long a_len)
 {
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  ogg_packet op;
   assert (ap_prc);
-  /*   if ((p_hdr = tiz_filter_prc_get_header ( */
-  /*          ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX))) */
-  {
-    op.packet = p_hdr->pBuffer + p_hdr->nOffset;
-    op.bytes = p_hdr->nFilledLen;
-    op.granulepos = ap_prc->oggz_audio_granulepos_;
-    op.packetno = ap_prc->oggz_audio_packetno_;
-    if (op.packetno == 0)
-      {
-        op.b_o_s = 1;
-      }
-    else
-      {
-        op.b_o_s = 0;
-      }
-    if (op.packetno == 9)
-      {
-        op.e_o_s = 1;
-      }
-    else
-      {
-        op.e_o_s = 0;
-      }
-    oggz_write_feed (ap_prc->p_oggz_, &op, ap_prc->oggz_audio_serialno_,
-                     OGGZ_FLUSH_AFTER, NULL);
-    ap_prc->oggz_audio_granulepos_ += 100;
-    ap_prc->oggz_audio_packetno_++;
-  }
+  if (a_len < 30 || 1 != ap_data[0] || 0 != memcmp (ap_data + 1, "vorbis", 6))
+    {
+      return false;
+    }
+  ap_prc->vorbis_blocksize_[0] = 1 << (ap_data[28] & 0x0F);
+  ap_prc->vorbis_blocksize_[1] = 1 << (ap_data[28] >> 4);
+  TIZ_DEBUG (handleOf (ap_prc), "vorbis blocksizes [%u, %u]",
+             ap_prc->vorbis_blocksize_[0], ap_prc->vorbis_blocksize_[1]);
+  return true;
+}
+
+/* The modes are the last thing in the setup header: a 6-bit count followed
+   by one 41-bit entry (blockflag, windowtype, transformtype, mapping) per
+   mode, and then the framing bit. The codebooks ahead of them can't be
+   skipped without decoding them, so the modes are found by walking the
+   packet backwards from the framing bit. */
+static bool
+parse_vorbis_setup_header (oggmuxsnk_prc_t * ap_prc, const OMX_U8 * ap_data,
+                           const long a_len)
+{
+  bool blockflags[OGGMUXSNK_VORBIS_MAX_MODES];
+  int found = 0;
+  int mode_count = 0;
+  long bit = a_len * 8 - 1;
+  int i = 0;
+
+  assert (ap_prc);
+
+  if (a_len < 7 || 5 != ap_data[0] || 0 != memcmp (ap_data + 1, "vorbis", 6))
+    {
+      return false;
+    }
+
+  /* Skip the padding, and then the framing bit */
+  while (bit >= 0 && !vorbis_bit (ap_data, bit))
+    {
+      bit--;
+    }
+  bit--;
+
+  while (bit + 1 >= 41 + 6 && found < OGGMUXSNK_VORBIS_MAX_MODES)
+    {
+      long mark = 0;
+      if (vorbis_read_backwards (ap_data, &bit, 8) > 63
+          || 0 != vorbis_read_backwards (ap_data, &bit, 16)
+          || 0 != vorbis_read_backwards (ap_data, &bit, 16))
+        {
+          break;
+        }
+      blockflags[found++] = vorbis_read_backwards (ap_data, &bit, 1);
+      mark = bit;
+      if (vorbis_read_backwards (ap_data, &bit, 6) + 1 == (OMX_U32) found)
+        {
+          mode_count = found;
+        }
+      bit = mark;
+    }
+
+  if (0 == mode_count)
+    {
+      return false;
+    }
+
+  /* The entries were collected last mode first */
+  for (i = 0; i < mode_count; ++i)
+    {
+      ap_prc->vorbis_mode_blockflag_[i] = blockflags[mode_count - 1 - i];
+    }
+  ap_prc->vorbis_mode_count_ = mode_count;
+  ap_prc->vorbis_mode_bits_ = ilog (mode_count - 1);
+  TIZ_DEBUG (handleOf (ap_prc), "vorbis modes [%d]", mode_count);
+  return true;
+}
+
+/* Samples completed by a Vorbis audio packet: the overlap of its window with
+   the previous one, i.e. a quarter of each block size */
+static OMX_U32
+vorbis_packet_samples (oggmuxsnk_prc_t * ap_prc, const OMX_U8 * ap_data,
+                       const long a_len)
+{
+  OMX_U32 samples = 0;
+  OMX_U32 blocksize = 0;
+  int mode = 0;
+
+  assert (ap_prc);
+
+  if (a_len < 1 || (ap_data[0] & 1) || 0 == ap_prc->vorbis_mode_count_)
+    {
+      return 0;
+    }
+
+  mode = (ap_data[0] >> 1) & ((1 << ap_prc->vorbis_mode_bits_) - 1);
+  if (mode >= ap_prc->vorbis_mode_count_)
+    {
+      return 0;
+    }
+
+  blocksize
+    = ap_prc->vorbis_blocksize_[ap_prc->vorbis_mode_blockflag_[mode] ? 1 : 0];
+  if (ap_prc->vorbis_prev_blocksize_ > 0)
+    {
+      samples = ap_prc->vorbis_prev_blocksize_ / 4 + blocksize / 4;
+    }
+  ap_prc->vorbis_prev_blocksize_ = blocksize;
+  return samples;
+}
+
+/*
+ * Input
+ */
+
+static OMX_ERRORTYPE
+feed_packet (oggmuxsnk_prc_t * ap_prc, ogg_packet * ap_op,
+             const long a_serialno, const int a_flush)
+{
+  assert (ap_prc);
+  assert (ap_op);
+  /* oggz copies the packet, so the input buffer can be returned right away */
+  on_oggz_error_ret_omx_oom (
+    oggz_write_feed (ap_prc->p_oggz_, ap_op, a_serialno, a_flush, NULL));
   return OMX_ErrorNone;
 }
 
+/* Stream count, coupled stream count and channel mapping of the Vorbis
+   channel order (RFC 7845, section 5.1.1.2), for 1 to 8 channels */
+static const unsigned char opus_vorbis_streams[8][2]
+  = {{1, 0}, {1, 1}, {2, 1}, {2, 2}, {3, 2}, {4, 2}, {4, 3}, {5, 3}};
+static const unsigned char opus_vorbis_mappings[8][8] = {
+  {0},
+  {0, 1},
+  {0, 2, 1},
+  {0, 1, 2, 3},
+  {0, 4, 1, 2, 3},
+  {0, 4, 1, 2, 3, 5},
+  {0, 4, 1, 2, 3, 5, 6},
+  {0, 6, 1, 2, 3, 4, 5, 7},
+};
+
+/* OpusHead packet, for encoders that don't send their own */
 static OMX_ERRORTYPE
-video_hungry (oggmuxsnk_prc_t * ap_prc)
+enqueue_opus_head (oggmuxsnk_prc_t * ap_prc)
 {
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_TIZONIA_AUDIO_PARAM_OPUSTYPE opustype;
+  unsigned char data[21 + 255];
+  unsigned int channels = 0;
+  unsigned int i = 0;
   ogg_packet op;
+
   assert (ap_prc);
-  /*   if ((p_hdr = tiz_filter_prc_get_header ( */
-  /*          ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX))) */
-  {
-    op.packet = p_hdr->pBuffer + p_hdr->nOffset;
-    op.bytes = p_hdr->nFilledLen;
-    op.granulepos = ap_prc->oggz_video_granulepos_;
-    op.packetno = ap_prc->oggz_video_packetno_;
-    if (op.packetno == 0)
-      {
-        op.b_o_s = 1;
-      }
-    else
-      {
-        op.b_o_s = 0;
-      }
-    if (op.packetno == 9)
-      {
-        op.e_o_s = 1;
-      }
-    else
-      {
-        op.e_o_s = 0;
-      }
-    oggz_write_feed (ap_prc->p_oggz_, &op, ap_prc->oggz_video_serialno_,
-                     OGGZ_FLUSH_AFTER, NULL);
-    ap_prc->oggz_video_granulepos_ += 1;
-    ap_prc->oggz_video_packetno_++;
-  }
-  return OMX_ErrorNone;
+
+  TIZ_INIT_OMX_PORT_STRUCT (opustype, ARATELIA_OGG_MUXER_SINK_PORT_0_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexParamAudioOpus, &opustype));
+
+  channels = MIN (MAX (opustype.nChannels, 1), 255);
+
+  memcpy (data, "OpusHead", 8);            /* identifier */
+  data[8] = 1;                             /* version */
+  data[9] = channels;                      /* channels */
+  le16 (data + 10, 0);                     /* pre-skip */
+  le32 (data + 12, opustype.nSampleRate);  /* original sample rate */
+  le16 (data + 16, 0);                     /* gain */
+  op.bytes = 19;
+
+  if (channels <= 2)
+    {
+      data[18] = 0; /* channel mapping family: mono or stereo */
+    }
+  else if (channels <= 8)
+    {
+      /* Surround, in the Vorbis channel order */
+      data[18] = 1;
+      data[19] = opus_vorbis_streams[channels - 1][0];
+      data[20] = opus_vorbis_streams[channels - 1][1];
+      memcpy (data + 21, opus_vorbis_mappings[channels - 1], channels);
+      op.bytes = 21 + channels;
+    }
+  else
+    {
+      /* No defined layout: one uncoupled stream per channel */
+      data[18] = 255;
+      data[19] = channels;
+      data[20] = 0;
+      for (i = 0; i < channels; ++i)
+        {
+          data[21 + i] = i;
+        }
+      op.bytes = 21 + channels;
+    }
+
+  op.packet = data;
+  op.b_o_s = 1;
+  op.e_o_s = 0;
+  op.granulepos = 0;
+  op.packetno = ap_prc->oggz_audio_packetno_++;
+
+  return feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_,
+                      OGGZ_FLUSH_AFTER);
 }
 
-static int
-og_hungry (OGGZ * oggz, int empty, void * user_data)
+/* A generic OpusTags packet */
+static OMX_ERRORTYPE
+enqueue_opus_tags (oggmuxsnk_prc_t * ap_prc)
 {
-  oggmuxsnk_prc_t * p_prc = user_data;
+  const char * identifier = "OpusTags";
+  const char * vendor = "Tizonia";
+  unsigned char data[8 + 4 + 7 + 4];
+  ogg_packet op;
 
-  assert (p_prc);
-  audio_hungry (p_prc);
-  video_hungry (p_prc);
+  assert (ap_prc);
 
-  return 0;
+  memcpy (data, identifier, 8);
+  le32 (data + 8, strlen (vendor));
+  memcpy (data + 12, vendor, strlen (vendor));
+  le32 (data + 12 + strlen (vendor), 0);
+
+  op.packet = data;
+  op.bytes = sizeof (data);
+  op.b_o_s = 0;
+  op.e_o_s = 0;
+  op.granulepos = 0;
+  op.packetno = ap_prc->oggz_audio_packetno_++;
+
+  return feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_,
+                      OGGZ_FLUSH_AFTER);
 }
 
-static void
-update_cache_size (oggmuxsnk_prc_t * ap_prc)
+static OMX_ERRORTYPE
+detect_audio_codec (oggmuxsnk_prc_t * ap_prc, const OMX_U8 * ap_data,
+                    const long a_len)
 {
   assert (ap_prc);
-  assert (ap_prc->bitrate_ > 0);
-  ap_prc->cache_bytes_ = ((ap_prc->bitrate_ * 1000) / 8)
-                         * ARATELIA_OGG_MUXER_DEFAULT_CACHE_SECONDS;
-  if (ap_prc->p_trans_)
+  if (a_len >= 19 && 0 == memcmp (ap_data, "OpusHead", 8))
+    {
+      ap_prc->audio_codec_ = EOggMuxSnkCodecOpus;
+      ap_prc->opus_preskip_ = get_le16 (ap_data + 10);
+      TIZ_DEBUG (handleOf (ap_prc), "opus pre-skip [%u]",
+                 ap_prc->opus_preskip_);
+    }
+  else if (parse_vorbis_id_header (ap_prc, ap_data, a_len))
     {
-      tiz_urltrans_set_internal_buffer_size (ap_prc->p_trans_,
-                                             ap_prc->cache_bytes_);
+      ap_prc->audio_codec_ = EOggMuxSnkCodecVorbis;
     }
+  else
+    {
+      /* Raw Opus packets; the port is configured for Opus */
+      ap_prc->audio_codec_ = EOggMuxSnkCodecOpus;
+      ap_prc->opus_preskip_ = 0;
+      tiz_check_omx (enqueue_opus_head (ap_prc));
+      tiz_check_omx (enqueue_opus_tags (ap_prc));
+    }
+  return OMX_ErrorNone;
 }
 
-/* static OMX_ERRORTYPE */
-/* mux_streams (oggmuxsnk_prc_t * ap_prc) */
-/* { */
-/*   OMX_ERRORTYPE rc = OMX_ErrorNotReady; */
-/*   long oggz_rc = OGGZ_ERR_OK; */
-/*   while ((oggz_rc = oggz_write (ap_prc->p_oggz_, 32)) > 0); */
-/*   return rc; */
-/* } */
+static OMX_ERRORTYPE
+release_input_buffer (oggmuxsnk_prc_t * ap_prc, const OMX_U32 a_pid,
+                      OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+  if (ap_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                 ap_hdr);
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag, a_pid,
+                           ap_hdr->nFlags, NULL);
+    }
+  ap_hdr->nFilledLen = 0;
+  return tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)), a_pid,
+                                 ap_hdr);
+}
 
-static size_t
-og_io_write (void * ap_user_handle, void * ap_buf, size_t n)
+static OMX_ERRORTYPE
+audio_hungry (oggmuxsnk_prc_t * ap_prc)
 {
-  oggmuxsnk_prc_t * p_prc = ap_user_handle;
-  ssize_t bytes_written = 0;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  const OMX_U8 * p_data = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_ERRORTYPE release_rc = OMX_ErrorNone;
+  int flush = 0;
+  ogg_packet op;
 
-  assert (p_prc);
-  assert (p_prc->p_file_);
+  assert (ap_prc);
 
-  bytes_written = write (fileno (p_prc->p_file_), ap_buf, n);
-  if (0 == bytes_written)
+  if (ap_prc->audio_eos_)
     {
-      TIZ_DEBUG (handleOf (p_prc), "Zero bytes_written buf [%p] n [%d]", ap_buf,
-                 n);
+      return OMX_ErrorNotReady;
     }
-  else if (-1 == bytes_written)
+
+  tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                       ARATELIA_OGG_MUXER_SINK_PORT_0_INDEX, 0,
+                                       &p_hdr));
+  if (!p_hdr)
     {
-      TIZ_ERROR (handleOf (p_prc), "[%s]", strerror (errno));
+      return OMX_ErrorNotReady;
     }
-  return bytes_written;
+
+  p_data = p_hdr->pBuffer + p_hdr->nOffset;
+  op.packet = (unsigned char *) p_data;
+  op.bytes = p_hdr->nFilledLen;
+  op.e_o_s = ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0 ? 1 : 0);
+  ap_prc->audio_eos_ = (op.e_o_s > 0);
+
+  if (EOggMuxSnkCodecUnknown == ap_prc->audio_codec_ && op.bytes > 0)
+    {
+      rc = detect_audio_codec (ap_prc, p_data, op.bytes);
+    }
+
+  if (EOggMuxSnkCodecVorbis == ap_prc->audio_codec_
+      && ap_prc->oggz_audio_packetno_ < 3)
+    {
+      /* Identification, comment and setup headers. The first one goes on a
+         page of its own, and audio data starts on a fresh page */
+      if (2 == ap_prc->oggz_audio_packetno_
+          && !parse_vorbis_setup_header (ap_prc, p_data, op.bytes))
+        {
+          TIZ_WARN (handleOf (ap_prc),
+                    "Unable to find the vorbis modes; "
+                    "granule positions will be wrong");
+        }
+      flush = (1 != ap_prc->oggz_audio_packetno_ ? OGGZ_FLUSH_AFTER : 0);
+    }
+  else if (EOggMuxSnkCodecOpus == ap_prc->audio_codec_
+           && ap_prc->oggz_audio_packetno_ < 2)
+    {
+      /* OpusHead and OpusTags, each on its own page */
+      flush = OGGZ_FLUSH_AFTER;
+    }
+  else if (EOggMuxSnkCodecVorbis == ap_prc->audio_codec_)
+    {
+      ap_prc->oggz_audio_granulepos_
+        += vorbis_packet_samples (ap_prc, p_data, op.bytes);
+    }
+  else
+    {
+      ap_prc->oggz_audio_granulepos_ += opus_packet_samples (p_data, op.bytes);
+    }
+
+  op.b_o_s = (0 == ap_prc->oggz_audio_packetno_ ? 1 : 0);
+  op.granulepos = ap_prc->oggz_audio_granulepos_;
+  op.packetno = ap_prc->oggz_audio_packetno_++;
+
+  TIZ_DEBUG (handleOf (ap_prc), "packetno [%lld] bytes [%ld] granulepos [%lld]",
+             (long long) op.packetno, op.bytes, (long long) op.granulepos);
+
+  if (OMX_ErrorNone == rc)
+    {
+      rc = feed_packet (ap_prc, &op, ap_prc->oggz_audio_serialno_, flush);
+    }
+
+  /* The header goes back to the client even if the packet was not muxed */
+  release_rc
+    = release_input_buffer (ap_prc, ARATELIA_OGG_MUXER_SINK_PORT_0_INDEX, p_hdr);
+  return (OMX_ErrorNone != rc ? rc : release_rc);
 }
 
+static OMX_ERRORTYPE
+video_hungry (oggmuxsnk_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_ERRORTYPE release_rc = OMX_ErrorNone;
+  ogg_packet op;
+
+  assert (ap_prc);
+
+  if (ap_prc->video_eos_
+      || !is_port_enabled (ap_prc, ARATELIA_OGG_MUXER_SINK_PORT_1_INDEX))
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                       ARATELIA_OGG_MUXER_SINK_PORT_1_INDEX, 0,
+                                       &p_hdr));
+  if (!p_hdr)
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  /* No video codec is negotiated on this port; granule positions are frame
+     counts */
+  op.packet = p_hdr->pBuffer + p_hdr->nOffset;
+  op.bytes = p_hdr->nFilledLen;
+  op.b_o_s = (0 == ap_prc->oggz_video_packetno_ ? 1 : 0);
+  op.e_o_s = ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0 ? 1 : 0);
+  op.granulepos = ap_prc->oggz_video_granulepos_++;
+  op.packetno = ap_prc->oggz_video_packetno_++;
+  ap_prc->video_eos_ = (op.e_o_s > 0);
+
+  rc = feed_packet (ap_prc, &op, ap_prc->oggz_video_serialno_, 0);
+
+  /* The header goes back to the client even if the packet was not muxed */
+  release_rc
+    = release_input_buffer (ap_prc, ARATELIA_OGG_MUXER_SINK_PORT_1_INDEX, p_hdr);
+  return (OMX_ErrorNone != rc ? rc : release_rc);
+}
+
+/**
+ * This is callback which Oggz will call when oggz is hungry.
+ *
+ * \param oggz The OGGZ handle
+ * \param empty A value of 1 indicates that the packet queue is currently
+ *        empty. A value of 0 indicates that the packet queue is not empty.
+ * \param user_data A generic pointer provided to oggz
+ * \retval 0 Continue
+ * \retval non-zero Instruct Oggz to stop.
+ */
 static int
-og_io_flush (void * ap_user_handle)
+og_hungry (OGGZ * oggz, int empty, void * user_data)
 {
-  oggmuxsnk_prc_t * p_prc = ap_user_handle;
+  oggmuxsnk_prc_t * p_prc = user_data;
+  OMX_ERRORTYPE audio_rc = OMX_ErrorNone;
+  OMX_ERRORTYPE video_rc = OMX_ErrorNone;
+
   assert (p_prc);
-  assert (p_prc->p_file_);
-  return fflush (p_prc->p_file_);
+
+  audio_rc = audio_hungry (p_prc);
+  video_rc = video_hungry (p_prc);
+
+  if (OMX_ErrorNone == audio_rc || OMX_ErrorNone == video_rc)
+    {
+      return OGGZ_CONTINUE;
+    }
+  else if (OMX_ErrorNotReady == audio_rc && OMX_ErrorNotReady == video_rc)
+    {
+      return OGGZ_STOP_OK;
+    }
+  return OGGZ_STOP_ERR;
 }
 
+static OMX_ERRORTYPE
+mux_streams (oggmuxsnk_prc_t * ap_prc)
+{
+  long oggz_rc = 0;
+
+  assert (ap_prc);
+
+  while ((oggz_rc = oggz_write (ap_prc->p_oggz_, ap_prc->wr_size_)) > 0)
+    {
+    }
+
+  if (ap_prc->io_error_ || OGGZ_ERR_STOP_ERR == oggz_rc)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : oggz_write (%ld)",
+                 oggz_rc);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  ap_prc->eos_ = ap_prc->audio_eos_
+                 && (ap_prc->video_eos_
+                     || !is_port_enabled (
+                          ap_prc, ARATELIA_OGG_MUXER_SINK_PORT_1_INDEX));
+
+  /* Files are written in whole buffers; a pipe or a socket gets every page
+     as soon as it is complete */
+  if (ap_prc->eos_ || !ap_prc->is_regular_file_)
+    {
+      tiz_check_omx (flush_write_buffer (ap_prc));
+    }
+  return OMX_ErrorNone;
+}
+
+/*
+ * Resources
+ */
+
 static OMX_ERRORTYPE
 alloc_uri (oggmuxsnk_prc_t * ap_prc)
 {
@@ -253,31 +825,208 @@ alloc_uri (oggmuxsnk_prc_t * ap_prc)
   return rc;
 }
 
+static int
+connect_tcp (oggmuxsnk_prc_t * ap_prc, const char * ap_hostport)
+{
+  char host[NI_MAXHOST];
+  const char * p_port = NULL;
+  struct addrinfo hints;
+  struct addrinfo * p_res = NULL;
+  struct addrinfo * p_ai = NULL;
+  size_t host_len = 0;
+  int fd = -1;
+  int gai_rc = 0;
+
+  assert (ap_prc);
+  assert (ap_hostport);
+
+  /* host:port, or [v6 address]:port */
+  if ('[' == ap_hostport[0])
+    {
+      const char * p_end = strchr (ap_hostport, ']');
+      if (!p_end || ':' != p_end[1])
+        {
+          return -1;
+        }
+      host_len = p_end - ap_hostport - 1;
+      p_port = p_end + 2;
+      ap_hostport++;
+    }
+  else
+    {
+      if (!(p_port = strrchr (ap_hostport, ':')))
+        {
+          return -1;
+        }
+      host_len = p_port - ap_hostport;
+      p_port++;
+    }
+
+  if (host_len >= sizeof (host))
+    {
+      return -1;
+    }
+  memcpy (host, ap_hostport, host_len);
+  host[host_len] = '\0';
+
+  memset (&hints, 0, sizeof (hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (0 != (gai_rc = getaddrinfo (host, p_port, &hints, &p_res)))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "getaddrinfo [%s] : %s", host,
+                 gai_strerror (gai_rc));
+      return -1;
+    }
+
+  for (p_ai = p_res; p_ai && fd < 0; p_ai = p_ai->ai_next)
+    {
+      if ((fd = socket (p_ai->ai_family, p_ai->ai_socktype | SOCK_CLOEXEC,
+                        p_ai->ai_protocol))
+          >= 0)
+        {
+          if (0 != connect (fd, p_ai->ai_addr, p_ai->ai_addrlen))
+            {
+              close (fd);
+              fd = -1;
+            }
+        }
+    }
+
+  freeaddrinfo (p_res);
+  return fd;
+}
+
+static int
+connect_unix (const char * ap_path)
+{
+  struct sockaddr_un addr;
+  int fd = -1;
+
+  assert (ap_path);
+
+  if (strlen (ap_path) >= sizeof (addr.sun_path))
+    {
+      return -1;
+    }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, ap_path);
+
+  if ((fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0
+      && 0 != connect (fd, (struct sockaddr *) &addr, sizeof (addr)))
+    {
+      close (fd);
+      fd = -1;
+    }
+  return fd;
+}
+
+/* Supported destinations:
+ *  - a path or a file:// uri (regular files, but also fifos)
+ *  - "-" for stdout, or fd://N for a descriptor inherited from the IL client
+ *  - tcp://host:port and unix:///path, for a stream socket to connect to
+ */
 static OMX_ERRORTYPE
-alloc_data_store (oggmuxsnk_prc_t * ap_prc, tiz_buffer_t ** app_store,
-                  const OMX_U32 a_pid)
+alloc_destination (oggmuxsnk_prc_t * ap_prc)
 {
-  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  const char * p_uri = NULL;
+  struct stat st;
+
   assert (ap_prc);
-  assert (app_store);
-
-  TIZ_INIT_OMX_PORT_STRUCT (port_def, a_pid);
-  tiz_check_omx (
-    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
-                          OMX_IndexParamPortDefinition, &port_def));
-  assert (*app_store == NULL);
-  tiz_check_omx (tiz_buffer_init (&(*app_store), port_def.nBufferSize * 4));
+  assert (ap_prc->p_uri_);
+  assert (ap_prc->fd_ < 0);
+
+  p_uri = (const char *) ap_prc->p_uri_->contentURI;
+
+  if (0 == strcmp (p_uri, "-"))
+    {
+      ap_prc->fd_ = dup (STDOUT_FILENO);
+    }
+  else if (0 == strncmp (p_uri, "fd://", 5))
+    {
+      ap_prc->fd_ = dup ((int) strtol (p_uri + 5, NULL, 10));
+    }
+  else if (0 == strncmp (p_uri, "tcp://", 6))
+    {
+      ap_prc->fd_ = connect_tcp (ap_prc, p_uri + 6);
+    }
+  else if (0 == strncmp (p_uri, "unix://", 7))
+    {
+      ap_prc->fd_ = connect_unix (p_uri + 7);
+    }
+  else
+    {
+      if (0 == strncmp (p_uri, "file://", 7))
+        {
+          p_uri += 7;
+        }
+      ap_prc->fd_
+        = open (p_uri, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+  if (ap_prc->fd_ < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "unable to open [%s] (%s)",
+                 (const char *) ap_prc->p_uri_->contentURI, strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (0 == fstat (ap_prc->fd_, &st))
+    {
+      ap_prc->is_regular_file_ = S_ISREG (st.st_mode);
+      ap_prc->is_socket_ = S_ISSOCK (st.st_mode);
+    }
+
+  if (ap_prc->is_socket_ && !(fcntl (ap_prc->fd_, F_GETFL) & O_NONBLOCK))
+    {
+      /* A stalled peer must not block the component's thread forever */
+      struct timeval tv;
+      tv.tv_sec = ARATELIA_OGG_MUXER_WRITE_TIMEOUT_MS / 1000;
+      tv.tv_usec = (ARATELIA_OGG_MUXER_WRITE_TIMEOUT_MS % 1000) * 1000;
+      (void) setsockopt (ap_prc->fd_, SOL_SOCKET, SO_SNDTIMEO, &tv,
+                         sizeof (tv));
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc), "fd [%d] regular file [%s] socket [%s]",
+              ap_prc->fd_, (ap_prc->is_regular_file_ ? "YES" : "NO"),
+              (ap_prc->is_socket_ ? "YES" : "NO"));
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-alloc_file (oggmuxsnk_prc_t * ap_prc)
+alloc_write_buffer (oggmuxsnk_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const char * p_wr_size = NULL;
+  void * p_buf = NULL;
+
   assert (ap_prc);
-  tiz_check_null_ret_oom (
-    (ap_prc->p_file_ = fopen ((const char *) ap_prc->p_uri_->contentURI, "w")));
-  return rc;
+  assert (!ap_prc->p_wr_buf_);
+
+  p_wr_size = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                    ARATELIA_OGG_MUXER_COMPONENT_NAME
+                                    ".write_buffer_size");
+  ap_prc->wr_size_ = p_wr_size ? strtoul (p_wr_size, NULL, 10)
+                               : ARATELIA_OGG_MUXER_DEFAULT_WRITE_BUFFER_SIZE;
+  ap_prc->wr_size_ = MAX (ap_prc->wr_size_, ARATELIA_OGG_MUXER_WRITE_ALIGNMENT);
+  ap_prc->wr_size_ = (ap_prc->wr_size_ + ARATELIA_OGG_MUXER_WRITE_ALIGNMENT - 1)
+                     & ~((size_t) ARATELIA_OGG_MUXER_WRITE_ALIGNMENT - 1);
+
+  if (0 != posix_memalign (&p_buf, ARATELIA_OGG_MUXER_WRITE_ALIGNMENT,
+                           ap_prc->wr_size_))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "unable to allocate the write buffer (%zu bytes)",
+                 ap_prc->wr_size_);
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_prc->p_wr_buf_ = p_buf;
+  ap_prc->wr_len_ = 0;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -316,17 +1065,6 @@ dealloc_uri (/*@special@ */ oggmuxsnk_prc_t * ap_prc)
   ap_prc->p_uri_ = NULL;
 }
 
-static inline void
-dealloc_data_store (tiz_buffer_t ** app_store)
-{
-  assert (app_store);
-  if (*app_store)
-    {
-      tiz_buffer_destroy (*app_store);
-      *app_store = NULL;
-    }
-}
-
 static inline void
 dealloc_oggz (
   /*@special@ */ oggmuxsnk_prc_t * ap_prc)
@@ -336,41 +1074,53 @@ dealloc_oggz (
   assert (ap_prc);
   if (ap_prc->p_oggz_)
     {
-      /* TODO: delete oggz */
-      /*   oggz_close (ap_prc->p_oggz_); */
+      oggz_close (ap_prc->p_oggz_);
       ap_prc->p_oggz_ = NULL;
     }
 }
 
 static inline void
-dealloc_file (
-  /*@special@ */ oggmuxsnk_prc_t * ap_prc)
-/*@releases ap_prc->p_file_@ */
-/*@ensures isnull ap_prc->p_file_@ */
+dealloc_destination (oggmuxsnk_prc_t * ap_prc)
 {
   assert (ap_prc);
-  if (ap_prc->p_file_)
+  if (ap_prc->fd_ >= 0)
     {
-      fclose (ap_prc->p_file_);
-      ap_prc->p_file_ = NULL;
+      (void) flush_write_buffer (ap_prc);
+      close (ap_prc->fd_);
+      ap_prc->fd_ = -1;
     }
+  ap_prc->is_regular_file_ = false;
+  ap_prc->is_socket_ = false;
 }
 
-static OMX_ERRORTYPE
-release_buffer (oggmuxsnk_prc_t * ap_prc)
+static inline void
+dealloc_write_buffer (oggmuxsnk_prc_t * ap_prc)
 {
   assert (ap_prc);
+  free (ap_prc->p_wr_buf_);
+  ap_prc->p_wr_buf_ = NULL;
+  ap_prc->wr_len_ = 0;
+}
 
-  /*   if (ap_prc->p_outhdr_) */
-  /*     { */
-  /*       TIZ_NOTICE (handleOf (ap_prc), "releasing HEADER [%p] nFilledLen [%d]", */
-  /*                   ap_prc->p_outhdr_, ap_prc->p_outhdr_->nFilledLen); */
-  /*       tiz_check_omx (tiz_krn_release_buffer ( */
-  /*         tiz_get_krn (handleOf (ap_prc)), */
-  /*         ARATELIA_OGG_MUXER_SINK_PORT_0_INDEX, ap_prc->p_outhdr_)); */
-  /*       ap_prc->p_outhdr_ = NULL; */
-  /*     } */
-  return OMX_ErrorNone;
+static void
+reset_stream_parameters (oggmuxsnk_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->oggz_audio_granulepos_ = 0;
+  ap_prc->oggz_video_granulepos_ = 0;
+  ap_prc->oggz_audio_packetno_ = 0;
+  ap_prc->oggz_video_packetno_ = 0;
+  ap_prc->audio_codec_ = EOggMuxSnkCodecUnknown;
+  ap_prc->opus_preskip_ = 0;
+  ap_prc->vorbis_blocksize_[0] = 0;
+  ap_prc->vorbis_blocksize_[1] = 0;
+  ap_prc->vorbis_mode_count_ = 0;
+  ap_prc->vorbis_mode_bits_ = 0;
+  ap_prc->vorbis_prev_blocksize_ = 0;
+  ap_prc->audio_eos_ = false;
+  ap_prc->video_eos_ = false;
+  ap_prc->eos_ = false;
+  ap_prc->io_error_ = false;
 }
 
 /*
@@ -384,23 +1134,17 @@ oggmuxsnk_prc_ctor (void * ap_prc, va_list * app)
     = super_ctor (typeOf (ap_prc, "oggmuxsnkprc"), ap_prc, app);
   assert (p_prc);
 
-  p_prc->p_audio_store_ = NULL;
-  p_prc->p_video_store_ = NULL;
-  p_prc->p_file_ = NULL;
   p_prc->p_uri_ = NULL;
   p_prc->p_oggz_ = NULL;
+  p_prc->fd_ = -1;
+  p_prc->is_regular_file_ = false;
+  p_prc->is_socket_ = false;
+  p_prc->p_wr_buf_ = NULL;
+  p_prc->wr_size_ = 0;
+  p_prc->wr_len_ = 0;
   p_prc->oggz_audio_serialno_ = 0;
   p_prc->oggz_video_serialno_ = 0;
-  p_prc->oggz_audio_granulepos_ = 0;
-  p_prc->oggz_video_granulepos_ = 0;
-  p_prc->oggz_audio_packetno_ = 0;
-  p_prc->oggz_video_packetno_ = 0;
-  p_prc->eos_ = false;
-  p_prc->port_disabled_ = false;
-  p_prc->uri_changed_ = false;
-  p_prc->p_trans_ = NULL;
-  p_prc->bitrate_ = ARATELIA_OGG_MUXER_DEFAULT_BIT_RATE_KBITS;
-  update_cache_size (p_prc);
+  reset_stream_parameters (p_prc);
   return p_prc;
 }
 
@@ -420,13 +1164,10 @@ oggmuxsnk_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
 {
   oggmuxsnk_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  reset_stream_parameters (p_prc);
   tiz_check_omx (alloc_uri (p_prc));
-  tiz_check_omx (alloc_file (p_prc));
-  tiz_check_omx (alloc_oggz (p_prc));
-  tiz_check_omx (alloc_data_store (p_prc, &(p_prc->p_audio_store_),
-                                   ARATELIA_OGG_MUXER_SINK_PORT_0_INDEX));
-  tiz_check_omx (alloc_data_store (p_prc, &(p_prc->p_video_store_),
-                                   ARATELIA_OGG_MUXER_SINK_PORT_1_INDEX));
+  tiz_check_omx (alloc_write_buffer (p_prc));
+  tiz_check_omx (alloc_destination (p_prc));
   return OMX_ErrorNone;
 }
 
@@ -435,12 +1176,9 @@ oggmuxsnk_prc_deallocate_resources (void * ap_prc)
 {
   oggmuxsnk_prc_t * p_prc = ap_prc;
   assert (p_prc);
-  tiz_urltrans_destroy (p_prc->p_trans_);
-  p_prc->p_trans_ = NULL;
-  dealloc_data_store (&(p_prc->p_audio_store_));
-  dealloc_data_store (&(p_prc->p_video_store_));
   dealloc_oggz (p_prc);
-  dealloc_file (p_prc);
+  dealloc_destination (p_prc);
+  dealloc_write_buffer (p_prc);
   dealloc_uri (p_prc);
   return OMX_ErrorNone;
 }
@@ -450,18 +1188,18 @@ oggmuxsnk_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
 {
   oggmuxsnk_prc_t * p_prc = ap_prc;
   assert (ap_prc);
-  p_prc->eos_ = false;
-  tiz_urltrans_cancel (p_prc->p_trans_);
-  tiz_urltrans_set_internal_buffer_size (p_prc->p_trans_, p_prc->cache_bytes_);
-  return OMX_ErrorNone;
+  /* A stream that reached EOS in a previous run must not end this one. The
+     logical streams of that run are closed too, so start new ones on a fresh
+     oggz handle */
+  reset_stream_parameters (p_prc);
+  dealloc_oggz (p_prc);
+  return alloc_oggz (p_prc);
 }
 
 static OMX_ERRORTYPE
 oggmuxsnk_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid)
 {
-  oggmuxsnk_prc_t * p_prc = ap_prc;
-  assert (p_prc);
-  return tiz_urltrans_start (p_prc->p_trans_);
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -469,12 +1207,8 @@ oggmuxsnk_prc_stop_and_return (void * ap_prc)
 {
   oggmuxsnk_prc_t * p_prc = ap_prc;
   assert (p_prc);
-  if (p_prc->p_trans_)
-    {
-      tiz_urltrans_pause (p_prc->p_trans_);
-      tiz_urltrans_flush_buffer (p_prc->p_trans_);
-    }
-  return release_buffer (p_prc);
+  /* Whatever complete pages are buffered reach the destination */
+  return flush_write_buffer (p_prc);
 }
 
 /*
@@ -486,25 +1220,11 @@ oggmuxsnk_prc_buffers_ready (const void * ap_prc)
 {
   oggmuxsnk_prc_t * p_prc = (oggmuxsnk_prc_t *) ap_prc;
   assert (p_prc);
-  return tiz_urltrans_on_buffers_ready (p_prc->p_trans_);
-}
-
-static OMX_ERRORTYPE
-oggmuxsnk_prc_io_ready (void * ap_prc, tiz_event_io_t * ap_ev_io, int a_fd,
-                        int a_events)
-{
-  oggmuxsnk_prc_t * p_prc = ap_prc;
-  assert (p_prc);
-  return tiz_urltrans_on_io_ready (p_prc->p_trans_, ap_ev_io, a_fd, a_events);
-}
-
-static OMX_ERRORTYPE
-oggmuxsnk_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
-                           void * ap_arg, const uint32_t a_id)
-{
-  oggmuxsnk_prc_t * p_prc = ap_prc;
-  assert (p_prc);
-  return tiz_urltrans_on_timer_ready (p_prc->p_trans_, ap_ev_timer);
+  if (p_prc->eos_)
+    {
+      return OMX_ErrorNone;
+    }
+  return mux_streams (p_prc);
 }
 
 static OMX_ERRORTYPE
@@ -522,53 +1242,20 @@ oggmuxsnk_prc_resume (const void * ap_obj)
 static OMX_ERRORTYPE
 oggmuxsnk_prc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
-  oggmuxsnk_prc_t * p_prc = (oggmuxsnk_prc_t *) ap_obj;
-  if (p_prc->p_trans_)
-    {
-      tiz_urltrans_flush_buffer (p_prc->p_trans_);
-    }
-  return release_buffer (p_prc);
+  /* No input buffers are held; packets are copied into oggz when fed */
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 oggmuxsnk_prc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
-  oggmuxsnk_prc_t * p_prc = (oggmuxsnk_prc_t *) ap_obj;
-  assert (p_prc);
-  TIZ_PRINTF_DBG_RED ("Disabling port was disabled? [%s]\n",
-                      p_prc->port_disabled_ ? "YES" : "NO");
-  p_prc->port_disabled_ = true;
-  if (p_prc->p_trans_)
-    {
-      tiz_urltrans_pause (p_prc->p_trans_);
-      tiz_urltrans_flush_buffer (p_prc->p_trans_);
-    }
-  /* Release any buffers held  */
-  return release_buffer ((oggmuxsnk_prc_t *) ap_obj);
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 oggmuxsnk_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
 {
-  oggmuxsnk_prc_t * p_prc = (oggmuxsnk_prc_t *) ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  assert (p_prc);
-  TIZ_PRINTF_DBG_RED ("Enabling port was disabled? [%s]\n",
-                      p_prc->port_disabled_ ? "YES" : "NO");
-  if (p_prc->port_disabled_)
-    {
-      p_prc->port_disabled_ = false;
-      if (!p_prc->uri_changed_)
-        {
-          rc = tiz_urltrans_unpause (p_prc->p_trans_);
-        }
-      else
-        {
-          p_prc->uri_changed_ = false;
-          rc = tiz_urltrans_start (p_prc->p_trans_);
-        }
-    }
-  return rc;
+  return OMX_ErrorNone;
 }
 
 /*
@@ -629,9 +1316,7 @@ oggmuxsnk_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, oggmuxsnk_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
-     tiz_srv_io_ready, oggmuxsnk_prc_io_ready,
      /* TIZ_CLASS_COMMENT: */
-     tiz_srv_timer_ready, oggmuxsnk_prc_timer_ready,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, oggmuxsnk_prc_buffers_ready,
      /* TIZ_CLASS_COMMENT: */
@@ -42,28 +42,44 @@ extern "C" {
 
 #include <oggz/oggz.h>
 
+typedef enum oggmuxsnk_codec oggmuxsnk_codec_t;
+enum oggmuxsnk_codec
+{
+  EOggMuxSnkCodecUnknown = 0,
+  EOggMuxSnkCodecOpus,
+  EOggMuxSnkCodecVorbis
+};
+
 typedef struct oggmuxsnk_prc oggmuxsnk_prc_t;
 struct oggmuxsnk_prc
 {
   /* Object */
   const tiz_prc_t _;
-  tiz_buffer_t * p_audio_store_;
-  tiz_buffer_t * p_video_store_;
-  FILE * p_file_;
   OMX_PARAM_CONTENTURITYPE * p_uri_;
   OGGZ * p_oggz_;
+  int fd_;
+  bool is_regular_file_;
+  bool is_socket_;
+  bool io_error_;
+  OMX_U8 * p_wr_buf_;
+  size_t wr_size_;
+  size_t wr_len_;
   long oggz_audio_serialno_;
   long oggz_video_serialno_;
-  long oggz_audio_granulepos_;
-  long oggz_video_granulepos_;
-  long oggz_audio_packetno_;
-  long oggz_video_packetno_;
+  ogg_int64_t oggz_audio_granulepos_;
+  ogg_int64_t oggz_video_granulepos_;
+  ogg_int64_t oggz_audio_packetno_;
+  ogg_int64_t oggz_video_packetno_;
+  oggmuxsnk_codec_t audio_codec_;
+  OMX_U32 opus_preskip_;
+  OMX_U32 vorbis_blocksize_[2];
+  bool vorbis_mode_blockflag_[64];
+  int vorbis_mode_count_;
+  int vorbis_mode_bits_;
+  OMX_U32 vorbis_prev_blocksize_;
+  bool audio_eos_;
+  bool video_eos_;
   bool eos_;
-  bool port_disabled_;
-  bool uri_changed_;
-  tiz_urltrans_t * p_trans_;
-  int bitrate_;
-  int cache_bytes_;
 };
 
 typedef struct oggmuxsnk_prc_class oggmuxsnk_prc_class_t;
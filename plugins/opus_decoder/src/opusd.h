@@ -50,6 +50,9 @@ extern "C" {
 #define ARATELIA_OPUS_DECODER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_OPUS_DECODER_PORT_ALIGNMENT 0
 #define ARATELIA_OPUS_DECODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+/* Output sample formats, selected with nBitPerSample on the output port: 16
+   (signed 16-bit), 24 (signed 24-bit, packed) or 32 (32-bit float) */
+#define ARATELIA_OPUS_DECODER_DEFAULT_BITS_PER_SAMPLE 16
 
 #ifdef __cplusplus
 }
@@ -35,6 +35,10 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <tizplatform.h>
 
 #include <tizkernel.h>
@@ -383,6 +387,110 @@ release_headers (opusd_prc_t * ap_prc, const OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+/* TPDF dither: the sum of two uniform variables in [-0.5, 0.5) lsb */
+#define OPUSD_DITHER_SCALE (1.f / 4294967296.f)
+
+static inline uint32_t
+xorshift32 (uint32_t a_x)
+{
+  a_x ^= a_x << 13;
+  a_x ^= a_x >> 17;
+  a_x ^= a_x << 5;
+  return a_x;
+}
+
+static inline float
+tpdf_noise (uint32_t * ap_state)
+{
+  const uint32_t r1 = xorshift32 (*ap_state);
+  const uint32_t r2 = xorshift32 (r1);
+  *ap_state = r2;
+  return ((float) (int32_t) r1 + (float) (int32_t) r2) * OPUSD_DITHER_SCALE;
+}
+
+#if defined(__SSE2__)
+static inline __m128i
+xorshift32_x4 (__m128i a_x)
+{
+  a_x = _mm_xor_si128 (a_x, _mm_slli_epi32 (a_x, 13));
+  a_x = _mm_xor_si128 (a_x, _mm_srli_epi32 (a_x, 17));
+  a_x = _mm_xor_si128 (a_x, _mm_slli_epi32 (a_x, 5));
+  return a_x;
+}
+
+static inline __m128
+tpdf_noise_x4 (__m128i * ap_state)
+{
+  const __m128i r1 = xorshift32_x4 (*ap_state);
+  const __m128i r2 = xorshift32_x4 (r1);
+  *ap_state = r2;
+  return _mm_mul_ps (_mm_add_ps (_mm_cvtepi32_ps (r1), _mm_cvtepi32_ps (r2)),
+                     _mm_set1_ps (OPUSD_DITHER_SCALE));
+}
+#endif
+
+static void
+float_to_s16 (opusd_prc_t * ap_prc, const float * ap_in, OMX_S16 * ap_out,
+              const size_t a_nsamples)
+{
+  const bool dither = ap_prc->dither_;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  {
+    const __m128 scale = _mm_set1_ps (32768.f);
+    const __m128 lo_clip = _mm_set1_ps (-32768.f);
+    const __m128 hi_clip = _mm_set1_ps (32767.f);
+    __m128i state = _mm_loadu_si128 ((const __m128i *) ap_prc->dither_state_);
+
+    for (; i + 8 <= a_nsamples; i += 8)
+      {
+        __m128 a = _mm_mul_ps (_mm_loadu_ps (ap_in + i), scale);
+        __m128 b = _mm_mul_ps (_mm_loadu_ps (ap_in + i + 4), scale);
+        if (dither)
+          {
+            a = _mm_add_ps (a, tpdf_noise_x4 (&state));
+            b = _mm_add_ps (b, tpdf_noise_x4 (&state));
+          }
+        /* Clip before converting: out-of-range floats would convert to
+           INT_MIN. The pack saturates to 16 bits. */
+        a = _mm_min_ps (_mm_max_ps (a, lo_clip), hi_clip);
+        b = _mm_min_ps (_mm_max_ps (b, lo_clip), hi_clip);
+        _mm_storeu_si128 ((__m128i *) (ap_out + i),
+                          _mm_packs_epi32 (_mm_cvtps_epi32 (a),
+                                           _mm_cvtps_epi32 (b)));
+      }
+
+    _mm_storeu_si128 ((__m128i *) ap_prc->dither_state_, state);
+  }
+#endif
+
+  for (; i < a_nsamples; ++i)
+    {
+      float sample = ap_in[i] * 32768.f;
+      if (dither)
+        {
+          sample += tpdf_noise (&(ap_prc->dither_state_[0]));
+        }
+      ap_out[i] = (OMX_S16) float2int (fmaxf (-32768, fminf (sample, 32767)));
+    }
+}
+
+/* 24-bit samples are packed in 3 bytes, little-endian */
+static void
+float_to_s24 (const float * ap_in, OMX_U8 * ap_out, const size_t a_nsamples)
+{
+  size_t i = 0;
+  for (i = 0; i < a_nsamples; ++i)
+    {
+      const int32_t sample = (int32_t) float2int (
+        fmaxf (-8388608.f, fminf (ap_in[i] * 8388608.f, 8388607.f)));
+      ap_out[3 * i] = (OMX_U8) (sample & 0xff);
+      ap_out[3 * i + 1] = (OMX_U8) ((sample >> 8) & 0xff);
+      ap_out[3 * i + 2] = (OMX_U8) ((sample >> 16) & 0xff);
+    }
+}
+
 static OMX_ERRORTYPE
 transform_buffer (opusd_prc_t * ap_prc)
 {
@@ -422,13 +530,21 @@ transform_buffer (opusd_prc_t * ap_prc)
     opus_int32 len = p_in->nFilledLen;
     int fec = 0;
     float * output = NULL;
-    short * out = NULL;
     unsigned out_len = 0;
-    int i = 0;
     int tmp_skip = 0;
-    int frame_size = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data,
-                                                    len, ap_prc->p_out_buf_,
-                                                    OPUS_MAX_FRAME_SIZE, fec);
+    const size_t sample_size = ap_prc->pcmmode_.nBitPerSample / 8;
+    const size_t frame_bytes = sample_size * ap_prc->channels_;
+    OMX_U8 * p_dst = p_out->pBuffer + p_out->nOffset;
+    const size_t capacity = p_out->nAllocLen - p_out->nOffset;
+    /* Float output is decoded straight into the output buffer, if the
+       largest possible frame fits */
+    float * p_pcm = (4 == sample_size
+                     && capacity >= OPUS_MAX_FRAME_SIZE * frame_bytes)
+                      ? (float *) p_dst
+                      : ap_prc->p_out_buf_;
+    int frame_size
+      = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data, len, p_pcm,
+                                       OPUS_MAX_FRAME_SIZE, fec);
 
     if (frame_size < 0)
       {
@@ -441,17 +557,41 @@ transform_buffer (opusd_prc_t * ap_prc)
         tmp_skip
           = (ap_prc->preskip_ > frame_size) ? frame_size : ap_prc->preskip_;
         ap_prc->preskip_ -= tmp_skip;
-        output = ap_prc->p_out_buf_ + ap_prc->channels_ * tmp_skip;
+        output = p_pcm + ap_prc->channels_ * tmp_skip;
         out_len = frame_size - tmp_skip;
 
-        /* Convert to short and save to output file */
-        out = (short *) (p_out->pBuffer + p_out->nOffset);
-        for (i = 0; i < (int) out_len * ap_prc->channels_; ++i)
+        if (out_len * frame_bytes > capacity)
           {
-            out[i] = (short) float2int (
-              fmaxf (-32768, fminf (output[i] * 32768.f, 32767)));
+            TIZ_WARN (handleOf (ap_prc),
+                      "Output buffer too small [%u] - dropping [%u] frames",
+                      (unsigned int) capacity,
+                      (unsigned int) (out_len - capacity / frame_bytes));
+            out_len = capacity / frame_bytes;
           }
 
+        switch (sample_size)
+          {
+            case 4:
+              {
+                if ((OMX_U8 *) output != p_dst)
+                  {
+                    memmove (p_dst, output, out_len * frame_bytes);
+                  }
+              }
+              break;
+            case 3:
+              {
+                float_to_s24 (output, p_dst, out_len * ap_prc->channels_);
+              }
+              break;
+            default:
+              {
+                float_to_s16 (ap_prc, output, (OMX_S16 *) p_dst,
+                              out_len * ap_prc->channels_);
+              }
+              break;
+          };
+
         if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
           {
             /* Propagate EOS flag to output */
@@ -459,7 +599,7 @@ transform_buffer (opusd_prc_t * ap_prc)
             p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
           }
 
-        p_out->nFilledLen = out_len * ap_prc->channels_ * 2;
+        p_out->nFilledLen = out_len * frame_bytes;
         TIZ_TRACE (handleOf (ap_prc),
                    "frame_size [%d] len [%d] - error [%s] nFilledLen [%d]",
                    frame_size, len, opus_strerror (frame_size),
@@ -551,6 +691,16 @@ opusd_prc_ctor (void * ap_obj, va_list * app)
   reset_stream_parameters (p_prc);
   p_prc->in_port_disabled_ = false;
   p_prc->out_port_disabled_ = false;
+  p_prc->dither_
+    = (0 == tiz_rcfile_compare_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                      ARATELIA_OPUS_DECODER_COMPONENT_NAME
+                                      ".dither",
+                                      "true"));
+  /* Any non-zero seeds will do */
+  p_prc->dither_state_[0] = 0x9e3779b9;
+  p_prc->dither_state_[1] = 0x7f4a7c15;
+  p_prc->dither_state_[2] = 0x6a09e667;
+  p_prc->dither_state_[3] = 0xbb67ae85;
   TIZ_TRACE (handleOf (p_prc), "Opus library vesion [%s]",
              opus_get_version_string ());
   return p_prc;
@@ -598,8 +748,21 @@ opusd_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
                                        &(p_prc->pcmmode_)));
 
   TIZ_TRACE (handleOf (p_prc),
-             "sample rate renderer = [%d] channels renderer = [%d]",
-             p_prc->pcmmode_.nSamplingRate, p_prc->pcmmode_.nChannels);
+             "sample rate renderer = [%d] channels renderer = [%d] "
+             "bits per sample [%d]",
+             p_prc->pcmmode_.nSamplingRate, p_prc->pcmmode_.nChannels,
+             p_prc->pcmmode_.nBitPerSample);
+
+  if (16 != p_prc->pcmmode_.nBitPerSample
+      && 24 != p_prc->pcmmode_.nBitPerSample
+      && 32 != p_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_ERROR (handleOf (p_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "unsupported bits per sample [%d]",
+                 p_prc->pcmmode_.nBitPerSample);
+      return OMX_ErrorUnsupportedSetting;
+    }
 
   reset_stream_parameters (ap_obj);
   return OMX_ErrorNone;
@@ -34,6 +34,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <opus.h>
 #include <opus_multistream.h>
 
@@ -54,6 +55,8 @@ struct opusd_prc
   int mapping_family_;
   int channels_;
   int preskip_;
+  bool dither_;
+  uint32_t dither_state_[4];
   bool eos_;
   bool in_port_disabled_;
   bool out_port_disabled_;
@@ -38,6 +38,7 @@ extern "C" {
 
 /* 120ms at 48000 */
 #define OPUS_MAX_FRAME_SIZE (960 * 6)
+#define ARATELIA_OPUS_DECODER_MAX_CHANNELS 8
 
 #define ARATELIA_OPUS_DECODER_DEFAULT_ROLE OMX_ROLE_AUDIO_DECODER_OPUS
 #define ARATELIA_OPUS_DECODER_COMPONENT_NAME \
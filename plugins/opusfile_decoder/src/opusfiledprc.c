@@ -49,6 +49,44 @@
 static OMX_ERRORTYPE
 opusfiled_prc_deallocate_resources (void *);
 
+/* op_read_float delivers the channels in Vorbis order (RFC 7845, section
+   5.1.1.2), for up to ARATELIA_OPUS_DECODER_MAX_CHANNELS channels */
+static const OMX_AUDIO_CHANNELTYPE
+  vorbis_channel_order[ARATELIA_OPUS_DECODER_MAX_CHANNELS]
+                      [ARATELIA_OPUS_DECODER_MAX_CHANNELS]
+  = {
+      {OMX_AUDIO_ChannelCF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelLR,
+       OMX_AUDIO_ChannelRR},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+       OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+       OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR, OMX_AUDIO_ChannelLFE},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+       OMX_AUDIO_ChannelLS, OMX_AUDIO_ChannelRS, OMX_AUDIO_ChannelCS,
+       OMX_AUDIO_ChannelLFE},
+      {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+       OMX_AUDIO_ChannelLS, OMX_AUDIO_ChannelRS, OMX_AUDIO_ChannelLR,
+       OMX_AUDIO_ChannelRR, OMX_AUDIO_ChannelLFE},
+  };
+
+static void
+set_channel_mapping (opusfiled_prc_t * ap_prc, const OMX_U32 a_channels)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < OMX_AUDIO_MAXCHANNELS; ++i)
+    {
+      ap_prc->pcmmode_.eChannelMapping[i]
+        = (a_channels > 0 && a_channels <= ARATELIA_OPUS_DECODER_MAX_CHANNELS
+           && i < a_channels)
+            ? vorbis_channel_order[a_channels - 1][i]
+            : OMX_AUDIO_ChannelNone;
+    }
+}
+
 static OMX_ERRORTYPE
 update_pcm_mode (opusfiled_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  const OMX_U32 a_channels)
@@ -65,6 +103,7 @@ update_pcm_mode (opusfiled_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  ap_prc->pcmmode_.nChannels, a_channels);
       ap_prc->pcmmode_.nSamplingRate = a_samplerate;
       ap_prc->pcmmode_.nChannels = a_channels;
+      set_channel_mapping (ap_prc, a_channels);
       tiz_check_omx (tiz_krn_SetParameter_internal (
         tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
         OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
@@ -78,6 +117,26 @@ update_pcm_mode (opusfiled_prc_t * ap_prc, const OMX_U32 a_samplerate,
   return OMX_ErrorNone;
 }
 
+/* Streams with more channels than the output port can describe are
+   downmixed to stereo, from the first link that needs it onwards */
+static OMX_U32
+output_channels (opusfiled_prc_t * ap_prc, const int a_link)
+{
+  int channels = 0;
+  assert (ap_prc);
+  channels = op_channel_count (ap_prc->p_opus_dec_, a_link);
+  if (!ap_prc->stereo_downmix_
+      && (channels > ARATELIA_OPUS_DECODER_MAX_CHANNELS
+          || channels > OMX_AUDIO_MAXCHANNELS))
+    {
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "[%d] channels not supported : downmixing to stereo",
+                  channels);
+      ap_prc->stereo_downmix_ = true;
+    }
+  return ap_prc->stereo_downmix_ ? 2 : channels;
+}
+
 static OMX_ERRORTYPE
 allocate_temp_data_store (opusfiled_prc_t * ap_prc)
 {
@@ -166,35 +225,99 @@ store_data (opusfiled_prc_t * ap_prc)
   return rc;
 }
 
+static int
+read_from_store (opusfiled_prc_t * ap_prc, unsigned char * ap_ptr,
+                 const int a_nbytes)
+{
+  int bytes_read = 0;
+  assert (ap_prc);
+
+  if (tiz_buffer_available (ap_prc->p_store_) > ap_prc->store_offset_)
+    {
+      bytes_read = MIN (a_nbytes, tiz_buffer_available (ap_prc->p_store_)
+                                    - ap_prc->store_offset_);
+      memcpy (ap_ptr, tiz_buffer_get (ap_prc->p_store_) + ap_prc->store_offset_,
+              bytes_read);
+      if (ap_prc->decoder_inited_)
+        {
+          tiz_buffer_advance (ap_prc->p_store_, bytes_read);
+        }
+      else
+        {
+          ap_prc->store_offset_ += bytes_read;
+        }
+    }
+  return bytes_read;
+}
+
+/* Returns the current input header, if it has data in it. Empty headers are
+   returned to the upstream component straight away (this is where an EOS
+   flag carried by an empty header gets noticed). */
+static OMX_BUFFERHEADERTYPE *
+get_input_header (opusfiled_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  assert (ap_prc);
+  while ((p_in = tiz_filter_prc_get_header (
+            ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX))
+         && 0 == p_in->nFilledLen)
+    {
+      (void) release_input_header (ap_prc);
+    }
+  return p_in;
+}
+
+static bool
+input_available (opusfiled_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (tiz_buffer_available (ap_prc->p_store_) > ap_prc->store_offset_
+          || get_input_header (ap_prc));
+}
+
 static int
 read_cback (void * ap_private, unsigned char * ap_ptr, int a_nbytes)
 {
   opusfiled_prc_t * p_prc = ap_private;
   int bytes_read = 0;
 
-  (void) store_data (p_prc);
+  assert (p_prc);
+
+  if (!p_prc->decoder_inited_)
+    {
+      /* op_open_callbacks may need more data than we currently have; the
+         stream headers are staged in the store so that they can be re-read
+         from the start on the next attempt. */
+      (void) store_data (p_prc);
+    }
 
   TIZ_TRACE (handleOf (p_prc),
              "decoder_inited_ [%s] store bytes [%d] offset [%d]",
              (p_prc->decoder_inited_ ? "YES" : "NO"),
              tiz_buffer_available (p_prc->p_store_), p_prc->store_offset_);
 
-  if (tiz_buffer_available (p_prc->p_store_) > 0)
+  /* Whatever is left in the store from the header parsing goes first */
+  bytes_read = read_from_store (p_prc, ap_ptr, a_nbytes);
+
+  if (p_prc->decoder_inited_)
     {
-      bytes_read = MIN (a_nbytes, tiz_buffer_available (p_prc->p_store_)
-                                    - p_prc->store_offset_);
-      memcpy (ap_ptr, tiz_buffer_get (p_prc->p_store_) + p_prc->store_offset_,
-              bytes_read);
-      if (p_prc->decoder_inited_)
-        {
-          tiz_buffer_advance (p_prc->p_store_, bytes_read);
-        }
-      else
+      /* Then consume straight from the queued input buffers */
+      OMX_BUFFERHEADERTYPE * p_in = NULL;
+      while (bytes_read < a_nbytes && (p_in = get_input_header (p_prc)))
         {
-          p_prc->store_offset_ += bytes_read;
+          const int len = MIN (a_nbytes - bytes_read, (int) p_in->nFilledLen);
+          memcpy (ap_ptr + bytes_read, p_in->pBuffer + p_in->nOffset, len);
+          p_in->nOffset += len;
+          p_in->nFilledLen -= len;
+          bytes_read += len;
+          if (0 == p_in->nFilledLen)
+            {
+              (void) release_input_header (p_prc);
+            }
         }
     }
-  else
+
+  if (0 == bytes_read)
     {
       TIZ_TRACE (handleOf (p_prc), "Run out of compressed data");
     }
@@ -227,8 +350,8 @@ init_opus_decoder (opusfiled_prc_t * ap_prc)
                      ap_prc->store_offset_);
           ap_prc->decoder_inited_ = true;
           tiz_buffer_advance (ap_prc->p_store_, ap_prc->store_offset_);
-          tiz_check_omx (update_pcm_mode (
-            ap_prc, 48000, op_channel_count (ap_prc->p_opus_dec_, -1)));
+          tiz_check_omx (
+            update_pcm_mode (ap_prc, 48000, output_channels (ap_prc, -1)));
         }
       ap_prc->store_offset_ = 0;
     }
@@ -246,23 +369,15 @@ transform_buffer (opusfiled_prc_t * ap_prc)
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
     ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+  const bool have_input = input_available (ap_prc);
 
-  if (!store_data (ap_prc))
+  if (!have_input || NULL == p_out)
     {
-      TIZ_ERROR (handleOf (ap_prc),
-                 "[OMX_ErrorInsufficientResources] : "
-                 "Could not store all the incoming data");
-      return OMX_ErrorInsufficientResources;
-    }
-
-  if (tiz_buffer_available (ap_prc->p_store_) == 0 || NULL == p_out)
-    {
-      TIZ_TRACE (handleOf (ap_prc), "store bytes [%d] OUT HEADER [%p]",
-                 tiz_buffer_available (ap_prc->p_store_), p_out);
+      TIZ_TRACE (handleOf (ap_prc), "input [%s] OUT HEADER [%p]",
+                 have_input ? "YES" : "NO", p_out);
 
       /* Propagate the EOS flag to the next component */
-      if (tiz_buffer_available (ap_prc->p_store_) == 0 && p_out
-          && tiz_filter_prc_is_eos (ap_prc))
+      if (!have_input && p_out && tiz_filter_prc_is_eos (ap_prc))
         {
           p_out->nFlags |= OMX_BUFFERFLAG_EOS;
           tiz_filter_prc_release_header (
@@ -277,16 +392,42 @@ transform_buffer (opusfiled_prc_t * ap_prc)
 
   {
     unsigned char * p_pcm = p_out->pBuffer + p_out->nOffset;
-    const long len = p_out->nAllocLen;
+    /* op_read_float wants the buffer size in floats, across all channels */
+    const int len = (p_out->nAllocLen - p_out->nOffset) / sizeof (float);
+    const bool downmix = ap_prc->stereo_downmix_;
+    int link = -1;
     int samples_read
-      = op_read_float_stereo (ap_prc->p_opus_dec_, (float *) p_pcm, len);
-    TIZ_TRACE (handleOf (ap_prc), "samples_read [%d] ", samples_read);
+      = downmix ? op_read_float_stereo (ap_prc->p_opus_dec_, (float *) p_pcm,
+                                        len)
+                : op_read_float (ap_prc->p_opus_dec_, (float *) p_pcm, len,
+                                 &link);
+    TIZ_TRACE (handleOf (ap_prc), "samples_read [%d] link [%d]", samples_read,
+               link);
 
     if (samples_read > 0)
       {
-        p_out->nFilledLen = 2 * samples_read * sizeof (float);
-        (void) tiz_filter_prc_release_header (
-          ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+        /* A chained stream may change the channel count between links; the
+           samples just read are already laid out for the new link */
+        const OMX_U32 channels = output_channels (ap_prc, link);
+        if (downmix != ap_prc->stereo_downmix_)
+          {
+            /* This is the first link with too many channels: these samples
+               can't be delivered, but the next read will be downmixed */
+            TIZ_NOTICE (handleOf (ap_prc), "Dropping [%d] samples",
+                        samples_read);
+          }
+        else
+          {
+            tiz_check_omx (update_pcm_mode (ap_prc, 48000, channels));
+            p_out->nFilledLen = samples_read * channels * sizeof (float);
+            (void) tiz_filter_prc_release_header (
+              ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+          }
+      }
+    else if (0 == samples_read)
+      {
+        TIZ_TRACE (handleOf (ap_prc), "No more samples for now");
+        rc = OMX_ErrorNotReady;
       }
     else
       {
@@ -318,6 +459,7 @@ reset_stream_parameters (opusfiled_prc_t * ap_prc)
 {
   assert (ap_prc);
   ap_prc->decoder_inited_ = false;
+  ap_prc->stereo_downmix_ = false;
   tiz_buffer_clear (ap_prc->p_store_);
   ap_prc->store_offset_ = 0;
   tiz_filter_prc_update_eos_flag (ap_prc, false);
@@ -52,6 +52,7 @@ struct opusfiled_prc
   tiz_buffer_t * p_store_;
   OMX_U32 store_offset_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  bool stereo_downmix_;
 };
 
 typedef struct opusfiled_prc_class opusfiled_prc_class_t;
@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <tizplatform.h>
@@ -162,6 +163,106 @@ static bool store_data (sndfiled_prc_t *ap_prc)
   return rc;
 }
 
+/* Reads from the bytes left in the store, if any. The store is only filled
+   while sf_open_virtual parses the file header, as a failed open needs to
+   re-read the same bytes from the start. */
+static sf_count_t read_from_store (sndfiled_prc_t *ap_prc, void *ap_ptr,
+                                   const sf_count_t count)
+{
+  sf_count_t bytes_read = 0;
+  assert (ap_prc);
+
+  if (tiz_buffer_available (ap_prc->p_store_) > ap_prc->store_offset_)
+    {
+      bytes_read = MIN (count, tiz_buffer_available (ap_prc->p_store_)
+                               - ap_prc->store_offset_);
+      memcpy (ap_ptr, tiz_buffer_get (ap_prc->p_store_) + ap_prc->store_offset_,
+              bytes_read);
+      if (ap_prc->decoder_inited_)
+        {
+          tiz_buffer_advance (ap_prc->p_store_,
+                              bytes_read + ap_prc->store_offset_);
+          ap_prc->store_offset_ = 0;
+        }
+      else
+        {
+          ap_prc->store_offset_ += bytes_read;
+        }
+    }
+  return bytes_read;
+}
+
+/* Returns the current input header, if it has data in it. Empty headers are
+   released straight away, so that an EOS flag on them gets noticed. */
+static OMX_BUFFERHEADERTYPE *get_in_data_hdr (sndfiled_prc_t *ap_prc)
+{
+  OMX_BUFFERHEADERTYPE *p_in = NULL;
+  assert (ap_prc);
+  while ((p_in = get_in_hdr (ap_prc)) && 0 == p_in->nFilledLen)
+    {
+      (void)release_in_hdr (ap_prc);
+    }
+  return p_in;
+}
+
+static bool input_available (sndfiled_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  return (tiz_buffer_available (ap_prc->p_store_) > ap_prc->store_offset_
+          || get_in_data_hdr (ap_prc));
+}
+
+static OMX_ERRORTYPE update_pcm_mode (sndfiled_prc_t *ap_prc,
+                                      const OMX_U32 a_samplerate,
+                                      const OMX_U32 a_channels,
+                                      const OMX_U32 a_bits_per_sample)
+{
+  assert (ap_prc);
+  if (a_samplerate != ap_prc->pcmmode_.nSamplingRate
+      || a_channels != ap_prc->pcmmode_.nChannels
+      || a_bits_per_sample != ap_prc->pcmmode_.nBitPerSample)
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "Updating pcm mode : samplerate [%d] channels [%d] "
+                 "bits per sample [%d]",
+                 a_samplerate, a_channels, a_bits_per_sample);
+      ap_prc->pcmmode_.nSamplingRate = a_samplerate;
+      ap_prc->pcmmode_.nChannels = a_channels;
+      ap_prc->pcmmode_.nBitPerSample = a_bits_per_sample;
+      ap_prc->pcmmode_.eNumData = OMX_NumericalDataSigned;
+      ap_prc->pcmmode_.eEndian = OMX_EndianLittle;
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+          tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+          OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
+      tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_PCM_DECODER_OUTPUT_PORT_INDEX,
+                           OMX_IndexParamAudioPcm, /* the index of the
+                                                      struct that has
+                                                      been modififed */
+                           NULL);
+    }
+  return OMX_ErrorNone;
+}
+
+/* The output sample format that preserves the source resolution: 16-bit for
+   anything up to 16 bits (including the companded and ADPCM formats), packed
+   24-bit for 24-bit PCM, and float (nBitPerSample 32) for 32-bit PCM and the
+   floating point formats. */
+static OMX_U32 output_bits_per_sample (const int a_sf_format)
+{
+  switch (a_sf_format & SF_FORMAT_SUBMASK)
+    {
+      case SF_FORMAT_PCM_24:
+        return 24;
+      case SF_FORMAT_PCM_32:
+      case SF_FORMAT_FLOAT:
+      case SF_FORMAT_DOUBLE:
+        return 32;
+      default:
+        return 16;
+    };
+}
+
 static sf_count_t sf_io_get_filelen (void *user_data)
 {
   /* We don't know the size of the stream */
@@ -182,30 +283,37 @@ static sf_count_t sf_io_read (void *ap_ptr, sf_count_t count, void *user_data)
   assert (ap_ptr);
   assert (p_prc);
 
-  if (!tiz_filter_prc_is_eos (p_prc) && store_data (p_prc)
-      && tiz_buffer_available (p_prc->p_store_) > 0)
+  if (!p_prc->decoder_inited_)
     {
-      TIZ_TRACE (handleOf (p_prc),
-                 "count [%d] decoder_inited_ [%s] store bytes [%d] offset [%d]",
-                 count, (p_prc->decoder_inited_ ? "YES" : "NO"),
-                 tiz_buffer_available (p_prc->p_store_),
-                 p_prc->store_offset_);
-      bytes_read = MIN (count, tiz_buffer_available (p_prc->p_store_)
-                               - p_prc->store_offset_);
-      memcpy (ap_ptr,
-              tiz_buffer_get (p_prc->p_store_) + p_prc->store_offset_,
-              bytes_read);
-      if (p_prc->decoder_inited_)
-        {
-          tiz_buffer_advance (p_prc->p_store_,
-                              bytes_read + p_prc->store_offset_);
-          p_prc->store_offset_ = 0;
-        }
-      else
+      (void)store_data (p_prc);
+    }
+
+  TIZ_TRACE (handleOf (p_prc),
+             "count [%d] decoder_inited_ [%s] store bytes [%d] offset [%d]",
+             count, (p_prc->decoder_inited_ ? "YES" : "NO"),
+             tiz_buffer_available (p_prc->p_store_), p_prc->store_offset_);
+
+  bytes_read = read_from_store (p_prc, ap_ptr, count);
+
+  if (p_prc->decoder_inited_)
+    {
+      /* Serve the rest straight from the queued input buffers */
+      OMX_BUFFERHEADERTYPE *p_in = NULL;
+      while (bytes_read < count && (p_in = get_in_data_hdr (p_prc)))
         {
-          p_prc->store_offset_ += bytes_read;
+          const OMX_U32 len = MIN (count - bytes_read, p_in->nFilledLen);
+          memcpy ((OMX_U8 *)ap_ptr + bytes_read,
+                  p_in->pBuffer + p_in->nOffset, len);
+          p_in->nOffset += len;
+          p_in->nFilledLen -= len;
+          bytes_read += len;
+          if (0 == p_in->nFilledLen)
+            {
+              (void)release_in_hdr (p_prc);
+            }
         }
     }
+
   TIZ_TRACE (handleOf (p_prc), "Satisfied callback ? [%s]",
              (bytes_read == count ? "YES" : "NO"));
   return bytes_read;
@@ -249,6 +357,7 @@ static OMX_ERRORTYPE open_sf (sndfiled_prc_t *ap_prc)
               SF_INFO *p = &(ap_prc->sf_info_);
               ap_prc->decoder_inited_ = true;
               tiz_buffer_advance (ap_prc->p_store_, ap_prc->store_offset_);
+              ap_prc->store_offset_ = 0;
 
               TIZ_TRACE (handleOf (ap_prc), "frames [%d]", p->frames);
               TIZ_TRACE (handleOf (ap_prc), "samplerate [%d]", p->samplerate);
@@ -256,6 +365,8 @@ static OMX_ERRORTYPE open_sf (sndfiled_prc_t *ap_prc)
               TIZ_TRACE (handleOf (ap_prc), "format [%d]", p->format);
               TIZ_TRACE (handleOf (ap_prc), "sections [%d]", p->sections);
               TIZ_TRACE (handleOf (ap_prc), "seekable [%d]", p->seekable);
+              rc = update_pcm_mode (ap_prc, p->samplerate, p->channels,
+                                    output_bits_per_sample (p->format));
             }
         }
     }
@@ -263,24 +374,66 @@ static OMX_ERRORTYPE open_sf (sndfiled_prc_t *ap_prc)
   return rc;
 }
 
+/* Reads straight into the output buffer, in the format advertised on the
+   output port */
+static sf_count_t read_frames (sndfiled_prc_t *ap_prc,
+                               OMX_BUFFERHEADERTYPE *ap_out)
+{
+  const int channels = ap_prc->sf_info_.channels;
+  const OMX_U32 avail = ap_out->nAllocLen - ap_out->nOffset;
+  OMX_U8 *p_dst = ap_out->pBuffer + ap_out->nOffset;
+  sf_count_t num_frames = 0;
+
+  switch (ap_prc->pcmmode_.nBitPerSample)
+    {
+      case 24:
+        {
+          /* libsndfile hands out 24-bit samples left-justified in 32-bit
+             ints; pack them down to 3 bytes in place (the write position
+             never overtakes the read position) */
+          const int32_t *p_src = (const int32_t *)p_dst;
+          sf_count_t i = 0;
+          num_frames = sf_readf_int (ap_prc->p_sf_, (int *)p_dst,
+                                     avail / (sizeof(int32_t) * channels));
+          for (i = 0; i < num_frames * channels; ++i)
+            {
+              const int32_t s = p_src[i] >> 8;
+              *p_dst++ = (OMX_U8)s;
+              *p_dst++ = (OMX_U8)(s >> 8);
+              *p_dst++ = (OMX_U8)(s >> 16);
+            }
+          ap_out->nFilledLen = num_frames * 3 * channels;
+        }
+        break;
+      case 32:
+        {
+          num_frames = sf_readf_float (ap_prc->p_sf_, (float *)p_dst,
+                                       avail / (sizeof(float) * channels));
+          ap_out->nFilledLen = num_frames * sizeof(float) * channels;
+        }
+        break;
+      default:
+        {
+          num_frames = sf_readf_short (ap_prc->p_sf_, (short int *)p_dst,
+                                       avail / (sizeof(short int) * channels));
+          ap_out->nFilledLen = num_frames * sizeof(short int) * channels;
+        }
+        break;
+    };
+  return num_frames;
+}
+
 static OMX_ERRORTYPE transform_buffer (sndfiled_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNotReady;
   OMX_BUFFERHEADERTYPE *p_out = get_out_hdr (ap_prc);
 
-  (void)store_data (ap_prc);
-
   assert (ap_prc);
   assert (ap_prc->p_sf_);
 
-  if (p_out && tiz_buffer_available (ap_prc->p_store_) > 0)
+  if (p_out && input_available (ap_prc))
     {
-      size_t frame_size = sizeof(short int) * ap_prc->sf_info_.channels;
-      sf_count_t read_frames = p_out->nAllocLen / frame_size;
-      sf_count_t num_frames = sf_readf_short (
-          ap_prc->p_sf_, (short int *)(p_out->pBuffer + p_out->nOffset),
-          read_frames);
-      p_out->nFilledLen = num_frames * frame_size;
+      sf_count_t num_frames = read_frames (ap_prc, p_out);
       if (num_frames > 0 || tiz_filter_prc_is_eos (ap_prc))
         {
           (void)release_out_hdr (ap_prc);
@@ -348,7 +501,14 @@ static OMX_ERRORTYPE sndfiled_prc_deallocate_resources (void *ap_obj)
 static OMX_ERRORTYPE sndfiled_prc_prepare_to_transfer (void *ap_obj,
                                                        OMX_U32 a_pid)
 {
-  reset_stream_parameters (ap_obj);
+  sndfiled_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_PCM_DECODER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
+                                       handleOf (p_prc), OMX_IndexParamAudioPcm,
+                                       &(p_prc->pcmmode_)));
+  reset_stream_parameters (p_prc);
   return OMX_ErrorNone;
 }
 
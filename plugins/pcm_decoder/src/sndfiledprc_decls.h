@@ -51,6 +51,7 @@ struct sndfiled_prc
   bool decoder_inited_;
   tiz_buffer_t *p_store_;
   OMX_U32 store_offset_;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
 };
 
 typedef struct sndfiled_prc_class sndfiled_prc_class_t;
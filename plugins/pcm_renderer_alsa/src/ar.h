@@ -58,6 +58,11 @@ extern "C"
 
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT 20
 
+/* Buffer and period times used when no explicit period size and/or period
+   count are configured (i.e. the classic 100 ms latency profile) */
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME_US 100000
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME_US 25000
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <byteswap.h>
 
@@ -198,14 +199,14 @@ check_alsa_support_pcm_format (ar_prc_t * ap_prc,
               *ap_snd_pcm_format = SND_PCM_FORMAT_FLOAT_LE;
             }
             break;
-          case SND_PCM_FORMAT_S24:
+          case SND_PCM_FORMAT_S24_3LE:
             {
-              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_BE;
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_3BE;
             }
             break;
-          case SND_PCM_FORMAT_S24_BE:
+          case SND_PCM_FORMAT_S24_3BE:
             {
-              *ap_snd_pcm_format = SND_PCM_FORMAT_S24;
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S24_3LE;
             }
             break;
           case SND_PCM_FORMAT_S16:
@@ -272,11 +273,13 @@ retrieve_alsa_pcm_format_and_num_channels (ar_prc_t * ap_prc,
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamAudioPcm, &ap_prc->pcmmode_));
 
+  /* 24-bit samples are packed in 3 bytes; ALSA's S24 formats are 24 bits
+     in 4 bytes */
   if (ap_prc->pcmmode_.nBitPerSample == 24)
     {
       *ap_snd_pcm_format = ap_prc->pcmmode_.eEndian == OMX_EndianLittle
-                             ? SND_PCM_FORMAT_S24
-                             : SND_PCM_FORMAT_S24_BE;
+                             ? SND_PCM_FORMAT_S24_3LE
+                             : SND_PCM_FORMAT_S24_3BE;
     }
   /* NOTE: this is to allow float pcm streams coming from the the vorbis or
      opusfile decoders */
@@ -378,6 +381,166 @@ using_null_alsa_device (ar_prc_t * ap_prc)
                         OMX_MAX_STRINGNAME_SIZE));
 }
 
+static unsigned long
+get_alsa_uint_setting (const char * ap_key)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? strtoul (p_value, NULL, 10) : 0;
+}
+
+static void
+obtain_alsa_settings (ar_prc_t * ap_prc)
+{
+  const char * p_access = NULL;
+  assert (ap_prc);
+
+  /* MMAP access is preferred; 'rw' forces the snd_pcm_writei path */
+  ap_prc->access_ = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+  p_access = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                   ARATELIA_AUDIO_RENDERER_COMPONENT_NAME
+                                   ".access");
+  if (p_access && 0 == strncmp (p_access, "rw", OMX_MAX_STRINGNAME_SIZE))
+    {
+      ap_prc->access_ = SND_PCM_ACCESS_RW_INTERLEAVED;
+    }
+
+  /* A value of zero means 'use the default' */
+  ap_prc->period_size_ = get_alsa_uint_setting (
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".period_size");
+  ap_prc->period_count_ = get_alsa_uint_setting (
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".period_count");
+  ap_prc->start_threshold_ = get_alsa_uint_setting (
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".start_threshold");
+  ap_prc->avail_min_ = get_alsa_uint_setting (
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".avail_min");
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "access [%s] period_size [%lu] period_count [%u] "
+             "start_threshold [%lu] avail_min [%lu]",
+             snd_pcm_access_name (ap_prc->access_), ap_prc->period_size_,
+             ap_prc->period_count_, ap_prc->start_threshold_,
+             ap_prc->avail_min_);
+}
+
+static OMX_ERRORTYPE
+set_alsa_period (ar_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->period_size_ > 0)
+    {
+      snd_pcm_uframes_t period_size = ap_prc->period_size_;
+      bail_on_snd_pcm_error (snd_pcm_hw_params_set_period_size_near (
+        ap_prc->p_pcm_, ap_prc->p_hw_params_, &period_size, 0));
+    }
+  else
+    {
+      unsigned int period_time = ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME_US;
+      bail_on_snd_pcm_error (snd_pcm_hw_params_set_period_time_near (
+        ap_prc->p_pcm_, ap_prc->p_hw_params_, &period_time, 0));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+set_alsa_hw_params (ar_prc_t * ap_prc, const snd_pcm_format_t a_format)
+{
+  snd_pcm_t * p_pcm = NULL;
+  snd_pcm_hw_params_t * p_hw = NULL;
+  unsigned int rate = 0;
+
+  assert (ap_prc);
+  p_pcm = ap_prc->p_pcm_;
+  p_hw = ap_prc->p_hw_params_;
+  rate = ap_prc->pcmmode_.nSamplingRate;
+
+  /* Allow alsa-lib resampling */
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_rate_resample (p_pcm, p_hw, 1));
+
+  if (SND_PCM_ACCESS_MMAP_INTERLEAVED == ap_prc->access_
+      && snd_pcm_hw_params_set_access (p_pcm, p_hw,
+                                       SND_PCM_ACCESS_MMAP_INTERLEAVED)
+           < 0)
+    {
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "MMAP access not supported by the device; "
+                  "using RW access instead");
+      ap_prc->access_ = SND_PCM_ACCESS_RW_INTERLEAVED;
+    }
+
+  if (SND_PCM_ACCESS_RW_INTERLEAVED == ap_prc->access_)
+    {
+      bail_on_snd_pcm_error (snd_pcm_hw_params_set_access (
+        p_pcm, p_hw, SND_PCM_ACCESS_RW_INTERLEAVED));
+    }
+
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_format (p_pcm, p_hw, a_format));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_channels (
+    p_pcm, p_hw, ap_prc->num_channels_supported_));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_rate_near (p_pcm, p_hw, &rate, 0));
+
+  if (ap_prc->period_count_ > 0)
+    {
+      unsigned int periods = ap_prc->period_count_;
+      tiz_check_omx (set_alsa_period (ap_prc));
+      bail_on_snd_pcm_error (
+        snd_pcm_hw_params_set_periods_near (p_pcm, p_hw, &periods, 0));
+    }
+  else
+    {
+      /* Same strategy as snd_pcm_set_params: buffer time first */
+      unsigned int buffer_time = ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME_US;
+      bail_on_snd_pcm_error (
+        snd_pcm_hw_params_set_buffer_time_near (p_pcm, p_hw, &buffer_time, 0));
+      tiz_check_omx (set_alsa_period (ap_prc));
+    }
+
+  bail_on_snd_pcm_error (snd_pcm_hw_params (p_pcm, p_hw));
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+set_alsa_sw_params (ar_prc_t * ap_prc)
+{
+  snd_pcm_sw_params_t * p_sw = NULL;
+  snd_pcm_uframes_t buffer_size = 0;
+  snd_pcm_uframes_t period_size = 0;
+  snd_pcm_uframes_t start_threshold = 0;
+  snd_pcm_uframes_t avail_min = 0;
+
+  assert (ap_prc);
+
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_get_buffer_size (ap_prc->p_hw_params_, &buffer_size));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_get_period_size (
+    ap_prc->p_hw_params_, &period_size, NULL));
+
+  /* By default, start when the buffer is full (rounded down to a whole number
+     of periods) and wake up once per period */
+  start_threshold = ap_prc->start_threshold_ > 0
+                      ? MIN (ap_prc->start_threshold_, buffer_size)
+                      : (buffer_size / period_size) * period_size;
+  avail_min = ap_prc->avail_min_ > 0 ? ap_prc->avail_min_ : period_size;
+
+  snd_pcm_sw_params_alloca (&p_sw);
+  bail_on_snd_pcm_error (snd_pcm_sw_params_current (ap_prc->p_pcm_, p_sw));
+  bail_on_snd_pcm_error (snd_pcm_sw_params_set_start_threshold (
+    ap_prc->p_pcm_, p_sw, start_threshold));
+  bail_on_snd_pcm_error (
+    snd_pcm_sw_params_set_avail_min (ap_prc->p_pcm_, p_sw, avail_min));
+  bail_on_snd_pcm_error (snd_pcm_sw_params (ap_prc->p_pcm_, p_sw));
+  ap_prc->buffer_frames_ = buffer_size;
+  ap_prc->start_frames_ = start_threshold;
+
+  TIZ_DEBUG (handleOf (ap_prc),
+             "access [%s] buffer_size [%lu] period_size [%lu] "
+             "start_threshold [%lu] avail_min [%lu]",
+             snd_pcm_access_name (ap_prc->access_), buffer_size, period_size,
+             start_threshold, avail_min);
+
+  return OMX_ErrorNone;
+}
+
 static inline OMX_ERRORTYPE
 start_io_watcher (ar_prc_t * ap_prc)
 {
@@ -850,6 +1013,117 @@ arrange_samples_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
   return OMX_ErrorNone;
 }
 
+static void
+copy_frames (const ar_prc_t * ap_prc, OMX_U8 * ap_dst, const OMX_U8 * ap_src,
+             const unsigned long int a_sample_size,
+             const unsigned long int a_step, const snd_pcm_uframes_t a_frames)
+{
+  assert (ap_prc);
+  if (ap_prc->pcmmode_.nChannels < ap_prc->num_channels_supported_)
+    {
+      /* Replicate the sample on every channel supported by the device (see
+         arrange_samples_buffer) */
+      snd_pcm_uframes_t i = 0;
+      for (i = 0; i < a_frames; ++i)
+        {
+          unsigned int j = 0;
+          for (j = 0; j < ap_prc->num_channels_supported_; ++j)
+            {
+              memcpy (ap_dst, ap_src + (a_step * i), a_sample_size);
+              ap_dst += a_sample_size;
+            }
+        }
+    }
+  else
+    {
+      memcpy (ap_dst, ap_src, a_frames * a_step);
+    }
+}
+
+/* Unlike snd_pcm_writei, committing frames with snd_pcm_mmap_commit never
+   starts the device, so the start threshold is applied here */
+static void
+mmap_start_if_ready (ar_prc_t * ap_prc)
+{
+  snd_pcm_sframes_t avail = 0;
+  assert (ap_prc);
+  if (SND_PCM_STATE_PREPARED == snd_pcm_state (ap_prc->p_pcm_)
+      && (avail = snd_pcm_avail_update (ap_prc->p_pcm_)) >= 0
+      && ap_prc->buffer_frames_ - MIN ((snd_pcm_uframes_t) avail,
+                                       ap_prc->buffer_frames_)
+           >= ap_prc->start_frames_)
+    {
+      int err = snd_pcm_start (ap_prc->p_pcm_);
+      if (err < 0)
+        {
+          TIZ_WARN (handleOf (ap_prc), "snd_pcm_start error: %s",
+                    snd_strerror (err));
+        }
+    }
+}
+
+/* Write straight into the device's ring buffer. Returns the number of frames
+   written or a negative error code, like snd_pcm_writei does. */
+static snd_pcm_sframes_t
+mmap_write (ar_prc_t * ap_prc, const OMX_U8 * ap_src,
+            const unsigned long int a_sample_size,
+            const unsigned long int a_step, snd_pcm_uframes_t a_frames)
+{
+  snd_pcm_uframes_t written = 0;
+  snd_pcm_sframes_t avail = 0;
+
+  assert (ap_prc);
+  assert (ap_src);
+
+  avail = snd_pcm_avail_update (ap_prc->p_pcm_);
+  if (avail < 0)
+    {
+      return avail;
+    }
+  else if (0 == avail)
+    {
+      /* A full ring must be playing, whatever the start threshold is */
+      mmap_start_if_ready (ap_prc);
+      return -EAGAIN;
+    }
+
+  a_frames = MIN (a_frames, (snd_pcm_uframes_t) avail);
+  while (written < a_frames)
+    {
+      const snd_pcm_channel_area_t * p_areas = NULL;
+      snd_pcm_uframes_t offset = 0;
+      snd_pcm_uframes_t frames = a_frames - written;
+      snd_pcm_sframes_t committed = 0;
+      OMX_U8 * p_dst = NULL;
+      int err = snd_pcm_mmap_begin (ap_prc->p_pcm_, &p_areas, &offset, &frames);
+
+      if (err < 0)
+        {
+          return err;
+        }
+
+      /* Interleaved access: all channels share the first area */
+      p_dst = (OMX_U8 *) p_areas[0].addr + (p_areas[0].first / 8)
+              + offset * (p_areas[0].step / 8);
+      copy_frames (ap_prc, p_dst, ap_src + (written * a_step), a_sample_size,
+                   a_step, frames);
+
+      committed = snd_pcm_mmap_commit (ap_prc->p_pcm_, offset, frames);
+      if (committed < 0)
+        {
+          return committed;
+        }
+      else if ((snd_pcm_uframes_t) committed != frames)
+        {
+          return -EPIPE;
+        }
+      written += committed;
+    }
+
+  mmap_start_if_ready (ap_prc);
+  return written;
+}
+
 static OMX_ERRORTYPE
 render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
@@ -874,10 +1148,18 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
       const void * p_buffer = NULL;
       snd_pcm_sframes_t err = 0;
 
-      tiz_check_omx (arrange_samples_buffer (ap_prc, ap_hdr, sample_size, step,
-                                             samples_per_channel, &p_buffer));
-
-      err = snd_pcm_writei (ap_prc->p_pcm_, p_buffer, samples_per_channel);
+      if (SND_PCM_ACCESS_MMAP_INTERLEAVED == ap_prc->access_)
+        {
+          err = mmap_write (ap_prc, ap_hdr->pBuffer + ap_hdr->nOffset,
+                            sample_size, step, samples_per_channel);
+        }
+      else
+        {
+          tiz_check_omx (arrange_samples_buffer (ap_prc, ap_hdr, sample_size,
+                                                 step, samples_per_channel,
+                                                 &p_buffer));
+          err = snd_pcm_writei (ap_prc->p_pcm_, p_buffer, samples_per_channel);
+        }
 
       if (-EAGAIN == err)
         {
@@ -895,6 +1177,12 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
                          snd_strerror ((int) err));
               rc = OMX_ErrorUnderflow;
             }
+          else if (SND_PCM_ACCESS_MMAP_INTERLEAVED == ap_prc->access_)
+            {
+              /* The device is PREPARED again; restart it as soon as there
+                 is enough data, if it isn't there already */
+              mmap_start_if_ready (ap_prc);
+            }
         }
       else
         {
@@ -957,6 +1245,12 @@ buffer_emptied (ar_prc_t * ap_prc)
       /* Record the fact that EOS shown up. We'll signal it to the client on a
          timer event */
       ap_prc->nflags_ = ap_prc->p_inhdr_->nFlags;
+      /* Make sure that a short stream that never reached the start threshold
+         gets played too */
+      if (SND_PCM_STATE_PREPARED == snd_pcm_state (ap_prc->p_pcm_))
+        {
+          (void) snd_pcm_start (ap_prc->p_pcm_);
+        }
       tiz_check_omx (start_eos_timer (ap_prc));
     }
 
@@ -1001,6 +1295,13 @@ ar_prc_ctor (void * ap_prc, va_list * app)
   ar_prc_t * p_prc = super_ctor (typeOf (ap_prc, "arprc"), ap_prc, app);
   p_prc->p_pcm_ = NULL;
   p_prc->p_hw_params_ = NULL;
+  p_prc->access_ = SND_PCM_ACCESS_MMAP_INTERLEAVED;
+  p_prc->period_size_ = 0;
+  p_prc->period_count_ = 0;
+  p_prc->start_threshold_ = 0;
+  p_prc->avail_min_ = 0;
+  p_prc->buffer_frames_ = 0;
+  p_prc->start_frames_ = 0;
   p_prc->p_pcm_name_ = NULL;
   p_prc->p_mixer_name_ = NULL;
   p_prc->swap_byte_order_ = false;
@@ -1052,6 +1353,8 @@ ar_prc_allocate_resources (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       char * p_device = get_alsa_device (p_prc);
       assert (p_device);
 
+      obtain_alsa_settings (p_prc);
+
       /* Open a PCM in non-blocking mode */
       bail_on_snd_pcm_error (snd_pcm_open (
         &p_prc->p_pcm_, p_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK));
@@ -1114,13 +1417,10 @@ ar_prc_prepare_to_transfer (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       tiz_check_omx (retrieve_alsa_pcm_format_and_num_channels (
         p_prc, &snd_pcm_format, &p_prc->num_channels_supported_));
 
-      /* This sets the hardware and software parameters in a convenient way. */
-      bail_on_snd_pcm_error (snd_pcm_set_params (
-        p_prc->p_pcm_, snd_pcm_format, SND_PCM_ACCESS_RW_INTERLEAVED,
-        (unsigned int) p_prc->num_channels_supported_,
-        p_prc->pcmmode_.nSamplingRate, 0, /* allow alsa-lib resampling */
-        100000                            /* overall latency in us */
-        ));
+      /* Set up the hardware and software parameters, as per the access
+         mode, period and threshold settings found in the config file. */
+      tiz_check_omx (set_alsa_hw_params (p_prc, snd_pcm_format));
+      tiz_check_omx (set_alsa_sw_params (p_prc));
 
       bail_on_snd_pcm_error (snd_pcm_poll_descriptors (
         p_prc->p_pcm_, p_prc->p_fds_, p_prc->descriptor_count_));
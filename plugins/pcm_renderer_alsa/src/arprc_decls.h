@@ -50,6 +50,13 @@ extern "C"
     OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
     snd_pcm_t *p_pcm_;
     snd_pcm_hw_params_t *p_hw_params_;
+    snd_pcm_access_t access_;
+    snd_pcm_uframes_t period_size_;
+    unsigned int period_count_;
+    snd_pcm_uframes_t start_threshold_;
+    snd_pcm_uframes_t avail_min_;
+    snd_pcm_uframes_t buffer_frames_;    /* as configured on the device */
+    snd_pcm_uframes_t start_frames_;     /* as configured on the device */
     char *p_pcm_name_;
     char *p_mixer_name_;
     bool swap_byte_order_;
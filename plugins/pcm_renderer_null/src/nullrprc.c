@@ -0,0 +1,814 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   nullrprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Null PCM renderer processor class
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+#include <tizscheduler.h>
+
+#include "nullr.h"
+#include "nullrprc.h"
+#include "nullrprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.null_renderer.prc"
+#endif
+
+#define NULLR_WAV_HEADER_SIZE 44
+#define NULLR_FNV1A_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define NULLR_FNV1A_PRIME 0x100000001b3ULL
+
+/* Forward declarations */
+static OMX_ERRORTYPE
+nullr_prc_deallocate_resources (void *);
+
+static OMX_U64
+now_ns (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000000ULL + (OMX_U64) ts.tv_nsec;
+}
+
+static char *
+obtain_string_option (const char * ap_key)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE * 2];
+  const char * p_value = NULL;
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_NULL_RENDERER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  return (p_value && strlen (p_value) > 0) ? strdup (p_value) : NULL;
+}
+
+static bool
+obtain_bool_option (const char * ap_key)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE * 2];
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_NULL_RENDERER_COMPONENT_NAME,
+            ap_key);
+  return (0 == tiz_rcfile_compare_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key,
+                                         "true"));
+}
+
+static void
+obtain_options (nullr_prc_t * ap_prc)
+{
+  char * p_format = NULL;
+  assert (ap_prc);
+
+  free (ap_prc->p_out_path_);
+  free (ap_prc->p_stats_path_);
+
+  ap_prc->paced_ = obtain_bool_option ("paced");
+  ap_prc->checksum_enabled_ = obtain_bool_option ("checksum");
+  ap_prc->p_out_path_ = obtain_string_option ("output_file");
+  ap_prc->p_stats_path_ = obtain_string_option ("stats_file");
+
+  /* WAV unless 'raw' has been requested */
+  p_format = obtain_string_option ("output_format");
+  ap_prc->wav_output_ = !(p_format && 0 == strcmp (p_format, "raw"));
+  free (p_format);
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "paced [%s] checksum [%s] output [%s] (%s) stats [%s]",
+             ap_prc->paced_ ? "YES" : "NO",
+             ap_prc->checksum_enabled_ ? "YES" : "NO",
+             ap_prc->p_out_path_ ? ap_prc->p_out_path_ : "none",
+             ap_prc->wav_output_ ? "wav" : "raw",
+             ap_prc->p_stats_path_ ? ap_prc->p_stats_path_ : "none");
+}
+
+static OMX_ERRORTYPE
+obtain_pcm_mode (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_NULL_RENDERER_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc), OMX_IndexParamAudioPcm,
+    &ap_prc->pcmmode_));
+  TIZ_NOTICE (handleOf (ap_prc),
+              "nChannels = [%d] nBitPerSample = [%d] nSamplingRate = [%d] "
+              "eNumData = [%d] eEndian = [%d]",
+              ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample,
+              ap_prc->pcmmode_.nSamplingRate, ap_prc->pcmmode_.eNumData,
+              ap_prc->pcmmode_.eEndian);
+  if (ap_prc->wav_output_ && OMX_EndianLittle != ap_prc->pcmmode_.eEndian)
+    {
+      TIZ_WARN (handleOf (ap_prc),
+                "Big-endian PCM is written as-is; the WAV file will not "
+                "play correctly");
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_U64
+byte_rate (const nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (OMX_U64) ap_prc->pcmmode_.nSamplingRate * ap_prc->pcmmode_.nChannels
+         * (ap_prc->pcmmode_.nBitPerSample / 8);
+}
+
+/*
+ * Output file
+ */
+
+static void
+put_le16 (OMX_U8 * ap_dst, const OMX_U16 a_val)
+{
+  ap_dst[0] = (OMX_U8) (a_val & 0xff);
+  ap_dst[1] = (OMX_U8) (a_val >> 8);
+}
+
+static void
+put_le32 (OMX_U8 * ap_dst, const OMX_U32 a_val)
+{
+  put_le16 (ap_dst, (OMX_U16) (a_val & 0xffff));
+  put_le16 (ap_dst + 2, (OMX_U16) (a_val >> 16));
+}
+
+static OMX_ERRORTYPE
+write_wav_header (nullr_prc_t * ap_prc)
+{
+  const OMX_AUDIO_PARAM_PCMMODETYPE * p_mode = &(ap_prc->pcmmode_);
+  const OMX_U16 block_align
+    = (OMX_U16) (p_mode->nChannels * (p_mode->nBitPerSample / 8));
+  /* The data chunk size is limited to 32 bits */
+  const OMX_U32 data_bytes = ap_prc->out_data_bytes_ > 0xffffffffULL - 36
+                               ? 0xffffffffUL - 36
+                               : (OMX_U32) ap_prc->out_data_bytes_;
+  OMX_U8 hdr[NULLR_WAV_HEADER_SIZE];
+
+  assert (ap_prc);
+  assert (ap_prc->p_out_file_);
+
+  memcpy (hdr, "RIFF", 4);
+  put_le32 (hdr + 4, 36 + data_bytes);
+  memcpy (hdr + 8, "WAVEfmt ", 8);
+  put_le32 (hdr + 16, 16);
+  /* 32-bit samples are floats in this tree */
+  put_le16 (hdr + 20, 32 == p_mode->nBitPerSample
+                        ? 3  /* WAVE_FORMAT_IEEE_FLOAT */
+                        : 1); /* WAVE_FORMAT_PCM */
+  put_le16 (hdr + 22, (OMX_U16) p_mode->nChannels);
+  put_le32 (hdr + 24, p_mode->nSamplingRate);
+  put_le32 (hdr + 28, p_mode->nSamplingRate * block_align);
+  put_le16 (hdr + 32, block_align);
+  put_le16 (hdr + 34, (OMX_U16) p_mode->nBitPerSample);
+  memcpy (hdr + 36, "data", 4);
+  put_le32 (hdr + 40, data_bytes);
+
+  if (0 != fseeko (ap_prc->p_out_file_, 0, SEEK_SET)
+      || 1 != fwrite (hdr, sizeof (hdr), 1, ap_prc->p_out_file_)
+      || 0 != fseeko (ap_prc->p_out_file_, 0, SEEK_END))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "Unable to write the WAV header (%s)",
+                 strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+open_output_file (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_out_path_ && !ap_prc->p_out_file_)
+    {
+      if (!(ap_prc->p_out_file_ = fopen (ap_prc->p_out_path_, "wb")))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Unable to open [%s] (%s)",
+                     ap_prc->p_out_path_, strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_prc->out_data_bytes_ = 0;
+      if (ap_prc->wav_output_)
+        {
+          /* The header is rewritten with the final sizes on close */
+          tiz_check_omx (write_wav_header (ap_prc));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+close_output_file (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_out_file_)
+    {
+      if (ap_prc->wav_output_)
+        {
+          (void) write_wav_header (ap_prc);
+        }
+      fclose (ap_prc->p_out_file_);
+      ap_prc->p_out_file_ = NULL;
+    }
+}
+
+/*
+ * Statistics
+ */
+
+static void
+reset_stats (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->start_ns_ = 0;
+  ap_prc->bytes_ = 0;
+  ap_prc->buffers_ = 0;
+  ap_prc->underruns_ = 0;
+  ap_prc->checksum_ = NULLR_FNV1A_OFFSET_BASIS;
+}
+
+static void
+report_stats (nullr_prc_t * ap_prc)
+{
+  OMX_U64 elapsed_ns = 0;
+  double media_secs = 0.0;
+  double wall_secs = 0.0;
+  double rt_factor = 0.0;
+  const OMX_U64 rate = byte_rate (ap_prc);
+
+  assert (ap_prc);
+
+  if (0 == ap_prc->buffers_)
+    {
+      return;
+    }
+
+  elapsed_ns = now_ns () - ap_prc->start_ns_;
+  wall_secs = (double) elapsed_ns / 1e9;
+  media_secs = rate > 0 ? (double) ap_prc->bytes_ / (double) rate : 0.0;
+  rt_factor = wall_secs > 0.0 ? media_secs / wall_secs : 0.0;
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "bytes [%llu] buffers [%llu] media [%.3f s] wall [%.3f s] "
+              "throughput [%.0f bytes/s] realtime factor [%.2fx] "
+              "underruns [%u] checksum [%016llx]",
+              (unsigned long long) ap_prc->bytes_,
+              (unsigned long long) ap_prc->buffers_, media_secs, wall_secs,
+              wall_secs > 0.0 ? (double) ap_prc->bytes_ / wall_secs : 0.0,
+              rt_factor, (unsigned int) ap_prc->underruns_,
+              ap_prc->checksum_enabled_ ? (unsigned long long) ap_prc->checksum_
+                                        : 0ULL);
+
+  if (ap_prc->p_stats_path_)
+    {
+      FILE * p_file = fopen (ap_prc->p_stats_path_, "a");
+      if (p_file)
+        {
+          fprintf (p_file,
+                   "{\"component\":\"%s\",\"paced\":%s,\"bytes\":%llu,"
+                   "\"buffers\":%llu,\"media_s\":%.3f,\"elapsed_ns\":%llu,"
+                   "\"bytes_per_sec\":%.0f,\"realtime_factor\":%.2f,"
+                   "\"underruns\":%u",
+                   ARATELIA_NULL_RENDERER_COMPONENT_NAME,
+                   ap_prc->paced_ ? "true" : "false",
+                   (unsigned long long) ap_prc->bytes_,
+                   (unsigned long long) ap_prc->buffers_, media_secs,
+                   (unsigned long long) elapsed_ns,
+                   wall_secs > 0.0 ? (double) ap_prc->bytes_ / wall_secs : 0.0,
+                   rt_factor, (unsigned int) ap_prc->underruns_);
+          if (ap_prc->checksum_enabled_)
+            {
+              fprintf (p_file, ",\"checksum\":\"%016llx\"",
+                       (unsigned long long) ap_prc->checksum_);
+            }
+          fprintf (p_file, "}\n");
+          fclose (p_file);
+        }
+      else
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Unable to open [%s] (%s)",
+                     ap_prc->p_stats_path_, strerror (errno));
+        }
+    }
+
+  reset_stats (ap_prc);
+}
+
+/*
+ * Data consumption
+ */
+
+static bool
+ready_to_process (const nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (!ap_prc->paused_ && !ap_prc->port_disabled_ && !ap_prc->stopped_);
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_header (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (!ap_prc->p_inhdr_ && !ap_prc->port_disabled_)
+    {
+      (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_NULL_RENDERER_PORT_INDEX, 0,
+                                   &ap_prc->p_inhdr_);
+    }
+  return ap_prc->p_inhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_inhdr_)
+    {
+      ap_prc->p_inhdr_->nOffset = 0;
+      ap_prc->p_inhdr_->nFilledLen = 0;
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                             ARATELIA_NULL_RENDERER_PORT_INDEX,
+                                             ap_prc->p_inhdr_));
+      ap_prc->p_inhdr_ = NULL;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+consume_header (nullr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  const OMX_U8 * p_data = NULL;
+  OMX_U32 len = 0;
+
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  p_data = ap_hdr->pBuffer + ap_hdr->nOffset;
+  len = ap_hdr->nFilledLen;
+
+  if (0 == ap_prc->buffers_)
+    {
+      ap_prc->start_ns_ = now_ns ();
+    }
+  ++ap_prc->buffers_;
+  ap_prc->eos_ = false;
+  ap_prc->bytes_ += len;
+  ap_prc->played_bytes_ += len;
+
+  if (ap_prc->checksum_enabled_)
+    {
+      /* FNV-1a, 64-bit */
+      OMX_U64 hash = ap_prc->checksum_;
+      OMX_U32 i = 0;
+      for (i = 0; i < len; ++i)
+        {
+          hash ^= p_data[i];
+          hash *= NULLR_FNV1A_PRIME;
+        }
+      ap_prc->checksum_ = hash;
+    }
+
+  if (ap_prc->p_out_file_ && len > 0)
+    {
+      if (1 != fwrite (p_data, len, 1, ap_prc->p_out_file_))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Unable to write [%u] bytes (%s)",
+                     (unsigned int) len, strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_prc->out_data_bytes_ += len;
+    }
+
+  if ((ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                 ap_hdr);
+      ap_prc->eos_ = true;
+      /* The next stream re-anchors the clock */
+      ap_prc->clock_origin_ns_ = 0;
+      report_stats (ap_prc);
+      if (ap_prc->p_out_file_)
+        {
+          (void) fflush (ap_prc->p_out_file_);
+        }
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                           ARATELIA_NULL_RENDERER_PORT_INDEX, ap_hdr->nFlags,
+                           NULL);
+    }
+
+  return release_header (ap_prc);
+}
+
+/* Free-running mode: consume everything that is available */
+static OMX_ERRORTYPE
+render_all (nullr_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
+    {
+      tiz_check_omx (consume_header (ap_prc, p_hdr));
+    }
+  return OMX_ErrorNone;
+}
+
+/* Paced mode: consume what the stream's clock allows. The clock is started
+   by the first buffer; if it runs ahead of the data by more than one period,
+   that counts as an underrun and the clock is re-anchored. */
+static OMX_ERRORTYPE
+render_paced (nullr_prc_t * ap_prc)
+{
+  const OMX_U64 rate = byte_rate (ap_prc);
+  const OMX_U64 period_ns
+    = ARATELIA_NULL_RENDERER_DEFAULT_PERIOD_MS * 1000000ULL;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_U64 now = 0;
+  OMX_U64 played_ns = 0;
+
+  assert (ap_prc);
+
+  if (0 == rate)
+    {
+      return render_all (ap_prc);
+    }
+
+  while (ready_to_process (ap_prc))
+    {
+      now = now_ns ();
+      if (0 == ap_prc->clock_origin_ns_)
+        {
+          if (!get_header (ap_prc))
+            {
+              break;
+            }
+          ap_prc->clock_origin_ns_ = now;
+          ap_prc->played_bytes_ = 0;
+        }
+
+      played_ns = ap_prc->played_bytes_ * 1000000000ULL / rate;
+      if (ap_prc->clock_origin_ns_ + played_ns > now)
+        {
+          /* Ahead of the clock; wait for the next tick */
+          break;
+        }
+
+      if (!(p_hdr = get_header (ap_prc)))
+        {
+          if (!ap_prc->eos_
+              && now - (ap_prc->clock_origin_ns_ + played_ns) > period_ns)
+            {
+              ++ap_prc->underruns_;
+              TIZ_DEBUG (handleOf (ap_prc), "underrun [%u]",
+                         (unsigned int) ap_prc->underruns_);
+              ap_prc->clock_origin_ns_ = now - played_ns;
+            }
+          break;
+        }
+
+      tiz_check_omx (consume_header (ap_prc, p_hdr));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+render_pcm_data (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ap_prc->paced_ ? render_paced (ap_prc) : render_all (ap_prc);
+}
+
+static OMX_ERRORTYPE
+start_clock (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->clock_origin_ns_ = 0;
+  ap_prc->played_bytes_ = 0;
+  if (ap_prc->paced_ && ap_prc->p_ev_timer_ && !ap_prc->timer_started_)
+    {
+      const double period = ARATELIA_NULL_RENDERER_DEFAULT_PERIOD_MS / 1000.0;
+      tiz_check_omx (tiz_srv_timer_watcher_start (ap_prc, ap_prc->p_ev_timer_,
+                                                  period, period));
+      ap_prc->timer_started_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+stop_clock (nullr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && ap_prc->timer_started_)
+    {
+      (void) tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+      ap_prc->timer_started_ = false;
+    }
+}
+
+/*
+ * nullrprc
+ */
+
+static void *
+nullr_prc_ctor (void * ap_prc, va_list * app)
+{
+  nullr_prc_t * p_prc = super_ctor (typeOf (ap_prc, "nullrprc"), ap_prc, app);
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_NULL_RENDERER_PORT_INDEX);
+  p_prc->p_inhdr_ = NULL;
+  p_prc->port_disabled_ = false;
+  p_prc->paused_ = false;
+  p_prc->stopped_ = true;
+  p_prc->eos_ = false;
+  p_prc->paced_ = false;
+  p_prc->checksum_enabled_ = false;
+  p_prc->wav_output_ = true;
+  p_prc->p_out_path_ = NULL;
+  p_prc->p_stats_path_ = NULL;
+  p_prc->p_out_file_ = NULL;
+  p_prc->out_data_bytes_ = 0;
+  p_prc->p_ev_timer_ = NULL;
+  p_prc->timer_started_ = false;
+  p_prc->clock_origin_ns_ = 0;
+  p_prc->played_bytes_ = 0;
+  reset_stats (p_prc);
+  return p_prc;
+}
+
+static void *
+nullr_prc_dtor (void * ap_prc)
+{
+  (void) nullr_prc_deallocate_resources (ap_prc);
+  return super_dtor (typeOf (ap_prc, "nullrprc"), ap_prc);
+}
+
+/*
+ * from tizsrv class
+ */
+
+static OMX_ERRORTYPE
+nullr_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
+{
+  nullr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  obtain_options (p_prc);
+  if (p_prc->paced_ && !p_prc->p_ev_timer_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+    }
+  tiz_check_omx (obtain_pcm_mode (p_prc));
+  return open_output_file (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_deallocate_resources (void * ap_prc)
+{
+  nullr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  stop_clock (p_prc);
+  if (p_prc->p_ev_timer_)
+    {
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
+    }
+  close_output_file (p_prc);
+  free (p_prc->p_out_path_);
+  p_prc->p_out_path_ = NULL;
+  free (p_prc->p_stats_path_);
+  p_prc->p_stats_path_ = NULL;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullr_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
+{
+  nullr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->eos_ = false;
+  reset_stats (p_prc);
+  return obtain_pcm_mode (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid)
+{
+  nullr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  return start_clock (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_stop_and_return (void * ap_prc)
+{
+  nullr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  stop_clock (p_prc);
+  /* Streams that are stopped before the end are reported too */
+  report_stats (p_prc);
+  return release_header (p_prc);
+}
+
+/*
+ * from tizprc class
+ */
+
+static OMX_ERRORTYPE
+nullr_prc_buffers_ready (const void * ap_prc)
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  /* In paced mode, a new buffer only restarts the clock after an idle
+     period; otherwise the timer drives consumption */
+  if (ready_to_process (p_prc)
+      && (!p_prc->paced_ || 0 == p_prc->clock_origin_ns_))
+    {
+      return render_pcm_data (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullr_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
+                       void * ap_arg, const uint32_t a_id)
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  if (ready_to_process (p_prc))
+    {
+      return render_pcm_data (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullr_prc_pause (const void * ap_prc)
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_clock (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullr_prc_resume (const void * ap_prc)
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  tiz_check_omx (start_clock (p_prc));
+  return render_pcm_data (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->clock_origin_ns_ = 0;
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_port_disable (const void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_clock (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullr_prc_port_enable (const void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  nullr_prc_t * p_prc = (nullr_prc_t *) ap_prc;
+  assert (p_prc);
+  if (p_prc->port_disabled_)
+    {
+      /* The stream's format may have changed */
+      p_prc->port_disabled_ = false;
+      if (p_prc->wav_output_ && p_prc->out_data_bytes_ > 0)
+        {
+          TIZ_WARN (handleOf (p_prc),
+                    "PCM format may change mid-file; the WAV header describes "
+                    "the last format only");
+        }
+      tiz_check_omx (nullr_prc_prepare_to_transfer (p_prc, OMX_ALL));
+      if (!p_prc->stopped_)
+        {
+          tiz_check_omx (start_clock (p_prc));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+/*
+ * nullr_prc_class
+ */
+
+static void *
+nullr_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "nullrprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+nullr_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * nullrprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizprc), "nullrprc_class", classOf (tizprc),
+     sizeof (nullr_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, nullr_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return nullrprc_class;
+}
+
+void *
+nullr_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * nullrprc_class = tiz_get_type (ap_hdl, "nullrprc_class");
+  TIZ_LOG_CLASS (nullrprc_class);
+  void * nullrprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (nullrprc_class, "nullrprc", tizprc, sizeof (nullr_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, nullr_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, nullr_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, nullr_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, nullr_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, nullr_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, nullr_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, nullr_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_timer_ready, nullr_prc_timer_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, nullr_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, nullr_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, nullr_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, nullr_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, nullr_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, nullr_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return nullrprc;
+}
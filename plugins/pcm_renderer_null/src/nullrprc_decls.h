@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   nullrprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Null PCM renderer processor class declarations
+ *
+ *
+ */
+
+#ifndef NULLRPRC_DECLS_H
+#define NULLRPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <OMX_Core.h>
+
+#include <tizprc_decls.h>
+
+typedef struct nullr_prc nullr_prc_t;
+struct nullr_prc
+{
+  /* Object */
+  const tiz_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  OMX_BUFFERHEADERTYPE * p_inhdr_;
+  bool port_disabled_;
+  bool paused_;
+  bool stopped_;
+  bool eos_;
+  /* Configuration */
+  bool paced_;
+  bool checksum_enabled_;
+  bool wav_output_;
+  char * p_out_path_;
+  char * p_stats_path_;
+  FILE * p_out_file_;
+  OMX_U64 out_data_bytes_;
+  /* Pacing */
+  tiz_event_timer_t * p_ev_timer_;
+  bool timer_started_;
+  OMX_U64 clock_origin_ns_;
+  OMX_U64 played_bytes_;
+  /* Per-stream statistics */
+  OMX_U64 start_ns_;
+  OMX_U64 bytes_;
+  OMX_U64 buffers_;
+  OMX_U32 underruns_;
+  OMX_U64 checksum_;
+};
+
+typedef struct nullr_prc_class nullr_prc_class_t;
+struct nullr_prc_class
+{
+  /* Class */
+  const tiz_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NULLRPRC_DECLS_H */
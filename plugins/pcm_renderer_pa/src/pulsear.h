@@ -57,6 +57,8 @@ extern "C"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_APP_NAME    "Tizonia PulseAudio PCM Renderer"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_STREAM_NAME "Tizonia Pulseadio PCM renderer (playback stream)"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME   NULL
+/* Overall playback latency requested from the server (0 = server default) */
+#define ARATELIA_PCM_RENDERER_DEFAULT_TARGET_LATENCY_MS 100
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <tizplatform.h>
@@ -207,6 +208,8 @@ release_header (pulsear_prc_t * ap_prc)
   return OMX_ErrorNone;
 }
 
+/* Pulseaudio mainloop lock must have been acquired before calling this
+   function */
 static OMX_ERRORTYPE
 buffer_emptied (pulsear_prc_t * ap_prc)
 {
@@ -216,6 +219,13 @@ buffer_emptied (pulsear_prc_t * ap_prc)
 
   if ((ap_prc->p_inhdr_->nFlags & OMX_BUFFERFLAG_EOS) != 0)
     {
+      /* Start playing whatever is still below the prebuffering threshold */
+      pa_operation * p_op
+        = pa_stream_trigger (ap_prc->p_pa_stream_, NULL, NULL);
+      if (p_op)
+        {
+          pa_operation_unref (p_op);
+        }
       TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
                  ap_prc->p_inhdr_);
       tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag, 0,
@@ -225,41 +235,111 @@ buffer_emptied (pulsear_prc_t * ap_prc)
   return release_header (ap_prc);
 }
 
+/* Pulseaudio mainloop lock must have been acquired before calling this
+   function. Fills one of the server's memory blocks with the contents of as
+   many queued headers as will fit. Returns the number of bytes written. */
+static size_t
+write_pcm_chunk (pulsear_prc_t * ap_prc, const size_t a_writable,
+                 OMX_ERRORTYPE * ap_rc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  void * p_data = NULL;
+  size_t nbytes = a_writable;
+  size_t filled = 0;
+
+  assert (ap_prc);
+  assert (ap_rc);
+
+  /* Obtain a buffer straight from the server's memory pool, to avoid
+     pa_stream_write's intermediate copy */
+  if (pa_stream_begin_write (ap_prc->p_pa_stream_, &p_data, &nbytes) < 0
+      || !p_data)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "pa_stream_begin_write failed : %s",
+                 pa_strerror (pa_context_errno (ap_prc->p_pa_context_)));
+      return 0;
+    }
+
+  nbytes = MIN (nbytes, a_writable);
+  while (filled < nbytes && OMX_ErrorNone == *ap_rc
+         && (p_hdr = get_header (ap_prc)))
+    {
+      const size_t chunk = MIN (nbytes - filled, p_hdr->nFilledLen);
+      memcpy ((OMX_U8 *) p_data + filled, p_hdr->pBuffer + p_hdr->nOffset,
+              chunk);
+      filled += chunk;
+      p_hdr->nOffset += chunk;
+      p_hdr->nFilledLen -= chunk;
+      if (0 == p_hdr->nFilledLen)
+        {
+          *ap_rc = buffer_emptied (ap_prc);
+        }
+    }
+
+  if (filled > 0)
+    {
+      if (pa_stream_write (ap_prc->p_pa_stream_, p_data, filled, NULL, 0,
+                           PA_SEEK_RELATIVE)
+          < 0)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "pa_stream_write failed : %s",
+                     pa_strerror (pa_context_errno (ap_prc->p_pa_context_)));
+          filled = 0;
+        }
+    }
+  else
+    {
+      (void) pa_stream_cancel_write (ap_prc->p_pa_stream_);
+    }
+
+  return filled;
+}
+
 static OMX_ERRORTYPE
 render_pcm_data (pulsear_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  size_t writable = 0;
   assert (ap_prc);
 
-  while ((p_hdr = get_header (ap_prc)) && ap_prc->pa_nbytes_ > 0)
+  /* 'pa_nbytes_' is only a hint of the space available in the server; it
+     avoids taking the mainloop lock when there is known to be none */
+  if (!get_header (ap_prc) || 0 == ap_prc->pa_nbytes_)
     {
-      if (p_hdr->nFilledLen > 0)
-        {
-          const int bytes_to_write
-            = MIN (ap_prc->pa_nbytes_, p_hdr->nFilledLen);
-          assert (ap_prc->p_pa_loop_);
-          assert (ap_prc->p_pa_context_);
-
-          pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
-          int result = pa_stream_write (
-            ap_prc->p_pa_stream_, p_hdr->pBuffer + p_hdr->nOffset,
-            bytes_to_write, NULL, 0, PA_SEEK_RELATIVE);
-          /* TODO : Check return code */
-          (void) result;
-          pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
-          p_hdr->nFilledLen -= bytes_to_write;
-          p_hdr->nOffset += bytes_to_write;
-          ap_prc->pa_nbytes_ -= bytes_to_write;
-        }
+      return OMX_ErrorNone;
+    }
+
+  assert (ap_prc->p_pa_loop_);
+  assert (ap_prc->p_pa_context_);
 
+  /* Write as many headers as the server will currently take, under a single
+     lock acquisition */
+  pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
+  writable = pa_stream_writable_size (ap_prc->p_pa_stream_);
+  if ((size_t) -1 == writable)
+    {
+      writable = 0;
+    }
+  while (writable > 0 && OMX_ErrorNone == rc && (p_hdr = get_header (ap_prc)))
+    {
+      size_t written = 0;
       if (0 == p_hdr->nFilledLen)
         {
+          /* e.g. an empty EOS buffer */
           rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          continue;
+        }
+      written = write_pcm_chunk (ap_prc, writable, &rc);
+      if (0 == written)
+        {
+          break;
         }
+      writable -= written;
     }
+  pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
 
+  ap_prc->pa_nbytes_ = writable;
   return rc;
 }
 
@@ -580,6 +660,50 @@ init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
   return rc;
 }
 
+static void
+init_pulseaudio_buffer_attr (pulsear_prc_t * ap_prc,
+                             const pa_sample_spec * ap_spec,
+                             pa_buffer_attr * ap_attr)
+{
+  assert (ap_prc);
+  assert (ap_spec);
+  assert (ap_attr);
+
+  /* With PA_STREAM_ADJUST_LATENCY, tlength is the overall latency,
+     i.e. including the sink's own buffering. The server is asked for more
+     data every quarter of that, and playback starts (or resumes after an
+     underrun) once half of it is buffered. */
+  ap_attr->tlength = pa_usec_to_bytes (
+    (pa_usec_t) ap_prc->target_latency_ms_ * PA_USEC_PER_MSEC, ap_spec);
+  ap_attr->minreq = ap_attr->tlength / 4;
+  ap_attr->prebuf = ap_attr->tlength / 2;
+  ap_attr->maxlength = (uint32_t) -1;
+  ap_attr->fragsize = (uint32_t) -1;
+
+  TIZ_DEBUG (handleOf (ap_prc),
+             "target latency [%u] ms : tlength [%u] minreq [%u] prebuf [%u]",
+             ap_prc->target_latency_ms_, ap_attr->tlength, ap_attr->minreq,
+             ap_attr->prebuf);
+}
+
+static void
+obtain_target_latency (pulsear_prc_t * ap_prc)
+{
+  const char * p_latency = NULL;
+  assert (ap_prc);
+
+  ap_prc->target_latency_ms_ = ARATELIA_PCM_RENDERER_DEFAULT_TARGET_LATENCY_MS;
+  p_latency = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                    ARATELIA_PCM_RENDERER_COMPONENT_NAME
+                                    ".target_latency_ms");
+  if (p_latency)
+    {
+      ap_prc->target_latency_ms_ = strtoul (p_latency, NULL, 10);
+    }
+  TIZ_TRACE (handleOf (ap_prc), "target latency [%u] ms",
+             ap_prc->target_latency_ms_);
+}
+
 /* Pulseaudio mainloop lock must have been acquired before calling this
    function */
 static int
@@ -602,6 +726,9 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
 
   {
     pa_sample_spec spec;
+    pa_buffer_attr attr;
+    pa_buffer_attr * p_attr = NULL;
+    pa_stream_flags_t flags = PA_STREAM_NOFLAGS;
     switch (pa_context_get_state (ap_prc->p_pa_context_))
       {
         case PA_CONTEXT_UNCONNECTED:
@@ -634,13 +761,20 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
     pa_stream_set_write_callback (ap_prc->p_pa_stream_,
                                   pulseaudio_stream_write_cback, ap_prc);
 
+    if (ap_prc->target_latency_ms_ > 0)
+      {
+        init_pulseaudio_buffer_attr (ap_prc, &spec, &attr);
+        p_attr = &attr;
+        flags = PA_STREAM_ADJUST_LATENCY;
+      }
+
     goto_end_on_pa_error (pa_stream_connect_playback (
       ap_prc->p_pa_stream_,
       ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME, /* Name of the sink to
                                                        connect to, or NULL for
                                                        default */
-      NULL,   /* Buffering attributes, or NULL for default */
-      0,      /* Additional flags, or 0 for default */
+      p_attr, /* Buffering attributes, or NULL for default */
+      flags,  /* Additional flags, or 0 for default */
       NULL,   /* Initial volume, or NULL for default */
       NULL)); /* Synchronize this stream with the specified one, or NULL for
                    a standalone stream  */
@@ -973,6 +1107,7 @@ pulsear_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_pa_stream_ = NULL;
   p_prc->pa_stream_state_ = PA_STREAM_UNCONNECTED;
   p_prc->pa_nbytes_ = 0;
+  p_prc->target_latency_ms_ = ARATELIA_PCM_RENDERER_DEFAULT_TARGET_LATENCY_MS;
   p_prc->p_ev_timer_ = NULL;
   p_prc->gain_ = ARATELIA_PCM_RENDERER_DEFAULT_GAIN_VALUE;
   p_prc->volume_ = ARATELIA_PCM_RENDERER_DEFAULT_VOLUME_VALUE;
@@ -1006,6 +1141,7 @@ pulsear_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
   if (!(p_prc->p_ev_timer_))
     {
       set_volume (ap_prc, p_prc->volume_);
+      obtain_target_latency (p_prc);
       tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
       rc = init_pulseaudio (ap_prc);
     }
@@ -63,6 +63,7 @@ struct pulsear_prc
   struct pa_cvolume pa_vol_;
   pa_stream_state_t pa_stream_state_;
   size_t pa_nbytes_;
+  OMX_U32 target_latency_ms_;
   tiz_event_timer_t *p_ev_timer_;
   float gain_;
   long volume_;
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmtee.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM tee component constants
+ *
+ *
+ */
+
+#ifndef PCMTEE_H
+#define PCMTEE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#define ARATELIA_PCM_TEE_DEFAULT_ROLE             "audio_splitter.pcm"
+#define ARATELIA_PCM_TEE_COMPONENT_NAME           "OMX.Aratelia.audio_splitter.pcm"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_PCM_TEE_INPUT_PORT_INDEX         0
+#define ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX        1
+/* Maximum number of output ports; output ports are at indexes
+   ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX to ARATELIA_PCM_TEE_MAX_OUTPUTS. Unused
+   output ports are expected to be disabled by the IL client. */
+#define ARATELIA_PCM_TEE_MAX_OUTPUTS              4
+#define ARATELIA_PCM_TEE_PORT_MIN_BUF_COUNT       2
+/* Same as the mp3 encoder's input buffer size: 25ms of 16-bit stereo audio at
+   48khz */
+#define ARATELIA_PCM_TEE_PORT_MIN_BUF_SIZE        (2*4800)
+#define ARATELIA_PCM_TEE_PORT_NONCONTIGUOUS       OMX_FALSE
+#define ARATELIA_PCM_TEE_PORT_ALIGNMENT           0
+#define ARATELIA_PCM_TEE_PORT_SUPPLIERPREF        OMX_BufferSupplyInput
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif                          /* PCMTEE_H */
@@ -0,0 +1,424 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmteeprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM tee processor
+ *
+ * Each input buffer is copied to all the enabled output ports. The input
+ * buffer is only returned once every enabled output has received all of its
+ * data, hence the slowest consumer sets the pace of the whole stream.
+ *
+ * The EOS flag is not forwarded. It is reported to the IL client with
+ * OMX_EventBufferFlag instead, so that the output branches see a single
+ * continuous stream across input streams (e.g. the tracks of a playlist).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "pcmtee.h"
+#include "pcmteeprc.h"
+#include "pcmteeprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_tee.prc"
+#endif
+
+#define PCMTEE_OUT_IDX(pid) ((pid) - ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX)
+
+/* Forward declarations */
+static OMX_ERRORTYPE pcmtee_prc_deallocate_resources (void *);
+
+static void
+reset_output_offsets (pcmtee_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  memset (ap_prc->out_offsets_, 0, sizeof (ap_prc->out_offsets_));
+  memset (ap_prc->out_done_, 0, sizeof (ap_prc->out_done_));
+}
+
+static OMX_ERRORTYPE
+copy_to_output (pcmtee_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_in,
+                const OMX_U32 a_pid)
+{
+  const OMX_U32 idx = PCMTEE_OUT_IDX (a_pid);
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+
+  assert (ap_prc);
+  assert (ap_in);
+  assert (idx < ARATELIA_PCM_TEE_MAX_OUTPUTS);
+
+  if (0 == ap_in->nFilledLen)
+    {
+      /* Nothing to forward */
+      ap_prc->out_done_[idx] = true;
+    }
+
+  while (!ap_prc->out_done_[idx]
+         && (p_out = tiz_filter_prc_get_header (ap_prc, a_pid)))
+    {
+      const OMX_U32 pending = ap_in->nFilledLen - ap_prc->out_offsets_[idx];
+      const OMX_U32 space
+        = p_out->nAllocLen - (p_out->nOffset + p_out->nFilledLen);
+      const OMX_U32 nbytes = MIN (pending, space);
+
+      if (nbytes > 0)
+        {
+          memcpy (p_out->pBuffer + p_out->nOffset + p_out->nFilledLen,
+                  ap_in->pBuffer + ap_in->nOffset + ap_prc->out_offsets_[idx],
+                  nbytes);
+          p_out->nFilledLen += nbytes;
+          ap_prc->out_offsets_[idx] += nbytes;
+        }
+
+      p_out->nTimeStamp = ap_in->nTimeStamp;
+      if (ap_prc->out_offsets_[idx] == ap_in->nFilledLen)
+        {
+          ap_prc->out_done_[idx] = true;
+        }
+      tiz_check_omx (tiz_filter_prc_release_header (ap_prc, a_pid));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static bool
+all_outputs_done (pcmtee_prc_t * ap_prc)
+{
+  OMX_U32 pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX;
+  assert (ap_prc);
+  for (; pid <= ARATELIA_PCM_TEE_MAX_OUTPUTS; ++pid)
+    {
+      if (!tiz_filter_prc_is_port_disabled (ap_prc, pid)
+          && !ap_prc->out_done_[PCMTEE_OUT_IDX (pid)])
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static OMX_ERRORTYPE
+transform_buffer (pcmtee_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in
+    = tiz_filter_prc_get_header (ap_prc, ARATELIA_PCM_TEE_INPUT_PORT_INDEX);
+  OMX_U32 pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX;
+
+  assert (ap_prc);
+
+  if (!p_in)
+    {
+      return OMX_ErrorNone;
+    }
+
+  for (; pid <= ARATELIA_PCM_TEE_MAX_OUTPUTS; ++pid)
+    {
+      if (!tiz_filter_prc_is_port_disabled (ap_prc, pid))
+        {
+          tiz_check_omx (copy_to_output (ap_prc, p_in, pid));
+        }
+    }
+
+  if (all_outputs_done (ap_prc))
+    {
+      if (p_in->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                     p_in);
+          tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                               ARATELIA_PCM_TEE_INPUT_PORT_INDEX, p_in->nFlags,
+                               NULL);
+          p_in->nFlags &= ~OMX_BUFFERFLAG_EOS;
+        }
+      p_in->nFilledLen = 0;
+      reset_output_offsets (ap_prc);
+      tiz_check_omx (tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_PCM_TEE_INPUT_PORT_INDEX));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static bool
+input_pending (pcmtee_prc_t * ap_prc)
+{
+  /* There is work to do only if the input buffer is available and at least
+     one of the outputs that still need this buffer has a header */
+  OMX_U32 pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX;
+  assert (ap_prc);
+  if (!tiz_filter_prc_get_header (ap_prc, ARATELIA_PCM_TEE_INPUT_PORT_INDEX))
+    {
+      return false;
+    }
+  if (all_outputs_done (ap_prc))
+    {
+      return true;
+    }
+  for (; pid <= ARATELIA_PCM_TEE_MAX_OUTPUTS; ++pid)
+    {
+      if (!tiz_filter_prc_is_port_disabled (ap_prc, pid)
+          && !ap_prc->out_done_[PCMTEE_OUT_IDX (pid)]
+          && tiz_filter_prc_get_header (ap_prc, pid))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+static void
+reset_stream_parameters (pcmtee_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  reset_output_offsets (ap_prc);
+  tiz_filter_prc_update_eos_flag (ap_prc, false);
+}
+
+/*
+ * pcmteeprc
+ */
+
+static void *
+pcmtee_prc_ctor (void * ap_obj, va_list * app)
+{
+  pcmtee_prc_t * p_prc
+    = super_ctor (typeOf (ap_obj, "pcmteeprc"), ap_obj, app);
+  assert (p_prc);
+  reset_output_offsets (p_prc);
+  return p_prc;
+}
+
+static void *
+pcmtee_prc_dtor (void * ap_obj)
+{
+  (void) pcmtee_prc_deallocate_resources (ap_obj);
+  return super_dtor (typeOf (ap_obj, "pcmteeprc"), ap_obj);
+}
+
+/*
+ * from tizsrv class
+ */
+
+static OMX_ERRORTYPE
+pcmtee_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_deallocate_resources (void * ap_obj)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
+{
+  pcmtee_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  reset_stream_parameters (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_stop_and_return (void * ap_obj)
+{
+  pcmtee_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  reset_output_offsets (p_prc);
+  return tiz_filter_prc_release_all_headers (p_prc);
+}
+
+/*
+ * from tizprc class
+ */
+
+static OMX_ERRORTYPE
+pcmtee_prc_buffers_ready (const void * ap_prc)
+{
+  pcmtee_prc_t * p_prc = (pcmtee_prc_t *) ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_prc);
+
+  TIZ_TRACE (handleOf (p_prc), "eos [%s] ",
+             tiz_filter_prc_is_eos (p_prc) ? "YES" : "NO");
+  while (OMX_ErrorNone == rc && input_pending (p_prc))
+    {
+      rc = transform_buffer (p_prc);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
+{
+  pcmtee_prc_t * p_prc = (pcmtee_prc_t *) ap_prc;
+  assert (p_prc);
+  if (OMX_ALL == a_pid)
+    {
+      OMX_U32 pid = ARATELIA_PCM_TEE_INPUT_PORT_INDEX;
+      for (; pid <= ARATELIA_PCM_TEE_MAX_OUTPUTS; ++pid)
+        {
+          tiz_filter_prc_update_port_disabled_flag (p_prc, pid, false);
+        }
+    }
+  else
+    {
+      tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, false);
+      if (ARATELIA_PCM_TEE_INPUT_PORT_INDEX != a_pid)
+        {
+          /* A newly enabled output starts receiving data with the next input
+             buffer */
+          p_prc->out_done_[PCMTEE_OUT_IDX (a_pid)] = true;
+          p_prc->out_offsets_[PCMTEE_OUT_IDX (a_pid)] = 0;
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmtee_prc_port_disable (const void * ap_prc, OMX_U32 a_pid)
+{
+  pcmtee_prc_t * p_prc = (pcmtee_prc_t *) ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  if (OMX_ALL == a_pid)
+    {
+      OMX_U32 pid = ARATELIA_PCM_TEE_INPUT_PORT_INDEX;
+      rc = tiz_filter_prc_release_all_headers (p_prc);
+      for (; pid <= ARATELIA_PCM_TEE_MAX_OUTPUTS; ++pid)
+        {
+          tiz_filter_prc_update_port_disabled_flag (p_prc, pid, true);
+        }
+      reset_output_offsets (p_prc);
+    }
+  else
+    {
+      if (ARATELIA_PCM_TEE_INPUT_PORT_INDEX == a_pid)
+        {
+          OMX_BUFFERHEADERTYPE ** pp_in = tiz_filter_prc_get_header_ptr (
+            p_prc, ARATELIA_PCM_TEE_INPUT_PORT_INDEX);
+          if (*pp_in)
+            {
+              (*pp_in)->nFilledLen = 0;
+            }
+          reset_output_offsets (p_prc);
+        }
+      rc = tiz_filter_prc_release_header (p_prc, a_pid);
+      tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, true);
+      if (OMX_ErrorNone == rc && ARATELIA_PCM_TEE_INPUT_PORT_INDEX != a_pid)
+        {
+          /* The remaining outputs may now be able to make progress */
+          rc = pcmtee_prc_buffers_ready (p_prc);
+        }
+    }
+  return rc;
+}
+
+/*
+ * pcmtee_prc_class
+ */
+
+static void *
+pcmtee_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "pcmteeprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+pcmtee_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * pcmteeprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizfilterprc), "pcmteeprc_class", classOf (tizfilterprc),
+     sizeof (pcmtee_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, pcmtee_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return pcmteeprc_class;
+}
+
+void *
+pcmtee_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * pcmteeprc_class = tiz_get_type (ap_hdl, "pcmteeprc_class");
+  TIZ_LOG_CLASS (pcmteeprc_class);
+  void * pcmteeprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (pcmteeprc_class, "pcmteeprc", tizfilterprc, sizeof (pcmtee_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, pcmtee_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, pcmtee_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, pcmtee_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, pcmtee_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, pcmtee_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, pcmtee_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, pcmtee_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, pcmtee_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, pcmtee_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, pcmtee_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return pcmteeprc;
+}
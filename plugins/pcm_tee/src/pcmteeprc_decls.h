@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmteeprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM tee processor class decls
+ *
+ *
+ */
+
+#ifndef PCMTEEPRC_DECLS_H
+#define PCMTEEPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <tizfilterprc.h>
+#include <tizfilterprc_decls.h>
+
+#include "pcmtee.h"
+
+typedef struct pcmtee_prc pcmtee_prc_t;
+struct pcmtee_prc
+{
+  /* Object */
+  const tiz_filter_prc_t _;
+  /* Bytes of the current input buffer already copied to each output port */
+  OMX_U32 out_offsets_[ARATELIA_PCM_TEE_MAX_OUTPUTS];
+  /* Whether each output port has received all of the current input buffer */
+  bool out_done_[ARATELIA_PCM_TEE_MAX_OUTPUTS];
+};
+
+typedef struct pcmtee_prc_class pcmtee_prc_class_t;
+struct pcmtee_prc_class
+{
+  /* Class */
+  const tiz_filter_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PCMTEEPRC_DECLS_H */
@@ -0,0 +1,442 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_pcmtee.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  PCM tee unit tests
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <check.h>
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+#include <OMX_Types.h>
+
+#include <tizplatform.h>
+
+#include "pcmtee.h"
+#include "check_pcmtee.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_tee.check"
+#endif
+
+#define PCMTEE_TEST_NPORTS (1 + ARATELIA_PCM_TEE_MAX_OUTPUTS)
+/* The outputs that are used in the transfer test; the rest are disabled */
+#define PCMTEE_TEST_NOUTPUTS 2
+#define PCMTEE_TEST_MAX_BUFFERS 8
+/* Overall timeout for each of the waits, in milliseconds */
+#define PCMTEE_TEST_TIMEOUT 5000
+
+typedef struct pcmtee_test_ctx pcmtee_test_ctx_t;
+struct pcmtee_test_ctx
+{
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  OMX_STATETYPE state;
+  OMX_U32 ndisabled;
+  OMX_U32 nempty_done;
+  bool eos_reported;
+  bool error_reported;
+  OMX_U8 * p_received[PCMTEE_TEST_NPORTS];
+  OMX_U32 received_len[PCMTEE_TEST_NPORTS];
+  OMX_U32 received_cap;
+};
+
+static void
+ctx_init (pcmtee_test_ctx_t * ap_ctx, const OMX_U32 a_capacity)
+{
+  OMX_U32 i = 0;
+  assert (ap_ctx);
+  memset (ap_ctx, 0, sizeof (pcmtee_test_ctx_t));
+  fail_if (OMX_ErrorNone != tiz_mutex_init (&(ap_ctx->mutex)));
+  fail_if (OMX_ErrorNone != tiz_cond_init (&(ap_ctx->cond)));
+  ap_ctx->state = OMX_StateLoaded;
+  ap_ctx->received_cap = a_capacity;
+  for (i = 0; i < PCMTEE_TEST_NPORTS && a_capacity > 0; ++i)
+    {
+      fail_if (NULL == (ap_ctx->p_received[i] = tiz_mem_calloc (1, a_capacity)));
+    }
+}
+
+static void
+ctx_destroy (pcmtee_test_ctx_t * ap_ctx)
+{
+  OMX_U32 i = 0;
+  assert (ap_ctx);
+  for (i = 0; i < PCMTEE_TEST_NPORTS; ++i)
+    {
+      tiz_mem_free (ap_ctx->p_received[i]);
+    }
+  (void) tiz_cond_destroy (&(ap_ctx->cond));
+  (void) tiz_mutex_destroy (&(ap_ctx->mutex));
+}
+
+typedef bool (*ctx_pred_f) (const pcmtee_test_ctx_t * ap_ctx, OMX_U32 a_arg);
+
+/* Waits, with the context locked, until the predicate holds; returns false on
+   timeout */
+static bool
+ctx_wait (pcmtee_test_ctx_t * ap_ctx, ctx_pred_f apf_pred, const OMX_U32 a_arg)
+{
+  OMX_U32 waited = 0;
+  bool done = false;
+  assert (ap_ctx);
+  tiz_mutex_lock (&(ap_ctx->mutex));
+  while (!(done = apf_pred (ap_ctx, a_arg)) && waited < PCMTEE_TEST_TIMEOUT)
+    {
+      (void) tiz_cond_timedwait (&(ap_ctx->cond), &(ap_ctx->mutex), 100);
+      waited += 100;
+    }
+  tiz_mutex_unlock (&(ap_ctx->mutex));
+  return done;
+}
+
+static bool
+state_is (const pcmtee_test_ctx_t * ap_ctx, OMX_U32 a_state)
+{
+  return ap_ctx->state == (OMX_STATETYPE) a_state;
+}
+
+static bool
+ndisabled_is (const pcmtee_test_ctx_t * ap_ctx, OMX_U32 a_count)
+{
+  return ap_ctx->ndisabled == a_count;
+}
+
+static bool
+transfer_done (const pcmtee_test_ctx_t * ap_ctx, OMX_U32 a_nbytes)
+{
+  OMX_U32 pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX;
+  for (; pid < ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX + PCMTEE_TEST_NOUTPUTS;
+       ++pid)
+    {
+      if (ap_ctx->received_len[pid] < a_nbytes)
+        {
+          return false;
+        }
+    }
+  return ap_ctx->nempty_done > 0 && ap_ctx->eos_reported;
+}
+
+static OMX_ERRORTYPE
+check_EventHandler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                    OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2,
+                    OMX_PTR pEventData)
+{
+  pcmtee_test_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Component Event [%s] [%u] [%u]",
+           tiz_evt_to_str (eEvent), nData1, nData2);
+
+  tiz_mutex_lock (&(p_ctx->mutex));
+  if (OMX_EventCmdComplete == eEvent)
+    {
+      if (OMX_CommandStateSet == (OMX_COMMANDTYPE) nData1)
+        {
+          p_ctx->state = (OMX_STATETYPE) nData2;
+        }
+      else if (OMX_CommandPortDisable == (OMX_COMMANDTYPE) nData1)
+        {
+          p_ctx->ndisabled++;
+        }
+    }
+  else if (OMX_EventBufferFlag == eEvent)
+    {
+      /* The tee absorbs EOS and reports it on the input port */
+      p_ctx->eos_reported = (ARATELIA_PCM_TEE_INPUT_PORT_INDEX == nData1
+                             && (nData2 & OMX_BUFFERFLAG_EOS));
+    }
+  else if (OMX_EventError == eEvent)
+    {
+      p_ctx->error_reported = true;
+    }
+  tiz_cond_broadcast (&(p_ctx->cond));
+  tiz_mutex_unlock (&(p_ctx->mutex));
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+check_EmptyBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                       OMX_BUFFERHEADERTYPE * ap_buf)
+{
+  pcmtee_test_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+  tiz_mutex_lock (&(p_ctx->mutex));
+  p_ctx->nempty_done++;
+  tiz_cond_broadcast (&(p_ctx->cond));
+  tiz_mutex_unlock (&(p_ctx->mutex));
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+check_FillBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                      OMX_BUFFERHEADERTYPE * ap_buf)
+{
+  pcmtee_test_ctx_t * p_ctx = ap_app_data;
+  OMX_U32 pid = 0;
+  assert (p_ctx);
+  assert (ap_buf);
+  pid = ap_buf->nOutputPortIndex;
+  tiz_mutex_lock (&(p_ctx->mutex));
+  if (pid < PCMTEE_TEST_NPORTS && p_ctx->p_received[pid]
+      && p_ctx->received_len[pid] + ap_buf->nFilledLen <= p_ctx->received_cap)
+    {
+      memcpy (p_ctx->p_received[pid] + p_ctx->received_len[pid],
+              ap_buf->pBuffer + ap_buf->nOffset, ap_buf->nFilledLen);
+      p_ctx->received_len[pid] += ap_buf->nFilledLen;
+    }
+  tiz_cond_broadcast (&(p_ctx->cond));
+  tiz_mutex_unlock (&(p_ctx->mutex));
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE _check_cbacks
+  = {check_EventHandler, check_EmptyBufferDone, check_FillBufferDone};
+
+START_TEST (test_pcmtee_ports_and_role)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_PORT_PARAM_TYPE port_param;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_U8 role[OMX_MAX_STRINGNAME_SIZE];
+  pcmtee_test_ctx_t ctx;
+  OMX_U32 pid = 0;
+
+  ctx_init (&ctx, 0);
+
+  error = OMX_Init ();
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_GetHandle (&p_hdl, ARATELIA_PCM_TEE_COMPONENT_NAME, &ctx,
+                         &_check_cbacks);
+  fail_if (OMX_ErrorNone != error);
+
+  error = ((OMX_COMPONENTTYPE *) p_hdl)->ComponentRoleEnum (p_hdl, role, 0);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (0 != strcmp ((const char *) role, ARATELIA_PCM_TEE_DEFAULT_ROLE));
+
+  TIZ_INIT_OMX_STRUCT (port_param);
+  error = OMX_GetParameter (p_hdl, OMX_IndexParamAudioInit, &port_param);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (PCMTEE_TEST_NPORTS != port_param.nPorts);
+  fail_if (ARATELIA_PCM_TEE_INPUT_PORT_INDEX != port_param.nStartPortNumber);
+
+  for (pid = 0; pid < PCMTEE_TEST_NPORTS; ++pid)
+    {
+      TIZ_INIT_OMX_PORT_STRUCT (port_def, pid);
+      error = OMX_GetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+      fail_if (OMX_ErrorNone != error);
+      fail_if (OMX_PortDomainAudio != port_def.eDomain);
+      fail_if (OMX_AUDIO_CodingPCM != port_def.format.audio.eEncoding);
+      fail_if ((ARATELIA_PCM_TEE_INPUT_PORT_INDEX == pid ? OMX_DirInput
+                                                         : OMX_DirOutput)
+               != port_def.eDir);
+    }
+
+  error = OMX_FreeHandle (p_hdl);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_Deinit ();
+  fail_if (OMX_ErrorNone != error);
+
+  ctx_destroy (&ctx);
+}
+END_TEST
+
+START_TEST (test_pcmtee_fan_out)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_BUFFERHEADERTYPE * hdrs[PCMTEE_TEST_NPORTS][PCMTEE_TEST_MAX_BUFFERS];
+  OMX_U32 nbuffers = 0;
+  OMX_U32 nbytes = 0;
+  OMX_U32 pid = 0;
+  OMX_U32 i = 0;
+  pcmtee_test_ctx_t ctx;
+
+  error = OMX_Init ();
+  fail_if (OMX_ErrorNone != error);
+
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_PCM_TEE_INPUT_PORT_INDEX);
+
+  /* Room for everything the outputs may receive */
+  ctx_init (&ctx, 4 * ARATELIA_PCM_TEE_PORT_MIN_BUF_SIZE
+                    * PCMTEE_TEST_MAX_BUFFERS);
+
+  error = OMX_GetHandle (&p_hdl, ARATELIA_PCM_TEE_COMPONENT_NAME, &ctx,
+                         &_check_cbacks);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_GetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+  fail_if (OMX_ErrorNone != error);
+  nbuffers = port_def.nBufferCountActual;
+  nbytes = port_def.nBufferSize;
+  fail_if (nbuffers > PCMTEE_TEST_MAX_BUFFERS);
+
+  /* Only the first two outputs are used */
+  for (pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX + PCMTEE_TEST_NOUTPUTS;
+       pid < PCMTEE_TEST_NPORTS; ++pid)
+    {
+      error = OMX_SendCommand (p_hdl, OMX_CommandPortDisable, pid, NULL);
+      fail_if (OMX_ErrorNone != error);
+    }
+  fail_if (!ctx_wait (&ctx, ndisabled_is,
+                      PCMTEE_TEST_NPORTS - ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX
+                        - PCMTEE_TEST_NOUTPUTS));
+
+  /* Loaded -> Idle */
+  error = OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  for (pid = 0; pid <= PCMTEE_TEST_NOUTPUTS; ++pid)
+    {
+      for (i = 0; i < nbuffers; ++i)
+        {
+          error = OMX_AllocateBuffer (p_hdl, &hdrs[pid][i], pid, NULL, nbytes);
+          fail_if (OMX_ErrorNone != error);
+        }
+    }
+  fail_if (!ctx_wait (&ctx, state_is, OMX_StateIdle));
+
+  /* Idle -> Executing */
+  error
+    = OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateExecuting, NULL);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (!ctx_wait (&ctx, state_is, OMX_StateExecuting));
+
+  for (pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX; pid <= PCMTEE_TEST_NOUTPUTS;
+       ++pid)
+    {
+      for (i = 0; i < nbuffers; ++i)
+        {
+          error = OMX_FillThisBuffer (p_hdl, hdrs[pid][i]);
+          fail_if (OMX_ErrorNone != error);
+        }
+    }
+
+  /* One full input buffer, with EOS */
+  for (i = 0; i < nbytes; ++i)
+    {
+      hdrs[0][0]->pBuffer[i] = (OMX_U8) (i * 13);
+    }
+  hdrs[0][0]->nOffset = 0;
+  hdrs[0][0]->nFilledLen = nbytes;
+  hdrs[0][0]->nFlags = OMX_BUFFERFLAG_EOS;
+  error = OMX_EmptyThisBuffer (p_hdl, hdrs[0][0]);
+  fail_if (OMX_ErrorNone != error);
+
+  fail_if (!ctx_wait (&ctx, transfer_done, nbytes));
+  fail_if (ctx.error_reported);
+
+  /* Every active output got an identical copy of the input */
+  for (pid = ARATELIA_PCM_TEE_OUTPUT_PORT_INDEX; pid <= PCMTEE_TEST_NOUTPUTS;
+       ++pid)
+    {
+      fail_if (nbytes != ctx.received_len[pid]);
+      fail_if (0 != memcmp (ctx.p_received[pid], hdrs[0][0]->pBuffer, nbytes));
+    }
+
+  /* Executing -> Idle -> Loaded */
+  error = OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (!ctx_wait (&ctx, state_is, OMX_StateIdle));
+
+  error = OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+  fail_if (OMX_ErrorNone != error);
+  for (pid = 0; pid <= PCMTEE_TEST_NOUTPUTS; ++pid)
+    {
+      for (i = 0; i < nbuffers; ++i)
+        {
+          error = OMX_FreeBuffer (p_hdl, pid, hdrs[pid][i]);
+          fail_if (OMX_ErrorNone != error);
+        }
+    }
+  fail_if (!ctx_wait (&ctx, state_is, OMX_StateLoaded));
+
+  error = OMX_FreeHandle (p_hdl);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_Deinit ();
+  fail_if (OMX_ErrorNone != error);
+
+  ctx_destroy (&ctx);
+}
+END_TEST
+
+Suite *
+pcmtee_suite (void)
+{
+  TCase * tc_pcmtee;
+  Suite * s = suite_create ("libtizpcmtee");
+
+  /* test case */
+  tc_pcmtee = tcase_create ("PCM tee");
+  tcase_set_timeout (tc_pcmtee, 20);
+  tcase_add_test (tc_pcmtee, test_pcmtee_ports_and_role);
+  tcase_add_test (tc_pcmtee, test_pcmtee_fan_out);
+  suite_add_tcase (s, tc_pcmtee);
+
+  return s;
+}
+
+int
+main (void)
+{
+  int number_failed;
+  SRunner * sr = NULL;
+
+  putenv (TIZ_PLATFORM_RC_FILE_ENV);
+  sr = srunner_create (pcmtee_suite ());
+
+  tiz_log_init ();
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Tizonia - PCM tee unit tests");
+
+  srunner_run_all (sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  tiz_log_deinit ();
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
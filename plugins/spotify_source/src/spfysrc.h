@@ -53,6 +53,9 @@ extern "C" {
 #define ARATELIA_SPOTIFY_SOURCE_DEFAULT_CACHE_SECONDS 6
 #define ARATELIA_SPOTIFY_SOURCE_MIN_CACHE_SECONDS 7
 #define ARATELIA_SPOTIFY_SOURCE_MAX_CACHE_SECONDS 12
+#define ARATELIA_SPOTIFY_SOURCE_RING_SIZE_BYTES                     \
+  (((ARATELIA_SPOTIFY_SOURCE_DEFAULT_BIT_RATE_KBITS * 1000) / 8) \
+   * ARATELIA_SPOTIFY_SOURCE_MAX_CACHE_SECONDS * 2)
 
 #ifdef __cplusplus
 }
@@ -82,21 +82,14 @@ omx_preferred_bitrate_to_spfy (
   const OMX_TIZONIA_AUDIO_SPOTIFYBITRATETYPE a_bitrate_type, int * ap_bitrate);
 static void
 end_of_track_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event);
+static void
+pcm_data_available (OMX_PTR ap_prc, tiz_ring_t * ap_ring);
 
 /* The application key, specific to each project. */
 extern const uint8_t g_appkey[];
 /* The size of the application key. */
 extern const size_t g_appkey_size;
 
-typedef struct spfy_music_delivery_data spfy_music_delivery_data_t;
-struct spfy_music_delivery_data
-{
-  sp_session * p_sess;
-  sp_audioformat format;
-  void * p_frames;
-  int num_frames;
-};
-
 static OMX_S32
 ready_playlist_map_compare_func (OMX_PTR ap_key1, OMX_PTR ap_key2)
 {
@@ -244,7 +237,7 @@ static void
 reset_stream_parameters (spfysrc_prc_t * ap_prc)
 {
   assert (ap_prc);
-  tiz_buffer_clear (ap_prc->p_store_);
+  tiz_ring_clear (ap_prc->p_ring_);
   ap_prc->initial_cache_bytes_
     = ((ARATELIA_SPOTIFY_SOURCE_DEFAULT_BIT_RATE_KBITS * 1000) / 8)
       * ARATELIA_SPOTIFY_SOURCE_DEFAULT_CACHE_SECONDS;
@@ -738,7 +731,7 @@ end:
 }
 
 static OMX_ERRORTYPE
-allocate_temp_data_store (spfysrc_prc_t * ap_prc)
+allocate_pcm_ring (spfysrc_prc_t * ap_prc)
 {
   OMX_PARAM_PORTDEFINITIONTYPE port_def;
   assert (ap_prc);
@@ -746,34 +739,24 @@ allocate_temp_data_store (spfysrc_prc_t * ap_prc)
   tiz_check_omx (
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamPortDefinition, &port_def));
-  assert (ap_prc->p_store_ == NULL);
-  return tiz_buffer_init (&(ap_prc->p_store_), port_def.nBufferSize);
+  assert (ap_prc->p_ring_ == NULL);
+  /* The ring needs to be able to hold the maximum cache plus some headroom
+     for the data that libspotify delivers before a pause takes effect */
+  return tiz_ring_init (
+    &(ap_prc->p_ring_), handleOf (ap_prc), ap_prc,
+    MAX (port_def.nBufferSize, ARATELIA_SPOTIFY_SOURCE_RING_SIZE_BYTES),
+    pcm_data_available);
 }
 
 static inline void
-deallocate_temp_data_store (
+deallocate_pcm_ring (
   /*@special@ */ spfysrc_prc_t * ap_prc)
-/*@releases ap_prc->p_store_@ */
-/*@ensures isnull ap_prc->p_store_@ */
+/*@releases ap_prc->p_ring_@ */
+/*@ensures isnull ap_prc->p_ring_@ */
 {
   assert (ap_prc);
-  tiz_buffer_destroy (ap_prc->p_store_);
-  ap_prc->p_store_ = NULL;
-}
-
-static inline int
-copy_to_omx_buffer (OMX_BUFFERHEADERTYPE * ap_hdr, const void * ap_src,
-                    const int nbytes)
-{
-  int n = MIN (nbytes, ap_hdr->nAllocLen - ap_hdr->nFilledLen);
-  assert (n > 0);
-  (void) memcpy (ap_hdr->pBuffer + ap_hdr->nOffset, ap_src, n);
-  ap_hdr->nFilledLen += n;
-  ap_hdr->nOffset += n;
-  TIZ_PRINTF_DBG_YEL (
-    "HEADER [%p] nbytes [%d] alloc [%d] fill [%d] offset [%d]\n", ap_hdr, n,
-    ap_hdr->nAllocLen, ap_hdr->nFilledLen, ap_hdr->nOffset);
-  return n;
+  tiz_ring_destroy (ap_prc->p_ring_);
+  ap_prc->p_ring_ = NULL;
 }
 
 static OMX_ERRORTYPE
@@ -887,7 +870,7 @@ reevaluate_cache (spfysrc_prc_t * ap_prc)
 
   if (ap_prc->p_sp_session_ && !ap_prc->initial_cache_bytes_)
     {
-      const int current_cache_bytes = tiz_buffer_available (ap_prc->p_store_);
+      const int current_cache_bytes = tiz_ring_available (ap_prc->p_ring_);
       if (current_cache_bytes > ap_prc->max_cache_bytes_
           && !ap_prc->spotify_paused_)
         {
@@ -911,30 +894,28 @@ consume_cache (spfysrc_prc_t * ap_prc)
   /* Also, control here the delivery of the next eos flag */
   if (ap_prc->eos_ && ap_prc->bytes_till_eos_ <= 0)
     {
-      ap_prc->bytes_till_eos_ = tiz_buffer_available (ap_prc->p_store_);
+      ap_prc->bytes_till_eos_ = tiz_ring_available (ap_prc->p_ring_);
     }
 
   TIZ_TRACE (handleOf (ap_prc),
-             "store [%d] initial_cache [%d] min_cache [%d] max_cache [%d]",
-             tiz_buffer_available (ap_prc->p_store_),
+             "ring [%d] initial_cache [%d] min_cache [%d] max_cache [%d]",
+             tiz_ring_available (ap_prc->p_ring_),
              ap_prc->initial_cache_bytes_, ap_prc->min_cache_bytes_,
              ap_prc->max_cache_bytes_);
 
-  if (tiz_buffer_available (ap_prc->p_store_) > ap_prc->initial_cache_bytes_)
+  if (tiz_ring_available (ap_prc->p_ring_) > ap_prc->initial_cache_bytes_)
     {
-      int nbytes_stored = 0;
       OMX_BUFFERHEADERTYPE * p_out = NULL;
 
       /* Reset the initial size */
       ap_prc->initial_cache_bytes_ = 0;
 
-      while ((nbytes_stored = tiz_buffer_available (ap_prc->p_store_)) > 0
+      while (tiz_ring_available (ap_prc->p_ring_) > 0
              && (p_out = buffer_needed (ap_prc)) != NULL)
         {
-          int nbytes_copied = copy_to_omx_buffer (
-            p_out, tiz_buffer_get (ap_prc->p_store_), nbytes_stored);
+          /* Drain the ring straight into the OMX buffer */
+          (void) tiz_ring_read_into_hdr (ap_prc->p_ring_, p_out);
           tiz_check_omx (release_buffer (ap_prc));
-          (void) tiz_buffer_advance (ap_prc->p_store_, nbytes_copied);
           p_out = NULL;
         }
     }
@@ -1125,77 +1106,60 @@ metadata_updated (sp_session * sess)
 }
 
 static void
-music_delivery_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+detect_pcm_format (spfysrc_prc_t * ap_prc)
+{
+  OMX_U32 channels = 0;
+  OMX_U32 sample_rate = 0;
+
+  assert (ap_prc);
+
+  /* These are written from libspotify's thread before the data is pushed into
+     the ring */
+  channels = __atomic_load_n (&(ap_prc->delivery_channels_), __ATOMIC_ACQUIRE);
+  sample_rate
+    = __atomic_load_n (&(ap_prc->delivery_samplerate_), __ATOMIC_ACQUIRE);
+
+  if (channels > 0
+      && (ap_prc->auto_detect_on_ || ap_prc->num_channels_ != channels
+          || ap_prc->samplerate_ != sample_rate))
+    {
+      ap_prc->auto_detect_on_ = false;
+      ap_prc->num_channels_ = channels;
+      ap_prc->samplerate_ = sample_rate;
+      ap_prc->audio_coding_type_ = OMX_AUDIO_CodingPCM;
+      set_audio_coding_on_port (ap_prc);
+      set_pcm_audio_info_on_port (ap_prc);
+      /* And now trigger the OMX_EventPortFormatDetected and
+         OMX_EventPortSettingsChanged events or a
+         OMX_ErrorFormatNotDetected event */
+      send_port_auto_detect_events (ap_prc);
+    }
+}
+
+/**
+ * Called in the component's thread context when libspotify has written new
+ * pcm data into the ring.
+ */
+static void
+pcm_data_available (OMX_PTR ap_prc, tiz_ring_t * ap_ring)
 {
   spfysrc_prc_t * p_prc = ap_prc;
 
   assert (p_prc);
-  assert (ap_event);
+  assert (ap_ring);
 
-  TIZ_TRACE (handleOf (ap_prc), "p_data [%p] ", ap_event->p_data);
+  TIZ_TRACE (handleOf (p_prc), "spotify_paused_ [%s] ring [%d]",
+             p_prc->spotify_paused_ ? "YES" : "NO",
+             tiz_ring_available (ap_ring));
 
   /* Decide if spotify music delivery needs pause/re-start */
-  reevaluate_cache (ap_prc);
+  reevaluate_cache (p_prc);
 
-  if (!p_prc->stopping_ && ap_event->p_data)
+  if (!p_prc->stopping_)
     {
-      spfy_music_delivery_data_t * p_data = ap_event->p_data;
-      int nbytes
-        = p_data->num_frames * sizeof (int16_t) * p_data->format.channels;
-      OMX_U8 * p_in = (OMX_U8 *) p_data->p_frames;
-      OMX_BUFFERHEADERTYPE * p_out = NULL;
-
-      TIZ_TRACE (handleOf (ap_prc),
-                 "nbytes [%d] spotify_paused_ [%s] store [%d]", nbytes,
-                 p_prc->spotify_paused_ ? "YES" : "NO",
-                 tiz_buffer_available (p_prc->p_store_));
-
-      consume_cache (p_prc);
-      if (!p_prc->spotify_paused_)
-        {
-          while (nbytes > 0 && (p_out = buffer_needed (p_prc)) != NULL
-                 && !p_prc->initial_cache_bytes_)
-            {
-              int nbytes_copied = copy_to_omx_buffer (p_out, p_in, nbytes);
-              (void) release_buffer (p_prc);
-              nbytes -= nbytes_copied;
-              p_in += nbytes_copied;
-            }
-        }
-
-      if (nbytes > 0)
-        {
-          int nbytes_stored = 0;
-          if ((nbytes_stored = tiz_buffer_push (p_prc->p_store_, p_in, nbytes))
-              < nbytes)
-            {
-              TIZ_ERROR (handleOf (p_prc),
-                         "Unable to store all the data (wanted %d, "
-                         "stored %d).",
-                         nbytes, nbytes_stored);
-              assert (0);
-            }
-          nbytes -= nbytes_stored;
-        }
-      if (p_prc->auto_detect_on_
-          || p_prc->num_channels_ != p_data->format.channels
-          || p_prc->samplerate_ != p_data->format.sample_rate)
-        {
-          p_prc->auto_detect_on_ = false;
-          p_prc->num_channels_ = p_data->format.channels;
-          p_prc->samplerate_ = p_data->format.sample_rate;
-          p_prc->audio_coding_type_ = OMX_AUDIO_CodingPCM;
-          set_audio_coding_on_port (p_prc);
-          set_pcm_audio_info_on_port (p_prc);
-          /* And now trigger the OMX_EventPortFormatDetected and
-             OMX_EventPortSettingsChanged events or a
-             OMX_ErrorFormatNotDetected event */
-          send_port_auto_detect_events (p_prc);
-        }
-      tiz_mem_free (p_data->p_frames);
-      tiz_mem_free (ap_event->p_data);
+      detect_pcm_format (p_prc);
+      (void) consume_cache (p_prc);
     }
-  tiz_mem_free (ap_event);
 }
 
 /**
@@ -1207,43 +1171,32 @@ static int
 music_delivery (sp_session * sess, const sp_audioformat * format,
                 const void * frames, int num_frames)
 {
+  spfysrc_prc_t * p_prc = sp_session_userdata (sess);
   int num_frames_delivered = 0;
-  if (num_frames > 0)
-    {
-      /* We'll only send another pluggable event into the component's main
-         event queue if there are a few spaces available. Otherwise, we'll ask
-         Spotify to wait a little. */
-      if (tiz_comp_event_queue_unused_spaces (
-            handleOf (sp_session_userdata (sess)))
-          >= SPFYSRC_MIN_QUEUE_UNUSED_SPACES)
+
+  assert (p_prc);
+  assert (format);
+
+  if (num_frames > 0 && p_prc->p_ring_)
+    {
+      const size_t frame_size = sizeof (int16_t) * format->channels;
+      /* Only whole frames are written. If the ring is full, libspotify will
+         deliver the remaining frames again later. */
+      num_frames_delivered
+        = MIN ((size_t) num_frames,
+               tiz_ring_writable (p_prc->p_ring_) / frame_size);
+      if (num_frames_delivered > 0)
         {
-          spfy_music_delivery_data_t * p_data
-            = tiz_mem_calloc (1, sizeof (spfy_music_delivery_data_t));
-          if (p_data)
-            {
-              size_t pcm_buffer_len
-                = num_frames * sizeof (int16_t) * format->channels;
-              assert (sess);
-              assert (format);
-              assert (frames);
-              p_data->p_sess = sess;
-              p_data->format.sample_type = format->sample_type;
-              p_data->format.sample_rate = format->sample_rate;
-              p_data->format.channels = format->channels;
-              p_data->p_frames = tiz_mem_alloc (pcm_buffer_len);
-              memcpy (p_data->p_frames, frames, pcm_buffer_len);
-              p_data->num_frames = num_frames;
-              TIZ_PRINTF_DBG_YEL (
-                "music_delivery - num frames : %d pcm_buffer_len : %d - "
-                "spaces %d\n",
-                num_frames, pcm_buffer_len,
-                tiz_comp_event_queue_unused_spaces (
-                  handleOf (sp_session_userdata (sess))));
-              post_spotify_event (sp_session_userdata (sess),
-                                  music_delivery_handler, p_data);
-              num_frames_delivered = num_frames;
-            }
+          __atomic_store_n (&(p_prc->delivery_channels_), format->channels,
+                            __ATOMIC_RELEASE);
+          __atomic_store_n (&(p_prc->delivery_samplerate_),
+                            format->sample_rate, __ATOMIC_RELEASE);
+          (void) tiz_ring_write (p_prc->p_ring_, frames,
+                                 num_frames_delivered * frame_size);
         }
+      TIZ_PRINTF_DBG_YEL (
+        "music_delivery - num frames : %d delivered : %d - ring free %d\n",
+        num_frames, num_frames_delivered, tiz_ring_writable (p_prc->p_ring_));
     }
   return num_frames_delivered;
 }
@@ -1648,7 +1601,9 @@ spfysrc_prc_ctor (void * ap_obj, va_list * app)
   p_prc->initial_cache_bytes_ = 0;
   p_prc->min_cache_bytes_ = 0;
   p_prc->max_cache_bytes_ = 0;
-  p_prc->p_store_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->delivery_channels_ = 0;
+  p_prc->delivery_samplerate_ = 0;
   p_prc->p_ev_timer_ = NULL;
   p_prc->p_shuffle_lst_ = NULL;
   TIZ_INIT_OMX_STRUCT (p_prc->session_);
@@ -1736,7 +1691,7 @@ spfysrc_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
   assert (NULL == p_prc->p_uri_param_);
   assert (NULL == p_prc->p_shuffle_lst_);
 
-  tiz_check_omx (allocate_temp_data_store (p_prc));
+  tiz_check_omx (allocate_pcm_ring (p_prc));
   tiz_check_omx (retrieve_session_configuration (p_prc));
   tiz_check_omx (retrieve_playlist (p_prc));
   tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
@@ -1814,7 +1769,9 @@ spfysrc_prc_deallocate_resources (void * ap_prc)
   p_prc->sp_config_.cache_location = p_prc->sp_config_.settings_location = NULL;
   p_prc->spotify_inited_ = false;
 
-  deallocate_temp_data_store (p_prc);
+  /* libspotify's threads are gone by now, so it is safe to release the
+     ring */
+  deallocate_pcm_ring (p_prc);
 
   return OMX_ErrorNone;
 }
@@ -1860,13 +1817,15 @@ spfysrc_prc_buffers_ready (const void * ap_obj)
     {
       start_playback (p_prc);
     }
-  if (p_prc->transfering_ && p_prc->spotify_paused_)
+  if (p_prc->transfering_)
     {
+      /* Drain whatever was left in the ring while no buffers were
+         available */
       rc = consume_cache (p_prc);
       /* Decide if spotify music delivery needs pause/re-start */
       reevaluate_cache (p_prc);
     }
-  else
+  if (OMX_ErrorNone == rc && !(p_prc->transfering_ && p_prc->spotify_paused_))
     {
       rc = process_spotify_session_events (p_prc);
     }
@@ -39,6 +39,7 @@ extern "C" {
 #include <OMX_Core.h>
 
 #include <tizprc_decls.h>
+#include <tizring.h>
 
 typedef struct spfysrc_prc spfysrc_prc_t;
 struct spfysrc_prc
@@ -57,7 +58,10 @@ struct spfysrc_prc
   int initial_cache_bytes_;
   int min_cache_bytes_;
   int max_cache_bytes_;
-  tiz_buffer_t * p_store_; /* The component's pcm buffer */
+  tiz_ring_t * p_ring_; /* Hand-off ring for the pcm data delivered from
+                          libspotify's thread */
+  OMX_U32 delivery_channels_;   /* Written from libspotify's thread */
+  OMX_U32 delivery_samplerate_; /* Written from libspotify's thread */
   tiz_event_timer_t * p_ev_timer_;
   tiz_shuffle_lst_t * p_shuffle_lst_;
   OMX_TIZONIA_AUDIO_PARAM_SPOTIFYSESSIONTYPE session_;
@@ -29,14 +29,11 @@
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
-#include <signal.h>
 
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
 
-#include <fishsound/constants.h>
-
 #include <tizplatform.h>
 
 #include <tizkernel.h>
@@ -50,142 +47,13 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.vorbis_decoder.prc"
 #endif
 
-/* This macros assume the existence of an "ap_prc" local variable */
-#define bail_on_fish_error(expr, msg)                      \
-  do                                                       \
-    {                                                      \
-      int fish_error = FISH_SOUND_OK;                      \
-      if (FISH_SOUND_OK != (fish_error = (expr)))          \
-        {                                                  \
-          TIZ_ERROR (handleOf (ap_prc),                    \
-                     "[OMX_ErrorInsufficientResources] : " \
-                     "%s (fish error %d)",                 \
-                     msg, fish_error);                     \
-          goto end;                                        \
-        }                                                  \
-    }                                                      \
-  while (0)
+/* The identification, comment and setup headers */
+#define VORBISD_NUM_HEADER_PACKETS 3
 
 /* Forward declarations */
 static OMX_ERRORTYPE
 vorbisd_prc_deallocate_resources (void *);
 
-static OMX_ERRORTYPE
-alloc_temp_data_store (vorbisd_prc_t * ap_prc)
-{
-  OMX_PARAM_PORTDEFINITIONTYPE port_def;
-  assert (ap_prc);
-  if (!ap_prc->p_store_)
-    {
-      port_def.nSize = (OMX_U32) sizeof (OMX_PARAM_PORTDEFINITIONTYPE);
-      port_def.nVersion.nVersion = OMX_VERSION;
-      port_def.nPortIndex = ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX;
-
-      tiz_check_omx (tiz_api_GetParameter (
-        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
-        OMX_IndexParamPortDefinition, &port_def));
-
-      assert (ap_prc->p_store_ == NULL);
-      ap_prc->store_size_ = port_def.nBufferSize;
-      tiz_check_null_ret_oom (
-        (ap_prc->p_store_ = tiz_mem_alloc (ap_prc->store_size_)));
-    }
-  return OMX_ErrorNone;
-}
-
-static inline void
-dealloc_temp_data_store (
-  /*@special@ */ vorbisd_prc_t * ap_prc)
-/*@releases ap_prc->p_store_@ */
-/*@ensures isnull ap_prc->p_store_@ */
-{
-  assert (ap_prc);
-  tiz_mem_free (ap_prc->p_store_);
-  ap_prc->p_store_ = NULL;
-  ap_prc->store_size_ = 0;
-  ap_prc->store_offset_ = 0;
-}
-
-static inline OMX_U8 **
-get_store_ptr (vorbisd_prc_t * ap_prc)
-{
-  assert (ap_prc);
-  return &(ap_prc->p_store_);
-}
-
-static inline OMX_U32 *
-get_store_size_ptr (vorbisd_prc_t * ap_prc)
-{
-  assert (ap_prc);
-  return &(ap_prc->store_size_);
-}
-
-static inline OMX_U32 *
-get_store_offset_ptr (vorbisd_prc_t * ap_prc)
-{
-  assert (ap_prc);
-  return &(ap_prc->store_offset_);
-}
-
-static int
-store_data (vorbisd_prc_t * ap_prc, const OMX_U8 * ap_data, OMX_U32 a_nbytes)
-{
-  OMX_U8 ** pp_store = NULL;
-  OMX_U32 * p_offset = NULL;
-  OMX_U32 * p_size = NULL;
-  OMX_U32 nbytes_to_copy = 0;
-  OMX_U32 nbytes_avail = 0;
-
-  assert (ap_prc);
-  assert (ap_data);
-
-  pp_store = get_store_ptr (ap_prc);
-  p_size = get_store_size_ptr (ap_prc);
-  p_offset = get_store_offset_ptr (ap_prc);
-
-  assert (pp_store && *pp_store);
-  assert (p_size);
-  assert (p_offset);
-
-  nbytes_avail = *p_size - *p_offset;
-
-  if (a_nbytes > nbytes_avail)
-    {
-      /* need to re-alloc */
-      OMX_U8 * p_new_store = NULL;
-      p_new_store = tiz_mem_realloc (*pp_store, *p_offset + a_nbytes);
-      if (p_new_store)
-        {
-          *pp_store = p_new_store;
-          *p_size = *p_offset + a_nbytes;
-          nbytes_avail = *p_size - *p_offset;
-          TIZ_TRACE (handleOf (ap_prc),
-                     "Realloc'd data store "
-                     "to new size [%d]",
-                     *p_size);
-        }
-    }
-  nbytes_to_copy = MIN (nbytes_avail, a_nbytes);
-  memcpy (*pp_store + *p_offset, ap_data, nbytes_to_copy);
-  *p_offset += nbytes_to_copy;
-
-  TIZ_TRACE (handleOf (ap_prc), "bytes currently stored [%d]", *p_offset);
-
-  return a_nbytes - nbytes_to_copy;
-}
-
-static inline void
-write_frame_float_ilv (float * to, const float * from, const int channels)
-{
-  int i = 0;
-  assert (to);
-  assert (from);
-  for (i = 0; i < channels; ++i)
-    {
-      to[i] = from[i];
-    }
-}
-
 static OMX_ERRORTYPE
 update_pcm_mode (vorbisd_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  const OMX_U32 a_channels)
@@ -273,8 +141,8 @@ store_stream_metadata (vorbisd_prc_t * ap_prc)
 
     (void) tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
 
-    snprintf (info, 99, "%d Ch, %d Hz", ap_prc->fsinfo_.channels,
-              ap_prc->fsinfo_.samplerate);
+    snprintf (info, 99, "%d Ch, %ld Hz", ap_prc->vi_.channels,
+              ap_prc->vi_.rate);
     info[99] = '\000';
     (void) store_metadata (ap_prc, "Vorbis Stream", info);
   }
@@ -288,241 +156,194 @@ store_stream_metadata (vorbisd_prc_t * ap_prc)
                               NULL);
 }
 
-static int
-fishsound_decoded_callback (FishSound * ap_fsound, float * app_pcm[],
-                            long frames, void * ap_user_data)
+static OMX_ERRORTYPE
+init_vorbis_decoder (vorbisd_prc_t * ap_prc)
 {
-  int rc = FISH_SOUND_CONTINUE;
-  vorbisd_prc_t * p_prc = ap_user_data;
-  OMX_BUFFERHEADERTYPE * p_out = NULL;
-
-  (void) ap_fsound;
-  assert (app_pcm);
-  assert (ap_user_data);
-
-  TIZ_PRINTF_DBG_RED ("frames [%d] \n", frames);
-
-  /* Possible return values are: */
-
-  /* FISH_SOUND_CONTINUE Continue decoding */
-  /* FISH_SOUND_STOP_OK Stop decoding immediately and return control to the
-     fish_sound_decode() caller */
-  /* FISH_SOUND_STOP_ERR Stop decoding immediately, purge buffered data, and
-     return control to the fish_sound_decode() caller */
-
-  if (!p_prc->started_)
+  assert (ap_prc);
+  if (!ap_prc->decoder_inited_)
     {
-      p_prc->started_ = true;
-      fish_sound_command (p_prc->p_fsnd_, FISH_SOUND_GET_INFO,
-                          &(p_prc->fsinfo_), sizeof (FishSoundInfo));
-      if (p_prc->fsinfo_.channels > 2
-          || p_prc->fsinfo_.format != FISH_SOUND_VORBIS)
-        {
-          TIZ_ERROR (handleOf (p_prc),
-                     "Supported Vorbis "
-                     "streams up tp 2 channels only.");
-          rc = FISH_SOUND_STOP_ERR;
-          goto end;
-        }
-      TIZ_NOTICE (handleOf (p_prc), "Channels [%d] sampling rate [%d]",
-                  p_prc->fsinfo_.channels, p_prc->fsinfo_.samplerate);
-      store_stream_metadata (p_prc);
-      (void) update_pcm_mode (p_prc, p_prc->fsinfo_.samplerate,
-                              p_prc->fsinfo_.channels);
+      vorbis_info_init (&(ap_prc->vi_));
+      vorbis_comment_init (&(ap_prc->vc_));
+      ap_prc->decoder_inited_ = true;
     }
+  ap_prc->packetno_ = 0;
+  return OMX_ErrorNone;
+}
 
-  p_out = tiz_filter_prc_get_header (p_prc,
-                                     ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
-  if (!p_out)
+static void
+deinit_vorbis_decoder (vorbisd_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->synthesis_inited_)
     {
-      TIZ_TRACE (handleOf (p_prc),
-                 "No more output buffers "
-                 "available at the moment");
-      rc = FISH_SOUND_STOP_OK;
-      goto end;
+      vorbis_block_clear (&(ap_prc->vb_));
+      vorbis_dsp_clear (&(ap_prc->vd_));
+      ap_prc->synthesis_inited_ = false;
+    }
+  if (ap_prc->decoder_inited_)
+    {
+      vorbis_comment_clear (&(ap_prc->vc_));
+      vorbis_info_clear (&(ap_prc->vi_));
+      ap_prc->decoder_inited_ = false;
     }
-
-  {
-    /* write decoded PCM samples */
-    size_t i = 0;
-    size_t frame_len = sizeof (float) * p_prc->fsinfo_.channels;
-    size_t frames_alloc = ((p_out->nAllocLen - p_out->nOffset) / frame_len);
-    size_t frames_to_write = (frames > frames_alloc) ? frames_alloc : frames;
-    size_t bytes_to_write = frames_to_write * frame_len;
-    assert (p_out);
-
-    for (i = 0; i < frames_to_write; ++i)
-      {
-        size_t frame_offset = i * frame_len;
-        size_t float_offset = i * p_prc->fsinfo_.channels;
-        float * out
-          = (float *) (p_out->pBuffer + p_out->nOffset + frame_offset);
-        write_frame_float_ilv (out, ((float *) app_pcm) + float_offset,
-                               p_prc->fsinfo_.channels);
-      }
-    p_out->nFilledLen += bytes_to_write;
-    p_out->nOffset += bytes_to_write;
-
-    if (frames_to_write < frames)
-      {
-        /* Temporarily store the data until an omx buffer is
-         * available */
-        OMX_U32 nbytes_remaining = (frames - frames_to_write) * frame_len;
-        TIZ_TRACE (handleOf (p_prc), "Need to store [%d] bytes",
-                   nbytes_remaining);
-        nbytes_remaining = store_data (
-          p_prc, (OMX_U8 *) (app_pcm[frames_to_write * sizeof (float)]),
-          nbytes_remaining);
-      }
-
-    if (tiz_filter_prc_is_eos (p_prc))
-      {
-        /* Propagate EOS flag to output */
-        p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-        tiz_filter_prc_update_eos_flag (p_prc, false);
-        TIZ_TRACE (handleOf (p_prc), "Propagating EOS flag to output");
-      }
-    /* TODO: Shouldn't ignore this rc */
-    (void) tiz_filter_prc_release_header (
-      p_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
-    /* Let's process one input buffer at a time, for now */
-    rc = FISH_SOUND_STOP_OK;
-  }
-
-end:
-
-  return rc;
 }
 
 static OMX_ERRORTYPE
-init_vorbis_decoder (vorbisd_prc_t * ap_prc)
+start_synthesis (vorbisd_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   assert (ap_prc);
-  assert (!ap_prc->p_fsnd_);
-
-  ap_prc->p_fsnd_ = fish_sound_new (FISH_SOUND_DECODE, &(ap_prc->fsinfo_));
-  tiz_check_null_ret_oom (ap_prc->p_fsnd_);
-
-  bail_on_fish_error (fish_sound_set_decoded_float_ilv (
-                        ap_prc->p_fsnd_, fishsound_decoded_callback, ap_prc),
-                      "Could not set the 'decoded' callback.");
-
-  rc = OMX_ErrorNone;
-
-end:
+  assert (!ap_prc->synthesis_inited_);
 
-  if (OMX_ErrorInsufficientResources == rc && ap_prc->p_fsnd_)
+  if (ap_prc->vi_.channels > 2)
     {
-      fish_sound_delete (ap_prc->p_fsnd_);
-      ap_prc->p_fsnd_ = NULL;
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorStreamCorruptFatal] : Supported Vorbis "
+                 "streams up to 2 channels only.");
+      return OMX_ErrorStreamCorruptFatal;
     }
 
-  return rc;
+  if (0 != vorbis_synthesis_init (&(ap_prc->vd_), &(ap_prc->vi_)))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Could not initialise the vorbis synthesis state.");
+      return OMX_ErrorInsufficientResources;
+    }
+  (void) vorbis_block_init (&(ap_prc->vd_), &(ap_prc->vb_));
+  ap_prc->synthesis_inited_ = true;
+  ap_prc->started_ = true;
+
+  TIZ_NOTICE (handleOf (ap_prc), "Channels [%d] sampling rate [%ld]",
+              ap_prc->vi_.channels, ap_prc->vi_.rate);
+  store_stream_metadata (ap_prc);
+  return update_pcm_mode (ap_prc, ap_prc->vi_.rate, ap_prc->vi_.channels);
 }
 
 static OMX_ERRORTYPE
-transform_buffer (vorbisd_prc_t * ap_prc)
+decode_packet (vorbisd_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_in)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE * p_in = tiz_filter_prc_get_header (
-    ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX);
-  OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
-    ap_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
+  ogg_packet op;
+  int vorbis_rc = 0;
 
-  if (!p_in || !p_out)
+  assert (ap_prc);
+  assert (ap_in);
+  assert (ap_prc->decoder_inited_);
+
+  /* The demuxer delivers one vorbis packet per buffer */
+  op.packet = ap_in->pBuffer + ap_in->nOffset;
+  op.bytes = ap_in->nFilledLen;
+  op.b_o_s = (0 == ap_prc->packetno_) ? 1 : 0;
+  op.e_o_s = 0;
+  op.granulepos = -1;
+  op.packetno = ap_prc->packetno_++;
+
+  if (!ap_prc->started_)
     {
-      TIZ_TRACE (handleOf (ap_prc), "IN HEADER [%p] OUT HEADER [%p]", p_in,
-                 p_out);
+      if (0 > (vorbis_rc = vorbis_synthesis_headerin (
+                 &(ap_prc->vi_), &(ap_prc->vc_), &op)))
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[OMX_ErrorStreamCorruptFatal] : "
+                     "Invalid vorbis header packet [%ld] (vorbis error %d)",
+                     (long) op.packetno, vorbis_rc);
+          return OMX_ErrorStreamCorruptFatal;
+        }
+      if (VORBISD_NUM_HEADER_PACKETS == ap_prc->packetno_)
+        {
+          return start_synthesis (ap_prc);
+        }
       return OMX_ErrorNone;
     }
 
+  if (0 == (vorbis_rc = vorbis_synthesis (&(ap_prc->vb_), &op)))
+    {
+      (void) vorbis_synthesis_blockin (&(ap_prc->vd_), &(ap_prc->vb_));
+    }
+  else
+    {
+      /* OV_ENOTAUDIO or OV_EBADPACKET; the packet is simply skipped */
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "Skipping packet [%ld] (vorbis error %d)",
+                  (long) op.packetno, vorbis_rc);
+    }
+  return OMX_ErrorNone;
+}
+
+static inline bool
+pcm_pending (vorbisd_prc_t * ap_prc)
+{
   assert (ap_prc);
+  return (ap_prc->synthesis_inited_
+          && vorbis_synthesis_pcmout (&(ap_prc->vd_), NULL) > 0);
+}
 
-  TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFilledLen [%d] nFlags [%d] ",
-             p_in, p_in->nFilledLen, p_in->nFlags);
+/* Interleaves the decoded audio straight from libvorbis' own planar buffers
+   into as many output buffers as it takes. Whatever doesn't fit stays in
+   libvorbis until the next output buffer arrives. */
+static OMX_ERRORTYPE
+write_pcm (vorbisd_prc_t * ap_prc)
+{
+  float ** pp_pcm = NULL;
+  int frames = 0;
+
+  assert (ap_prc);
 
-  if (0 == p_in->nFilledLen)
+  while (ap_prc->synthesis_inited_
+         && (frames = vorbis_synthesis_pcmout (&(ap_prc->vd_), &pp_pcm)) > 0)
     {
-      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
-                 p_in->nFlags);
-      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+      const int channels = ap_prc->vi_.channels;
+      const OMX_U32 frame_len = sizeof (float) * channels;
+      OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
+        ap_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
+      OMX_U32 room = 0;
+      int nframes = 0;
+      int i = 0;
+      int c = 0;
+      float * p_dst = NULL;
+
+      if (!p_out)
         {
-          /* Inmediately propagate EOS flag to output */
-          TIZ_TRACE (handleOf (ap_prc), "Let's propagate EOS flag to output");
-          p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-          p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
-          tiz_check_omx (tiz_filter_prc_release_header (
-            ap_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX));
+          TIZ_TRACE (handleOf (ap_prc),
+                     "No more output buffers available at the moment");
+          return OMX_ErrorNotReady;
         }
-    }
-  /*   raise(SIGTRAP); */
 
-  if (p_in->nFilledLen > 0)
-    {
-      unsigned char * p_data = p_in->pBuffer + p_in->nOffset;
-      const long len = p_in->nFilledLen;
-      long bytes_consumed = fish_sound_decode (ap_prc->p_fsnd_, p_data, len);
-      TIZ_TRACE (handleOf (ap_prc), "p_in->nFilledLen [%d] ", p_in->nFilledLen);
-      TIZ_TRACE (handleOf (ap_prc), "bytes_consumed [%d] ", bytes_consumed);
+      assert (p_out->nAllocLen >= p_out->nOffset + p_out->nFilledLen);
+      room = (p_out->nAllocLen - p_out->nOffset - p_out->nFilledLen)
+             / frame_len;
+      nframes = MIN (frames, (int) room);
+      p_dst = (float *) (p_out->pBuffer + p_out->nOffset + p_out->nFilledLen);
 
-      if (bytes_consumed >= 0)
+      for (i = 0; i < nframes; ++i)
         {
-          assert (p_in->nFilledLen >= bytes_consumed);
-          p_in->nFilledLen = 0;
-          p_in->nOffset = 0;
+          for (c = 0; c < channels; ++c)
+            {
+              *p_dst++ = pp_pcm[c][i];
+            }
         }
-      else
+      (void) vorbis_synthesis_read (&(ap_prc->vd_), nframes);
+      p_out->nFilledLen += nframes * frame_len;
+
+      if (room - nframes == 0)
         {
-          switch (bytes_consumed)
-            {
-              case FISH_SOUND_STOP_ERR:
-                {
-                  /* Decoding was stopped by a FishSoundDecode* */
-                  /* callback returning FISH_SOUND_STOP_ERR before any input
-                   * bytes were consumed. */
-                  /* This will occur when PCM is decoded from previously
-                   * buffered input, and */
-                  /* stopping is immediately requested. */
-                  TIZ_ERROR (handleOf (ap_prc),
-                             "[FISH_SOUND_ERR_STOP_ERR] : "
-                             "While decoding the input stream.");
-                  rc = OMX_ErrorStreamCorruptFatal;
-                }
-                break;
-              case FISH_SOUND_ERR_OUT_OF_MEMORY:
-                {
-                  TIZ_ERROR (handleOf (ap_prc),
-                             "[FISH_SOUND_ERR_OUT_OF_MEMORY] : "
-                             "While decoding the input stream.");
-                  rc = OMX_ErrorInsufficientResources;
-                }
-                break;
-              case FISH_SOUND_ERR_BAD:
-                {
-                  TIZ_ERROR (handleOf (ap_prc),
-                             "[FISH_SOUND_ERR_BAD] : "
-                             "While decoding the input stream.");
-                  rc = OMX_ErrorStreamCorruptFatal;
-                }
-                break;
-              default:
-                {
-                  TIZ_ERROR (handleOf (ap_prc),
-                             "[%s] : "
-                             "While decoding the input stream.",
-                             bytes_consumed);
-                  assert (0);
-                  rc = OMX_ErrorStreamCorruptFatal;
-                }
-            };
+          /* This one is full */
+          tiz_check_omx (tiz_filter_prc_release_header (
+            ap_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX));
         }
     }
+  return OMX_ErrorNone;
+}
 
-  if (0 == p_in->nFilledLen)
+static OMX_ERRORTYPE
+release_input_header (vorbisd_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = tiz_filter_prc_get_header (
+    ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX);
+
+  assert (ap_prc);
+
+  if (p_in)
     {
-      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
-                 p_in->nFlags);
       if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
         {
           /* Let's propagate EOS flag to output */
@@ -530,10 +351,42 @@ transform_buffer (vorbisd_prc_t * ap_prc)
           tiz_filter_prc_update_eos_flag (ap_prc, true);
           p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
         }
-      rc = tiz_filter_prc_release_header (
-        ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX);
+      p_in->nFilledLen = 0;
+      tiz_check_omx (tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+transform_buffer (vorbisd_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+
+  assert (ap_prc);
+
+  /* Audio already decoded goes out before the next packet is decoded */
+  if (OMX_ErrorNone != (rc = write_pcm (ap_prc)))
+    {
+      return rc;
+    }
+
+  if (!(p_in = tiz_filter_prc_get_header (
+          ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX)))
+    {
+      return OMX_ErrorNotReady;
     }
 
+  TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFilledLen [%d] nFlags [%d] ",
+             p_in, p_in->nFilledLen, p_in->nFlags);
+
+  if (p_in->nFilledLen > 0)
+    {
+      rc = decode_packet (ap_prc, p_in);
+    }
+
+  tiz_check_omx (release_input_header (ap_prc));
   return rc;
 }
 
@@ -542,15 +395,10 @@ reset_stream_parameters (vorbisd_prc_t * ap_prc)
 {
   assert (ap_prc);
   ap_prc->started_ = false;
-  if (ap_prc->p_fsnd_)
+  if (ap_prc->decoder_inited_)
     {
-      fish_sound_reset (ap_prc->p_fsnd_);
-    }
-  tiz_mem_set (&(ap_prc->fsinfo_), 0, sizeof (FishSoundInfo));
-  if (ap_prc->p_store_)
-    {
-      tiz_mem_set (ap_prc->p_store_, 0, ap_prc->store_size_);
-      ap_prc->store_offset_ = 0;
+      deinit_vorbis_decoder (ap_prc);
+      (void) init_vorbis_decoder (ap_prc);
     }
 }
 
@@ -576,11 +424,10 @@ vorbisd_prc_ctor (void * ap_obj, va_list * app)
   vorbisd_prc_t * p_prc
     = super_ctor (typeOf (ap_obj, "vorbisdprc"), ap_obj, app);
   assert (p_prc);
-  p_prc->p_fsnd_ = NULL;
+  p_prc->decoder_inited_ = false;
+  p_prc->synthesis_inited_ = false;
+  p_prc->packetno_ = 0;
   p_prc->started_ = false;
-  p_prc->p_store_ = NULL;
-  p_prc->store_size_ = 0;
-  p_prc->store_offset_ = 0;
   return p_prc;
 }
 
@@ -598,7 +445,6 @@ vorbisd_prc_dtor (void * ap_obj)
 static OMX_ERRORTYPE
 vorbisd_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
-  tiz_check_omx (alloc_temp_data_store (ap_obj));
   return init_vorbis_decoder (ap_obj);
 }
 
@@ -607,12 +453,7 @@ vorbisd_prc_deallocate_resources (void * ap_obj)
 {
   vorbisd_prc_t * p_prc = ap_obj;
   assert (p_prc);
-  if (p_prc->p_fsnd_)
-    {
-      fish_sound_delete (p_prc->p_fsnd_);
-      p_prc->p_fsnd_ = NULL;
-    }
-  dealloc_temp_data_store (p_prc);
+  deinit_vorbis_decoder (p_prc);
   return OMX_ErrorNone;
 }
 
@@ -654,28 +495,40 @@ vorbisd_prc_buffers_ready (const void * ap_obj)
 {
   vorbisd_prc_t * p_prc = (vorbisd_prc_t *) ap_obj;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
 
   assert (p_prc);
 
   TIZ_TRACE (handleOf (p_prc), "eos [%s] avail [%s]",
              tiz_filter_prc_is_eos (p_prc) ? "YES" : "NO",
              tiz_filter_prc_headers_available (p_prc) ? "YES" : "NO");
-  while (tiz_filter_prc_headers_available (p_prc) && OMX_ErrorNone == rc)
+  while (OMX_ErrorNone == rc)
     {
       rc = transform_buffer (p_prc);
     }
 
-  if (tiz_filter_prc_is_eos (p_prc))
+  if (OMX_ErrorNotReady == rc)
     {
-      OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
-        p_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
-      if (p_out)
+      rc = OMX_ErrorNone;
+    }
+
+  if (OMX_ErrorNone == rc && !pcm_pending (p_prc)
+      && (p_out = tiz_filter_prc_get_header (
+            p_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX)))
+    {
+      /* Input has run dry; don't sit on a partially filled buffer */
+      if (tiz_filter_prc_is_eos (p_prc))
         {
           p_out->nFlags |= OMX_BUFFERFLAG_EOS;
           tiz_filter_prc_update_eos_flag (p_prc, false);
           tiz_check_omx (tiz_filter_prc_release_header (
             p_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX));
         }
+      else if (p_out->nFilledLen > 0)
+        {
+          tiz_check_omx (tiz_filter_prc_release_header (
+            p_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX));
+        }
     }
   return rc;
 }
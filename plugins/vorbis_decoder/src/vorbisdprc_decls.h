@@ -34,7 +34,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
-#include <fishsound/fishsound.h>
+#include <vorbis/codec.h>
 
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
@@ -44,13 +44,15 @@ struct vorbisd_prc
 {
   /* Object */
   const tiz_filter_prc_t _;
-  FishSound * p_fsnd_;
-  FishSoundInfo fsinfo_;
+  vorbis_info vi_;
+  vorbis_comment vc_;
+  vorbis_dsp_state vd_;
+  vorbis_block vb_;
+  bool decoder_inited_;
+  bool synthesis_inited_;
+  ogg_int64_t packetno_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   bool started_;
-  OMX_U8 * p_store_;
-  OMX_U32 store_size_;
-  OMX_U32 store_offset_;
 };
 
 typedef struct vorbisd_prc_class vorbisd_prc_class_t;
@@ -56,6 +56,14 @@ extern "C" {
 #define ARATELIA_WEBM_DEMUXER_WEBM_PORT_ALIGNMENT 0
 #define ARATELIA_WEBM_DEMUXER_WEBM_PORT_SUPPLIERPREF OMX_BufferSupplyInput
 
+/* Upper bound of the unconsumed data kept in the input store (can be
+   overriden in tizonia.conf) */
+#define ARATELIA_WEBM_DEMUXER_DEFAULT_MAX_STORE_BYTES 1024 * 1024 * 4
+
+/* Seconds to wait for the upstream source to answer a stream reposition
+   request, before the seek is given up */
+#define ARATELIA_WEBM_DEMUXER_REPOSITION_TIMEOUT 5.0F
+
 /* Source/filter audio output port */
 #define ARATELIA_WEBM_DEMUXER_AUDIO_PORT_MIN_BUF_COUNT 2
 #define ARATELIA_WEBM_DEMUXER_AUDIO_PORT_MIN_BUF_SIZE 1024 * 8
@@ -25,7 +25,12 @@
  *
  * TODO: Support for video demuxing (VP8/VP9 demuxing no handled yet).
  * TODO: Finalise support for audio demuxer (VORBIS not handled yet, only OPUS demuxing).
- * TODO: Seek support.
+ *
+ * The input store is a sliding window over the stream: data consumed by
+ * nestegg is discarded, and the store stops pulling input once it holds
+ * 'max_store_bytes' of unconsumed data. Seeks are resolved with the Cues
+ * element; when the target is outside the window, the upstream source is
+ * asked to reposition the stream (see OMX_TizoniaIndexConfigStreamPosition).
  *
  */
 
@@ -36,6 +41,7 @@
 #include <alloca.h>
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <OMX_TizoniaExt.h>
@@ -43,6 +49,7 @@
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizport.h>
 #include <tizscheduler.h>
 
 #include "webmdmux.h"
@@ -57,12 +64,17 @@
 static OMX_HANDLETYPE g_handle = NULL;
 
 #define NESTEGG_INT_MAX_FAILED_ATTEMPTS 20
+#define WEBMDMUX_EBML_ID_CUES 0x1C53BB6B
 
 /* Forward declarations */
 static OMX_ERRORTYPE
 webmdmuxflt_prc_deallocate_resources (void *);
 static OMX_ERRORTYPE
 store_data (webmdmuxflt_prc_t * ap_prc);
+static void
+stop_reposition_timer (webmdmuxflt_prc_t * ap_prc);
+static void
+end_reposition (webmdmuxflt_prc_t * ap_prc, const bool a_repositioned);
 
 #define on_nestegg_error_ret_omx_oom(expr)                            \
   do                                                                  \
@@ -127,7 +139,10 @@ ne_io_read (void * ap_buffer, size_t a_length, void * a_userdata)
       return 0;
     }
 
-  (void) store_data (p_prc);
+  if (tiz_buffer_available (p_prc->p_webm_store_) < a_length)
+    {
+      (void) store_data (p_prc);
+    }
 
   if (ap_buffer && a_length > 0)
     {
@@ -161,24 +176,34 @@ static int
 ne_io_seek (int64_t offset, int whence, void * userdata)
 {
   webmdmuxflt_prc_t * p_prc = userdata;
-  int tb_whence = TIZ_BUFFER_SEEK_SET;
+  int64_t window_start = 0;
+  int64_t window_end = 0;
+  int64_t target = offset;
   assert (p_prc);
   TIZ_DEBUG (handleOf (userdata), "offset %lld - whence %d", offset, whence);
+
+  /* Offsets are absolute stream offsets; the store only holds the window
+     [store_base_, window_end] */
+  window_start = p_prc->store_base_;
+  window_end = window_start + tiz_buffer_offset (p_prc->p_webm_store_)
+               + tiz_buffer_available (p_prc->p_webm_store_);
+
   switch (whence)
     {
       case NESTEGG_SEEK_SET:
         {
-          tb_whence = TIZ_BUFFER_SEEK_SET;
+          target = offset;
         }
         break;
       case NESTEGG_SEEK_CUR:
         {
-          tb_whence = TIZ_BUFFER_SEEK_CUR;
+          target = window_start + tiz_buffer_offset (p_prc->p_webm_store_)
+                   + offset;
         }
         break;
       case NESTEGG_SEEK_END:
         {
-          tb_whence = TIZ_BUFFER_SEEK_END;
+          target = window_end + offset;
         }
         break;
       default:
@@ -187,7 +212,19 @@ ne_io_seek (int64_t offset, int whence, void * userdata)
         }
         break;
     };
-  return tiz_buffer_seek (p_prc->p_webm_store_, offset, tb_whence);
+
+  if (target < window_start || target > window_end)
+    {
+      /* Remember the offset; it will be requested from the upstream component
+         if this seek is part of a stream position change */
+      TIZ_DEBUG (handleOf (userdata), "offset %lld outside [%lld, %lld]",
+                 target, window_start, window_end);
+      p_prc->reposition_offset_ = target;
+      return -1;
+    }
+
+  return tiz_buffer_seek (p_prc->p_webm_store_, target - window_start,
+                          TIZ_BUFFER_SEEK_SET);
 }
 
 /** User supplied tell callback.
@@ -201,7 +238,7 @@ ne_io_tell (void * userdata)
 {
   webmdmuxflt_prc_t * p_prc = userdata;
   assert (p_prc);
-  return tiz_buffer_offset (p_prc->p_webm_store_);
+  return p_prc->store_base_ + tiz_buffer_offset (p_prc->p_webm_store_);
 }
 
 /** nestegg logging callback function. */
@@ -479,6 +516,23 @@ store_data (webmdmuxflt_prc_t * ap_prc)
 
   OMX_BUFFERHEADERTYPE * p_in = get_webm_hdr (ap_prc);
 
+  /* While a stream reposition is in progress, the data that was already on
+     its way belongs to the old position. It is stored all the same, in case
+     the source can't reposition and the stream carries on from there. */
+  if (p_in
+      && (p_in->nFlags & (OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION
+                          | OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR)))
+    {
+      const bool repositioned
+        = (p_in->nFlags & OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION) > 0;
+      p_in->nFlags &= ~(OMX_TIZONIA_BUFFERFLAG_STREAMPOSITION
+                        | OMX_TIZONIA_BUFFERFLAG_STREAMPOSITIONERROR);
+      if (ap_prc->awaiting_reposition_)
+        {
+          end_reposition (ap_prc, repositioned);
+        }
+    }
+
   if (p_in)
     {
       int pushed = 0;
@@ -619,6 +673,36 @@ able_to_demux (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+static inline bool
+store_has_room (const webmdmuxflt_prc_t * ap_prc)
+{
+  const int avail = tiz_buffer_available (ap_prc->p_webm_store_);
+  assert (ap_prc);
+  /* The cap does not apply while nestegg is initialising or seeking, or when
+     nestegg needs a larger element than the cap */
+  return (!ap_prc->ne_inited_ || ap_prc->seek_tstamp_ >= 0
+          || avail < ap_prc->ne_last_read_len_
+          || (size_t) avail < ap_prc->store_max_bytes_);
+}
+
+static void
+evict_consumed_data (webmdmuxflt_prc_t * ap_prc)
+{
+  const int consumed = tiz_buffer_offset (ap_prc->p_webm_store_);
+  assert (ap_prc);
+  /* Nestegg is about to read a new packet, and will not go back past the
+     start of it (other than when seeking, which is served from the cues). To
+     amortise the cost of moving the unconsumed data, only compact once it is
+     outweighed by the consumed data. */
+  if (consumed > 0
+      && consumed >= tiz_buffer_available (ap_prc->p_webm_store_))
+    {
+      ap_prc->store_base_ += tiz_buffer_compact (ap_prc->p_webm_store_);
+      TIZ_TRACE (handleOf (ap_prc), "store base [%llu]",
+                 (unsigned long long) ap_prc->store_base_);
+    }
+}
+
 static OMX_ERRORTYPE
 read_packet (webmdmuxflt_prc_t * ap_prc)
 {
@@ -632,15 +716,25 @@ read_packet (webmdmuxflt_prc_t * ap_prc)
       nestegg_read_reset (ap_prc->p_ne_);
     }
 
+  if (!ap_prc->p_ne_pkt_)
+    {
+      evict_consumed_data (ap_prc);
+    }
+
   if (ap_prc->p_ne_pkt_
       || (ap_prc->ne_read_err_
           = nestegg_read_packet (ap_prc->p_ne_, &ap_prc->p_ne_pkt_))
            > 0)
     {
       unsigned int track = 0;
+      uint64_t tstamp = 0;
       assert (ap_prc->p_ne_pkt_);
 
       nestegg_packet_track (ap_prc->p_ne_pkt_, &track);
+      if (0 == nestegg_packet_tstamp (ap_prc->p_ne_pkt_, &tstamp))
+        {
+          ap_prc->position_ = tstamp / 1000;
+        }
 
       tiz_check_omx (extract_track_audio_data (ap_prc, track));
       tiz_check_omx (extract_track_video_data (ap_prc, track));
@@ -682,6 +776,7 @@ static OMX_ERRORTYPE
 alloc_input_store (webmdmuxflt_prc_t * ap_prc)
 {
   OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  const char * p_max_store = NULL;
   assert (ap_prc);
 
   TIZ_INIT_OMX_PORT_STRUCT (port_def,
@@ -690,6 +785,16 @@ alloc_input_store (webmdmuxflt_prc_t * ap_prc)
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamPortDefinition, &port_def));
 
+  /* The store never holds less than a few input buffers */
+  p_max_store = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_WEBM_DEMUXER_COMPONENT_NAME ".max_store_bytes");
+  ap_prc->store_max_bytes_ = p_max_store
+                               ? strtoul (p_max_store, NULL, 10)
+                               : ARATELIA_WEBM_DEMUXER_DEFAULT_MAX_STORE_BYTES;
+  ap_prc->store_max_bytes_
+    = MAX (ap_prc->store_max_bytes_, port_def.nBufferSize * 4);
+
   assert (ap_prc->p_webm_store_ == NULL);
   tiz_check_omx (
     tiz_buffer_init (&(ap_prc->p_webm_store_), port_def.nBufferSize * 4));
@@ -772,6 +877,7 @@ reset_nestegg_members (webmdmuxflt_prc_t * ap_prc)
   ap_prc->ne_read_err_ = 0;
   ap_prc->ne_last_read_len_ = 0;
   ap_prc->ne_failed_init_count_ = 0;
+  ap_prc->reposition_offset_ = -1;
 }
 
 static void
@@ -790,6 +896,13 @@ reset_stream_parameters (webmdmuxflt_prc_t * ap_prc)
   dealloc_nestegg (ap_prc);
   reset_nestegg_members (ap_prc);
 
+  ap_prc->store_base_ = 0;
+  ap_prc->awaiting_reposition_ = false;
+  stop_reposition_timer (ap_prc);
+  ap_prc->seek_requested_ = false;
+  ap_prc->seek_tstamp_ = -1;
+  ap_prc->position_ = 0;
+
   tiz_buffer_clear (ap_prc->p_webm_store_);
   tiz_buffer_clear (ap_prc->p_aud_store_);
   tiz_buffer_clear (ap_prc->p_vid_store_);
@@ -1116,6 +1229,237 @@ do_flush (webmdmuxflt_prc_t * ap_prc, OMX_U32 a_pid)
   return tiz_filter_prc_release_header (ap_prc, a_pid);
 }
 
+static size_t
+ebml_vint_length (const OMX_U8 a_first_byte)
+{
+  size_t len = 1;
+  OMX_U8 mask = 0x80;
+  while (len <= 8 && !(a_first_byte & mask))
+    {
+      mask >>= 1;
+      ++len;
+    }
+  return len;
+}
+
+/* Nestegg parses the Cues element in one go, and a partial parse would leave
+   it with an incomplete index; so after repositioning the stream at the Cues,
+   wait until the whole element is in the store. */
+static bool
+cues_incomplete (webmdmuxflt_prc_t * ap_prc)
+{
+  const OMX_U8 * p_data = tiz_buffer_get (ap_prc->p_webm_store_);
+  const size_t avail = tiz_buffer_available (ap_prc->p_webm_store_);
+  uint32_t id = 0;
+  size_t size_len = 0;
+  uint64_t size = 0;
+  size_t i = 0;
+
+  assert (ap_prc);
+
+  if (tiz_filter_prc_is_eos (ap_prc))
+    {
+      return false;
+    }
+
+  if (avail < 5)
+    {
+      return true;
+    }
+
+  id = ((uint32_t) p_data[0] << 24) | ((uint32_t) p_data[1] << 16)
+       | ((uint32_t) p_data[2] << 8) | (uint32_t) p_data[3];
+  size_len = ebml_vint_length (p_data[4]);
+  if (WEBMDMUX_EBML_ID_CUES != id || size_len > 8)
+    {
+      return false;
+    }
+
+  if (avail < 4 + size_len)
+    {
+      return true;
+    }
+
+  size = p_data[4] & (0xFF >> size_len);
+  for (i = 1; i < size_len; ++i)
+    {
+      size = (size << 8) | p_data[4 + i];
+    }
+
+  /* Unknown-sized element: nothing to wait for */
+  if (size == ((uint64_t) 1 << (7 * size_len)) - 1)
+    {
+      return false;
+    }
+
+  return avail < 4 + size_len + size;
+}
+
+static OMX_ERRORTYPE
+request_reposition (webmdmuxflt_prc_t * ap_prc, const OMX_S64 a_offset)
+{
+  OMX_TIZONIA_STREAMPOSITIONTYPE position;
+  OMX_HANDLETYPE p_source = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_prc);
+  assert (a_offset >= 0);
+
+  p_source = tiz_port_get_tunnel_comp (
+    tiz_krn_get_port (tiz_get_krn (handleOf (ap_prc)),
+                      ARATELIA_WEBM_DEMUXER_FILTER_PORT_0_INDEX));
+
+  if (!p_source)
+    {
+      TIZ_WARN (handleOf (ap_prc),
+                "[OMX_ErrorUnsupportedSetting] : no upstream component to "
+                "reposition the stream at [%lld]",
+                a_offset);
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  /* SetConfig is not answered synchronously; only sources that implement
+     repositioning know about this index, so ask for it first */
+  TIZ_INIT_OMX_PORT_STRUCT (position, OMX_ALL);
+  if (OMX_ErrorNone
+      != (rc = OMX_GetConfig (p_source, OMX_TizoniaIndexConfigStreamPosition,
+                              &position)))
+    {
+      TIZ_WARN (handleOf (ap_prc), "[%s] : upstream can't reposition",
+                tiz_err_to_str (rc));
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  TIZ_DEBUG (handleOf (ap_prc), "requesting stream position [%lld]",
+             a_offset);
+
+  TIZ_INIT_OMX_PORT_STRUCT (position, OMX_ALL);
+  position.nOffset = a_offset;
+  if (OMX_ErrorNone
+      != (rc = OMX_SetConfig (p_source, OMX_TizoniaIndexConfigStreamPosition,
+                              &position)))
+    {
+      TIZ_WARN (handleOf (ap_prc), "[%s] : upstream can't reposition",
+                tiz_err_to_str (rc));
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  /* The answer comes as a flag on an input buffer; don't wait forever */
+  if (ap_prc->p_ev_timer_ && !ap_prc->timer_started_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_start (
+        ap_prc, ap_prc->p_ev_timer_, ARATELIA_WEBM_DEMUXER_REPOSITION_TIMEOUT,
+        0));
+      ap_prc->timer_started_ = true;
+    }
+
+  ap_prc->reposition_offset_ = a_offset;
+  ap_prc->awaiting_reposition_ = true;
+  return OMX_ErrorNone;
+}
+
+static void
+stop_reposition_timer (webmdmuxflt_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && ap_prc->timer_started_)
+    {
+      (void) tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+    }
+  ap_prc->timer_started_ = false;
+}
+
+static void
+end_reposition (webmdmuxflt_prc_t * ap_prc, const bool a_repositioned)
+{
+  assert (ap_prc);
+  assert (ap_prc->awaiting_reposition_);
+
+  stop_reposition_timer (ap_prc);
+  ap_prc->awaiting_reposition_ = false;
+
+  if (a_repositioned)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "stream repositioned to [%lld]",
+                 ap_prc->reposition_offset_);
+      tiz_buffer_clear (ap_prc->p_webm_store_);
+      ap_prc->store_base_ = ap_prc->reposition_offset_;
+      /* An EOS received before the reposition belonged to the old position */
+      tiz_filter_prc_update_eos_flag (ap_prc, false);
+    }
+  else
+    {
+      /* The store is still contiguous with the incoming data; carry on from
+         where we are */
+      TIZ_WARN (handleOf (ap_prc),
+                "Stream not repositioned at [%lld]; unable to seek to [%lld] ns",
+                ap_prc->reposition_offset_, ap_prc->seek_tstamp_);
+      ap_prc->seek_tstamp_ = -1;
+    }
+  ap_prc->reposition_offset_ = -1;
+}
+
+static OMX_ERRORTYPE
+seek_stream (webmdmuxflt_prc_t * ap_prc)
+{
+  unsigned int track = 0;
+  int ne_rc = -1;
+  int attempt = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->seek_tstamp_ >= 0);
+
+  if (!ap_prc->ne_inited_ || ap_prc->awaiting_reposition_
+      || cues_incomplete (ap_prc))
+    {
+      /* Try again when more data arrives */
+      return OMX_ErrorNone;
+    }
+
+  track = (NESTEGG_TRACK_UNKNOWN != ap_prc->ne_audio_track_)
+            ? ap_prc->ne_audio_track_
+            : ap_prc->ne_video_track_;
+
+  if (ap_prc->p_ne_pkt_)
+    {
+      nestegg_free_packet (ap_prc->p_ne_pkt_);
+      ap_prc->p_ne_pkt_ = NULL;
+      ap_prc->ne_chunk_ = 0;
+    }
+  ap_prc->ne_read_err_ = 0;
+
+  /* After loading the cues, nestegg seeks back to where it was, which may
+     well be outside the window by now; that costs one more attempt. */
+  for (attempt = 0; attempt < 2 && 0 != ne_rc; ++attempt)
+    {
+      ap_prc->reposition_offset_ = -1;
+      ne_rc = nestegg_track_seek (ap_prc->p_ne_, track, ap_prc->seek_tstamp_);
+    }
+
+  if (0 == ne_rc)
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "seek to [%lld] ns done",
+                 ap_prc->seek_tstamp_);
+      ap_prc->position_ = ap_prc->seek_tstamp_ / 1000;
+      ap_prc->seek_tstamp_ = -1;
+      return OMX_ErrorNone;
+    }
+
+  if (ap_prc->reposition_offset_ >= 0
+      && OMX_ErrorNone
+           == request_reposition (ap_prc, ap_prc->reposition_offset_))
+    {
+      return OMX_ErrorNone;
+    }
+
+  /* The stream is not seekable (no cues, or no cooperative source); carry on
+     from where we are */
+  TIZ_WARN (handleOf (ap_prc), "Unable to seek to [%lld] ns",
+            ap_prc->seek_tstamp_);
+  ap_prc->seek_tstamp_ = -1;
+  return OMX_ErrorNone;
+}
+
 /*
  * webmdmuxfltprc
  */
@@ -1131,6 +1475,8 @@ webmdmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_vid_store_ = NULL;
   p_prc->p_aud_header_lengths_ = NULL;
   p_prc->p_vid_header_lengths_ = NULL;
+  p_prc->p_ev_timer_ = NULL;
+  p_prc->timer_started_ = false;
   reset_stream_parameters (p_prc);
   g_handle = handleOf (ap_prc);
   return p_prc;
@@ -1155,6 +1501,10 @@ webmdmuxflt_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
   assert (p_prc);
   tiz_check_omx (alloc_input_store (p_prc));
   tiz_check_omx (alloc_output_stores (p_prc));
+  if (!p_prc->p_ev_timer_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+    }
   return OMX_ErrorNone;
 }
 
@@ -1163,6 +1513,12 @@ webmdmuxflt_prc_deallocate_resources (void * ap_prc)
 {
   webmdmuxflt_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  stop_reposition_timer (p_prc);
+  if (p_prc->p_ev_timer_)
+    {
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
+    }
   dealloc_output_stores (p_prc);
   dealloc_input_store (p_prc);
   dealloc_nestegg (p_prc);
@@ -1203,7 +1559,10 @@ webmdmuxflt_prc_buffers_ready (const void * ap_prc)
 
   assert (p_prc);
 
-  tiz_check_omx (store_data (p_prc));
+  if (store_has_room (p_prc))
+    {
+      tiz_check_omx (store_data (p_prc));
+    }
 
   if (!p_prc->ne_inited_)
     {
@@ -1224,7 +1583,12 @@ webmdmuxflt_prc_buffers_ready (const void * ap_prc)
         }
     }
 
-  if (p_prc->ne_inited_)
+  if (p_prc->ne_inited_ && p_prc->seek_tstamp_ >= 0)
+    {
+      tiz_check_omx (seek_stream (p_prc));
+    }
+
+  if (p_prc->ne_inited_ && p_prc->seek_tstamp_ < 0)
     {
       tiz_check_omx (deliver_codec_metadata (
         p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX));
@@ -1249,6 +1613,42 @@ webmdmuxflt_prc_buffers_ready (const void * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+webmdmuxflt_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
+                               OMX_INDEXTYPE a_config_idx)
+{
+  webmdmuxflt_prc_t * p_prc = ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+
+  if (OMX_IndexConfigTimePosition == a_config_idx && p_prc->seek_requested_)
+    {
+      p_prc->seek_requested_ = false;
+      if (p_prc->seek_tstamp_ >= 0)
+        {
+          rc = seek_stream (p_prc);
+        }
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
+                             void * ap_arg, const uint32_t a_id)
+{
+  webmdmuxflt_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->timer_started_ = false;
+  if (p_prc->awaiting_reposition_)
+    {
+      TIZ_WARN (handleOf (p_prc), "upstream did not answer the reposition");
+      end_reposition (p_prc, false);
+      return webmdmuxflt_prc_buffers_ready (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 webmdmuxflt_prc_pause (const void * ap_obj)
 {
@@ -1289,6 +1689,81 @@ webmdmuxflt_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const webmdmuxflt_prc_t * p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+  assert (ap_struct);
+
+  switch (a_index)
+    {
+      case OMX_IndexConfigTimePosition:
+        {
+          OMX_TIME_CONFIG_TIMESTAMPTYPE * p_ts = ap_struct;
+          p_ts->nTimestamp = p_prc->position_;
+        }
+        break;
+
+      case OMX_IndexConfigTimeSeekMode:
+        {
+          /* Seeks land on the cluster of the closest cue point */
+          OMX_TIME_CONFIG_SEEKMODETYPE * p_mode = ap_struct;
+          p_mode->eType = OMX_TIME_SeekModeFast;
+        }
+        break;
+
+      default:
+        {
+          rc = super_GetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj,
+                                ap_hdl, a_index, ap_struct);
+        }
+        break;
+    };
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  webmdmuxflt_prc_t * p_prc = (webmdmuxflt_prc_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+  assert (ap_struct);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      /* This is invoked twice per request, by the config port and by the
+         kernel. Record the target, and let the config change notification
+         start the seek. */
+      const OMX_TIME_CONFIG_TIMESTAMPTYPE * p_ts = ap_struct;
+      p_prc->seek_tstamp_ = MAX (p_ts->nTimestamp, 0) * 1000;
+      if (!p_prc->seek_requested_)
+        {
+          p_prc->seek_requested_ = true;
+          rc = super_SetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj,
+                                ap_hdl, a_index, ap_struct);
+        }
+    }
+  else if (OMX_IndexConfigTimeSeekMode != a_index)
+    {
+      rc = super_SetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
 /*
  * webmdmuxflt_prc_class
  */
@@ -1350,6 +1825,8 @@ webmdmuxflt_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, webmdmuxflt_prc_buffers_ready,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_timer_ready, webmdmuxflt_prc_timer_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_pause, webmdmuxflt_prc_pause,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_resume, webmdmuxflt_prc_resume,
@@ -1359,6 +1836,12 @@ webmdmuxflt_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, webmdmuxflt_prc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_port_enable, webmdmuxflt_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_config_change, webmdmuxflt_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, webmdmuxflt_prc_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, webmdmuxflt_prc_SetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -72,6 +72,15 @@ struct webmdmuxflt_prc
   int ne_read_err_;
   int ne_last_read_len_;
   int ne_failed_init_count_;
+  OMX_U64 store_base_;
+  size_t store_max_bytes_;
+  OMX_S64 reposition_offset_;
+  bool awaiting_reposition_;
+  tiz_event_timer_t * p_ev_timer_;
+  bool timer_started_;
+  bool seek_requested_;
+  OMX_S64 seek_tstamp_;
+  OMX_TICKS position_;
 };
 
 typedef struct webmdmuxflt_prc_class webmdmuxflt_prc_class_t;
@@ -23,6 +23,12 @@
  *
  * @brief  Tizonia OpenMAX IL - RM SQLite3 database handling - implementation
  *
+ * The 'resources' and 'components' tables are loaded in memory when the
+ * database is opened, and the 'allocation' table is kept in memory for the
+ * lifetime of the daemon, so that all the checks made during resource
+ * arbitration are simple lookups. Modifications are written through to the
+ * database using precompiled statements, one transaction per operation.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -54,15 +60,53 @@ static const char *TIZ_RM_DB_CREATE_ALLOC_TABLE =
   "create table allocation(cname varchar(255), uuid varchar(16), grpid "
   "smallint, pri smallint, resid smallint, allocation mediumint)";
 
-// static const char *TIZ_RM_DB_RESNAMES_FROM_RESOURCES
-//     = "select resname from resources";
-// static const char *TIZ_RM_DB_RESIDS_FROM_RESOURCES
-//     = "select resid from resources";
+static const char *TIZ_RM_DB_SELECT_RESOURCES
+    = "select resid, initial, current from resources";
+static const char *TIZ_RM_DB_SELECT_COMPONENTS
+    = "select cname, grpid, pri, resid, requirement from components";
+
+static const char *TIZ_RM_DB_BEGIN = "begin transaction";
+static const char *TIZ_RM_DB_COMMIT = "commit transaction";
+static const char *TIZ_RM_DB_ROLLBACK = "rollback transaction";
+static const char *TIZ_RM_DB_INSERT_ALLOC =
+  "insert into allocation (cname, uuid, grpid, pri, resid, allocation) "
+  "values(?1, ?2, ?3, ?4, ?5, ?6)";
+static const char *TIZ_RM_DB_DELETE_ALLOC
+    = "delete from allocation where uuid=?1 and resid=?2";
+static const char *TIZ_RM_DB_UPDATE_CURRENT
+    = "update resources set current=?1 where resid=?2";
+
+namespace
+{
+  // Runs a precompiled statement that returns no rows, and resets it so that
+  // it can be reused
+  int step_stmt (sqlite3_stmt *p_stmt)
+  {
+    int rc = sqlite3_step (p_stmt);
+    sqlite3_reset (p_stmt);
+    sqlite3_clear_bindings (p_stmt);
+    return (SQLITE_DONE == rc) ? SQLITE_OK : rc;
+  }
 
-static const char *TIZ_RM_DB_CNAMES_FROM_COMPONENTS
-    = "select cname from components";
+  void finalize_stmt (sqlite3_stmt *&p_stmt)
+  {
+    if (p_stmt)
+    {
+      sqlite3_finalize (p_stmt);
+      p_stmt = 0;
+    }
+  }
+}
 
-tizrmdb::tizrmdb (char const *ap_dbname) : pdb_ (0), dbname_ (ap_dbname)
+tizrmdb::tizrmdb (char const *ap_dbname)
+  : pdb_ (0),
+    dbname_ (ap_dbname),
+    p_begin_stmt_ (0),
+    p_commit_stmt_ (0),
+    p_rollback_stmt_ (0),
+    p_alloc_insert_stmt_ (0),
+    p_alloc_delete_stmt_ (0),
+    p_current_update_stmt_ (0)
 {
 }
 
@@ -88,6 +132,14 @@ tiz_rm_error_t tizrmdb::connect ()
     else
     {
       rc = reset_alloc_table ();
+      if (SQLITE_OK == rc)
+      {
+        rc = load_tables ();
+      }
+      if (SQLITE_OK == rc)
+      {
+        rc = prepare_statements ();
+      }
       if (rc != SQLITE_OK)
       {
         TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not init db [%s]",
@@ -129,6 +181,7 @@ int tizrmdb::open (char const *ap_dbname)
 int tizrmdb::close ()
 {
   int rc = SQLITE_OK;
+  finalize_statements ();
   if (pdb_)
   {
     rc = sqlite3_close (pdb_);
@@ -136,6 +189,13 @@ int tizrmdb::close ()
     dbname_.clear ();
   }
 
+  for (int rid = 0; rid < TIZ_RM_RESOURCE_MAX; ++rid)
+  {
+    resources_[rid] = resource ();
+  }
+  provisions_.clear ();
+  allocations_.clear ();
+
   return rc;
 }
 
@@ -153,6 +213,7 @@ int tizrmdb::reset_alloc_table ()
     {
       TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not drop allocation table [%s]",
                p_errmsg);
+      sqlite3_free (p_errmsg);
     }
 
     rc = sqlite3_exec (pdb_, TIZ_RM_DB_CREATE_ALLOC_TABLE, NULL, NULL,
@@ -161,33 +222,203 @@ int tizrmdb::reset_alloc_table ()
     {
       TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not create allocation table [%s]",
                p_errmsg);
+      sqlite3_free (p_errmsg);
       return rc;
     }
     TIZ_LOG (TIZ_PRIORITY_TRACE, "Created allocation table succesfully");
   }
 
+  allocations_.clear ();
+
   return rc;
 }
 
+int tizrmdb::load_tables ()
+{
+  sqlite3_stmt *p_stmt = 0;
+  int rc = SQLITE_OK;
+
+  BOOST_ASSERT (pdb_);
+
+  rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_SELECT_RESOURCES, -1, &p_stmt, 0);
+  while (SQLITE_OK == rc && SQLITE_ROW == (rc = sqlite3_step (p_stmt)))
+  {
+    const int rid = sqlite3_column_int (p_stmt, 0);
+    if (rid >= 0 && rid < TIZ_RM_RESOURCE_MAX)
+    {
+      resources_[rid].provisioned = true;
+      resources_[rid].initial = sqlite3_column_int (p_stmt, 1);
+      resources_[rid].current = sqlite3_column_int (p_stmt, 2);
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "resource [%d] initial [%d] current [%d]",
+               rid, resources_[rid].initial, resources_[rid].current);
+    }
+    rc = SQLITE_OK;
+  }
+  finalize_stmt (p_stmt);
+
+  if (SQLITE_DONE != rc)
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not load the resources table [%s]",
+             sqlite_error_str (rc).c_str ());
+    return rc;
+  }
+
+  rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_SELECT_COMPONENTS, -1, &p_stmt, 0);
+  while (SQLITE_OK == rc && SQLITE_ROW == (rc = sqlite3_step (p_stmt)))
+  {
+    const unsigned char *p_cname = sqlite3_column_text (p_stmt, 0);
+    provision prov;
+    prov.grpid = sqlite3_column_int (p_stmt, 1);
+    prov.pri = sqlite3_column_int (p_stmt, 2);
+    prov.requirement = sqlite3_column_int (p_stmt, 4);
+    if (p_cname)
+    {
+      provisions_[provision_key_t (
+          reinterpret_cast< const char * >(p_cname),
+          sqlite3_column_int (p_stmt, 3))] = prov;
+    }
+    rc = SQLITE_OK;
+  }
+  finalize_stmt (p_stmt);
+
+  if (SQLITE_DONE != rc)
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not load the components table [%s]",
+             sqlite_error_str (rc).c_str ());
+    return rc;
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Loaded [%zu] component provisioning entries",
+           provisions_.size ());
+
+  return SQLITE_OK;
+}
+
+int tizrmdb::prepare_statements ()
+{
+  int rc = SQLITE_OK;
+
+  BOOST_ASSERT (pdb_);
+
+  if (SQLITE_OK
+          != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_BEGIN, -1,
+                                       &p_begin_stmt_, 0))
+      || SQLITE_OK
+             != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_COMMIT, -1,
+                                          &p_commit_stmt_, 0))
+      || SQLITE_OK
+             != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_ROLLBACK, -1,
+                                          &p_rollback_stmt_, 0))
+      || SQLITE_OK
+             != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_INSERT_ALLOC, -1,
+                                          &p_alloc_insert_stmt_, 0))
+      || SQLITE_OK
+             != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_DELETE_ALLOC, -1,
+                                          &p_alloc_delete_stmt_, 0))
+      || SQLITE_OK
+             != (rc = sqlite3_prepare_v2 (pdb_, TIZ_RM_DB_UPDATE_CURRENT, -1,
+                                          &p_current_update_stmt_, 0)))
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not prepare statements [%s] - [%s]",
+             sqlite_error_str (rc).c_str (), sqlite3_errmsg (pdb_));
+    finalize_statements ();
+  }
+
+  return rc;
+}
+
+void tizrmdb::finalize_statements ()
+{
+  finalize_stmt (p_begin_stmt_);
+  finalize_stmt (p_commit_stmt_);
+  finalize_stmt (p_rollback_stmt_);
+  finalize_stmt (p_alloc_insert_stmt_);
+  finalize_stmt (p_alloc_delete_stmt_);
+  finalize_stmt (p_current_update_stmt_);
+}
+
+int tizrmdb::begin_transaction ()
+{
+  BOOST_ASSERT (p_begin_stmt_);
+  return step_stmt (p_begin_stmt_);
+}
+
+int tizrmdb::commit_transaction ()
+{
+  BOOST_ASSERT (p_commit_stmt_);
+  return step_stmt (p_commit_stmt_);
+}
+
+void tizrmdb::rollback_transaction ()
+{
+  BOOST_ASSERT (p_rollback_stmt_);
+  (void)step_stmt (p_rollback_stmt_);
+}
+
+int tizrmdb::persist_allocation (const allocation_key_t &key,
+                                 const allocation &alloc)
+{
+  int rc = persist_deallocation (key);
+  if (SQLITE_OK == rc)
+  {
+    sqlite3_stmt *p_stmt = p_alloc_insert_stmt_;
+    BOOST_ASSERT (p_stmt);
+    sqlite3_bind_text (p_stmt, 1, alloc.cname.c_str (), -1, SQLITE_STATIC);
+    sqlite3_bind_text (p_stmt, 2, key.first.c_str (), -1, SQLITE_STATIC);
+    sqlite3_bind_int (p_stmt, 3, alloc.grpid);
+    sqlite3_bind_int (p_stmt, 4, alloc.pri);
+    sqlite3_bind_int (p_stmt, 5, key.second);
+    sqlite3_bind_int (p_stmt, 6, alloc.quantity);
+    rc = step_stmt (p_stmt);
+  }
+  return rc;
+}
+
+int tizrmdb::persist_deallocation (const allocation_key_t &key)
+{
+  sqlite3_stmt *p_stmt = p_alloc_delete_stmt_;
+  BOOST_ASSERT (p_stmt);
+  sqlite3_bind_text (p_stmt, 1, key.first.c_str (), -1, SQLITE_STATIC);
+  sqlite3_bind_int (p_stmt, 2, key.second);
+  return step_stmt (p_stmt);
+}
+
+int tizrmdb::persist_current (const unsigned int &rid, const int &current)
+{
+  sqlite3_stmt *p_stmt = p_current_update_stmt_;
+  BOOST_ASSERT (p_stmt);
+  sqlite3_bind_int (p_stmt, 1, current);
+  sqlite3_bind_int (p_stmt, 2, rid);
+  return step_stmt (p_stmt);
+}
+
+const tizrmdb::provision *tizrmdb::find_provision (
+    const std::string &cname, const unsigned int &rid) const
+{
+  provision_map_t::const_iterator it
+      = provisions_.find (provision_key_t (cname, rid));
+  return (it != provisions_.end ()) ? &(it->second) : 0;
+}
+
+std::string tizrmdb::uuid_str (const std::vector< unsigned char > &uuid)
+{
+  char uuid_str[129];
+  tiz_uuid_str (&uuid[0], uuid_str);
+  return std::string (uuid_str);
+}
+
 bool tizrmdb::resource_available (const unsigned int &rid,
                                   const unsigned int &quantity) const
 {
   bool ret_val = false;
-  int rc = SQLITE_OK;
-  char query[255];
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::resource_available : Checking resource "
            " availability for resid [%d] - quantity [%d]",
            rid, quantity);
 
-  snprintf (query, sizeof(query),
-            "select * from resources where resid='%d' and current>='%d'", rid,
-            quantity);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK == rc && !vdata_.empty ())
+  if (resource_provisioned (rid)
+      && resources_[rid].current >= static_cast< int >(quantity))
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "tizrmdb::resource_available : "
@@ -202,17 +433,10 @@ bool tizrmdb::resource_available (const unsigned int &rid,
 bool tizrmdb::resource_provisioned (const unsigned int &rid) const
 {
   bool ret_val = false;
-  int rc = SQLITE_OK;
-  char query[255];
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "tizrmdb::resource_provisioned");
 
-  snprintf (query, sizeof(query), "select * from resources where resid='%d'",
-            rid);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK == rc && !vdata_.empty ())
+  if (rid < TIZ_RM_RESOURCE_MAX && resources_[rid].provisioned)
   {
     ret_val = true;
   }
@@ -228,25 +452,17 @@ bool tizrmdb::resource_acquired (const std::vector< unsigned char > &uuid,
                                  const unsigned int &quantity) const
 {
   bool ret_val = false;
-  int rc = SQLITE_OK;
-  char query[255];
-  char uuid_str[129];
-
-  tiz_uuid_str (&uuid[0], uuid_str);
+  const std::string uuid_s = uuid_str (uuid);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::resource_acquired : uuid [%s] - "
            "rid [%d] - quantity [%d]",
-           uuid_str, rid, quantity);
-
-  snprintf (query, sizeof(query),
-            "select * from allocation where uuid='%s' and resid='%d' "
-            "and allocation>='%d'",
-            uuid_str, rid, quantity);
-
-  rc = run_query (query);
+           uuid_s.c_str (), rid, quantity);
 
-  if (SQLITE_OK == rc && !vdata_.empty ())
+  allocation_map_t::const_iterator it
+      = allocations_.find (allocation_key_t (uuid_s, rid));
+  if (it != allocations_.end ()
+      && it->second.quantity >= static_cast< int >(quantity))
   {
     ret_val = true;
   }
@@ -255,7 +471,7 @@ bool tizrmdb::resource_acquired (const std::vector< unsigned char > &uuid,
            "tizrmdb::resource_acquired : "
            "'%s' : allocated [%s] units "
            "of resource id [%d] (at least [%d] units were expected)",
-           uuid_str, (true == ret_val ? "ENOUGH" : "NOT ENOUGH"), rid,
+           uuid_s.c_str (), (true == ret_val ? "ENOUGH" : "NOT ENOUGH"), rid,
            quantity);
 
   return ret_val;
@@ -264,23 +480,16 @@ bool tizrmdb::resource_acquired (const std::vector< unsigned char > &uuid,
 bool tizrmdb::comp_provisioned (const std::string &cname) const
 {
   bool ret_val = false;
-  int rc = SQLITE_OK;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "tizrmdb::comp_provisioned : Checking [%s]",
            cname.c_str ());
 
-  rc = run_query (TIZ_RM_DB_CNAMES_FROM_COMPONENTS);
-
-  if (SQLITE_OK == rc)
+  // Entries are ordered by component name first
+  provision_map_t::const_iterator it
+      = provisions_.lower_bound (provision_key_t (cname, 0));
+  if (it != provisions_.end () && it->first.first == cname)
   {
-    for (std::vector< std::string >::iterator it = vdata_.begin ();
-         it < vdata_.end (); ++it)
-    {
-      if (cname.compare (*it) == 0)
-      {
-        ret_val = true;
-      }
-    }
+    ret_val = true;
   }
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "'%s' is [%s]", cname.c_str (),
@@ -292,26 +501,7 @@ bool tizrmdb::comp_provisioned (const std::string &cname) const
 bool tizrmdb::comp_provisioned_with_resid (const std::string &cname,
                                            const unsigned int &rid) const
 {
-  bool ret_val = false;
-  int rc = SQLITE_OK;
-  char query[255];
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE,
-           "tizrmdb::comp_provisioned_with_resid : "
-           "'%s' : Checking component provisioning for "
-           "resource id [%d]",
-           cname.c_str (), rid);
-
-  snprintf (query, sizeof(query),
-            "select * from components where cname='%s' and resid=%d",
-            cname.c_str (), rid);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK == rc && !vdata_.empty ())
-  {
-    ret_val = true;
-  }
+  const bool ret_val = (find_provision (cname, rid) != 0);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "'%s' : is [%s] with resource id [%d]",
            cname.c_str (),
@@ -326,22 +516,19 @@ tiz_rm_error_t tizrmdb::acquire_resource (
     const unsigned int &grpid, const unsigned int &pri)
 {
   int rc = SQLITE_OK;
-  char query[500];
-  char uuid_str[129];
+  const std::string uuid_s = uuid_str (uuid);
+  const provision *p_prov = 0;
   int current = 0;
-  int requirement = 0;
-
-  tiz_uuid_str (&uuid[0], uuid_str);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::acquire_resource : "
            "'%s': Acquiring [%d] units of resource [%d] "
            "uuid [%s]",
-           cname.c_str (), quantity, rid, uuid_str);
+           cname.c_str (), quantity, rid, uuid_s.c_str ());
 
   // Check that the component is provisioned and is allowed access to the
   // resource
-  if (!comp_provisioned_with_resid (cname, rid))
+  if (!(p_prov = find_provision (cname, rid)))
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "tizrmdb::acquire_resource : "
@@ -350,23 +537,38 @@ tiz_rm_error_t tizrmdb::acquire_resource (
     return TIZ_RM_COMPONENT_NOT_PROVISIONED;
   }
 
-  requirement = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
   // TODO: Replace this with proper error check
-  assert (requirement >= 0);
+  assert (p_prov->requirement >= 0);
+
+  // Units of this resource already held by this component instance count
+  // towards its provisioned requirement
+  const allocation_key_t key (uuid_s, rid);
+  allocation alloc;
+  allocation_map_t::const_iterator it = allocations_.find (key);
+  if (it != allocations_.end ())
+  {
+    alloc = it->second;
+  }
+  else
+  {
+    alloc.quantity = 0;
+  }
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::acquire_resource : "
            "[%s]: provisioned requirement [%d] units, "
-           "actually requested [%d] ...",
-           cname.c_str (), requirement, quantity);
+           "already allocated [%d], actually requested [%d] ...",
+           cname.c_str (), p_prov->requirement, alloc.quantity, quantity);
 
-  if (quantity > (unsigned int) requirement)
+  if ((unsigned int)alloc.quantity > (unsigned int)p_prov->requirement
+      || quantity > (unsigned int)p_prov->requirement
+                        - (unsigned int)alloc.quantity)
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "tizrmdb::acquire_resource : "
-             "[%s]: requested [%d] units, but provisioned "
+             "[%s]: requested [%d] units on top of [%d], but provisioned "
              "only [%d]",
-             cname.c_str (), quantity, requirement);
+             cname.c_str (), quantity, alloc.quantity, p_prov->requirement);
     return TIZ_RM_NOT_ENOUGH_RESOURCE_PROVISIONED;
   }
 
@@ -380,45 +582,34 @@ tiz_rm_error_t tizrmdb::acquire_resource (
     return TIZ_RM_NOT_ENOUGH_RESOURCE_AVAILABLE;
   }
 
-  current = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
+  current = resources_[rid].current;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::acquire_resource: "
            "Resource [%d]: available [%d] units ...",
            rid, current);
 
-  snprintf (query, sizeof(query),
-            "insert or replace into allocation (cname, uuid, grpid, "
-            "pri, resid, allocation) "
-            "values('%s', '%s', %d, %d, %d, %d)",
-            cname.c_str (), uuid_str, grpid, pri, rid, quantity);
+  alloc.cname = cname;
+  alloc.uuid = uuid;
+  alloc.grpid = grpid;
+  alloc.pri = pri;
+  alloc.quantity += quantity;
 
-  rc = run_query (query);
-
-  if (SQLITE_OK != rc)
+  if (SQLITE_OK != (rc = begin_transaction ())
+      || SQLITE_OK != (rc = persist_allocation (key, alloc))
+      || SQLITE_OK != (rc = persist_current (rid, current - quantity))
+      || SQLITE_OK != (rc = commit_transaction ()))
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "tizrmdb::acquire_resource : "
-             "'%s' : Could not update allocation table",
-             cname.c_str ());
+             "'%s' : Could not update the database [%s]",
+             cname.c_str (), sqlite_error_str (rc).c_str ());
+    rollback_transaction ();
     return TIZ_RM_DATABASE_ERROR;
   }
 
-  snprintf (query, sizeof(query),
-            "update resources set current=%d where resid=%d",
-            current - quantity, rid);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK != rc)
-  {
-    TIZ_LOG (TIZ_PRIORITY_TRACE,
-             "tizrmdb::acquire_resource : "
-             "Could not update resource table "
-             "for resource [%s]",
-             rid);
-    return TIZ_RM_DATABASE_ERROR;
-  }
+  allocations_[key] = alloc;
+  resources_[rid].current = current - quantity;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::acquire_resource: "
@@ -434,10 +625,9 @@ tiz_rm_error_t tizrmdb::release_resource (
     const unsigned int &grpid, const unsigned int &pri)
 {
   int rc = SQLITE_OK;
-  char query[500];
-  char uuid_str[129];
-  int current = 0;
-  int requirement = 0;
+  const std::string uuid_s = uuid_str (uuid);
+  const provision *p_prov = 0;
+  int allocated = 0;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::release_resource : "
@@ -446,27 +636,26 @@ tiz_rm_error_t tizrmdb::release_resource (
 
   // Check that the component is provisioned and is allowed to access the
   // resource
-  if (!comp_provisioned_with_resid (cname, rid))
+  if (!(p_prov = find_provision (cname, rid)))
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE, "'%s' is not provisioned...", cname.c_str ());
     return TIZ_RM_COMPONENT_NOT_PROVISIONED;
   }
 
-  requirement = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
   // TODO: Replace this with proper error check
-  assert (requirement >= 0);
+  assert (p_prov->requirement >= 0);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "'%s': provisioned requirement [%d] units, "
            "actually requested [%d] ...",
-           cname.c_str (), requirement, quantity);
+           cname.c_str (), p_prov->requirement, quantity);
 
-  if (quantity > (unsigned int) requirement)
+  if (quantity > (unsigned int)p_prov->requirement)
   {
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "'%s': releasing [%d] units, "
              "but provisioned only [%d]",
-             cname.c_str (), quantity, requirement);
+             cname.c_str (), quantity, p_prov->requirement);
     return TIZ_RM_NOT_ENOUGH_RESOURCE_PROVISIONED;
   }
 
@@ -480,76 +669,49 @@ tiz_rm_error_t tizrmdb::release_resource (
     return TIZ_RM_NOT_ENOUGH_RESOURCE_ACQUIRED;
   }
 
-  current = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE,
-           "Resource [%d]: current allocation [%d] units ...", rid, current);
-
-  tiz_uuid_str (&uuid[0], uuid_str);
-
-  // Update allocation table to reflect the resource release...
-
-  // ... first delete the the row...
-  snprintf (query, sizeof(query),
-            "delete from allocation where "
-            "cname='%s' and uuid='%s' and resid=%d",
-            cname.c_str (), uuid_str, rid);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK != rc)
+  if (!resource_provisioned (rid))
   {
-    TIZ_LOG (TIZ_PRIORITY_TRACE,
-             "'%s' : Could not update allocation "
-             "table ",
-             cname.c_str ());
-    return TIZ_RM_DATABASE_ACCESS_ERROR;
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Resource [%d] not available...", rid);
+    return TIZ_RM_NOT_ENOUGH_RESOURCE_AVAILABLE;
   }
 
-  //... now create a new one, only if there's some resource allocation
-  // remaining
-  if (current - quantity)
-  {
-    // TODO : This string is duplicated. Move to a constant
-    snprintf (query, sizeof(query),
-              "insert or replace into allocation (cname, uuid, grpid, pri, "
-              "resid, allocation) values('%s', '%s', %d, %d, %d, %d)",
-              cname.c_str (), uuid_str, grpid, pri, rid, current - quantity);
-
-    rc = run_query (query);
+  const allocation_key_t key (uuid_s, rid);
+  allocation alloc = allocations_[key];
+  allocated = alloc.quantity;
+  alloc.grpid = grpid;
+  alloc.pri = pri;
+  alloc.quantity = allocated - quantity;
 
-    if (SQLITE_OK != rc)
-    {
-      TIZ_LOG (TIZ_PRIORITY_TRACE, "'%s' : Could not update allocation table",
-               cname.c_str ());
-      return TIZ_RM_DATABASE_ACCESS_ERROR;
-    }
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "Resource [%d]: current allocation [%d] units ...", rid, allocated);
+
+  // Update the allocation table to reflect the resource release (the row
+  // stays only if there's some resource allocation remaining), and then the
+  // resource table.
+  if (SQLITE_OK != (rc = begin_transaction ())
+      || SQLITE_OK
+             != (rc = (alloc.quantity > 0 ? persist_allocation (key, alloc)
+                                          : persist_deallocation (key)))
+      || SQLITE_OK
+             != (rc = persist_current (rid,
+                                       resources_[rid].current + quantity))
+      || SQLITE_OK != (rc = commit_transaction ()))
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "'%s' : Could not update the database [%s]",
+             cname.c_str (), sqlite_error_str (rc).c_str ());
+    rollback_transaction ();
+    return TIZ_RM_DATABASE_ACCESS_ERROR;
   }
 
-  // Now, obtain the current resource availability
-  if (!resource_available (rid, 0))
+  if (alloc.quantity > 0)
   {
-    TIZ_LOG (TIZ_PRIORITY_TRACE, "Resource [%d] not available...", rid);
-    return TIZ_RM_NOT_ENOUGH_RESOURCE_AVAILABLE;
+    allocations_[key] = alloc;
   }
-
-  current = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
-
-  // Now update the resource table...
-  snprintf (query, sizeof(query),
-            "update resources set current=%d where resid=%d",
-            current + quantity, rid);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK != rc)
+  else
   {
-    TIZ_LOG (TIZ_PRIORITY_TRACE,
-             "Could not update resource table "
-             "for resource [%s]",
-             rid);
-    return TIZ_RM_DATABASE_ACCESS_ERROR;
+    allocations_.erase (key);
   }
+  resources_[rid].current += quantity;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "'%s' : Succesfully released [%d] units of "
@@ -563,75 +725,80 @@ tiz_rm_error_t tizrmdb::release_all (const std::string &cname,
                                     const std::vector< unsigned char > &uuid)
 {
   int rc = SQLITE_OK;
-  char query[500];
-  char uuid_str[129];
-  int current = 0;
-  int remaining = 0;
-
-  tiz_uuid_str (&uuid[0], uuid_str);
+  const std::string uuid_s = uuid_str (uuid);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::release_all : Releasing resources for "
            "component with uuid [%s]",
-           uuid_str);
+           uuid_s.c_str ());
 
-  for (int rid = 0; rid < TIZ_RM_RESOURCE_MAX; ++rid)
+  // Entries are ordered by uuid first
+  allocation_map_t::iterator first
+      = allocations_.lower_bound (allocation_key_t (uuid_s, 0));
+  allocation_map_t::iterator last = first;
+  while (last != allocations_.end () && last->first.first == uuid_s)
   {
-    if (resource_acquired (uuid, rid, 0))
-    {
-      const std::string cname = vdata_[0];
-      current = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
-
-      TIZ_LOG (TIZ_PRIORITY_TRACE,
-               "'%s' uuid [%s] : Resource [%d] "
-               "current allocation is "
-               "[%d] units ...",
-               cname.c_str (), uuid_str, rid, current);
-
-      // Update allocation table to reflect the resource release...
-      snprintf (query, sizeof(query),
-                "delete from allocation where "
-                "cname='%s' and uuid='%s' and resid=%d",
-                cname.c_str (), uuid_str, rid);
-
-      rc = run_query (query);
+    ++last;
+  }
 
-      if (SQLITE_OK != rc)
-      {
-        TIZ_LOG (TIZ_PRIORITY_TRACE,
-                 "'%s' : Could not update allocation "
-                 "table ",
-                 cname.c_str ());
-        return TIZ_RM_DATABASE_ACCESS_ERROR;
-      }
+  if (first == last)
+  {
+    return TIZ_RM_SUCCESS;
+  }
 
-      // Now, obtain the current resource availability
-      resource_available (rid, 0);
+  if (SQLITE_OK != (rc = begin_transaction ()))
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not start transaction [%s]",
+             sqlite_error_str (rc).c_str ());
+    return TIZ_RM_DATABASE_ACCESS_ERROR;
+  }
 
-      remaining = strtol (vdata_[vdata_.size () - 1].c_str (), NULL, 0);
+  for (allocation_map_t::iterator it = first; it != last; ++it)
+  {
+    const unsigned int rid = it->first.second;
+    const int current = it->second.quantity;
 
-      // Now update the resource table...
-      snprintf (query, sizeof(query),
-                "update resources set current=%d where resid=%d",
-                remaining + current, rid);
+    TIZ_LOG (TIZ_PRIORITY_TRACE,
+             "'%s' uuid [%s] : Resource [%d] "
+             "current allocation is "
+             "[%d] units ...",
+             it->second.cname.c_str (), uuid_s.c_str (), rid, current);
 
-      rc = run_query (query);
+    if (SQLITE_OK != (rc = persist_deallocation (it->first))
+        || (resource_provisioned (rid)
+            && SQLITE_OK
+                   != (rc = persist_current (
+                           rid, resources_[rid].current + current))))
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE,
+               "'%s' : Could not update the database [%s]",
+               it->second.cname.c_str (), sqlite_error_str (rc).c_str ());
+      rollback_transaction ();
+      return TIZ_RM_DATABASE_ACCESS_ERROR;
+    }
+  }
 
-      if (SQLITE_OK != rc)
-      {
-        TIZ_LOG (TIZ_PRIORITY_TRACE,
-                 "Could not update resource table "
-                 "for resource [%s]",
-                 rid);
-        return TIZ_RM_DATABASE_ACCESS_ERROR;
-      }
+  if (SQLITE_OK != (rc = commit_transaction ()))
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Could not commit transaction [%s]",
+             sqlite_error_str (rc).c_str ());
+    rollback_transaction ();
+    return TIZ_RM_DATABASE_ACCESS_ERROR;
+  }
 
-      TIZ_LOG (TIZ_PRIORITY_TRACE,
-               "'%s':  Released [%d] units of "
-               "resource  id [%d]",
-               cname.c_str (), current, rid);
+  for (allocation_map_t::iterator it = first; it != last; ++it)
+  {
+    const unsigned int rid = it->first.second;
+    if (resource_provisioned (rid))
+    {
+      resources_[rid].current += it->second.quantity;
     }
+    TIZ_LOG (TIZ_PRIORITY_TRACE,
+             "'%s':  Released [%d] units of "
+             "resource  id [%d]",
+             it->second.cname.c_str (), it->second.quantity, rid);
   }
+  allocations_.erase (first, last);
 
   return TIZ_RM_SUCCESS;
 }
@@ -640,9 +807,6 @@ tiz_rm_error_t tizrmdb::find_owners (const unsigned int &rid,
                                     const unsigned int &pri,
                                     tiz_rm_owners_list_t &owners) const
 {
-  int rc = SQLITE_OK;
-  char query[500];
-
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "tizrmdb::find_owners : resource id [%d] "
            "pri > [%d]",
@@ -650,41 +814,23 @@ tiz_rm_error_t tizrmdb::find_owners (const unsigned int &rid,
 
   owners.clear ();
 
-  snprintf (query, sizeof(query),
-            "select * from allocation where resid='%d' and pri>'%d'", rid, pri);
-
-  rc = run_query (query);
-
-  if (SQLITE_OK != rc)
-  {
-    return TIZ_RM_DATABASE_ERROR;
-  }
-
-  int headingsize = vcol_head_.size ();
-  int datasize = vdata_.size ();
-  int num_cols = headingsize ? datasize / headingsize : 0;
-  for (int i = 0; i < num_cols; ++i)
+  for (allocation_map_t::const_iterator it = allocations_.begin ();
+       it != allocations_.end (); ++it)
   {
-    int idx = i * headingsize;
-    std::vector< unsigned char > uuid_vec;
-    OMX_UUIDTYPE uuid_array;
-    tiz_str_uuid (vdata_[idx + 1].data (), &uuid_array);
-
-    uuid_vec.assign (&uuid_array[0], &uuid_array[0] + 128);
-
-    int owner_grpid = strtol (vdata_[idx + 2].c_str (), NULL, 0);
-    int owner_pri = strtol (vdata_[idx + 3].c_str (), NULL, 0);
-    int owner_rid = strtol (vdata_[idx + 4].c_str (), NULL, 0);
-    int owner_quantity = strtol (vdata_[idx + 5].c_str (), NULL, 0);
+    const allocation &alloc = it->second;
+    if (it->first.second != rid || alloc.pri <= pri)
+    {
+      continue;
+    }
 
     TIZ_LOG (TIZ_PRIORITY_TRACE,
              "tizrmdb::find_owners : owner [%s] "
              "uuid [%s] grpid [%d] pri [%d] rid [%d] quantity [%d]",
-             vdata_[idx].c_str (), vdata_[idx + 1].c_str (), owner_grpid,
-             owner_pri, owner_rid, owner_quantity);
+             alloc.cname.c_str (), it->first.first.c_str (), alloc.grpid,
+             alloc.pri, rid, alloc.quantity);
 
-    owners.push_back (tizrmowner (vdata_[idx], uuid_vec, owner_grpid, owner_pri,
-                                  owner_rid, owner_quantity));
+    owners.push_back (tizrmowner (alloc.cname, alloc.uuid, alloc.grpid,
+                                  alloc.pri, rid, alloc.quantity));
   }
 
   // Sort the owners list in ascending priority order, using tizrmowner's
@@ -700,84 +846,6 @@ tiz_rm_error_t tizrmdb::find_owners (const unsigned int &rid,
   return TIZ_RM_SUCCESS;
 }
 
-int tizrmdb::run_query (char const *ap_sql)
-{
-  int rc = SQLITE_OK;
-  char *p_errmsg;
-  char **pp_result;
-  int nrow, ncol;
-
-  BOOST_ASSERT (ap_sql);
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "Running query [%s]", ap_sql);
-
-  vcol_head_.clear ();
-  vdata_.clear ();
-
-  rc = sqlite3_get_table (pdb_, ap_sql, &pp_result, &nrow, &ncol, &p_errmsg);
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "Running query [%s] rc [%d] nrow [%d] ncol [%d]",
-           ap_sql, rc, nrow, ncol);
-
-  if (SQLITE_OK == rc)
-  {
-    for (int i = 0; i < ncol; ++i)
-    {
-      vcol_head_.push_back (pp_result[i]);
-    }
-
-    for (int i = 0; i < ncol * nrow; ++i)
-    {
-      vdata_.push_back (pp_result[ncol + i]);
-    }
-  }
-  else
-  {
-    TIZ_LOG (TIZ_PRIORITY_TRACE, "Query execution failure: [%s] - [%s]",
-             sqlite_error_str (rc).c_str (), p_errmsg);
-  }
-
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "Run query [%s] rc [%d]", ap_sql, rc);
-
-  sqlite3_free_table (pp_result);
-
-  print_query_result ();
-
-  return rc;
-}
-
-int tizrmdb::run_query (char const *ap_sql) const
-{
-  return const_cast< tizrmdb * >(this)->run_query (ap_sql);
-}
-
-void tizrmdb::print_query_result () const
-{
-  TIZ_LOG (TIZ_PRIORITY_TRACE,
-           "tizrmdb::print_query_result : vdata_.size() [%d]"
-           " vcol_head_.size() [%d]",
-           vdata_.size (), vcol_head_.size ());
-
-  if (!vcol_head_.empty ())
-  {
-    int headingsize = vcol_head_.size ();
-    std::stringstream headings;
-    for (int i = 0; i < headingsize; ++i)
-    {
-      headings << "[" << vcol_head_[i] << "] \t\t\t ";
-    }
-    TIZ_LOG (TIZ_PRIORITY_TRACE, "%s", headings.str ().c_str ());
-
-    int datasize = vdata_.size ();
-    std::stringstream data;
-    for (int i = 0; i < datasize; ++i)
-    {
-      data << "[" << vdata_[i] << "] \t\t ";
-    }
-    TIZ_LOG (TIZ_PRIORITY_TRACE, "%s", data.str ().c_str ());
-  }
-}
-
 std::string tizrmdb::sqlite_error_str (int error) const
 {
   switch (error)
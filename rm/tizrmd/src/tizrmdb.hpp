@@ -29,8 +29,12 @@
 #define TIZRMDB_HPP
 
 class sqlite3;
+class sqlite3_stmt;
 
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/utility.hpp>
 
@@ -82,22 +86,76 @@ public:
   bool comp_provisioned_with_resid (const std::string &cname,
                                     const unsigned int &rid) const;
 
+private:
+  // In-memory image of the 'resources' table, indexed by resource id
+  struct resource
+  {
+    resource () : provisioned (false), initial (0), current (0)
+    {
+    }
+    bool provisioned;
+    int initial;
+    int current;
+  };
+
+  // A row of the 'components' table
+  struct provision
+  {
+    unsigned int grpid;
+    unsigned int pri;
+    int requirement;
+  };
+
+  // A row of the 'allocation' table
+  struct allocation
+  {
+    std::string cname;
+    std::vector< unsigned char > uuid;
+    unsigned int grpid;
+    unsigned int pri;
+    int quantity;
+  };
+
+  // (component name, resource id)
+  typedef std::pair< std::string, unsigned int > provision_key_t;
+  typedef std::map< provision_key_t, provision > provision_map_t;
+  // (uuid string, resource id)
+  typedef std::pair< std::string, unsigned int > allocation_key_t;
+  typedef std::map< allocation_key_t, allocation > allocation_map_t;
+
 private:
   int open (char const *ap_dbname);
   int close ();
   int reset_alloc_table ();
-
-  int run_query (char const *ap_sql);
-  int run_query (char const *ap_sql) const;
-
-  void print_query_result () const;
+  int load_tables ();
+  int prepare_statements ();
+  void finalize_statements ();
+
+  int begin_transaction ();
+  int commit_transaction ();
+  void rollback_transaction ();
+  int persist_allocation (const allocation_key_t &key,
+                          const allocation &alloc);
+  int persist_deallocation (const allocation_key_t &key);
+  int persist_current (const unsigned int &rid, const int &current);
+
+  const provision *find_provision (const std::string &cname,
+                                   const unsigned int &rid) const;
+  static std::string uuid_str (const std::vector< unsigned char > &uuid);
   std::string sqlite_error_str (int error) const;
 
 private:
   sqlite3 *pdb_;
   std::string dbname_;
-  mutable std::vector< std::string > vcol_head_;
-  mutable std::vector< std::string > vdata_;
+  sqlite3_stmt *p_begin_stmt_;
+  sqlite3_stmt *p_commit_stmt_;
+  sqlite3_stmt *p_rollback_stmt_;
+  sqlite3_stmt *p_alloc_insert_stmt_;
+  sqlite3_stmt *p_alloc_delete_stmt_;
+  sqlite3_stmt *p_current_update_stmt_;
+  resource resources_[TIZ_RM_RESOURCE_MAX];
+  provision_map_t provisions_;
+  allocation_map_t allocations_;
 };
 
 #endif  // TIZRMDB_HPP